@@ -77,6 +77,27 @@ lr	.req	x30
 	b.eq	\el1_label
 .endm
 
+/*
+ * Branch to \label unless the MMU and data cache are on and alignment
+ * checking is off. Until then all memory is treated as Device memory, on
+ * which unaligned accesses and DC ZVA fault.
+ */
+.macro	branch_if_strict_align, xreg, label
+	switch_el \xreg, 93f, 92f, 91f
+93:
+	mrs	\xreg, sctlr_el3
+	b	90f
+92:
+	mrs	\xreg, sctlr_el2
+	b	90f
+91:
+	mrs	\xreg, sctlr_el1
+90:
+	and	\xreg, \xreg, #(CR_M | CR_A | CR_C)
+	cmp	\xreg, #(CR_M | CR_C)
+	b.ne	\label
+.endm
+
 /*
  * Branch if current processor is a Cortex-A57 core.
  */
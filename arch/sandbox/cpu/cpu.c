@@ -9,11 +9,14 @@
 #include <errno.h>
 #include <linux/libfdt.h>
 #include <os.h>
+#include <worker.h>
 #include <asm/io.h>
 #include <asm/malloc.h>
 #include <asm/setjmp.h>
 #include <asm/state.h>
+#include <asm/test.h>
 #include <dm/root.h>
+#include <test/bench.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -341,3 +344,49 @@ ulong timer_get_boot_us(void)
 
 	return (count - base_count) / 1000;
 }
+
+#if CONFIG_IS_ENABLED(WORKER)
+/* Host threads used to run jobs, indexed by worker ID */
+static void *worker_threads[CONFIG_WORKER_MAX];
+
+/* Number of threads to use for jobs, or -1 if not yet known */
+static int worker_threads_count = -1;
+
+void sandbox_set_worker_count(int count)
+{
+	worker_threads_count = count;
+}
+
+int arch_worker_count(void)
+{
+	if (worker_threads_count < 0)
+		worker_threads_count = os_get_cpu_count() - 1;
+
+	return worker_threads_count;
+}
+
+int arch_worker_start(int id, void (*func)(void *arg), void *arg)
+{
+	if (id >= ARRAY_SIZE(worker_threads))
+		return -ENOSPC;
+
+	return os_thread_start(&worker_threads[id], func, arg);
+}
+
+int arch_worker_wait(int id)
+{
+	int ret;
+
+	ret = os_thread_join(worker_threads[id]);
+	worker_threads[id] = NULL;
+
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_UT_BENCH
+u64 bench_get_cycles(void)
+{
+	return os_get_cycles();
+}
+#endif
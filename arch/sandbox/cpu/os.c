@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -805,3 +806,63 @@ void *os_find_text_base(void)
 
 	return base;
 }
+
+struct os_thread {
+	pthread_t thread;
+	void (*func)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_entry(void *arg)
+{
+	struct os_thread *thr = arg;
+
+	thr->func(thr->arg);
+
+	return NULL;
+}
+
+int os_thread_start(void **threadp, void (*func)(void *arg), void *arg)
+{
+	struct os_thread *thr;
+
+	thr = malloc(sizeof(*thr));
+	if (!thr)
+		return -ENOMEM;
+	thr->func = func;
+	thr->arg = arg;
+	if (pthread_create(&thr->thread, NULL, os_thread_entry, thr)) {
+		free(thr);
+		return -EAGAIN;
+	}
+	*threadp = thr;
+
+	return 0;
+}
+
+int os_thread_join(void *thread)
+{
+	struct os_thread *thr = thread;
+	int ret;
+
+	ret = pthread_join(thr->thread, NULL);
+	free(thr);
+
+	return ret ? -ESRCH : 0;
+}
+
+int os_get_cpu_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? count : 1;
+}
+
+uint64_t os_get_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
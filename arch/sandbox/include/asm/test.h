@@ -244,4 +244,15 @@ uint sandbox_pci_read_bar(u32 barval, int type, uint size);
  */
 void sandbox_set_enable_memio(bool enable);
 
+/**
+ * sandbox_set_worker_count() - Set the number of secondary CPUs for jobs
+ *
+ * Normally sandbox runs jobs passed to worker_run() on one host thread for
+ * each host CPU. This allows tests to use several threads on a host with a
+ * single CPU, or to use none.
+ *
+ * @count: Number of secondary CPUs, or -1 to use one for each host CPU
+ */
+void sandbox_set_worker_count(int count);
+
 #endif
@@ -11,12 +11,75 @@
 #include <irq_func.h>
 #include <lmb.h>
 #include <mapmem.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
+#include <linux/lzo.h>
 #include <linux/sizes.h>
+#include <linux/zstd.h>
 
 /*
  * Image booting support
  */
+
+/* Get the compression of an Image, for algorithms which work in place */
+static int booti_get_comp(const void *buf)
+{
+	u32 magic = get_unaligned_le32(buf);
+
+	if (IS_ENABLED(CONFIG_LZ4) && magic == LZ4F_MAGIC)
+		return IH_COMP_LZ4;
+	if (IS_ENABLED(CONFIG_ZSTD) && magic == ZSTD_MAGICNUMBER)
+		return IH_COMP_ZSTD;
+	if (IS_ENABLED(CONFIG_LZO) && lzop_is_valid_header(buf))
+		return IH_COMP_LZO;
+
+	return IH_COMP_NONE;
+}
+
+/**
+ * booti_decomp() - Decompress an Image in place, if it is compressed
+ *
+ * The compressed data is moved to the end of a region starting at @ld which
+ * is just large enough to hold the Image, then decompressed to @ld. This
+ * avoids needing space for both a compressed and an uncompressed copy.
+ *
+ * booti is only given the address of the Image, so the length of the
+ * compressed data is found from its headers. It must lie in free memory.
+ *
+ * @images: Images information, whose memory map is used to check that the
+ *	region is free
+ * @ld: Address of the Image
+ * @return 0 if OK, -ve on error
+ */
+static int booti_decomp(bootm_headers_t *images, ulong ld)
+{
+	ulong comp_len, load_end;
+	int comp, ret;
+
+	comp = booti_get_comp(map_sysmem(ld, 0));
+	if (comp == IH_COMP_NONE)
+		return 0;
+
+	ret = image_decomp_get_len(comp, ld,
+				   lmb_get_free_size(&images->lmb, ld),
+				   &comp_len);
+	if (ret) {
+		printf("%s: cannot find the end of the Image (err=%d)\n",
+		       genimg_get_comp_name(comp), ret);
+		return ret;
+	}
+	ret = image_decomp_inplace(&images->lmb, comp, ld, ld, IH_TYPE_KERNEL,
+				   comp_len, &load_end);
+	if (ret) {
+		printf("%s: uncompress error %d\n", genimg_get_comp_name(comp),
+		       ret);
+		return ret;
+	}
+	debug("Image decompressed to 0x%lx-0x%lx\n", ld, load_end);
+
+	return 0;
+}
+
 static int booti_start(cmd_tbl_t *cmdtp, int flag, int argc,
 			char * const argv[], bootm_headers_t *images)
 {
@@ -38,6 +101,10 @@ static int booti_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		debug("*  kernel: cmdline image address = 0x%08lx\n", ld);
 	}
 
+	ret = booti_decomp(images, ld);
+	if (ret)
+		return 1;
+
 	ret = booti_setup(ld, &relocated_addr, &image_size, false);
 	if (ret != 0)
 		return 1;
@@ -104,6 +171,10 @@ static char booti_help_text[] =
 	"\tThe argument 'initrd' is optional and specifies the address\n"
 	"\tof an initrd in memory. The optional parameter ':size' allows\n"
 	"\tspecifying the size of a RAW initrd.\n"
+	"\tThe Image may be compressed with lz4, lzo or zstd. Its size is\n"
+	"\tthen read from the headers of the compressed data and it is\n"
+	"\tdecompressed in place, needing little more memory than the\n"
+	"\tuncompressed Image. A zstd Image must be a single frame.\n"
 #if defined(CONFIG_OF_LIBFDT)
 	"\tSince booting a Linux kernel requires a flat device-tree, a\n"
 	"\tthird argument providing the address of the device-tree blob\n"
@@ -15,6 +15,7 @@
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
 #include <fdt_support.h>
+#include <fdtdec.h>
 #include <mapmem.h>
 #include <asm/io.h>
 #include <asm/unaligned.h>
@@ -181,6 +182,7 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 				}
 			}
 		}
+		fdtdec_index_invalidate(blob);
 
 		return CMD_RET_SUCCESS;
 	}
@@ -192,6 +194,8 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			"Aborting!\n");
 		return CMD_RET_FAILURE;
 	}
+	/* Most subcommands change the blob, possibly without resizing it */
+	fdtdec_index_invalidate(working_fdt);
 
 	/*
 	 * Move the working_fdt
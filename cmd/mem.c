@@ -19,7 +19,9 @@
 #include <flash.h>
 #include <hash.h>
 #include <mapmem.h>
+#include <mem_parallel.h>
 #include <watchdog.h>
+#include <worker.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
 
@@ -801,14 +803,11 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 	return errs;
 }
 
-static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
-			    vu_long pattern, int iteration)
+/* Work out the pattern for an iteration, returning the increment to use */
+static long mem_test_pattern(ulong *patternp, int iteration)
 {
-	vu_long *end;
-	vu_long *addr;
-	ulong errs = 0;
-	ulong incr, length;
-	ulong val, readback;
+	ulong pattern = *patternp;
+	long incr;
 
 	/* Alternate the pattern */
 	incr = 1;
@@ -825,6 +824,21 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 		else
 			pattern = ~pattern;
 	}
+	*patternp = pattern;
+
+	return incr;
+}
+
+static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
+			    ulong pattern, int iteration)
+{
+	vu_long *end;
+	vu_long *addr;
+	ulong errs = 0;
+	ulong incr, length;
+	ulong val, readback;
+
+	incr = mem_test_pattern(&pattern, iteration);
 	length = (end_addr - start_addr) / sizeof(ulong);
 	end = buf + length;
 	printf("\rPattern %08lX  Writing..."
@@ -860,6 +874,39 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 	return errs;
 }
 
+/* The same as mem_test_quick(), but with each CPU testing part of memory */
+static ulong mem_test_parallel(struct mem_parallel *par, ulong pattern,
+			       int iteration)
+{
+	ulong errs;
+	long incr;
+	int i;
+
+	incr = mem_test_pattern(&pattern, iteration);
+	printf("\rPattern %08lX  Writing..."
+		"%12s"
+		"\b\b\b\b\b\b\b\b\b\b",
+		pattern, "");
+	if (mem_parallel_fill(par, pattern, incr))
+		return -1;
+
+	puts("Reading...");
+	errs = mem_parallel_check(par);
+	if (errs == -1UL)
+		return errs;
+	for (i = 0; i < par->count; i++) {
+		struct mem_parallel_part *part = &par->parts[i];
+
+		if (part->errs) {
+			printf("\nMem error @ 0x%08lX: found %08lX, expected %08lX (CPU %d: %lu errors)\n",
+			       part->err_addr, part->err_actual,
+			       part->err_expect, i, part->errs);
+		}
+	}
+
+	return errs;
+}
+
 /*
  * Perform a memory test. A more complete alternative test can be
  * configured using CONFIG_SYS_ALT_MEMTEST. The complete test loops until
@@ -875,6 +922,8 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 	ulong errs = 0;	/* number of errors, or -1 if interrupted */
 	ulong pattern = 0;
 	int iteration;
+	struct mem_parallel par;
+	bool parallel = false;
 #if defined(CONFIG_SYS_ALT_MEMTEST)
 	const int alt_test = 1;
 #else
@@ -911,6 +960,10 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 
 	buf = map_sysmem(start, end - start);
 	dummy = map_sysmem(CONFIG_SYS_MEMTEST_SCRATCH, sizeof(vu_long));
+	if (CONFIG_IS_ENABLED(WORKER) && !alt_test && worker_count() > 1) {
+		mem_parallel_split(&par, start, (void *)buf, end - start);
+		parallel = true;
+	}
 	for (iteration = 0;
 			!iteration_limit || iteration < iteration_limit;
 			iteration++) {
@@ -923,6 +976,8 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 		debug("\n");
 		if (alt_test) {
 			errs = mem_test_alt(buf, start, end, dummy);
+		} else if (parallel) {
+			errs = mem_test_parallel(&par, pattern, iteration);
 		} else {
 			errs = mem_test_quick(buf, start, end, pattern,
 					      iteration);
@@ -949,6 +1004,8 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 		putc('\n');
 		ret = 1;
 	} else {
+		if (parallel)
+			mem_parallel_show(&par);
 		printf("Tested %d iteration(s) with %lu errors.\n",
 			iteration, errs);
 		ret = errs != 0;
@@ -958,6 +1015,36 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 }
 #endif	/* CONFIG_CMD_MEMTEST */
 
+#ifdef CONFIG_CMD_MZERO
+static int do_mem_mzero(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	struct mem_parallel par;
+	ulong addr, size;
+	void *buf;
+	int ret;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+
+	buf = map_sysmem(addr, size);
+	mem_parallel_split(&par, addr, buf, size);
+	ret = mem_parallel_zero(&par);
+	unmap_sysmem(buf);
+	if (ret) {
+		printf("Zeroing %s\n",
+		       ret == -EINTR ? "interrupted" : "failed");
+		return CMD_RET_FAILURE;
+	}
+	mem_parallel_show(&par);
+
+	return 0;
+}
+#endif	/* CONFIG_CMD_MZERO */
+
 /* Modify memory.
  *
  * Syntax:
@@ -1270,6 +1357,15 @@ U_BOOT_CMD(
 );
 #endif	/* CONFIG_CMD_MEMTEST */
 
+#ifdef CONFIG_CMD_MZERO
+U_BOOT_CMD(
+	mzero,	3,	0,	do_mem_mzero,
+	"zero memory, sharing it out between CPUs (sandbox threads)",
+	"address size\n"
+	"    - zero 'size' bytes at 'address' and show the bandwidth"
+);
+#endif	/* CONFIG_CMD_MZERO */
+
 #ifdef CONFIG_CMD_MX_CYCLIC
 U_BOOT_CMD(
 	mdc,	4,	1,	do_mem_mdc,
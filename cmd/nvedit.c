@@ -28,6 +28,7 @@
 #include <command.h>
 #include <console.h>
 #include <env.h>
+#include <env_bin.h>
 #include <env_internal.h>
 #include <search.h>
 #include <errno.h>
@@ -698,6 +699,102 @@ char *from_env(const char *envvar)
 	return ret;
 }
 
+/* Copy out the value of a variable found by env_get_f() */
+static int env_get_f_copy(const char *name, int val, char *buf,
+			  unsigned int len)
+{
+	int n, c;
+
+	for (n = 0; n < len; ++n, ++buf) {
+		c = env_get_char(val++);
+		if (c < 0)
+			return c;
+		*buf = c;
+		if (*buf == '\0')
+			return n;
+	}
+
+	if (n)
+		*--buf = '\0';
+
+	printf("env_buf [%u bytes] too small for value of \"%s\"\n",
+	       len, name);
+
+	return n;
+}
+
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+/* Read @size bytes of the environment at @index, one character at a time */
+static int env_get_f_read(int index, void *buf, int size)
+{
+	u8 *p = buf;
+	int c;
+
+	while (size--) {
+		c = env_get_char(index++);
+		if (c < 0)
+			return c;
+		*p++ = c;
+	}
+
+	return 0;
+}
+
+/*
+ * Look up a variable in an environment in the binary format. The last
+ * record for the variable wins, as when the environment is imported.
+ */
+static int env_get_f_bin(const char *name, char *buf, unsigned int len)
+{
+	uint name_len = strlen(name);
+	struct env_bin_hdr hdr;
+	struct env_bin_rec rec;
+	uint pos, end, i, n;
+	int val = -1;
+	int c, ret;
+
+	ret = env_get_f_read(0, &hdr, sizeof(hdr));
+	if (ret)
+		return ret;
+	if (hdr.version != ENV_BIN_VERSION || hdr.hdr_size < sizeof(hdr) ||
+	    hdr.hdr_size > ENV_SIZE || hdr.size > ENV_SIZE - hdr.hdr_size)
+		return -1;
+
+	pos = hdr.hdr_size;
+	end = pos + hdr.size;
+	for (i = 0; i < hdr.count; i++) {
+		if (end - pos < sizeof(rec))
+			return -1;
+		ret = env_get_f_read(pos, &rec, sizeof(rec));
+		if (ret)
+			return ret;
+		pos += sizeof(rec);
+		if (rec.name_len >= end - pos ||
+		    rec.value_len >= end - pos - rec.name_len - 1)
+			return -1;
+
+		if (rec.name_len == name_len) {
+			for (n = 0; n < name_len; n++) {
+				c = env_get_char(pos + n);
+				if (c < 0)
+					return c;
+				if (c != name[n])
+					break;
+			}
+			if (n == name_len)
+				val = rec.flags & ENV_BIN_DELETE ? -1 :
+					pos + name_len + 1;
+		}
+		pos += env_bin_rec_size(rec.name_len, rec.value_len) -
+			sizeof(rec);
+	}
+	if (val < 0)
+		return -1;
+
+	return env_get_f_copy(name, val, buf, len);
+}
+#endif
+
 /*
  * Look up variable from environment for restricted C runtime env.
  */
@@ -705,8 +802,18 @@ int env_get_f(const char *name, char *buf, unsigned len)
 {
 	int i, nxt, c;
 
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+	u32 magic;
+
+	/* The default environment is always text */
+	if (gd->env_valid != ENV_INVALID &&
+	    !env_get_f_read(0, &magic, sizeof(magic)) &&
+	    magic == ENV_BIN_MAGIC)
+		return env_get_f_bin(name, buf, len);
+#endif
+
 	for (i = 0; env_get_char(i) != '\0'; i = nxt + 1) {
-		int val, n;
+		int val;
 
 		for (nxt = i; (c = env_get_char(nxt)) != '\0'; ++nxt) {
 			if (c < 0)
@@ -720,22 +827,7 @@ int env_get_f(const char *name, char *buf, unsigned len)
 			continue;
 
 		/* found; copy out */
-		for (n = 0; n < len; ++n, ++buf) {
-			c = env_get_char(val++);
-			if (c < 0)
-				return c;
-			*buf = c;
-			if (*buf == '\0')
-				return n;
-		}
-
-		if (n)
-			*--buf = '\0';
-
-		printf("env_buf [%u bytes] too small for value of \"%s\"\n",
-		       len, name);
-
-		return n;
+		return env_get_f_copy(name, val, buf, len);
 	}
 
 	return -1;
@@ -228,15 +228,13 @@ do_imgextract(cmd_tbl_t * cmdtp, int flag, int argc, char * const argv[])
 
 				printf("   Uncompressing part %d ... ", part);
 				/*
-				 * If we've got less than 4 MB of malloc()
-				 * space, use slower decompression algorithm
-				 * which requires at most 2300 KB of memory.
+				 * This falls back to the slower algorithm,
+				 * which requires at most 2300 KB of memory,
+				 * if malloc() space runs short.
 				 */
 				i = BZ2_bzBuffToBuffDecompress(
 					map_sysmem(ntohl(hdr->ih_load), 0),
-					&unc_len, (char *)data, len,
-					CONFIG_SYS_MALLOC_LEN < (4096 * 1024),
-					0);
+					&unc_len, (char *)data, len, 0, 0);
 				if (i != BZ_OK) {
 					printf("BUNZIP2 ERROR %d - "
 						"image not loaded\n", i);
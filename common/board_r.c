@@ -11,6 +11,7 @@
 
 #include <common.h>
 #include <api.h>
+#include <bouncebuf.h>
 #include <cpu_func.h>
 #include <exports.h>
 #include <hang.h>
@@ -331,8 +332,24 @@ static int initr_dm_devices(void)
 			return ret;
 	}
 
+	if (IS_ENABLED(CONFIG_DM_ASYNC_PROBE)) {
+		ret = dm_probe_async_start();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_DM_ASYNC_PROBE
+static int initr_dm_probe_async(void)
+{
+	/* A device which failed to probe has been reported; boot without it */
+	dm_probe_async_finish();
+
 	return 0;
 }
+#endif
 
 static int initr_bootstage(void)
 {
@@ -694,6 +711,9 @@ static init_fnc_t init_sequence_r[] = {
 	log_init,
 	initr_bootstage,	/* Needs malloc() but has its own timer */
 	initr_console_record,
+#if CONFIG_IS_ENABLED(BOUNCE_BUFFER_POOL)
+	bounce_buffer_init,
+#endif
 #ifdef CONFIG_SYS_NONCACHED_MEMORY
 	initr_noncached,
 #endif
@@ -867,6 +887,9 @@ static init_fnc_t init_sequence_r[] = {
 #endif
 #if defined(CONFIG_M68K) && defined(CONFIG_BLOCK_CACHE)
 	blkcache_init,
+#endif
+#ifdef CONFIG_DM_ASYNC_PROBE
+	initr_dm_probe_async,
 #endif
 	run_main_loop,
 };
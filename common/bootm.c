@@ -60,9 +60,18 @@ static void boot_start_lmb(bootm_headers_t *images)
 	lmb_init_and_reserve_range(&images->lmb, (phys_addr_t)mem_start,
 				   mem_size, NULL);
 }
+
+static struct lmb *bootm_get_lmb(bootm_headers_t *images)
+{
+	return &images->lmb;
+}
 #else
 #define lmb_reserve(lmb, base, size)
 static inline void boot_start_lmb(bootm_headers_t *images) { }
+static inline struct lmb *bootm_get_lmb(bootm_headers_t *images)
+{
+	return NULL;
+}
 #endif
 
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -220,6 +229,47 @@ static int bootm_find_os(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
+/*
+ * Copy the ramdisk straight to the place boot_ramdisk_high() would pick,
+ * rather than leaving it to be copied again once the OS is loaded. The
+ * place must be clear of the images which are still to be used and of the
+ * most that the OS can take up once loaded. If there is no such place, the
+ * ramdisk is left for boot_ramdisk_high() as before.
+ */
+static void bootm_place_ramdisk(void)
+{
+	ulong rd_len = images.rd_end - images.rd_start;
+	struct lmb lmb = images.lmb;
+	ulong os_len, start;
+
+	if (!images.rd_start || !boot_ramdisk_relocates())
+		return;
+
+	os_len = images.os.comp == IH_COMP_NONE ? images.os.image_len :
+		CONFIG_SYS_BOOTM_LEN;
+	if (images.os.end > images.os.start &&
+	    lmb_reserve(&lmb, images.os.start,
+			images.os.end - images.os.start) < 0)
+		return;
+	if (os_len && lmb_reserve(&lmb, images.os.load, os_len) < 0)
+		return;
+#if IMAGE_ENABLE_OF_LIBFDT
+	if (images.ft_len &&
+	    lmb_reserve(&lmb, map_to_sysmem(images.ft_addr),
+			images.ft_len) < 0)
+		return;
+#endif
+	if (boot_ramdisk_alloc(&lmb, images.rd_start, rd_len, &start))
+		return;
+
+	lmb_reserve(&images.lmb, start, rd_len);
+	boot_ramdisk_copy(start, images.rd_start, rd_len);
+	images.initrd_start = start;
+	images.initrd_end = start + rd_len;
+}
+#endif
+
 /**
  * bootm_find_images - wrapper to find and locate various images
  * @flag: Ignored Argument
@@ -280,6 +330,10 @@ int bootm_find_images(int flag, int argc, char * const argv[])
 	}
 #endif
 
+#ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
+	bootm_place_ramdisk();
+#endif
+
 	return 0;
 }
 
@@ -338,6 +392,49 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size, int ret)
 #endif
 
 #ifndef USE_HOSTCC
+#ifdef CONFIG_LMB
+/**
+ * bootm_use_inplace() - Check whether to decompress the OS in place
+ *
+ * This is needed if the compressed image is inside the region it would be
+ * decompressed into. The memory map decides whether it is possible: the
+ * rest of the FIT or legacy image is reserved in a copy of it, so that only
+ * the compressed data itself may be overwritten, along with a legacy header
+ * since that has been copied. Anything else already reserved, such as
+ * U-Boot itself, must not be in the way either.
+ *
+ * @images: Images information
+ * @return true to decompress in place
+ */
+static bool bootm_use_inplace(bootm_headers_t *images)
+{
+	image_info_t *os = &images->os;
+	ulong image_end = os->image_start + os->image_len;
+	struct lmb lmb;
+	ulong src, end;
+
+	if (os->comp == IH_COMP_NONE ||
+	    image_decomp_inplace_layout(os->comp, os->load, os->image_start,
+					os->image_len, &src, &end))
+		return false;
+	if (os->load >= image_end || end <= os->image_start)
+		return false;
+
+	lmb = images->lmb;
+	if (!images->legacy_hdr_valid && os->image_start > os->start)
+		lmb_reserve(&lmb, os->start, os->image_start - os->start);
+	if (os->end > image_end)
+		lmb_reserve(&lmb, image_end, os->end - image_end);
+
+	return lmb_get_free_size(&lmb, os->load) >= end - os->load;
+}
+#else
+static inline bool bootm_use_inplace(bootm_headers_t *images)
+{
+	return false;
+}
+#endif
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -348,15 +445,25 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	ulong image_start = os.image_start;
 	ulong image_len = os.image_len;
 	ulong flush_start = ALIGN_DOWN(load, ARCH_DMA_MINALIGN);
-	bool no_overlap;
+	bool no_overlap, inplace;
 	void *load_buf, *image_buf;
 	int err;
 
-	load_buf = map_sysmem(load, 0);
-	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	inplace = bootm_use_inplace(images);
+	if (inplace) {
+		err = image_decomp_inplace(bootm_get_lmb(images), os.comp,
+					   load, image_start, os.type,
+					   image_len, &load_end);
+		/* Nothing has been changed if the region is not free */
+		if (err == -EBUSY)
+			return err;
+	} else {
+		load_buf = map_sysmem(load, 0);
+		image_buf = map_sysmem(os.image_start, image_len);
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load, err);
 		bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
@@ -368,7 +475,8 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, load_end);
 	bootstage_mark(BOOTSTAGE_ID_KERNEL_LOADED);
 
-	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
+	no_overlap = inplace ||
+		(os.comp == IH_COMP_NONE && load == image_start);
 
 	if (!no_overlap && load < blob_end && load_end > blob_start) {
 		debug("images.os.start = 0x%lX, images.os.end = 0x%lx\n",
@@ -555,8 +663,11 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	if (!ret && (states & BOOTM_STATE_RAMDISK)) {
 		ulong rd_len = images->rd_end - images->rd_start;
 
-		ret = boot_ramdisk_high(&images->lmb, images->rd_start,
-			rd_len, &images->initrd_start, &images->initrd_end);
+		/* bootm_place_ramdisk() may have put it in place already */
+		if (!images->initrd_start)
+			ret = boot_ramdisk_high(&images->lmb, images->rd_start,
+				rd_len, &images->initrd_start,
+				&images->initrd_end);
 		if (!ret) {
 			env_set_hex("initrd_start", images->initrd_start);
 			env_set_hex("initrd_end", images->initrd_end);
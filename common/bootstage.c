@@ -29,6 +29,7 @@ struct bootstage_record {
 	const char *name;
 	int flags;		/* see enum bootstage_flags */
 	enum bootstage_id id;
+	ulong bytes;		/* bytes handled, or 0 if not counted */
 };
 
 struct bootstage_data {
@@ -38,7 +39,7 @@ struct bootstage_data {
 };
 
 enum {
-	BOOTSTAGE_VERSION	= 0,
+	BOOTSTAGE_VERSION	= 1,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
 };
@@ -215,6 +216,15 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+void bootstage_add_bytes(enum bootstage_id id, ulong bytes)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec = ensure_id(data, id);
+
+	if (rec)
+		rec->bytes += bytes;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -247,7 +257,10 @@ static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
 		print_grouped_ull(rec->time_us, BOOTSTAGE_DIGITS);
 		print_grouped_ull(rec->time_us - prev, BOOTSTAGE_DIGITS);
 	}
-	printf("  %s\n", get_record_name(buf, sizeof(buf), rec));
+	printf("  %s", get_record_name(buf, sizeof(buf), rec));
+	if (rec->bytes)
+		printf(" (%lu bytes)", rec->bytes);
+	printf("\n");
 
 	return rec->time_us;
 }
@@ -310,6 +323,9 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 				rec->start_us ? "accum" : "mark",
 				rec->time_us))
 			return -EINVAL;
+		if (rec->bytes &&
+		    fdt_setprop_cell(blob, node, "bytes", rec->bytes))
+			return -EINVAL;
 	}
 
 	return 0;
@@ -11,6 +11,138 @@
 #include <errno.h>
 #include <bouncebuf.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(BOUNCE_BUFFER_POOL)
+/* Size of the smallest buffers in the pool, as a power of two */
+#define BB_POOL_MIN_SHIFT	12
+
+struct bb_pool_slot {
+	void *buf;
+	bool busy;
+};
+
+static struct bb_pool_slot bb_pool[CONFIG_BOUNCE_BUFFER_POOL_CLASSES]
+				  [CONFIG_BOUNCE_BUFFER_POOL_SLOTS];
+#endif
+
+static struct bounce_buffer_stats bb_stats;
+
+#if CONFIG_IS_ENABLED(BOUNCE_BUFFER_POOL)
+int bounce_buffer_init(void)
+{
+	ulong size, total;
+	int class, i;
+	void *buf;
+
+	/* Each size is twice the one before, so they add up to one less */
+	size = 1UL << (BB_POOL_MIN_SHIFT + CONFIG_BOUNCE_BUFFER_POOL_CLASSES);
+	total = (size - (1UL << BB_POOL_MIN_SHIFT)) *
+		CONFIG_BOUNCE_BUFFER_POOL_SLOTS;
+	buf = memalign(ARCH_DMA_MINALIGN, total);
+	if (!buf) {
+		/* Carry on without the pool, using malloc() for each buffer */
+		debug("%s: No memory for %lu bytes\n", __func__, total);
+		return 0;
+	}
+
+	for (class = 0; class < CONFIG_BOUNCE_BUFFER_POOL_CLASSES; class++) {
+		size = 1UL << (BB_POOL_MIN_SHIFT + class);
+		for (i = 0; i < CONFIG_BOUNCE_BUFFER_POOL_SLOTS; i++) {
+			bb_pool[class][i].buf = buf;
+			buf += size;
+		}
+	}
+	bb_stats.pool_size = total;
+
+	return 0;
+}
+#endif
+
+/* The pool and statistics are in BSS, which is not usable until relocation */
+static bool bb_relocated(void)
+{
+	return !IS_ENABLED(CONFIG_SPL_BUILD) && (gd->flags & GD_FLG_RELOC);
+}
+
+/* Take a buffer of at least @len bytes from the pool, or return NULL */
+static void *bb_pool_get(size_t len)
+{
+#if CONFIG_IS_ENABLED(BOUNCE_BUFFER_POOL)
+	struct bb_pool_slot *slot;
+	ulong size;
+	int class, i;
+
+	if (!bb_relocated() || !bb_stats.pool_size)
+		return NULL;
+	for (class = 0; class < CONFIG_BOUNCE_BUFFER_POOL_CLASSES; class++) {
+		size = 1UL << (BB_POOL_MIN_SHIFT + class);
+		if (len <= size)
+			break;
+	}
+	if (class == CONFIG_BOUNCE_BUFFER_POOL_CLASSES)
+		return NULL;
+
+	for (i = 0; i < CONFIG_BOUNCE_BUFFER_POOL_SLOTS; i++) {
+		slot = &bb_pool[class][i];
+		if (slot->busy)
+			continue;
+		bb_stats.pool_hits++;
+		slot->busy = true;
+
+		return slot->buf;
+	}
+#endif
+
+	return NULL;
+}
+
+/* Give a buffer back to the pool, returning false if it is not from there */
+static bool bb_pool_put(void *buf)
+{
+#if CONFIG_IS_ENABLED(BOUNCE_BUFFER_POOL)
+	int class, i;
+
+	for (class = 0; class < CONFIG_BOUNCE_BUFFER_POOL_CLASSES; class++) {
+		for (i = 0; i < CONFIG_BOUNCE_BUFFER_POOL_SLOTS; i++) {
+			struct bb_pool_slot *slot = &bb_pool[class][i];
+
+			if (slot->busy && slot->buf == buf) {
+				slot->busy = false;
+				return true;
+			}
+		}
+	}
+#endif
+
+	return false;
+}
+
+void *bounce_buffer_alloc(size_t len)
+{
+	void *buf;
+
+	len = roundup(len, ARCH_DMA_MINALIGN);
+	buf = bb_pool_get(len);
+	if (buf)
+		return buf;
+	if (bb_relocated())
+		bb_stats.pool_misses++;
+
+	return memalign(ARCH_DMA_MINALIGN, len);
+}
+
+void bounce_buffer_free(void *buf)
+{
+	if (buf && !bb_pool_put(buf))
+		free(buf);
+}
+
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats)
+{
+	*stats = bb_stats;
+}
+
 static int addr_aligned(struct bounce_buffer *state)
 {
 	const ulong align_mask = ARCH_DMA_MINALIGN - 1;
@@ -40,15 +172,21 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 	state->len_aligned = roundup(len, ARCH_DMA_MINALIGN);
 	state->flags = flags;
 
+	if (bb_relocated())
+		bb_stats.starts++;
 	if (!addr_aligned(state)) {
-		state->bounce_buffer = memalign(ARCH_DMA_MINALIGN,
-						state->len_aligned);
+		state->bounce_buffer = bounce_buffer_alloc(state->len_aligned);
 		if (!state->bounce_buffer)
 			return -ENOMEM;
 
-		if (state->flags & GEN_BB_READ)
+		if (state->flags & GEN_BB_READ) {
 			memcpy(state->bounce_buffer, state->user_buffer,
 				state->len);
+			if (bb_relocated())
+				bb_stats.copied += state->len;
+		}
+	} else if (bb_relocated()) {
+		bb_stats.direct++;
 	}
 
 	/*
@@ -74,10 +212,13 @@ int bounce_buffer_stop(struct bounce_buffer *state)
 	if (state->bounce_buffer == state->user_buffer)
 		return 0;
 
-	if (state->flags & GEN_BB_WRITE)
+	if (state->flags & GEN_BB_WRITE) {
 		memcpy(state->user_buffer, state->bounce_buffer, state->len);
+		if (bb_relocated())
+			bb_stats.copied += state->len;
+	}
 
-	free(state->bounce_buffer);
+	bounce_buffer_free(state->bounce_buffer);
 
 	return 0;
 }
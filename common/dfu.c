@@ -34,6 +34,7 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 		pr_err("g_dnl_register failed");
 		return CMD_RET_FAILURE;
 	}
+	dfu_set_write_deferred(true);
 
 #ifdef CONFIG_DFU_TIMEOUT
 	unsigned long start_time = get_timer(0);
@@ -98,8 +99,16 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
+
+		/*
+		 * Write a filled DFU buffer half outside of the USB request
+		 * completion, so that the controller can already accept the
+		 * next block meanwhile.
+		 */
+		dfu_write_pending();
 	}
 exit:
+	dfu_set_write_deferred(false);
 	g_dnl_unregister();
 	usb_gadget_release(usbctrl_index);
 
@@ -17,6 +17,8 @@
 #include <fdt_support.h>
 #include <exports.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <sort.h>
 
 /**
  * fdt_getprop_u32_default_node - Return a node's property or a default
@@ -72,6 +74,408 @@ u32 fdt_getprop_u32_default(const void *fdt, const char *path,
 	return fdt_getprop_u32_default_node(fdt, off, 0, prop, dflt);
 }
 
+#if CONFIG_IS_ENABLED(OF_FIXUP_BATCH)
+/**
+ * struct fdt_batch_edit - A property value waiting to be written
+ *
+ * @node: Offset of the node holding the property
+ * @len: Length of the new value
+ * @name: Property name, followed in the same allocation by the value
+ * @val: New value
+ * @pos: Offset in the structure block at which the property is written
+ * @old_size: Size of the existing property record, 0 if it is new
+ * @nameoff: Offset of the property name in the strings block
+ */
+struct fdt_batch_edit {
+	int node;
+	int len;
+	char *name;
+	void *val;
+	int pos;
+	int old_size;
+	int nameoff;
+};
+
+/**
+ * struct fdt_batch - Property edits recorded by fdt_batch_setprop()
+ *
+ * @fdt: Blob being edited
+ * @depth: Number of fdt_batch_begin() calls without a matching
+ *	fdt_batch_end()
+ * @edit: Recorded edits, in the order they were first made
+ * @count: Number of edits recorded
+ * @max: Number of edits there is space for
+ * @err: First error found while applying edits, reported by fdt_batch_end()
+ */
+struct fdt_batch {
+	void *fdt;
+	int depth;
+	struct fdt_batch_edit *edit;
+	int count;
+	int max;
+	int err;
+};
+
+static struct fdt_batch fdt_batch;
+
+int fdt_batch_begin(void *fdt)
+{
+	struct fdt_batch *batch = &fdt_batch;
+
+	int ret;
+
+	if (batch->depth) {
+		if (batch->fdt != fdt)
+			return -FDT_ERR_BADSTATE;
+		batch->depth++;
+		return 0;
+	}
+
+	/* Put the blocks in the usual order so they can be resized */
+	ret = fdt_check_header(fdt);
+	if (!ret && (fdt_version(fdt) < 17 ||
+		     fdt_off_mem_rsvmap(fdt) > fdt_off_dt_struct(fdt) ||
+		     fdt_off_dt_strings(fdt) != fdt_off_dt_struct(fdt) +
+						fdt_size_dt_struct(fdt)))
+		ret = fdt_open_into(fdt, fdt, fdt_totalsize(fdt));
+	if (ret)
+		return ret;
+	batch->fdt = fdt;
+	batch->depth = 1;
+
+	return 0;
+}
+
+/* Find a string in the strings block which @s matches or is a suffix of */
+static int fdt_batch_find_string(const char *strtab, int size, const char *s)
+{
+	int len = strlen(s) + 1;
+	const char *p;
+
+	for (p = strtab; p <= strtab + size - len; p++) {
+		if (!memcmp(p, s, len))
+			return p - strtab;
+	}
+
+	return -1;
+}
+
+/* Write a property record to @buf and return its size */
+static int fdt_batch_put_prop(void *buf, struct fdt_batch_edit *edit)
+{
+	struct fdt_property *prop = buf;
+	int size = sizeof(*prop) + ALIGN(edit->len, FDT_TAGSIZE);
+
+	prop->tag = cpu_to_fdt32(FDT_PROP);
+	prop->len = cpu_to_fdt32(edit->len);
+	prop->nameoff = cpu_to_fdt32(edit->nameoff);
+	memcpy(prop->data, edit->val, edit->len);
+	memset(prop->data + edit->len, '\0', size - sizeof(*prop) - edit->len);
+
+	return size;
+}
+
+/*
+ * Order edits by position. fdt_setprop() adds a new property before all
+ * others in its node, so new properties at the same position go in reverse
+ * order, ahead of the existing property they are inserted before.
+ */
+static int fdt_batch_cmp(const void *a, const void *b)
+{
+	const struct fdt_batch_edit *ea = *(const struct fdt_batch_edit **)a;
+	const struct fdt_batch_edit *eb = *(const struct fdt_batch_edit **)b;
+
+	if (ea->pos != eb->pos)
+		return ea->pos - eb->pos;
+	if (!ea->old_size != !eb->old_size)
+		return ea->old_size ? 1 : -1;
+
+	return eb - ea;
+}
+
+/*
+ * Write a property directly. Nodes after @nodeoffset move by the change in
+ * size, so update the recorded edits and @offsetp to match.
+ */
+static int fdt_batch_setprop_now(struct fdt_batch *batch, int nodeoffset,
+				 const char *name, const void *val, int len,
+				 int *offsetp)
+{
+	void *fdt = batch->fdt;
+	int old_size = fdt_size_dt_struct(fdt);
+	int ret, delta, i;
+
+	ret = fdt_setprop(fdt, nodeoffset, name, val, len);
+	if (ret)
+		return ret;
+
+	delta = fdt_size_dt_struct(fdt) - old_size;
+	for (i = 0; i < batch->count; i++) {
+		if (batch->edit[i].node > nodeoffset)
+			batch->edit[i].node += delta;
+	}
+	if (offsetp && *offsetp > nodeoffset)
+		*offsetp += delta;
+
+	return 0;
+}
+
+/* Apply the edits one at a time, when there is no memory for a single pass */
+static int fdt_batch_apply_each(struct fdt_batch *batch, int *offsetp)
+{
+	int ret;
+	int i;
+
+	for (i = 0; i < batch->count; i++) {
+		struct fdt_batch_edit *edit = &batch->edit[i];
+
+		ret = fdt_batch_setprop_now(batch, edit->node, edit->name,
+					    edit->val, edit->len, offsetp);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * fdt_batch_apply() - Write all recorded edits with a single rewrite
+ *
+ * This works out where each property goes and how much the structure and
+ * strings blocks grow, moves the strings block once, then writes the new
+ * structure block in one pass. The result is the same as calling
+ * fdt_setprop() for each edit in turn.
+ *
+ * @batch: Batch to apply
+ * @offsetp: If not NULL, the offset of a node, which is updated to allow
+ *	for the edits before it
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+static int fdt_batch_apply(struct fdt_batch *batch, int *offsetp)
+{
+	struct fdt_batch_edit **order;
+	void *fdt = batch->fdt;
+	int struct_size, strings_size, new_struct_size, new_strings_size;
+	char *structp, *strtab, *buf, *p;
+	int shift = 0;
+	int i, j, pos;
+
+	struct_size = fdt_size_dt_struct(fdt);
+	strings_size = fdt_size_dt_strings(fdt);
+	structp = fdt + fdt_off_dt_struct(fdt);
+	strtab = fdt + fdt_off_dt_strings(fdt);
+
+	/* Work out where each edit goes and which names must be added */
+	new_struct_size = struct_size;
+	new_strings_size = strings_size;
+	for (i = 0; i < batch->count; i++) {
+		struct fdt_batch_edit *edit = &batch->edit[i];
+		const struct fdt_property *prop;
+		int len;
+
+		prop = fdt_get_property(fdt, edit->node, edit->name, &len);
+		if (prop) {
+			edit->pos = (const char *)prop - structp;
+			edit->old_size = sizeof(*prop) +
+					 ALIGN(len, FDT_TAGSIZE);
+			edit->nameoff = fdt32_to_cpu(prop->nameoff);
+		} else if (len == -FDT_ERR_NOTFOUND) {
+			fdt_next_tag(fdt, edit->node, &edit->pos);
+			edit->old_size = 0;
+			edit->nameoff = fdt_batch_find_string(strtab,
+							      strings_size,
+							      edit->name);
+			for (j = 0; edit->nameoff < 0 && j < i; j++) {
+				struct fdt_batch_edit *prev = &batch->edit[j];
+				int prev_len = strlen(prev->name);
+				int skip = prev_len - strlen(edit->name);
+
+				if (!prev->old_size && skip >= 0 &&
+				    prev->nameoff >= strings_size &&
+				    !strcmp(prev->name + skip, edit->name))
+					edit->nameoff = prev->nameoff + skip;
+			}
+			if (edit->nameoff < 0) {
+				edit->nameoff = new_strings_size;
+				new_strings_size += strlen(edit->name) + 1;
+			}
+		} else {
+			return len;
+		}
+		new_struct_size += sizeof(*prop) +
+				   ALIGN(edit->len, FDT_TAGSIZE) -
+				   edit->old_size;
+	}
+	if (fdt_off_dt_struct(fdt) + new_struct_size + new_strings_size >
+	    fdt_totalsize(fdt))
+		return -FDT_ERR_NOSPACE;
+
+	order = malloc(batch->count * sizeof(*order));
+	buf = malloc(new_struct_size);
+	if (!order || !buf) {
+		free(order);
+		free(buf);
+		return fdt_batch_apply_each(batch, offsetp);
+	}
+	for (i = 0; i < batch->count; i++)
+		order[i] = &batch->edit[i];
+	qsort(order, batch->count, sizeof(*order), fdt_batch_cmp);
+
+	/* Build the new structure block, copying what lies between edits */
+	p = buf;
+	for (i = 0, pos = 0; i < batch->count; i++) {
+		struct fdt_batch_edit *edit = order[i];
+
+		memcpy(p, structp + pos, edit->pos - pos);
+		p += edit->pos - pos;
+		p += fdt_batch_put_prop(p, edit);
+		pos = edit->pos + edit->old_size;
+		if (offsetp && edit->pos < *offsetp)
+			shift = p - buf - pos;
+	}
+	memcpy(p, structp + pos, struct_size - pos);
+
+	/* Move the strings block once, then add the new names */
+	strtab = structp + new_struct_size;
+	memmove(strtab, structp + struct_size, strings_size);
+	for (i = 0; i < batch->count; i++) {
+		struct fdt_batch_edit *edit = &batch->edit[i];
+
+		if (!edit->old_size && edit->nameoff >= strings_size)
+			strcpy(strtab + edit->nameoff, edit->name);
+	}
+	memcpy(structp, buf, new_struct_size);
+
+	fdt_set_size_dt_struct(fdt, new_struct_size);
+	fdt_set_off_dt_strings(fdt, fdt_off_dt_struct(fdt) + new_struct_size);
+	fdt_set_size_dt_strings(fdt, new_strings_size);
+	free(buf);
+	free(order);
+	if (offsetp)
+		*offsetp += shift;
+
+	return 0;
+}
+
+/* Apply all recorded edits, updating @offsetp (if not NULL) to match */
+static int fdt_batch_flush_offset(void *fdt, int *offsetp)
+{
+	struct fdt_batch *batch = &fdt_batch;
+	int ret = 0;
+	int i;
+
+	if (!batch->depth || batch->fdt != fdt || !batch->count)
+		return 0;
+
+	ret = fdt_batch_apply(batch, offsetp);
+	if (ret && !batch->err)
+		batch->err = ret;
+	fdtdec_index_invalidate(fdt);
+	for (i = 0; i < batch->count; i++)
+		free(batch->edit[i].name);
+	batch->count = 0;
+
+	return ret;
+}
+
+int fdt_batch_flush(void *fdt)
+{
+	return fdt_batch_flush_offset(fdt, NULL);
+}
+
+int fdt_batch_end(void *fdt)
+{
+	struct fdt_batch *batch = &fdt_batch;
+	int ret;
+
+	if (!batch->depth || batch->fdt != fdt)
+		return -FDT_ERR_BADSTATE;
+	if (batch->depth > 1) {
+		batch->depth--;
+		return 0;
+	}
+	fdt_batch_flush(fdt);
+
+	ret = batch->err;
+	free(batch->edit);
+	memset(batch, '\0', sizeof(*batch));
+
+	return ret;
+}
+
+int fdt_batch_setprop(void *fdt, int nodeoffset, const char *name,
+		      const void *val, int len)
+{
+	struct fdt_batch *batch = &fdt_batch;
+	struct fdt_batch_edit *edit;
+	int name_len = strlen(name) + 1;
+	int next;
+	char *p;
+	int i;
+
+	if (!batch->depth || batch->fdt != fdt)
+		return fdt_setprop(fdt, nodeoffset, name, val, len);
+
+	if (nodeoffset < 0 ||
+	    fdt_next_tag(fdt, nodeoffset, &next) != FDT_BEGIN_NODE)
+		return -FDT_ERR_BADOFFSET;
+	if (len < 0)
+		return -FDT_ERR_BADVALUE;
+
+	/* Setting the same property again replaces the recorded value */
+	for (i = 0; i < batch->count; i++) {
+		if (batch->edit[i].node == nodeoffset &&
+		    !strcmp(batch->edit[i].name, name))
+			break;
+	}
+	if (i == batch->count) {
+		if (batch->count == batch->max) {
+			int max = batch->max ? batch->max * 2 : 16;
+			void *ptr;
+
+			ptr = realloc(batch->edit, max * sizeof(*edit));
+			if (!ptr)
+				goto direct;
+			batch->edit = ptr;
+			batch->max = max;
+		}
+		batch->edit[i].name = NULL;
+	}
+	edit = &batch->edit[i];
+
+	/* Copy the value, since it may point into the blob */
+	p = realloc(edit->name, name_len + len);
+	if (!p)
+		goto direct;
+	memcpy(p, name, name_len);
+	memcpy(p + name_len, val, len);
+	edit->name = p;
+	edit->val = p + name_len;
+	edit->node = nodeoffset;
+	edit->len = len;
+	if (i == batch->count)
+		batch->count++;
+
+	return 0;
+
+direct:
+	/* Out of memory, so write this property now */
+	if (i < batch->count) {
+		free(batch->edit[i].name);
+		batch->count--;
+		memmove(&batch->edit[i], &batch->edit[i + 1],
+			(batch->count - i) * sizeof(*batch->edit));
+	}
+
+	return fdt_batch_setprop_now(batch, nodeoffset, name, val, len, NULL);
+}
+#else
+static int fdt_batch_flush_offset(void *fdt, int *offsetp)
+{
+	return 0;
+}
+#endif
+
 /**
  * fdt_find_and_setprop: Find a node and set it's property
  *
@@ -95,7 +499,7 @@ int fdt_find_and_setprop(void *fdt, const char *node, const char *prop,
 	if ((!create) && (fdt_get_property(fdt, nodeoff, prop, NULL) == NULL))
 		return 0; /* create flag not set; so exit quietly */
 
-	return fdt_setprop(fdt, nodeoff, prop, val, len);
+	return fdt_batch_setprop(fdt, nodeoff, prop, val, len);
 }
 
 /**
@@ -114,8 +518,12 @@ int fdt_find_or_add_subnode(void *fdt, int parentoffset, const char *name)
 
 	offset = fdt_subnode_offset(fdt, parentoffset, name);
 
-	if (offset == -FDT_ERR_NOTFOUND)
-		offset = fdt_add_subnode(fdt, parentoffset, name);
+	if (offset == -FDT_ERR_NOTFOUND) {
+		/* Recorded edits would be lost when the nodes move */
+		offset = fdt_batch_flush_offset(fdt, &parentoffset);
+		if (!offset)
+			offset = fdt_add_subnode(fdt, parentoffset, name);
+	}
 
 	if (offset < 0)
 		printf("%s: %s: %s\n", __func__, name, fdt_strerror(offset));
@@ -127,8 +535,8 @@ int fdt_find_or_add_subnode(void *fdt, int parentoffset, const char *name)
 #if defined(OF_STDOUT_PATH)
 static int fdt_fixup_stdout(void *fdt, int chosenoff)
 {
-	return fdt_setprop(fdt, chosenoff, "linux,stdout-path",
-			      OF_STDOUT_PATH, strlen(OF_STDOUT_PATH) + 1);
+	return fdt_batch_setprop(fdt, chosenoff, "linux,stdout-path",
+				 OF_STDOUT_PATH, strlen(OF_STDOUT_PATH) + 1);
 }
 #elif defined(CONFIG_OF_STDOUT_VIA_ALIAS) && defined(CONFIG_CONS_INDEX)
 static int fdt_fixup_stdout(void *fdt, int chosenoff)
@@ -157,7 +565,7 @@ static int fdt_fixup_stdout(void *fdt, int chosenoff)
 	/* fdt_setprop may break "path" so we copy it to tmp buffer */
 	memcpy(tmp, path, len);
 
-	err = fdt_setprop(fdt, chosenoff, "linux,stdout-path", tmp, len);
+	err = fdt_batch_setprop(fdt, chosenoff, "linux,stdout-path", tmp, len);
 	if (err < 0)
 		printf("WARNING: could not set linux,stdout-path %s.\n",
 		       fdt_strerror(err));
@@ -199,8 +607,8 @@ int fdt_root(void *fdt)
 
 	serial = env_get("serial#");
 	if (serial) {
-		err = fdt_setprop(fdt, 0, "serial-number", serial,
-				  strlen(serial) + 1);
+		err = fdt_batch_setprop(fdt, 0, "serial-number", serial,
+					strlen(serial) + 1);
 
 		if (err < 0) {
 			printf("WARNING: could not set serial-number %s.\n",
@@ -291,8 +699,8 @@ int fdt_chosen(void *fdt)
 
 	str = env_get("bootargs");
 	if (str) {
-		err = fdt_setprop(fdt, nodeoffset, "bootargs", str,
-				  strlen(str) + 1);
+		err = fdt_batch_setprop(fdt, nodeoffset, "bootargs", str,
+					strlen(str) + 1);
 		if (err < 0) {
 			printf("WARNING: could not set bootargs %s.\n",
 			       fdt_strerror(err));
@@ -339,12 +747,14 @@ void do_fixup_by_prop(void *fdt,
 		debug(" %.2x", *(u8*)(val+i));
 	debug("\n");
 #endif
+	fdt_batch_begin(fdt);
 	off = fdt_node_offset_by_prop_value(fdt, -1, pname, pval, plen);
 	while (off != -FDT_ERR_NOTFOUND) {
 		if (create || (fdt_get_property(fdt, off, prop, NULL) != NULL))
-			fdt_setprop(fdt, off, prop, val, len);
+			fdt_batch_setprop(fdt, off, prop, val, len);
 		off = fdt_node_offset_by_prop_value(fdt, off, pname, pval, plen);
 	}
+	fdt_batch_end(fdt);
 }
 
 void do_fixup_by_prop_u32(void *fdt,
@@ -366,12 +776,14 @@ void do_fixup_by_compat(void *fdt, const char *compat,
 		debug(" %.2x", *(u8*)(val+i));
 	debug("\n");
 #endif
+	fdt_batch_begin(fdt);
 	off = fdt_node_offset_by_compatible(fdt, -1, compat);
 	while (off != -FDT_ERR_NOTFOUND) {
 		if (create || (fdt_get_property(fdt, off, prop, NULL) != NULL))
-			fdt_setprop(fdt, off, prop, val, len);
+			fdt_batch_setprop(fdt, off, prop, val, len);
 		off = fdt_node_offset_by_compatible(fdt, off, compat);
 	}
+	fdt_batch_end(fdt);
 }
 
 void do_fixup_by_compat_u32(void *fdt, const char *compat,
@@ -525,6 +937,7 @@ void fdt_fixup_ethernet(void *fdt)
 	if (fdt_path_offset(fdt, "/aliases") < 0)
 		return;
 
+	fdt_batch_begin(fdt);
 	/* Cycle through all aliases */
 	for (prop = 0; ; prop++) {
 		const char *name;
@@ -585,6 +998,11 @@ void fdt_fixup_ethernet(void *fdt)
 					 &mac_addr, 6, 1);
 		}
 	}
+
+	i = fdt_batch_end(fdt);
+	if (i)
+		printf("Unable to update MAC addresses, err=%s\n",
+		       fdt_strerror(i));
 }
 
 int fdt_record_loadable(void *blob, u32 index, const char *name,
@@ -1790,6 +2208,21 @@ int fdt_fixup_display(void *blob, const char *path, const char *display)
  * in the case of an error
  */
 int fdt_overlay_apply_verbose(void *fdt, void *fdto)
+{
+	return fdt_overlay_apply_multi_verbose(fdt, &fdto, 1);
+}
+
+/**
+ * fdt_overlay_apply_multi_verbose - Apply overlays with verbose error reporting
+ *
+ * @fdt: ptr to device tree
+ * @fdtos: ptrs to device tree overlays, applied in order
+ * @count: number of overlays
+ *
+ * Convenience function to apply a list of overlays and display helpful
+ * messages in the case of an error
+ */
+int fdt_overlay_apply_multi_verbose(void *fdt, void *const fdtos[], int count)
 {
 	int err;
 	bool has_symbols;
@@ -1797,7 +2230,10 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	err = fdt_path_offset(fdt, "/__symbols__");
 	has_symbols = err >= 0;
 
-	err = fdt_overlay_apply(fdt, fdto);
+	if (count == 1)
+		err = fdt_overlay_apply(fdt, fdtos[0]);
+	else
+		err = fdt_overlay_apply_multi(fdt, fdtos, count);
 	if (err < 0) {
 		printf("failed on fdt_overlay_apply(): %s\n",
 				fdt_strerror(err));
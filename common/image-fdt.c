@@ -533,12 +533,21 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 	int ret = -EPERM;
 	int fdt_ret;
 
+	fdt_batch_begin(blob);
 	if (fdt_root(blob) < 0) {
 		printf("ERROR: root node setup failed\n");
+		fdt_batch_end(blob);
 		goto err;
 	}
 	if (fdt_chosen(blob) < 0) {
 		printf("ERROR: /chosen node create failed\n");
+		fdt_batch_end(blob);
+		goto err;
+	}
+	fdt_ret = fdt_batch_end(blob);
+	if (fdt_ret) {
+		printf("ERROR: root and /chosen fixup failed: %s\n",
+		       fdt_strerror(fdt_ret));
 		goto err;
 	}
 	if (arch_fixup_fdt(blob) < 0) {
@@ -2143,6 +2143,46 @@ int boot_get_setup_fit(bootm_headers_t *images, uint8_t arch,
 }
 
 #ifndef USE_HOSTCC
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+/**
+ * fit_apply_overlays() - Apply a list of overlays to the base FDT
+ *
+ * The base FDT is expanded once to make room for all of the overlays and
+ * packed again once they have been applied.
+ *
+ * @load: Address of base FDT
+ * @lenp: Size of base FDT, updated on success
+ * @ovs: Overlays to apply, in order
+ * @count: Number of overlays
+ * @ovlen: Total size of the overlays
+ * @return 0 if OK, -ve on error
+ */
+static int fit_apply_overlays(ulong load, ulong *lenp, void *const ovs[],
+			      int count, ulong ovlen)
+{
+	void *base;
+	int err;
+
+	if (!count)
+		return 0;
+
+	base = map_sysmem(load, *lenp + ovlen);
+	err = fdt_open_into(base, base, *lenp + ovlen);
+	if (err < 0) {
+		printf("failed on fdt_open_into\n");
+		return err;
+	}
+	/* the verbose method prints out messages on error */
+	err = fdt_overlay_apply_multi_verbose(base, ovs, count);
+	if (err < 0)
+		return err;
+	fdt_pack(base);
+	*lenp = fdt_totalsize(base);
+
+	return 0;
+}
+#endif
+
 int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, ulong *datap, ulong *lenp)
@@ -2159,7 +2199,10 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 	ulong ovload, ovlen;
 	const char *uconfig;
 	const char *uname;
-	void *base, *ov;
+	void **ovs = NULL, **new_ovs;
+	int ov_count = 0;
+	ulong ov_total = 0;
+	void *ov;
 	int i, err, noffset, ov_noffset;
 #endif
 
@@ -2212,8 +2255,6 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		goto out;
 	}
 
-	base = map_sysmem(load, len);
-
 	/* apply extra configs in FIT first, followed by args */
 	for (i = 1; ; i++) {
 		if (i < count) {
@@ -2258,28 +2299,44 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 				uname, ovload, ovlen);
 		ov = map_sysmem(ovload, ovlen);
 
-		base = map_sysmem(load, len + ovlen);
-		err = fdt_open_into(base, base, len + ovlen);
-		if (err < 0) {
-			printf("failed on fdt_open_into\n");
-			fdt_noffset = err;
+		new_ovs = realloc(ovs, (ov_count + 1) * sizeof(*ovs));
+		if (!new_ovs) {
+			fdt_noffset = -ENOMEM;
 			goto out;
 		}
-		/* the verbose method prints out messages on error */
-		err = fdt_overlay_apply_verbose(base, ov);
-		if (err < 0) {
-			fdt_noffset = err;
-			goto out;
+		ovs = new_ovs;
+		ovs[ov_count++] = ov;
+		ov_total += ovlen;
+
+		/*
+		 * An overlay which was copied out of the FIT may be overwritten
+		 * by the next one loaded to the same address, so apply it now.
+		 * Others are applied together at the end.
+		 */
+		if (ovload < image_start || ovload >= image_end) {
+			err = fit_apply_overlays(load, &len, ovs, ov_count,
+						 ov_total);
+			if (err < 0) {
+				fdt_noffset = err;
+				goto out;
+			}
+			ov_count = 0;
+			ov_total = 0;
 		}
-		fdt_pack(base);
-		len = fdt_totalsize(base);
 	}
+
+	err = fit_apply_overlays(load, &len, ovs, ov_count, ov_total);
+	if (err < 0)
+		fdt_noffset = err;
 #else
 	printf("config with overlays but CONFIG_OF_LIBFDT_OVERLAY not set\n");
 	fdt_noffset = -EBADF;
 #endif
 
 out:
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+	free(ovs);
+#endif
 	if (datap)
 		*datap = load;
 	if (lenp)
@@ -24,6 +24,7 @@
 #include <image.h>
 #include <lz4.h>
 #include <mapmem.h>
+#include <zstd.h>
 
 #if IMAGE_ENABLE_FIT || IMAGE_ENABLE_OF_LIBFDT
 #include <linux/libfdt.h>
@@ -193,6 +194,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -441,13 +443,12 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		uint size = unc_len;
 
 		/*
-		 * If we've got less than 4 MB of malloc() space,
-		 * use slower decompression algorithm which requires
-		 * at most 2300 KB of memory.
+		 * This falls back to the slower decompression algorithm,
+		 * which requires at most 2300 KB of memory, if there is not
+		 * enough malloc() space for the faster one.
 		 */
 		ret = BZ2_bzBuffToBuffDecompress(load_buf, &size,
-			image_buf, image_len,
-			CONFIG_SYS_MALLOC_LEN < (4096 * 1024), 0);
+			image_buf, image_len, 0, 0);
 		image_len = size;
 		break;
 	}
@@ -480,6 +481,15 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return -ENOSYS;
@@ -492,6 +502,117 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 
 
 #ifndef USE_HOSTCC
+int image_decomp_inplace_layout(int comp, ulong load, ulong image_start,
+				ulong image_len, ulong *srcp, ulong *endp)
+{
+	void *image_buf = map_sysmem(image_start, image_len);
+	size_t size;
+	ulong src;
+	int ret;
+
+	switch (comp) {
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+		ret = lzop_inplace_size(image_buf, image_len, &size);
+		break;
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		ret = ulz4fn_inplace_size(image_buf, image_len, &size);
+		break;
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		ret = zstd_inplace_size(image_buf, image_len, &size);
+		break;
+#endif
+	default:
+		ret = -EPROTONOSUPPORT;
+		break;
+	}
+	unmap_sysmem(image_buf);
+	if (ret)
+		return ret;
+
+	/*
+	 * The compressed data goes at the end of the region, aligned so that
+	 * the decoder can read it quickly. If it is already further up, the
+	 * decoder has even more room, so it can stay where it is.
+	 */
+	src = ALIGN(load + max_t(ulong, size, image_len) - image_len,
+		    sizeof(u64));
+	*srcp = max(src, image_start);
+	*endp = *srcp + image_len;
+
+	return 0;
+}
+
+int image_decomp_get_len(int comp, ulong image_start, ulong max_len,
+			 ulong *lenp)
+{
+	void *image_buf = map_sysmem(image_start, max_len);
+	size_t len;
+	int ret;
+
+	switch (comp) {
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+		ret = lzop_stream_len(image_buf, max_len, &len);
+		break;
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		ret = ulz4fn_stream_len(image_buf, max_len, &len);
+		break;
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		ret = zstd_stream_len(image_buf, max_len, &len);
+		break;
+#endif
+	default:
+		ret = -EPROTONOSUPPORT;
+		break;
+	}
+	unmap_sysmem(image_buf);
+	if (ret)
+		return ret;
+	*lenp = len;
+
+	return 0;
+}
+
+int image_decomp_inplace(struct lmb *lmb, int comp, ulong load,
+			 ulong image_start, int type, ulong image_len,
+			 ulong *load_end)
+{
+	ulong src, end;
+	int ret;
+
+	*load_end = load;
+	ret = image_decomp_inplace_layout(comp, load, image_start, image_len,
+					  &src, &end);
+	if (ret)
+		return ret;
+#ifdef CONFIG_LMB
+	if (lmb && lmb_get_free_size(lmb, load) < end - load) {
+		printf("   In-place region %08lx-%08lx is not free\n", load,
+		       end);
+		return -EBUSY;
+	}
+#endif
+	if (src != image_start) {
+		debug("   Moving compressed image from %08lx to %08lx\n",
+		      image_start, src);
+		memmove(map_sysmem(src, image_len),
+			map_sysmem(image_start, image_len), image_len);
+	}
+
+	return image_decomp(comp, load, src, type, map_sysmem(load, 0),
+			    map_sysmem(src, image_len), image_len, end - load,
+			    load_end);
+}
+
 #if CONFIG_IS_ENABLED(LEGACY_IMAGE_FORMAT)
 /**
  * image_get_ramdisk - get and verify ramdisk image
@@ -1027,6 +1148,21 @@ int genimg_has_config(bootm_headers_t *images)
 	return 0;
 }
 
+#if IMAGE_ENABLE_FIT
+/*
+ * If the ramdisk is going to be copied to its final place anyway, there is
+ * no point in first copying it to the load address given in the FIT.
+ */
+static enum fit_load_op boot_ramdisk_load_op(void)
+{
+#ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
+	if (boot_ramdisk_relocates())
+		return FIT_LOAD_IGNORED;
+#endif
+	return FIT_LOAD_OPTIONAL_NON_ZERO;
+}
+#endif
+
 /**
  * boot_get_ramdisk - main ramdisk handling routine
  * @argc: command argument count
@@ -1170,7 +1306,7 @@ int boot_get_ramdisk(int argc, char * const argv[], bootm_headers_t *images,
 					&fit_uname_config, arch,
 					IH_TYPE_RAMDISK,
 					BOOTSTAGE_ID_FIT_RD_START,
-					FIT_LOAD_OPTIONAL_NON_ZERO,
+					boot_ramdisk_load_op(),
 					&rd_data, &rd_len);
 			if (rd_noffset < 0)
 				return 1;
@@ -1237,6 +1373,84 @@ int boot_get_ramdisk(int argc, char * const argv[], bootm_headers_t *images,
 }
 
 #ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
+/**
+ * boot_get_initrd_high - read the ramdisk relocation hint
+ * @initrd_high: pointer to a ulong variable, will hold the highest address
+ *      the ramdisk may be moved to, or 0 for no limit
+ *
+ * returns:
+ *     true if the ramdisk is to be copied to RAM, false to use it in place
+ */
+static bool boot_get_initrd_high(ulong *initrd_high)
+{
+	bool initrd_copy_to_ram = true;
+	char *s;
+
+	s = env_get("initrd_high");
+	if (s) {
+		/* a value of "no" or a similar string will act like 0,
+		 * turning the "load high" feature off. This is intentional.
+		 */
+		*initrd_high = simple_strtoul(s, NULL, 16);
+		if (*initrd_high == ~0)
+			initrd_copy_to_ram = false;
+	} else {
+		*initrd_high = env_get_bootm_mapsize() + env_get_bootm_low();
+	}
+
+	debug("## initrd_high = 0x%08lx, copy_to_ram = %d\n",
+			*initrd_high, initrd_copy_to_ram);
+
+	return initrd_copy_to_ram;
+}
+
+bool boot_ramdisk_relocates(void)
+{
+	ulong initrd_high;
+
+	return boot_get_initrd_high(&initrd_high);
+}
+
+int boot_ramdisk_alloc(struct lmb *lmb, ulong rd_data, ulong rd_len,
+		       ulong *initrd_start)
+{
+	ulong initrd_high;
+
+	if (!boot_get_initrd_high(&initrd_high)) {	/* zero-copy ramdisk */
+		debug("   in-place initrd\n");
+		*initrd_start = rd_data;
+		lmb_reserve(lmb, rd_data, rd_len);
+		return 0;
+	}
+
+	/* An initrd_high of 0 means anywhere. The caller reports failure. */
+	*initrd_start = (ulong)__lmb_alloc_base(lmb, rd_len, 0x1000,
+						initrd_high);
+
+	return *initrd_start ? 0 : -ENOMEM;
+}
+
+void boot_ramdisk_copy(ulong dest, ulong src, ulong len)
+{
+	bootstage_mark(BOOTSTAGE_ID_COPY_RAMDISK);
+	printf("   Loading Ramdisk to %08lx, end %08lx ... ", dest, dest + len);
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_RAMDISK, "copy_ramdisk");
+	memmove_wd(map_sysmem(dest, len), map_sysmem(src, len), len, CHUNKSZ);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_RAMDISK);
+	bootstage_add_bytes(BOOTSTAGE_ID_ACCUM_RAMDISK, len);
+
+#ifdef CONFIG_MP
+	/*
+	 * Ensure the image is flushed to memory to handle
+	 * AMP boot scenarios in which we might not be
+	 * HW cache coherent
+	 */
+	flush_cache(dest, ALIGN(len, ARCH_DMA_MINALIGN));
+#endif
+	puts("OK\n");
+}
+
 /**
  * boot_ramdisk_high - relocate init ramdisk
  * @lmb: pointer to lmb handle, will be used for memory mgmt
@@ -1261,64 +1475,14 @@ int boot_get_ramdisk(int argc, char * const argv[], bootm_headers_t *images,
 int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 		  ulong *initrd_start, ulong *initrd_end)
 {
-	char	*s;
-	ulong	initrd_high;
-	int	initrd_copy_to_ram = 1;
-
-	s = env_get("initrd_high");
-	if (s) {
-		/* a value of "no" or a similar string will act like 0,
-		 * turning the "load high" feature off. This is intentional.
-		 */
-		initrd_high = simple_strtoul(s, NULL, 16);
-		if (initrd_high == ~0)
-			initrd_copy_to_ram = 0;
-	} else {
-		initrd_high = env_get_bootm_mapsize() + env_get_bootm_low();
-	}
-
-
-	debug("## initrd_high = 0x%08lx, copy_to_ram = %d\n",
-			initrd_high, initrd_copy_to_ram);
-
 	if (rd_data) {
-		if (!initrd_copy_to_ram) {	/* zero-copy ramdisk support */
-			debug("   in-place initrd\n");
-			*initrd_start = rd_data;
-			*initrd_end = rd_data + rd_len;
-			lmb_reserve(lmb, rd_data, rd_len);
-		} else {
-			if (initrd_high)
-				*initrd_start = (ulong)lmb_alloc_base(lmb,
-						rd_len, 0x1000, initrd_high);
-			else
-				*initrd_start = (ulong)lmb_alloc(lmb, rd_len,
-								 0x1000);
-
-			if (*initrd_start == 0) {
-				puts("ramdisk - allocation error\n");
-				goto error;
-			}
-			bootstage_mark(BOOTSTAGE_ID_COPY_RAMDISK);
-
-			*initrd_end = *initrd_start + rd_len;
-			printf("   Loading Ramdisk to %08lx, end %08lx ... ",
-					*initrd_start, *initrd_end);
-
-			memmove_wd((void *)*initrd_start,
-					(void *)rd_data, rd_len, CHUNKSZ);
-
-#ifdef CONFIG_MP
-			/*
-			 * Ensure the image is flushed to memory to handle
-			 * AMP boot scenarios in which we might not be
-			 * HW cache coherent
-			 */
-			flush_cache((unsigned long)*initrd_start,
-				    ALIGN(rd_len, ARCH_DMA_MINALIGN));
-#endif
-			puts("OK\n");
+		if (boot_ramdisk_alloc(lmb, rd_data, rd_len, initrd_start)) {
+			puts("ramdisk - allocation error\n");
+			return -1;
 		}
+		*initrd_end = *initrd_start + rd_len;
+		if (*initrd_start != rd_data)
+			boot_ramdisk_copy(*initrd_start, rd_data, rd_len);
 	} else {
 		*initrd_start = 0;
 		*initrd_end = 0;
@@ -1327,9 +1491,6 @@ int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 			*initrd_start, *initrd_end);
 
 	return 0;
-
-error:
-	return -1;
 }
 #endif /* CONFIG_SYS_BOOT_RAMDISK_HIGH */
 
@@ -12,6 +12,7 @@
 #include <image.h>
 #include <malloc.h>
 #include <spl.h>
+#include <zstd.h>
 #include <linux/libfdt.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -24,6 +25,12 @@ DECLARE_GLOBAL_DATA_PTR;
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
 #endif
 
+/* Check whether SPL can decompress any FIT images */
+static inline bool spl_fit_decomp_enabled(void)
+{
+	return IS_ENABLED(CONFIG_SPL_GZIP) || IS_ENABLED(CONFIG_SPL_ZSTD);
+}
+
 __weak void board_spl_fit_post_load(ulong load_addr, size_t length)
 {
 }
@@ -252,14 +259,14 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	bool external_data = false;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
-	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
+	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && spl_fit_decomp_enabled())) {
 		if (fit_image_get_type(fit, node, &type))
 			puts("Cannot get image type.\n");
 		else
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (spl_fit_decomp_enabled()) {
 		fit_image_get_comp(fit, node, &image_comp);
 		debug("%s ", genimg_get_comp_name(image_comp));
 	}
@@ -279,7 +286,15 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		if (fit_image_get_data_size(fit, node, &len))
 			return -ENOENT;
 
-		load_ptr = (load_addr + align_len) & ~align_len;
+		/*
+		 * Compressed data cannot be decompressed onto itself, so
+		 * read it to the general load address instead
+		 */
+		if (image_comp == IH_COMP_GZIP || image_comp == IH_COMP_ZSTD)
+			load_ptr = CONFIG_SYS_LOAD_ADDR;
+		else
+			load_ptr = load_addr;
+		load_ptr = (load_ptr + align_len) & ~align_len;
 		length = len;
 
 		overhead = get_aligned_image_overhead(info, offset);
@@ -325,8 +340,20 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
-	} else {
-		memcpy((void *)load_addr, src, length);
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
+	} else if (src != (void *)load_addr) {
+		/*
+		 * External data which is aligned on the medium (see mkimage -B)
+		 * has been read to its load address already
+		 */
+		memmove((void *)load_addr, src, length);
 	}
 
 	if (image_info) {
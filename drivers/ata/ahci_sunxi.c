@@ -3,6 +3,7 @@
 #include <dm.h>
 #include <scsi.h>
 #include <errno.h>
+#include <watchdog.h>
 #include <asm/io.h>
 #include <asm/gpio.h>
 
@@ -11,83 +12,125 @@
 #define AHCI_PHYCS2R 0x00c8
 #define AHCI_RWCR    0x00fc
 
+/* Steps of the PHY initialisation, each ending with a wait */
+enum sunxi_ahci_phy_state {
+	PHY_RESET,		/* registers disabled */
+	PHY_CONFIG,		/* PHY configured */
+	PHY_POWER_UP,		/* waiting for the PHY to power up */
+	PHY_CALIBRATE,		/* waiting for calibration */
+	PHY_SETTLE,		/* calibrated, letting it settle */
+};
+
+/**
+ * struct sunxi_ahci_priv - State of a probe in progress
+ *
+ * @base: Base address of the controller
+ * @state: Step of the PHY initialisation which is waiting
+ * @start: Time at which the wait started, in microseconds
+ * @wait: Length of the wait, in microseconds
+ */
+struct sunxi_ahci_priv {
+	ulong base;
+	enum sunxi_ahci_phy_state state;
+	ulong start;
+	ulong wait;
+};
+
+static void sunxi_ahci_wait(struct sunxi_ahci_priv *priv,
+			    enum sunxi_ahci_phy_state state, ulong wait)
+{
+	priv->state = state;
+	priv->start = timer_get_us();
+	priv->wait = wait;
+}
+
+static bool sunxi_ahci_waited(struct sunxi_ahci_priv *priv)
+{
+	return timer_get_us() - priv->start >= priv->wait;
+}
+
 /* This magic PHY initialisation was taken from the Allwinner releases
  * and Linux driver, but is completely undocumented.
+ *
+ * It is split into steps so that the waits between them do not block. Each
+ * call does whatever step is due and returns -EINPROGRESS until the PHY is
+ * ready.
  */
-static int sunxi_ahci_phy_init(u8 *reg_base)
+static int sunxi_ahci_phy_init(struct sunxi_ahci_priv *priv)
 {
+	u8 *reg_base = (u8 *)priv->base;
 	u32 reg_val;
-	int timeout;
-
-	writel(0, reg_base + AHCI_RWCR);
-	mdelay(5);
-
-	setbits_le32(reg_base + AHCI_PHYCS1R, 0x1 << 19);
-	clrsetbits_le32(reg_base + AHCI_PHYCS0R,
-			(0x7 << 24),
-			(0x5 << 24) | (0x1 << 23) | (0x1 << 18));
-	clrsetbits_le32(reg_base + AHCI_PHYCS1R,
-			(0x3 << 16) | (0x1f << 8) | (0x3 << 6),
-			(0x2 << 16) | (0x6 << 8) | (0x2 << 6));
-	setbits_le32(reg_base + AHCI_PHYCS1R, (0x1 << 28) | (0x1 << 15));
-	clrbits_le32(reg_base + AHCI_PHYCS1R, (0x1 << 19));
-	clrsetbits_le32(reg_base + AHCI_PHYCS0R, (0x7 << 20), (0x3 << 20));
-	clrsetbits_le32(reg_base + AHCI_PHYCS2R, (0x1f << 5), (0x19 << 5));
-	mdelay(5);
-
-	setbits_le32(reg_base + AHCI_PHYCS0R, (0x1 << 19));
-
-	timeout = 250; /* Power up takes approx 50 us */
-	for (;;) {
-		reg_val = readl(reg_base + AHCI_PHYCS0R) & (0x7 << 28);
-		if (reg_val == (0x2 << 28))
+
+	switch (priv->state) {
+	case PHY_RESET:
+		if (!sunxi_ahci_waited(priv))
+			break;
+		setbits_le32(reg_base + AHCI_PHYCS1R, 0x1 << 19);
+		clrsetbits_le32(reg_base + AHCI_PHYCS0R,
+				(0x7 << 24),
+				(0x5 << 24) | (0x1 << 23) | (0x1 << 18));
+		clrsetbits_le32(reg_base + AHCI_PHYCS1R,
+				(0x3 << 16) | (0x1f << 8) | (0x3 << 6),
+				(0x2 << 16) | (0x6 << 8) | (0x2 << 6));
+		setbits_le32(reg_base + AHCI_PHYCS1R,
+			     (0x1 << 28) | (0x1 << 15));
+		clrbits_le32(reg_base + AHCI_PHYCS1R, (0x1 << 19));
+		clrsetbits_le32(reg_base + AHCI_PHYCS0R, (0x7 << 20),
+				(0x3 << 20));
+		clrsetbits_le32(reg_base + AHCI_PHYCS2R, (0x1f << 5),
+				(0x19 << 5));
+		sunxi_ahci_wait(priv, PHY_CONFIG, 5000);
+		break;
+	case PHY_CONFIG:
+		if (!sunxi_ahci_waited(priv))
 			break;
-		if (--timeout == 0) {
+		setbits_le32(reg_base + AHCI_PHYCS0R, (0x1 << 19));
+		/* Power up takes approx 50 us */
+		sunxi_ahci_wait(priv, PHY_POWER_UP, 250);
+		break;
+	case PHY_POWER_UP:
+		reg_val = readl(reg_base + AHCI_PHYCS0R) & (0x7 << 28);
+		if (reg_val == (0x2 << 28)) {
+			setbits_le32(reg_base + AHCI_PHYCS2R, (0x1 << 24));
+			/* Calibration takes approx 10 us */
+			sunxi_ahci_wait(priv, PHY_CALIBRATE, 100);
+		} else if (sunxi_ahci_waited(priv)) {
 			printf("AHCI PHY power up failed.\n");
 			return -EIO;
 		}
-		udelay(1);
-	};
-
-	setbits_le32(reg_base + AHCI_PHYCS2R, (0x1 << 24));
-
-	timeout = 100; /* Calibration takes approx 10 us */
-	for (;;) {
+		break;
+	case PHY_CALIBRATE:
 		reg_val = readl(reg_base + AHCI_PHYCS2R) & (0x1 << 24);
-		if (reg_val == 0x0)
-			break;
-		if (--timeout == 0) {
+		if (reg_val == 0x0) {
+			sunxi_ahci_wait(priv, PHY_SETTLE, 15000);
+		} else if (sunxi_ahci_waited(priv)) {
 			printf("AHCI PHY calibration failed.\n");
 			return -EIO;
 		}
-		udelay(1);
+		break;
+	case PHY_SETTLE:
+		if (!sunxi_ahci_waited(priv))
+			break;
+		writel(0x7, reg_base + AHCI_RWCR);
+		return 0;
 	}
 
-	mdelay(15);
-
-	writel(0x7, reg_base + AHCI_RWCR);
-
-	return 0;
+	return -EINPROGRESS;
 }
 
-static int sunxi_sata_probe(struct udevice *dev)
+static int sunxi_sata_probe_finish(struct udevice *dev)
 {
-	ulong base;
-	u8 *reg;
+	struct sunxi_ahci_priv *priv = dev_get_priv(dev);
 	int ret;
 
-	base = dev_read_addr(dev);
-	if (base == FDT_ADDR_T_NONE) {
-		debug("%s: Failed to find address (err=%d\n)", __func__, ret);
-		return -EINVAL;
-	}
-	reg = (u8 *)base;
-	ret = sunxi_ahci_phy_init(reg);
+	ret = sunxi_ahci_phy_init(priv);
+	if (ret == -EINPROGRESS)
+		return ret;
 	if (ret) {
 		debug("%s: Failed to init phy (err=%d\n)", __func__, ret);
 		return ret;
 	}
-	ret = ahci_probe_scsi(dev, base);
+	ret = ahci_probe_scsi(dev, priv->base);
 	if (ret) {
 		debug("%s: Failed to probe (err=%d\n)", __func__, ret);
 		return ret;
@@ -96,6 +139,29 @@ static int sunxi_sata_probe(struct udevice *dev)
 	return 0;
 }
 
+static int sunxi_sata_probe(struct udevice *dev)
+{
+	struct sunxi_ahci_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	priv->base = dev_read_addr(dev);
+	if (priv->base == FDT_ADDR_T_NONE) {
+		debug("%s: Failed to find address\n", __func__);
+		return -EINVAL;
+	}
+	writel(0, (u8 *)priv->base + AHCI_RWCR);
+	sunxi_ahci_wait(priv, PHY_RESET, 5000);
+
+	/* Let the PHY start up while other devices are probed */
+	if (CONFIG_IS_ENABLED(DM_ASYNC_PROBE))
+		return -EINPROGRESS;
+
+	while ((ret = sunxi_sata_probe_finish(dev)) == -EINPROGRESS)
+		WATCHDOG_RESET();
+
+	return ret;
+}
+
 static int sunxi_sata_bind(struct udevice *dev)
 {
 	struct udevice *scsi_dev;
@@ -122,4 +188,8 @@ U_BOOT_DRIVER(ahci_sunxi_drv) = {
 	.of_match	= sunxi_ahci_ids,
 	.bind		= sunxi_sata_bind,
 	.probe		= sunxi_sata_probe,
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+	.probe_finish	= sunxi_sata_probe_finish,
+#endif
+	.priv_auto_alloc_size = sizeof(struct sunxi_ahci_priv),
 };
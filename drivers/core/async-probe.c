@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Start probing slow devices early and complete them while other
+ * initialisation runs
+ *
+ * Drivers which spend most of their probe time waiting for hardware (e.g.
+ * for a PHY to link up or a card to power on) can split probe() into a part
+ * that starts the hardware and returns -EINPROGRESS, and a non-blocking
+ * probe_finish() method. This file starts all such devices in dependency
+ * order and polls them until they are done, so that the waits overlap with
+ * each other and with the rest of board_init_r().
+ */
+
+#define LOG_CATEGORY	LOGC_DM
+
+#include <common.h>
+#include <bootstage.h>
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <dm/device-internal.h>
+#include <dm/of_access.h>
+#include <dm/root.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum async_probe_state {
+	ASYNC_PROBE_WAITING,	/* waiting for suppliers */
+	ASYNC_PROBE_PENDING,	/* probe started, polling probe_finish() */
+	ASYNC_PROBE_DONE,	/* probed, failed, or probed by someone else */
+};
+
+/**
+ * struct async_probe - A device whose probe may be completed later
+ *
+ * @dev: Device to probe, or NULL if it has been unbound
+ * @start_us: Time at which the probe was started
+ * @state: Current state of the probe
+ * @ret: Result of the probe, once @state is ASYNC_PROBE_DONE
+ */
+struct async_probe {
+	struct udevice *dev;
+	ulong start_us;
+	enum async_probe_state state;
+	int ret;
+};
+
+/**
+ * struct async_probe_phandles - A property listing phandles of suppliers
+ *
+ * @name: Property name, e.g. "clocks"
+ * @cells_name: Property giving the number of argument cells, e.g.
+ *	"#clock-cells"
+ */
+struct async_probe_phandles {
+	const char *name;
+	const char *cells_name;
+};
+
+static const struct async_probe_phandles supplier_props[] = {
+	{ "clocks", "#clock-cells" },
+	{ "resets", "#reset-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "phys", "#phy-cells" },
+	{ "dmas", "#dma-cells" },
+};
+
+static struct async_probe *async_list;
+static int async_count;
+
+/* Find the entry for a device, or NULL if it is not in the list */
+static struct async_probe *async_probe_find(struct udevice *dev)
+{
+	int i;
+
+	for (i = 0; i < async_count; i++) {
+		if (async_list[i].dev == dev)
+			return &async_list[i];
+	}
+
+	return NULL;
+}
+
+/* Check whether a device is an unfinished entry in the list */
+static bool async_probe_busy(struct udevice *dev)
+{
+	struct async_probe *ap = async_probe_find(dev);
+
+	return ap && ap->state != ASYNC_PROBE_DONE;
+}
+
+/* Check whether the device for a node is an unfinished entry in the list */
+static bool async_probe_node_busy(ofnode node)
+{
+	int i;
+
+	if (!ofnode_valid(node))
+		return false;
+	for (i = 0; i < async_count; i++) {
+		struct async_probe *ap = &async_list[i];
+
+		if (ap->state != ASYNC_PROBE_DONE &&
+		    ofnode_equal(dev_ofnode(ap->dev), node))
+			return true;
+	}
+
+	return false;
+}
+
+static bool async_probe_supply_busy(const char *name, const void *val,
+				    int len)
+{
+	int name_len = strlen(name);
+
+	if (len != sizeof(fdt32_t) || name_len < 7 ||
+	    strcmp(name + name_len - 7, "-supply"))
+		return false;
+
+	return async_probe_node_busy(ofnode_get_by_phandle(
+					fdt32_to_cpu(*(fdt32_t *)val)));
+}
+
+/**
+ * async_probe_blocked() - Check whether a device must wait for a supplier
+ *
+ * A device's suppliers are its parents and the devices referenced by its
+ * clocks, resets, power domains, PHYs, DMA channels and regulator supplies.
+ * Starting a device before its suppliers would make its probe() wait for
+ * them, so it is held back until none of them is waiting or pending.
+ *
+ * @ap: Entry to check
+ * @return true if a supplier has not finished probing
+ */
+static bool async_probe_blocked(struct async_probe *ap)
+{
+	struct udevice *dev = ap->dev;
+	ofnode node = dev_ofnode(dev);
+	struct ofnode_phandle_args args;
+	struct udevice *parent;
+	int i, j;
+
+	for (parent = dev->parent; parent; parent = parent->parent) {
+		if (async_probe_busy(parent))
+			return true;
+	}
+	if (!ofnode_valid(node))
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(supplier_props); i++) {
+		for (j = 0; !ofnode_parse_phandle_with_args(node,
+				supplier_props[i].name,
+				supplier_props[i].cells_name, 0, j, &args);
+		     j++) {
+			if (async_probe_node_busy(args.node))
+				return true;
+		}
+	}
+
+	if (ofnode_is_np(node)) {
+		struct property *pp;
+
+		for (pp = of_node_props(ofnode_to_np(node)); pp;
+		     pp = pp->next) {
+			if (async_probe_supply_busy(pp->name, pp->value,
+						    pp->length))
+				return true;
+		}
+	} else {
+		const void *blob = gd->fdt_blob;
+		const char *name;
+		const void *val;
+		int offset, len;
+
+		fdt_for_each_property_offset(offset, blob,
+					     ofnode_to_offset(node)) {
+			val = fdt_getprop_by_offset(blob, offset, &name, &len);
+			if (val && async_probe_supply_busy(name, val, len))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void async_probe_done(struct async_probe *ap, int ret)
+{
+	ap->state = ASYNC_PROBE_DONE;
+	ap->ret = ret;
+	if (ret)
+		log_err("Device '%s' failed to probe (err=%d)\n", ap->dev->name,
+			ret);
+	else
+		log_debug("%s: probed in %lu us\n", ap->dev->name,
+			  timer_get_boot_us() - ap->start_us);
+}
+
+static void async_probe_begin(struct async_probe *ap)
+{
+	int ret;
+
+	ap->start_us = timer_get_boot_us();
+	ret = device_probe_start(ap->dev);
+	if (ret == -EINPROGRESS)
+		ap->state = ASYNC_PROBE_PENDING;
+	else
+		async_probe_done(ap, ret);
+}
+
+void dm_probe_async_done(struct udevice *dev, int ret)
+{
+	struct async_probe *ap = async_probe_find(dev);
+
+	if (ap && ap->state != ASYNC_PROBE_DONE)
+		async_probe_done(ap, ret);
+}
+
+void dm_probe_async_unbind(struct udevice *dev)
+{
+	struct async_probe *ap = async_probe_find(dev);
+
+	if (ap) {
+		ap->dev = NULL;
+		ap->state = ASYNC_PROBE_DONE;
+	}
+}
+
+/* Start every device whose suppliers have finished, returning the number */
+static int async_probe_kick(void)
+{
+	int started = 0;
+	int i;
+
+	for (i = 0; i < async_count; i++) {
+		struct async_probe *ap = &async_list[i];
+
+		if (ap->state != ASYNC_PROBE_WAITING || async_probe_blocked(ap))
+			continue;
+		async_probe_begin(ap);
+		started++;
+	}
+
+	return started;
+}
+
+static int async_probe_add(struct udevice *parent, int count)
+{
+	struct udevice *dev;
+
+	list_for_each_entry(dev, &parent->child_head, sibling_node) {
+		if (dev->driver->probe_finish &&
+		    !(dev->flags & (DM_FLAG_ACTIVATED |
+				    DM_FLAG_PROBE_PENDING))) {
+			if (async_list)
+				async_list[count].dev = dev;
+			count++;
+		}
+		count = async_probe_add(dev, count);
+	}
+
+	return count;
+}
+
+int dm_probe_async_start(void)
+{
+	int count;
+
+	if (async_list)
+		return -EALREADY;
+	count = async_probe_add(dm_root(), 0);
+	if (!count)
+		return 0;
+
+	async_list = calloc(count, sizeof(*async_list));
+	if (!async_list)
+		return log_msg_ret("async", -ENOMEM);
+	async_count = async_probe_add(dm_root(), 0);
+	log_debug("Starting %d devices\n", async_count);
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_PROBE_ASYNC, "dm_probe_async");
+	async_probe_kick();
+
+	return 0;
+}
+
+int dm_probe_async_poll(void)
+{
+	int remaining = 0;
+	int i;
+
+	/* This records the result through dm_probe_async_done() */
+	for (i = 0; i < async_count; i++) {
+		if (async_list[i].state == ASYNC_PROBE_PENDING)
+			device_probe_poll(async_list[i].dev);
+	}
+
+	async_probe_kick();
+	for (i = 0; i < async_count; i++) {
+		if (async_list[i].state != ASYNC_PROBE_DONE)
+			remaining++;
+	}
+
+	return remaining;
+}
+
+int dm_probe_async_finish(void)
+{
+	int ret = 0;
+	int i;
+
+	if (!async_list)
+		return 0;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_PROBE_WAIT, "dm_probe_wait");
+	while (dm_probe_async_poll()) {
+		bool pending = false;
+
+		for (i = 0; i < async_count; i++) {
+			if (async_list[i].state == ASYNC_PROBE_PENDING)
+				pending = true;
+		}
+
+		/*
+		 * If nothing is pending but devices are still waiting, their
+		 * suppliers depend on each other. Start them anyway and let
+		 * device_probe() sort out the order.
+		 */
+		if (!pending) {
+			for (i = 0; i < async_count; i++) {
+				if (async_list[i].state == ASYNC_PROBE_WAITING)
+					async_probe_begin(&async_list[i]);
+			}
+		}
+		WATCHDOG_RESET();
+	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_PROBE_WAIT);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_PROBE_ASYNC);
+
+	for (i = 0; i < async_count && !ret; i++)
+		ret = async_list[i].ret;
+	free(async_list);
+	async_list = NULL;
+	async_count = 0;
+
+	return ret;
+}
@@ -65,7 +65,7 @@ int device_unbind(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev->flags & DM_FLAG_ACTIVATED)
+	if (dev->flags & (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING))
 		return -EINVAL;
 
 	if (!(dev->flags & DM_FLAG_BOUND))
@@ -102,6 +102,9 @@ int device_unbind(struct udevice *dev)
 
 	if (dev->parent)
 		list_del(&dev->sibling_node);
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+	dm_probe_async_unbind(dev);
+#endif
 
 	devres_release_all(dev);
 
@@ -162,6 +165,12 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!dev)
 		return -EINVAL;
 
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+	/* Let a pending probe finish so the driver sees a consistent state */
+	if ((dev->flags & DM_FLAG_PROBE_PENDING) && device_probe(dev))
+		return 0;
+#endif
+
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -28,6 +28,7 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <watchdog.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -377,6 +378,72 @@ fail:
 	return ret;
 }
 
+/* Undo the effects of a failed probe */
+static void device_probe_undo(struct udevice *dev)
+{
+	dev->flags &= ~(DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING);
+
+	dev->seq = -1;
+	device_free(dev);
+}
+
+/* Complete the probe of a device once the driver's probe has finished */
+static int device_probe_post(struct udevice *dev)
+{
+	int ret;
+
+	ret = uclass_post_probe_device(dev);
+	if (ret) {
+		if (device_remove(dev, DM_REMOVE_NORMAL)) {
+			dm_warn("%s: Device '%s' failed to remove on error path\n",
+				__func__, dev->name);
+		}
+		device_probe_undo(dev);
+
+		return ret;
+	}
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
+		pinctrl_select_state(dev, "default");
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+int device_probe_poll(struct udevice *dev)
+{
+	int ret;
+
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return 0;
+
+	ret = dev->driver->probe_finish(dev);
+	if (ret == -EINPROGRESS)
+		return ret;
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	if (ret) {
+		device_probe_undo(dev);
+	} else {
+		dev->flags |= DM_FLAG_ACTIVATED;
+		ret = device_probe_post(dev);
+	}
+	dm_probe_async_done(dev, ret);
+
+	return ret;
+}
+
+/* Wait for a pending probe to complete */
+static int device_probe_wait(struct udevice *dev)
+{
+	int ret;
+
+	while ((ret = device_probe_poll(dev)) == -EINPROGRESS)
+		WATCHDOG_RESET();
+
+	return ret;
+}
+#endif
+
 int device_probe(struct udevice *dev)
 {
 	const struct driver *drv;
@@ -386,6 +453,10 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		return device_probe_wait(dev);
+#endif
 	if (dev->flags & DM_FLAG_ACTIVATED)
 		return 0;
 
@@ -408,8 +479,8 @@ int device_probe(struct udevice *dev)
 		 * (e.g. PCI bridge devices). Test the flags again
 		 * so that we don't mess up the device.
 		 */
-		if (dev->flags & DM_FLAG_ACTIVATED)
-			return 0;
+		if (dev->flags & (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING))
+			return device_probe(dev);
 	}
 
 	seq = uclass_resolve_seq(dev);
@@ -461,31 +532,44 @@ int device_probe(struct udevice *dev)
 
 	if (drv->probe) {
 		ret = drv->probe(dev);
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+		/* The device is not active until probe_finish() is done */
+		if (ret == -EINPROGRESS && drv->probe_finish) {
+			dev->flags &= ~DM_FLAG_ACTIVATED;
+			dev->flags |= DM_FLAG_PROBE_PENDING;
+			if (dev->flags & DM_FLAG_PROBE_ASYNC)
+				return ret;
+			return device_probe_wait(dev);
+		}
+#endif
 		if (ret)
 			goto fail;
 	}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
+	return device_probe_post(dev);
+fail:
+	device_probe_undo(dev);
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
-		pinctrl_select_state(dev, "default");
+	return ret;
+}
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev, DM_REMOVE_NORMAL)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
-	}
-fail:
-	dev->flags &= ~DM_FLAG_ACTIVATED;
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+int device_probe_start(struct udevice *dev)
+{
+	int ret;
 
-	dev->seq = -1;
-	device_free(dev);
+	if (!dev)
+		return -EINVAL;
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		return -EINPROGRESS;
+
+	dev->flags |= DM_FLAG_PROBE_ASYNC;
+	ret = device_probe(dev);
+	dev->flags &= ~DM_FLAG_PROBE_ASYNC;
 
 	return ret;
 }
+#endif
 
 void *dev_get_platdata(const struct udevice *dev)
 {
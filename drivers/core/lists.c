@@ -10,6 +10,8 @@
 
 #include <common.h>
 #include <errno.h>
+#include <malloc.h>
+#include <sort.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -18,6 +20,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/err.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -50,6 +55,75 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id)
 	return NULL;
 }
 
+static int bind_driver_info(struct udevice *parent, bool pre_reloc_only,
+			    const struct driver_info *entry,
+			    struct udevice **devp, int *resultp)
+{
+	int ret;
+
+	ret = device_bind_by_name(parent, pre_reloc_only, entry, devp);
+	if (ret && ret != -EPERM) {
+		dm_warn("No match for driver '%s'\n", entry->name);
+		if (!*resultp || ret != -ENOENT)
+			*resultp = ret;
+	}
+
+	return ret;
+}
+
+#if CONFIG_IS_ENABLED(OF_PLATDATA) && !defined(CONFIG_SPL_BUILD)
+int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
+{
+	struct driver_info *info =
+		ll_entry_start(struct driver_info, driver_info);
+	const int n_ents = ll_entry_count(struct driver_info, driver_info);
+	struct udevice **devs;
+	bool pending, progress;
+	int result = 0;
+	int i, ret;
+
+	/*
+	 * Entries are sorted by name, so a parent can come after its
+	 * children. Bind in passes, each binding the entries whose parent is
+	 * bound already. devs[] holds the device bound for each entry, or
+	 * ERR_PTR() if binding failed, in which case any children are bound
+	 * to @parent instead.
+	 */
+	devs = calloc(n_ents, sizeof(*devs));
+	if (!devs)
+		return -ENOMEM;
+	do {
+		pending = false;
+		progress = false;
+		for (i = 0; i < n_ents; i++) {
+			const struct driver_info *entry = info + i;
+			struct udevice *bind_to = parent;
+
+			if (devs[i])
+				continue;
+			if (entry->parent) {
+				struct udevice *pdev;
+
+				pdev = devs[entry->parent - info];
+				if (!pdev) {
+					pending = true;
+					continue;
+				}
+				if (!IS_ERR(pdev))
+					bind_to = pdev;
+			}
+			ret = bind_driver_info(bind_to, pre_reloc_only, entry,
+					       &devs[i], &result);
+			if (ret)
+				devs[i] = ERR_PTR(ret);
+			progress = true;
+		}
+	} while (pending && progress);
+	free(devs);
+
+	return result;
+}
+#else
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 {
 	struct driver_info *info =
@@ -58,19 +132,13 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 	struct driver_info *entry;
 	struct udevice *dev;
 	int result = 0;
-	int ret;
 
-	for (entry = info; entry != info + n_ents; entry++) {
-		ret = device_bind_by_name(parent, pre_reloc_only, entry, &dev);
-		if (ret && ret != -EPERM) {
-			dm_warn("No match for driver '%s'\n", entry->name);
-			if (!result || ret != -ENOENT)
-				result = ret;
-		}
-	}
+	for (entry = info; entry != info + n_ents; entry++)
+		bind_driver_info(parent, pre_reloc_only, entry, &dev, &result);
 
 	return result;
 }
+#endif
 
 int device_bind_driver(struct udevice *parent, const char *drv_name,
 		       const char *dev_name, struct udevice **devp)
@@ -124,11 +192,141 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_entry - entry in the index of compatible strings
+ *
+ * @compat:	Compatible string, same as @id->compatible
+ * @drv:	Driver which has @id in its of_match list
+ * @id:		Match entry
+ */
+struct compat_entry {
+	const char *compat;
+	struct driver *drv;
+	const struct udevice_id *id;
+};
+
+/* All compatible strings of all drivers, sorted by string */
+static struct compat_entry *compat_index;
+static int compat_count;
+
+static int compat_entry_cmp(const void *a, const void *b)
+{
+	const struct compat_entry *ea = a, *eb = b;
+	int ret;
+
+	ret = strcmp(ea->compat, eb->compat);
+	if (ret)
+		return ret;
+
+	/* Keep the order of the linear search for duplicate strings */
+	if (ea->drv != eb->drv)
+		return ea->drv < eb->drv ? -1 : 1;
+
+	return ea->id < eb->id ? -1 : ea->id > eb->id;
+}
+
+static int compat_index_build(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *entry;
+	int count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	compat_index = malloc(count * sizeof(*compat_index));
+	if (!compat_index)
+		return -ENOMEM;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			compat_index[compat_count].compat = id->compatible;
+			compat_index[compat_count].drv = entry;
+			compat_index[compat_count].id = id;
+			compat_count++;
+		}
+	}
+	qsort(compat_index, compat_count, sizeof(*compat_index),
+	      compat_entry_cmp);
+
+	return 0;
+}
+
+/**
+ * compat_index_lookup() - Look up a compatible string in the index
+ *
+ * The index is built on first use, once full malloc() is available.
+ *
+ * @compat:	Compatible string to look up
+ * @drvp:	Returns the first driver which matches
+ * @of_idp:	Returns the match that was found
+ * @return 0 if found, -ENOENT if no driver matches, -EAGAIN if the index
+ *	is not available
+ */
+static int compat_index_lookup(const char *compat, struct driver **drvp,
+			       const struct udevice_id **of_idp)
+{
+	static bool failed;
+	int low = 0, high, mid;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || failed)
+		return -EAGAIN;
+	if (!compat_index && compat_index_build()) {
+		log_debug("Cannot build index of compatible strings\n");
+		failed = true;
+		return -EAGAIN;
+	}
+
+	high = compat_count;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (strcmp(compat_index[mid].compat, compat) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == compat_count || strcmp(compat_index[low].compat, compat))
+		return -ENOENT;
+
+	*drvp = compat_index[low].drv;
+	*of_idp = compat_index[low].id;
+
+	return 0;
+}
+#endif
+
+int lists_driver_lookup_compatible(const char *compat, struct driver **drvp,
+				   const struct udevice_id **of_idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+	int ret;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	ret = compat_index_lookup(compat, drvp, of_idp);
+	if (ret != -EAGAIN)
+		return ret;
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		ret = driver_check_compatible(entry->of_match, of_idp, compat);
+		if (!ret) {
+			*drvp = entry;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,13 +363,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		ret = lists_driver_lookup_compatible(compat, &entry, &id);
+		if (ret)
 			continue;
 
 		if (pre_reloc_only) {
@@ -41,7 +41,11 @@ struct udevice *dm_root(void)
 
 void dm_fixup_for_gd_move(struct global_data *new_gd)
 {
-	/* The sentinel node has moved, so update things that point to it */
+	/*
+	 * The sentinel node has moved, so update things that point to it.
+	 * The uclass table moves along with global_data and only points to
+	 * the uclasses, which stay where they are.
+	 */
 	if (gd->dm_root) {
 		new_gd->uclass_root.next->prev = &new_gd->uclass_root;
 		new_gd->uclass_root.prev->next = &new_gd->uclass_root;
@@ -138,6 +142,9 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+#if CONFIG_IS_ENABLED(DM_UCLASS_TABLE)
+	memset(gd->uclass_table, '\0', sizeof(gd->uclass_table));
+#endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -376,7 +383,13 @@ int dm_init_and_scan(bool pre_reloc_only)
 	}
 
 	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)) {
+		enum bootstage_id id = pre_reloc_only ?
+			BOOTSTAGE_ID_ACCUM_DM_SCAN_F :
+			BOOTSTAGE_ID_ACCUM_DM_SCAN_R;
+
+		bootstage_start(id, pre_reloc_only ? "dm_scan_f" : "dm_scan_r");
 		ret = dm_extended_scan_fdt(gd->fdt_blob, pre_reloc_only);
+		bootstage_accum(id);
 		if (ret) {
 			debug("dm_extended_scan_dt() failed: %d\n", ret);
 			return ret;
@@ -7,6 +7,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <env.h>
 #include <errno.h>
 #include <malloc.h>
@@ -168,8 +169,25 @@ static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
 
+/*
+ * With CONFIG_DFU_WRITE_DOUBLE_BUF and deferred writes enabled, dfu_buf is
+ * split into two halves of dfu_buf_half bytes. A filled half is handed over
+ * to dfu_write_pending() while dfu_write() goes on filling the other one.
+ * Halves are kept a multiple of the back end's get_write_align(), so that
+ * every write except the last one covers whole erase or write blocks. If
+ * the back end has no such size, or a half would be smaller than it, the
+ * whole buffer is written at once as before.
+ */
+static bool dfu_write_deferred;
+static unsigned long dfu_buf_half;
+static struct dfu_entity *dfu_pending;
+static u8 *dfu_pending_buf;
+static long dfu_pending_len;
+static int dfu_pending_ret;
+
 unsigned char *dfu_free_buf(void)
 {
+	dfu_pending = NULL;
 	free(dfu_buf);
 	dfu_buf = NULL;
 	return dfu_buf;
@@ -227,38 +245,122 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_buffer(struct dfu_entity *dfu, u8 *buf, long w_size)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   buf, w_size, 0);
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += w_size;
+	dfu->w_time += get_timer(start);
+
+	puts("#");
+
+	return ret;
+}
+
+void dfu_set_write_deferred(bool enable)
+{
+	dfu_write_deferred = enable;
+	if (!enable)
+		dfu_pending = NULL;
+}
+
+int dfu_write_pending(void)
+{
+	struct dfu_entity *dfu = dfu_pending;
+	int ret;
+
+	if (!dfu)
+		return 0;
+
+	dfu_pending = NULL;
+	ret = dfu_write_buffer(dfu, dfu_pending_buf, dfu_pending_len);
+	if (ret && !dfu_pending_ret)
+		dfu_pending_ret = ret;
+
+	return ret;
+}
+
+/* Complete the write of the pending half and return its result */
+static int dfu_write_pending_wait(void)
+{
+	int ret;
+
+	dfu_write_pending();
+	ret = dfu_pending_ret;
+	dfu_pending_ret = 0;
+
+	return ret;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	ret = dfu_write_pending_wait();
+	if (ret)
+		return ret;
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
-
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_buffer(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+/*
+ * Hand the filled half of the buffer over to dfu_write_pending() and switch
+ * to the other one. Without a split buffer this is a plain drain.
+ */
+static int dfu_write_buffer_swap(struct dfu_entity *dfu)
+{
+	int ret;
 
-	return ret;
+	if (!dfu_buf_half)
+		return dfu_write_buffer_drain(dfu);
+
+	/* the other half must be on the medium before it is reused */
+	ret = dfu_write_pending_wait();
+	if (ret)
+		return ret;
+
+	dfu_pending = dfu;
+	dfu_pending_buf = dfu->i_buf_start;
+	dfu_pending_len = dfu->i_buf - dfu->i_buf_start;
+
+	if (dfu->i_buf_start == dfu_buf)
+		dfu->i_buf_start = dfu_buf + dfu_buf_half;
+	else
+		dfu->i_buf_start = dfu_buf;
+	dfu->i_buf_end = dfu->i_buf_start + dfu_buf_half;
+	dfu->i_buf = dfu->i_buf_start;
+
+	return 0;
 }
 
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
 {
 	/* clear everything */
+	if (dfu_pending == dfu)
+		dfu_pending = NULL;
+	dfu_pending_ret = 0;
+	dfu_buf_half = 0;
 	dfu->crc = 0;
 	dfu->offset = 0;
 	dfu->i_blk_seq_num = 0;
@@ -268,6 +370,8 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->r_left = 0;
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
+	dfu->w_start = 0;
+	dfu->w_time = 0;
 
 	dfu->inited = 0;
 }
@@ -286,6 +390,17 @@ int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
 
 	dfu->i_buf_end = dfu->i_buf_start + dfu_get_buf_size();
 
+	if (IS_ENABLED(CONFIG_DFU_WRITE_DOUBLE_BUF) && !read &&
+	    dfu_write_deferred && dfu->get_write_align) {
+		unsigned long align = dfu->get_write_align(dfu);
+
+		if (align)
+			dfu_buf_half = rounddown(dfu_get_buf_size() / 2, align);
+		if (dfu_buf_half)
+			dfu->i_buf_end = dfu->i_buf_start + dfu_buf_half;
+	}
+	dfu->w_start = get_timer(0);
+
 	if (read) {
 		ret = dfu->get_medium_size(dfu, &dfu->r_left);
 		if (ret < 0)
@@ -310,9 +425,17 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
+	if (dfu->offset) {
+		ulong time = max(get_timer(dfu->w_start), 1UL);
+
+		printf("\nDFU %s: %llu bytes in %lu ms (%llu KiB/s), medium %lu ms\n",
+		       dfu->name, dfu->offset, time,
+		       lldiv(dfu->offset * 1000 / 1024, time), dfu->w_time);
+	}
+
 	if (dfu_hash_algo)
-		printf("\nDFU complete %s: 0x%08x\n", dfu_hash_algo->name,
-		       dfu->crc);
+		printf("%sDFU complete %s: 0x%08x\n", dfu->offset ? "" : "\n",
+		       dfu_hash_algo->name, dfu->crc);
 
 	dfu_flush_callback(dfu);
 
@@ -358,7 +481,7 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_swap(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
@@ -377,12 +500,15 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	dfu->i_buf += size;
 
 	/* if end or if buffer full flush */
-	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
+	if (size == 0)
 		ret = dfu_write_buffer_drain(dfu);
-		if (ret) {
-			dfu_transaction_cleanup(dfu);
-			return ret;
-		}
+	else if ((dfu->i_buf + size) > dfu->i_buf_end)
+		ret = dfu_write_buffer_swap(dfu);
+	else
+		ret = 0;
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
+		return ret;
 	}
 
 	return 0;
@@ -491,6 +617,7 @@ static int dfu_fill_entity(struct dfu_entity *dfu, char *s, int alt,
 	dfu->alt = alt;
 	dfu->max_buf_size = 0;
 	dfu->free_entity = NULL;
+	dfu->get_write_align = NULL;
 
 	/* Specific for mmc device */
 	if (strcmp(interface, "mmc") == 0) {
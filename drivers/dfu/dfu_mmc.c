@@ -222,6 +222,15 @@ int dfu_flush_medium_mmc(struct dfu_entity *dfu)
 	return ret;
 }
 
+static unsigned long dfu_get_write_align_mmc(struct dfu_entity *dfu)
+{
+	/* File writes are collected in dfu_file_buf, so any split will do */
+	if (dfu->layout != DFU_RAW_ADDR)
+		return 1;
+
+	return dfu->data.mmc.lba_blk_size;
+}
+
 int dfu_get_medium_size_mmc(struct dfu_entity *dfu, u64 *size)
 {
 	int ret;
@@ -413,6 +422,7 @@ int dfu_fill_entity_mmc(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->read_medium = dfu_read_medium_mmc;
 	dfu->write_medium = dfu_write_medium_mmc;
 	dfu->flush_medium = dfu_flush_medium_mmc;
+	dfu->get_write_align = dfu_get_write_align_mmc;
 	dfu->inited = 0;
 	dfu->free_entity = dfu_free_entity_mmc;
 
@@ -221,6 +221,12 @@ static int dfu_flush_medium_mtd(struct dfu_entity *dfu)
 	return 0;
 }
 
+static unsigned long dfu_get_write_align_mtd(struct dfu_entity *dfu)
+{
+	/* mtd_block_op() erases and writes whole blocks only */
+	return dfu->data.mtd.info->erasesize;
+}
+
 static unsigned int dfu_polltimeout_mtd(struct dfu_entity *dfu)
 {
 	/*
@@ -303,6 +309,7 @@ int dfu_fill_entity_mtd(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->read_medium = dfu_read_medium_mtd;
 	dfu->write_medium = dfu_write_medium_mtd;
 	dfu->flush_medium = dfu_flush_medium_mtd;
+	dfu->get_write_align = dfu_get_write_align_mtd;
 	dfu->poll_timeout = dfu_polltimeout_mtd;
 
 	/* initial state */
@@ -193,6 +193,14 @@ unsigned int dfu_polltimeout_nand(struct dfu_entity *dfu)
 	return DFU_DEFAULT_POLL_TIMEOUT;
 }
 
+static unsigned long dfu_get_write_align_nand(struct dfu_entity *dfu)
+{
+	struct mtd_info *mtd = get_nand_dev_by_index(nand_curr_device);
+
+	/* Each write erases the blocks it touches */
+	return mtd ? mtd->erasesize : 0;
+}
+
 int dfu_fill_entity_nand(struct dfu_entity *dfu, char *devstr, char *s)
 {
 	char *st;
@@ -242,6 +250,7 @@ int dfu_fill_entity_nand(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->read_medium = dfu_read_medium_nand;
 	dfu->write_medium = dfu_write_medium_nand;
 	dfu->flush_medium = dfu_flush_medium_nand;
+	dfu->get_write_align = dfu_get_write_align_nand;
 	dfu->poll_timeout = dfu_polltimeout_nand;
 
 	/* initial state */
@@ -40,6 +40,11 @@ static int dfu_write_medium_ram(struct dfu_entity *dfu, u64 offset,
 	return dfu_transfer_medium_ram(DFU_OP_WRITE, dfu, offset, buf, len);
 }
 
+static unsigned long dfu_get_write_align_ram(struct dfu_entity *dfu)
+{
+	return 1;
+}
+
 int dfu_get_medium_size_ram(struct dfu_entity *dfu, u64 *size)
 {
 	*size = dfu->data.ram.size;
@@ -79,6 +84,7 @@ int dfu_fill_entity_ram(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->write_medium = dfu_write_medium_ram;
 	dfu->get_medium_size = dfu_get_medium_size_ram;
 	dfu->read_medium = dfu_read_medium_ram;
+	dfu->get_write_align = dfu_get_write_align_ram;
 
 	dfu->inited = 0;
 
@@ -71,6 +71,12 @@ static int dfu_flush_medium_sf(struct dfu_entity *dfu)
 	return 0;
 }
 
+static unsigned long dfu_get_write_align_sf(struct dfu_entity *dfu)
+{
+	/* Each write erases the sector it starts in */
+	return dfu->data.sf.dev->sector_size;
+}
+
 static unsigned int dfu_polltimeout_sf(struct dfu_entity *dfu)
 {
 	/*
@@ -195,6 +201,7 @@ int dfu_fill_entity_sf(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->read_medium = dfu_read_medium_sf;
 	dfu->write_medium = dfu_write_medium_sf;
 	dfu->flush_medium = dfu_flush_medium_sf;
+	dfu->get_write_align = dfu_get_write_align_sf;
 	dfu->poll_timeout = dfu_polltimeout_sf;
 	dfu->free_entity = dfu_free_entity_sf;
 
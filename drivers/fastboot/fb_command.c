@@ -28,6 +28,38 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+#define STREAM_SEG_SIZE	CONFIG_FASTBOOT_FLASH_STREAM_SEG_SIZE
+
+/**
+ * stream_part - partition the next download is streamed to, if any
+ */
+static char stream_part[PART_NAME_LEN + 1];
+
+/**
+ * streamed_part - partition the last download was streamed to, if any
+ */
+static char streamed_part[PART_NAME_LEN + 1];
+
+/**
+ * stream_active - the current download is streamed
+ * stream_failed - writing the current download failed
+ * stream_response - response to the current download once it completes
+ */
+static bool stream_active;
+static bool stream_failed;
+static char stream_response[FASTBOOT_RESPONSE_LEN];
+
+/**
+ * stream_seg - segment of the buffer currently being filled
+ * stream_seg_fill - number of bytes in the current segment
+ * stream_pending - full segment waiting to be written, or -1
+ */
+static int stream_seg;
+static u32 stream_seg_fill;
+static int stream_pending = -1;
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -39,6 +71,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -88,6 +123,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -157,6 +198,7 @@ static void getvar(char *cmd_parameter, char *response)
  */
 static void download(char *cmd_parameter, char *response)
 {
+	bool stream = false;
 	char *tmp;
 
 	if (!cmd_parameter) {
@@ -169,13 +211,31 @@ static void download(char *cmd_parameter, char *response)
 		fastboot_fail("Expected nonzero image size", response);
 		return;
 	}
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	streamed_part[0] = '\0';
+	if (stream_part[0]) {
+		/* A streamed download only needs to fit the partition */
+		if (fastboot_mmc_stream_start(stream_part, response)) {
+			stream_part[0] = '\0';
+			return;
+		}
+		stream_active = true;
+		stream_failed = false;
+		stream_seg = 0;
+		stream_seg_fill = 0;
+		stream_pending = -1;
+		stream = true;
+	}
+#endif
+
 	/*
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
 	 *
 	 * where cmd_parameter is an 8 digit hexadecimal number
 	 */
-	if (fastboot_bytes_expected > fastboot_buf_size) {
+	if (fastboot_bytes_expected > fastboot_buf_size && !stream) {
 		fastboot_fail(cmd_parameter, response);
 	} else {
 		printf("Starting download of %d bytes\n",
@@ -194,6 +254,92 @@ u32 fastboot_data_remaining(void)
 	return fastboot_bytes_expected - fastboot_bytes_received;
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void *stream_seg_addr(int seg)
+{
+	return fastboot_buf_addr + seg * STREAM_SEG_SIZE;
+}
+
+/**
+ * stream_write() - Write a segment of a streamed download to storage
+ *
+ * @buf: Pointer to segment data
+ * @len: Size of segment data
+ *
+ * After the first failure the rest of the download is dropped and
+ * stream_response holds the reason.
+ */
+static void stream_write(const void *buf, u32 len)
+{
+	if (stream_failed)
+		return;
+
+	if (fastboot_mmc_stream_write(buf, len, stream_response))
+		stream_failed = true;
+}
+
+/**
+ * stream_download() - Collect streamed data into the segments
+ *
+ * @data: Pointer to received fastboot data
+ * @len: Length of received fastboot data
+ *
+ * A full segment is left for fastboot_data_flush() while the next data goes
+ * to the other segment.
+ */
+static void stream_download(const void *data, unsigned int len)
+{
+	u32 n;
+
+	while (len) {
+		n = min(len, STREAM_SEG_SIZE - stream_seg_fill);
+		memcpy(stream_seg_addr(stream_seg) + stream_seg_fill, data, n);
+		stream_seg_fill += n;
+		data += n;
+		len -= n;
+
+		if (stream_seg_fill == STREAM_SEG_SIZE) {
+			/* The other segment must be written before reuse */
+			fastboot_data_flush();
+			stream_pending = stream_seg;
+			stream_seg ^= 1;
+			stream_seg_fill = 0;
+		}
+	}
+}
+
+static bool stream_is_active(void)
+{
+	return stream_active;
+}
+#else
+static inline void stream_download(const void *data, unsigned int len)
+{
+}
+
+static inline bool stream_is_active(void)
+{
+	return false;
+}
+#endif
+
+/**
+ * fastboot_data_flush() - Write out received data when streaming
+ *
+ * When the current download is streamed to storage, write the segment
+ * filled by fastboot_data_download(), if any.
+ */
+void fastboot_data_flush(void)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (stream_pending < 0)
+		return;
+
+	stream_write(stream_seg_addr(stream_pending), STREAM_SEG_SIZE);
+	stream_pending = -1;
+#endif
+}
+
 /**
  * fastboot_data_download() - Copy image data to fastboot_buf_addr.
  *
@@ -222,9 +368,12 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	/* Download data to fastboot_buf_addr, or stream it to storage */
+	if (stream_is_active())
+		stream_download(fastboot_data, fastboot_data_len);
+	else
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -254,6 +403,30 @@ void fastboot_data_complete(char *response)
 	env_set_hex("filesize", image_size);
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (stream_active) {
+		char finish_response[FASTBOOT_RESPONSE_LEN];
+
+		fastboot_data_flush();
+		if (stream_seg_fill)
+			stream_write(stream_seg_addr(stream_seg),
+				     stream_seg_fill);
+		if (fastboot_mmc_stream_finish(stream_failed ?
+					       finish_response :
+					       stream_response))
+			stream_failed = true;
+		strlcpy(response, stream_response, FASTBOOT_RESPONSE_LEN);
+
+		/* The image is not in the buffer, so it cannot be booted */
+		image_size = 0;
+		if (!stream_failed)
+			strlcpy(streamed_part, stream_part,
+				sizeof(streamed_part));
+		stream_part[0] = '\0';
+		stream_active = false;
+	}
+#endif
 }
 
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
@@ -268,6 +441,19 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	/* A streamed image has already been written while downloading */
+	if (streamed_part[0]) {
+		if (strcmp(cmd_parameter, streamed_part))
+			fastboot_fail("image was streamed to another partition",
+				      response);
+		else
+			fastboot_okay(NULL, response);
+		streamed_part[0] = '\0';
+		return;
+	}
+#endif
+
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -335,3 +521,31 @@ static void oem_format(char *cmd_parameter, char *response)
 	}
 }
 #endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * oem_stream() - Stream the next download to a partition
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ *
+ * The next download is written to the partition as it arrives, so that it
+ * is not limited by the size of the download buffer. The following "flash"
+ * command for the same partition just reports success.
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	if (!cmd_parameter || !*cmd_parameter) {
+		fastboot_fail("partition not given", response);
+		return;
+	}
+
+	if (2 * STREAM_SEG_SIZE > fastboot_buf_size) {
+		fastboot_fail("buffer too small for streaming", response);
+		return;
+	}
+
+	strlcpy(stream_part, cmd_parameter, sizeof(stream_part));
+	fastboot_okay(NULL, response);
+}
+#endif
@@ -97,6 +97,45 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+
+	return fb_mmc_blk_write(dev_desc, blk, blkcnt, NULL);
+}
+#endif
+
+static void fb_mmc_init_sparse(struct blk_desc *dev_desc,
+			       disk_partition_t *info,
+			       struct sparse_storage *sparse,
+			       struct fb_mmc_sparse *sparse_priv)
+{
+	struct mmc *mmc __maybe_unused;
+
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	sparse->erase = NULL;
+	sparse->mssg = fastboot_fail;
+	sparse->priv = sparse_priv;
+
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	/* Zero-filled chunks can be erased if that yields zeroes */
+	mmc = find_mmc_device(dev_desc->devnum);
+	if (mmc && mmc_erase_reads_zero(mmc)) {
+		sparse->erase = fb_mmc_sparse_erase;
+		sparse->erase_blkcnt = mmc->erase_grp_size;
+	}
+#endif
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -490,19 +529,11 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
+		fb_mmc_init_sparse(dev_desc, &info, &sparse, &sparse_priv);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
@@ -513,6 +544,121 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * struct fb_mmc_stream - state of an image streamed to a partition
+ */
+static struct fb_mmc_stream {
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	char part_name[PART_NAME_LEN + 1];
+	bool started;
+	bool is_sparse;
+	lbaint_t blk;
+	struct fb_mmc_sparse sparse_priv;
+	struct sparse_storage sparse;
+	struct sparse_stream stream;
+} fb_mmc_stream;
+
+/**
+ * fastboot_mmc_stream_start() - Prepare streaming an image to eMMC
+ *
+ * @cmd: Named partition to write image to
+ * @response: Pointer to fastboot response buffer
+ */
+int fastboot_mmc_stream_start(const char *cmd, char *response)
+{
+	struct fb_mmc_stream *fs = &fb_mmc_stream;
+
+	memset(fs, '\0', sizeof(*fs));
+	if (fastboot_mmc_get_part_info(cmd, &fs->dev_desc, &fs->info,
+				       response) < 0)
+		return -ENOENT;
+
+	strlcpy(fs->part_name, cmd, sizeof(fs->part_name));
+	fs->blk = fs->info.start;
+
+	return 0;
+}
+
+/**
+ * fastboot_mmc_stream_write() - Write the next segment of a streamed image
+ *
+ * All segments but the last must be a multiple of the block size.
+ *
+ * @buffer: Pointer to segment data
+ * @len: Size of segment data
+ * @response: Pointer to fastboot response buffer
+ */
+int fastboot_mmc_stream_write(const void *buffer, u32 len, char *response)
+{
+	struct fb_mmc_stream *fs = &fb_mmc_stream;
+	lbaint_t blkcnt;
+	lbaint_t blks;
+
+	if (!fs->started) {
+		fs->started = true;
+		fs->is_sparse = len >= sizeof(sparse_header_t) &&
+				is_sparse_image((void *)buffer);
+		if (fs->is_sparse) {
+			fb_mmc_init_sparse(fs->dev_desc, &fs->info,
+					   &fs->sparse, &fs->sparse_priv);
+			printf("Flashing sparse image at offset " LBAFU "\n",
+			       fs->sparse.start);
+			if (sparse_stream_start(&fs->stream, &fs->sparse,
+						response))
+				return -ENOMEM;
+		} else {
+			puts("Flashing Raw Image\n");
+		}
+	}
+
+	if (fs->is_sparse)
+		return sparse_stream_write(&fs->stream, buffer, len,
+					   response) ? -EIO : 0;
+
+	blkcnt = DIV_ROUND_UP(len, fs->info.blksz);
+	if (fs->blk + blkcnt > fs->info.start + fs->info.size) {
+		pr_err("too large for partition: '%s'\n", fs->part_name);
+		fastboot_fail("too large for partition", response);
+		return -EFBIG;
+	}
+
+	blks = fb_mmc_blk_write(fs->dev_desc, fs->blk, blkcnt, buffer);
+	if (blks != blkcnt) {
+		pr_err("failed writing to device %d\n", fs->dev_desc->devnum);
+		fastboot_fail("failed writing to device", response);
+		return -EIO;
+	}
+	fs->blk += blkcnt;
+
+	return 0;
+}
+
+/**
+ * fastboot_mmc_stream_finish() - Complete streaming an image to eMMC
+ *
+ * @response: Pointer to fastboot response buffer
+ */
+int fastboot_mmc_stream_finish(char *response)
+{
+	struct fb_mmc_stream *fs = &fb_mmc_stream;
+
+	if (fs->is_sparse) {
+		if (sparse_stream_finish(&fs->stream, fs->part_name,
+					 response))
+			return -EIO;
+	} else {
+		printf("........ wrote " LBAFU " bytes to '%s'\n",
+		       (fs->blk - fs->info.start) * fs->info.blksz,
+		       fs->part_name);
+	}
+	fastboot_okay(NULL, response);
+
+	return 0;
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -122,13 +122,21 @@ static int regex_callback(const char *name, const char *attributes, void *priv)
 	struct regex_callback_priv *cbp = (struct regex_callback_priv *)priv;
 	struct slre slre;
 	char regex[strlen(name) + 3];
+	int plain;
+
+	/*
+	 * Most names in the list are not regular expressions, so compare
+	 * them directly rather than compiling each one for every lookup
+	 */
+	plain = !strpbrk(name, "\\^$.[]|()?*+");
 
 	/* Require the whole string to be described by the regex */
 	sprintf(regex, "^%s$", name);
-	if (slre_compile(&slre, regex)) {
-		struct cap caps[slre.num_caps + 2];
+	if (plain || slre_compile(&slre, regex)) {
+		struct cap caps[plain ? 1 : slre.num_caps + 2];
 
-		if (slre_match(&slre, cbp->searched_for,
+		if (plain ? !strcmp(name, cbp->searched_for) :
+		    slre_match(&slre, cbp->searched_for,
 			       strlen(cbp->searched_for), caps)) {
 			free(cbp->regex);
 			if (!attributes) {
@@ -61,6 +61,33 @@ char *env_get_default(const char *name)
 	return ret_val;
 }
 
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+/* Default environment in binary form, made on first use */
+static char *default_env_bin;
+static ssize_t default_env_bin_size;
+#endif
+
+/* Import the default environment, or the listed variables from it */
+static int env_import_default(int flags, int nvars, char * const vars[])
+{
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+	if (!default_env_bin) {
+		default_env_bin_size = htext_to_bin(
+				(char *)default_environment,
+				sizeof(default_environment), '\0',
+				&default_env_bin);
+		if (default_env_bin_size < 0)
+			default_env_bin = NULL;
+	}
+	if (default_env_bin)
+		return himport_bin_r(&env_htab, default_env_bin,
+				     default_env_bin_size, flags, nvars, vars);
+#endif
+	return himport_r(&env_htab, (char *)default_environment,
+			 sizeof(default_environment), '\0', flags, 0, nvars,
+			 vars);
+}
+
 void env_set_default(const char *s, int flags)
 {
 	if (sizeof(default_environment) > ENV_SIZE) {
@@ -79,9 +106,7 @@ void env_set_default(const char *s, int flags)
 		debug("Using default environment\n");
 	}
 
-	if (himport_r(&env_htab, (char *)default_environment,
-			sizeof(default_environment), '\0', flags, 0,
-			0, NULL) == 0)
+	if (env_import_default(flags, 0, NULL) == 0)
 		pr_err("## Error: Environment import failed: errno = %d\n",
 		       errno);
 
@@ -98,9 +123,7 @@ int env_set_default_vars(int nvars, char * const vars[], int flags)
 	 * (and use \0 as a separator)
 	 */
 	flags |= H_NOCLEAR;
-	return himport_r(&env_htab, (const char *)default_environment,
-				sizeof(default_environment), '\0',
-				flags, 0, nvars, vars);
+	return env_import_default(flags, nvars, vars);
 }
 
 /*
@@ -110,6 +133,7 @@ int env_set_default_vars(int nvars, char * const vars[], int flags)
 int env_import(const char *buf, int check)
 {
 	env_t *ep = (env_t *)buf;
+	int ret;
 
 	if (check) {
 		uint32_t crc;
@@ -122,8 +146,14 @@ int env_import(const char *buf, int check)
 		}
 	}
 
-	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
-			0, NULL)) {
+	if (CONFIG_IS_ENABLED(ENV_BINARY) &&
+	    hbin_detect((char *)ep->data, ENV_SIZE))
+		ret = himport_bin_r(&env_htab, (char *)ep->data, ENV_SIZE, 0,
+				    0, NULL);
+	else
+		ret = himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0,
+				0, 0, NULL);
+	if (ret) {
 		gd->flags |= GD_FLG_ENV_READY;
 		return 0;
 	}
@@ -208,7 +238,12 @@ int env_export(env_t *env_out)
 	ssize_t	len;
 
 	res = (char *)env_out->data;
-	len = hexport_r(&env_htab, '\0', 0, &res, ENV_SIZE, 0, NULL);
+	len = -1;
+	/* The binary form is larger, so fall back to text if it won't fit */
+	if (CONFIG_IS_ENABLED(ENV_BINARY))
+		len = hexport_bin_r(&env_htab, 0, &res, ENV_SIZE);
+	if (len < 0)
+		len = hexport_r(&env_htab, '\0', 0, &res, ENV_SIZE, 0, NULL);
 	if (len < 0) {
 		pr_err("Cannot export environment: errno = %d\n", errno);
 		return 1;
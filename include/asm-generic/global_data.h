@@ -22,6 +22,7 @@
 #ifndef __ASSEMBLY__
 #include <fdtdec.h>
 #include <membuff.h>
+#include <dm/uclass-id.h>
 #include <linux/list.h>
 
 typedef struct global_data {
@@ -67,6 +68,10 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+#if CONFIG_IS_ENABLED(DM_UCLASS_TABLE)
+	/* Uclasses in uclass_root, indexed by ID */
+	struct uclass *uclass_table[UCLASS_COUNT];
+#endif
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
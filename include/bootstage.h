@@ -205,6 +205,11 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_FSP_M,
 	BOOTSTATE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_DM_SCAN_F,
+	BOOTSTAGE_ID_ACCUM_DM_SCAN_R,
+	BOOTSTAGE_ID_ACCUM_DM_PROBE_ASYNC,
+	BOOTSTAGE_ID_ACCUM_DM_PROBE_WAIT,
+	BOOTSTAGE_ID_ACCUM_RAMDISK,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -310,6 +315,17 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * Add to the number of bytes handled by a bootstage activity
+ *
+ * This is shown in the report next to the time, so that the throughput of
+ * activities such as copying images can be seen.
+ *
+ * @param id	Bootstage id to record the bytes against
+ * @param bytes	Number of bytes to add
+ */
+void bootstage_add_bytes(enum bootstage_id id, ulong bytes);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -409,6 +425,10 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline void bootstage_add_bytes(enum bootstage_id id, ulong bytes)
+{
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
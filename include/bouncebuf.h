@@ -68,4 +68,59 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
  */
 int bounce_buffer_stop(struct bounce_buffer *state);
 
+/*
+ * Statistics about bounce buffers, collected once U-Boot has relocated.
+ * The pool counts include buffers from bounce_buffer_alloc().
+ */
+struct bounce_buffer_stats {
+	/* Number of calls to bounce_buffer_start() */
+	ulong starts;
+	/* Number of those which used the caller's buffer directly */
+	ulong direct;
+	/* Number of bytes copied to or from bounce buffers */
+	ulong copied;
+	/* Number of times a buffer in the pool was reused */
+	ulong pool_hits;
+	/* Number of bytes reserved for the pool, 0 if there is none */
+	ulong pool_size;
+	/* Number of buffers allocated with malloc() instead of the pool */
+	ulong pool_misses;
+};
+
+/**
+ * bounce_buffer_init() -- Reserve the pool of bounce buffers
+ *
+ * This is called once U-Boot has relocated and malloc() is ready. If there
+ * is not enough memory, the pool is left empty and each buffer comes from
+ * malloc() instead.
+ *
+ * Return: 0 (this cannot fail)
+ */
+int bounce_buffer_init(void);
+
+/**
+ * bounce_buffer_alloc() -- Allocate a DMA-aligned buffer
+ * len:		length of the buffer, which is rounded up to a whole number
+ *		of DMA-aligned blocks
+ *
+ * Transfers to or from the buffer never need to bounce, so a caller which
+ * needs somewhere to read data into, such as a filesystem, can use this to
+ * avoid a copy. The buffer comes from the pool when possible.
+ *
+ * Return: pointer to the buffer, or NULL if out of memory
+ */
+void *bounce_buffer_alloc(size_t len);
+
+/**
+ * bounce_buffer_free() -- Free a buffer from bounce_buffer_alloc()
+ * buf:		buffer to free, or NULL to do nothing
+ */
+void bounce_buffer_free(void *buf);
+
+/**
+ * bounce_buffer_get_stats() -- Get statistics about bounce buffers
+ * stats:	returns the statistics
+ */
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats);
+
 #endif
@@ -174,6 +174,30 @@ BZ_EXTERN int BZ_API(BZ2_bzDecompressEnd) (
       bz_stream *strm
    );
 
+/*-- U-Boot: decompression with a caller-supplied work area --*/
+
+/*
+ * Return the number of bytes of work area needed for a
+ * block size of blockSize100k (1 to 9, from the "BZh"
+ * header), using the small or the fast method.
+ */
+BZ_EXTERN unsigned int BZ_API(BZ2_bzDecompressWorkSize) (
+      int blockSize100k,
+      int small
+   );
+
+/*
+ * Like BZ2_bzDecompressInit() but take all memory from
+ * work instead of malloc(). The fast method is used if
+ * the work area is large enough for it, else the small
+ * one. BZ2_bzDecompressEnd() must still be called.
+ */
+BZ_EXTERN int BZ_API(BZ2_bzDecompressInitWork) (
+      bz_stream *strm,
+      void *work,
+      unsigned int len
+   );
+
 
 /*-- High(er) level library functions --*/
 
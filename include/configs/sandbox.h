@@ -102,8 +102,13 @@
 					"eth5addr=00:00:11:22:33:47\0" \
 					"ipaddr=1.2.3.4\0"
 
+/*
+ * bootm_size is larger than the RAM, so a ramdisk copied high could land on
+ * U-Boot's own data. Use the ramdisk in place unless told otherwise.
+ */
 #define MEM_LAYOUT_ENV_SETTINGS \
 	"bootm_size=0x10000000\0" \
+	"initrd_high=0xffffffffffffffff\0" \
 	"kernel_addr_r=0x1000000\0" \
 	"fdt_addr_r=0xc00000\0" \
 	"ramdisk_addr_r=0x2000000\0" \
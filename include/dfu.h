@@ -139,6 +139,13 @@ struct dfu_entity {
 	int (*flush_medium)(struct dfu_entity *dfu);
 	unsigned int (*poll_timeout)(struct dfu_entity *dfu);
 
+	/*
+	 * Size which every write_medium() call except the last one must be a
+	 * multiple of, e.g. the erase block size for media which erase on
+	 * write. 0 or no callback if writes must not be split.
+	 */
+	unsigned long (*get_write_align)(struct dfu_entity *dfu);
+
 	void (*free_entity)(struct dfu_entity *dfu);
 
 	struct list_head list;
@@ -155,6 +162,9 @@ struct dfu_entity {
 
 	u32 bad_skip;	/* for nand use */
 
+	ulong w_start;	/* transaction start, for rate reporting */
+	ulong w_time;	/* time spent in write_medium() [ms] */
+
 	unsigned int inited:1;
 };
 
@@ -187,6 +197,27 @@ int dfu_read(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_set_write_deferred() - allow dfu_write() to defer medium writes
+ *
+ * With CONFIG_DFU_WRITE_DOUBLE_BUF the DFU buffer is then split into two
+ * halves. Once a half is full, dfu_write() only hands it over and continues
+ * with the other half; the caller must call dfu_write_pending() from its
+ * main loop to write it to the medium. dfu_flush() writes everything out.
+ *
+ * @enable: true if the caller calls dfu_write_pending()
+ */
+void dfu_set_write_deferred(bool enable);
+
+/**
+ * dfu_write_pending() - write a buffer half handed over by dfu_write()
+ *
+ * An error is also returned by the next dfu_write() or dfu_flush() call.
+ *
+ * @return 0 if nothing was pending or it was written, error code otherwise
+ */
+int dfu_write_pending(void);
+
 /**
  * dfu_initiated_callback - weak callback called on DFU transaction start
  *
@@ -103,13 +103,62 @@ int device_ofdata_to_platdata(struct udevice *dev);
  * device_probe() - Probe a device, activating it
  *
  * Activate a device so that it is ready for use. All its parents are probed
- * first.
+ * first. If the device has a probe which is still pending (see
+ * device_probe_start()), this waits for it to complete.
  *
  * @dev: Pointer to device to probe
  * @return 0 if OK, -ve on error
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_start() - Start probing a device without waiting for it
+ *
+ * This works like device_probe() except that if the driver's probe() method
+ * returns -EINPROGRESS, the device is left with DM_FLAG_PROBE_PENDING set and
+ * this function returns immediately. The probe must then be completed with
+ * device_probe_poll(), or by a later call to device_probe().
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if the device is probed, -EINPROGRESS if the probe is pending,
+ *	other -ve on error
+ */
+int device_probe_start(struct udevice *dev);
+
+/**
+ * device_probe_poll() - Check whether a pending probe has completed
+ *
+ * This calls the driver's probe_finish() method for a device with a pending
+ * probe, completing the probe if it is done. If the driver reports an error
+ * the device is left inactive, as if probe() had failed.
+ *
+ * @dev: Pointer to device to check
+ * @return 0 if the device is probed (or has no pending probe), -EINPROGRESS
+ *	if the probe is still pending, other -ve on error
+ */
+int device_probe_poll(struct udevice *dev);
+
+/**
+ * dm_probe_async_done() - Record the result of a pending probe
+ *
+ * This is called when the pending probe of a device completes, whoever
+ * polled it, so that dm_probe_async_finish() can report the result.
+ *
+ * @dev: Device whose probe has completed
+ * @ret: 0 if the device is probed, else -ve error from the probe
+ */
+void dm_probe_async_done(struct udevice *dev, int ret);
+
+/**
+ * dm_probe_async_unbind() - Forget a device which is being unbound
+ *
+ * This stops dm_probe_async_start()'s list from referring to the device
+ * once it has been freed.
+ *
+ * @dev: Device being unbound
+ */
+void dm_probe_async_unbind(struct udevice *dev);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
@@ -73,6 +73,12 @@ struct driver_info;
  */
 #define DM_FLAG_REMOVE_WITH_PD_ON	(1 << 13)
 
+/* device_probe_start() is probing this device and need not wait for it */
+#define DM_FLAG_PROBE_ASYNC		(1 << 14)
+
+/* Driver probe() has been started but probe_finish() has not yet completed */
+#define DM_FLAG_PROBE_PENDING		(1 << 15)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -218,7 +224,14 @@ struct udevice_id {
  * @of_match: List of compatible strings to match, and any identifying data
  * for each.
  * @bind: Called to bind a device to its driver
- * @probe: Called to probe a device, i.e. activate it
+ * @probe: Called to probe a device, i.e. activate it. If probe_finish() is
+ * provided this may return -EINPROGRESS after starting the hardware, in
+ * which case probe_finish() is polled to complete the probe.
+ * @probe_finish: Called to check whether a probe which returned -EINPROGRESS
+ * has completed. Returns 0 when done, -EINPROGRESS if still waiting or
+ * another -ve error if the probe failed. This must not block. The device is
+ * not marked as activated until this returns 0. Only present with
+ * CONFIG_DM_ASYNC_PROBE; without it, probe() must not return -EINPROGRESS.
  * @remove: Called to remove a device, i.e. de-activate it
  * @unbind: Called to unbind a device from its driver
  * @ofdata_to_platdata: Called before probe to decode device tree data
@@ -252,6 +265,9 @@ struct driver {
 	const struct udevice_id *of_match;
 	int (*bind)(struct udevice *dev);
 	int (*probe)(struct udevice *dev);
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+	int (*probe_finish)(struct udevice *dev);
+#endif
 	int (*remove)(struct udevice *dev);
 	int (*unbind)(struct udevice *dev);
 	int (*ofdata_to_platdata)(struct udevice *dev);
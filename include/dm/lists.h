@@ -23,6 +23,21 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compatible() - Find the driver for a compatible string
+ *
+ * This returns the first driver, in linker-list order, with @compat in its
+ * of_match list. With CONFIG_DM_COMPAT_INDEX this is looked up in a sorted
+ * index once full malloc() is available.
+ *
+ * @compat: Compatible string to look up
+ * @drvp: Returns the driver which matches
+ * @of_idp: Returns the match that was found
+ * @return 0 if found, -ENOENT if no driver matches
+ */
+int lists_driver_lookup_compatible(const char *compat, struct driver **drvp,
+				   const struct udevice_id **of_idp);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  * id:		ID of the class
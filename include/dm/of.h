@@ -39,6 +39,9 @@ struct property {
  * @parent: Pointer to parent node, or NULL if this is the root node
  * @child: Pointer to head of child node list, or NULL if no children
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
+ * @props_offset: Offset of the node in the flat tree while its properties
+ *	are still to be unflattened, else -1. Use of_node_props() to get at
+ *	the properties.
  */
 struct device_node {
 	const char *name;
@@ -50,8 +53,30 @@ struct device_node {
 	struct device_node *parent;
 	struct device_node *child;
 	struct device_node *sibling;
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	int props_offset;
+#endif
 };
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/**
+ * of_node_props() - Get the properties of a node
+ *
+ * The properties of a node are unflattened from the flat tree when they are
+ * first needed.
+ *
+ * @np: Node to check
+ * @return pointer to head of list of properties, or NULL if none (or out of
+ *	memory)
+ */
+struct property *of_node_props(const struct device_node *np);
+#else
+static inline struct property *of_node_props(const struct device_node *np)
+{
+	return np->properties;
+}
+#endif
+
 #define OF_MAX_PHANDLE_ARGS 16
 
 /**
@@ -22,12 +22,18 @@
  * @name:	Driver name
  * @platdata:	Driver-specific platform data
  * @platdata_size: Size of platform data structure
+ * @parent:	Entry for the parent device, or NULL to bind the device to the
+ *		root device. This is set by dtoc when it is run with --parents,
+ *		which is only done for U-Boot proper.
  */
 struct driver_info {
 	const char *name;
 	const void *platdata;
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 	uint platdata_size;
+#ifndef CONFIG_SPL_BUILD
+	const struct driver_info *parent;
+#endif
 #endif
 };
 
@@ -43,4 +49,11 @@ struct driver_info {
 #define U_BOOT_DEVICES(__name)						\
 	ll_entry_declare_list(struct driver_info, __name, driver_info)
 
+/*
+ * Get a pointer to a device declared earlier with U_BOOT_DEVICE(). Unlike
+ * ll_entry_get() this can be used in a static initialiser.
+ */
+#define U_BOOT_DEVICE_REF(__name)					\
+	(&_u_boot_list_2_driver_info_2_##__name)
+
 #endif
@@ -114,6 +114,45 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+/**
+ * dm_probe_async_start() - Start probing devices which can finish later
+ *
+ * This finds all bound devices whose driver has a probe_finish() method and
+ * starts probing them, in an order such that each device's parents and the
+ * devices it references (clocks, resets, power domains, PHYs, DMA channels
+ * and regulator supplies) are probed first. Devices whose probe() returns
+ * -EINPROGRESS are left pending, to be completed by dm_probe_async_poll()
+ * and dm_probe_async_finish(). Anything which calls device_probe() on a
+ * pending device waits for it to complete.
+ *
+ * @return 0 if OK, -EALREADY if already started, other -ve on error
+ */
+int dm_probe_async_start(void);
+
+/**
+ * dm_probe_async_poll() - Make progress on pending probes
+ *
+ * This completes any pending probes which have finished, then starts any
+ * devices which were waiting for them. It does not block.
+ *
+ * @return number of devices which are not yet probed
+ */
+int dm_probe_async_poll(void);
+
+/**
+ * dm_probe_async_finish() - Wait for all probes started by
+ * dm_probe_async_start()
+ *
+ * The time from dm_probe_async_start() is recorded in bootstage as
+ * "dm_probe_async", and the time spent waiting here as "dm_probe_wait". The
+ * difference between the two is the time saved by overlapping the probes
+ * with other work.
+ *
+ * @return 0 if OK, else the error from the first device in the list which
+ *	failed to probe
+ */
+int dm_probe_async_finish(void);
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
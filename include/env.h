@@ -128,7 +128,8 @@ char *from_env(const char *envvar);
  *
  * This function is called from env_get() if the environment has not been
  * loaded yet (GD_FLG_ENV_READY flag is 0). Some environment locations will
- * support reading the value (slowly) and some will not.
+ * support reading the value (slowly) and some will not. With
+ * CONFIG_ENV_BINARY the stored environment may be in either format.
  *
  * @varname:	Variable to look up
  * @return value of variable, or NULL if not found
@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Binary environment format
+ *
+ * This is an alternative to the usual list of '\0'-terminated "name=value"
+ * strings. Each variable is stored with the lengths of its name and value
+ * and the hash of its name, so that it can be added to the environment hash
+ * table without parsing the text or hashing the name again.
+ *
+ * The environment data starts with a struct env_bin_hdr, which is followed
+ * by hdr->count records. Each record is a struct env_bin_rec followed by the
+ * name and the value, each with a terminating '\0', padded to a multiple of
+ * four bytes. All fields are in the byte order of the target.
+ *
+ * This file is used by host tools as well as U-Boot, so should only use
+ * plain C types.
+ */
+
+#ifndef __ENV_BIN_H
+#define __ENV_BIN_H
+
+#ifdef USE_HOSTCC
+#include <stddef.h>
+#include <stdint.h>
+#else
+#include <linux/types.h>
+#endif
+
+/* "\x7fENB" when stored little-endian, which is not a valid variable name */
+#define ENV_BIN_MAGIC		0x424e457f
+#define ENV_BIN_VERSION		1
+
+/* Record flags */
+#define ENV_BIN_DELETE		(1 << 0)	/* delete the variable */
+
+/**
+ * struct env_bin_hdr - Header of a binary environment
+ *
+ * @magic: ENV_BIN_MAGIC
+ * @version: ENV_BIN_VERSION
+ * @hdr_size: Size of this header in bytes, so that later versions can add
+ *	fields to it
+ * @reserved: Must be 0
+ * @count: Number of records
+ * @size: Total size of the records in bytes
+ * @crc: CRC32 of the records
+ */
+struct env_bin_hdr {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t hdr_size;
+	uint16_t reserved;
+	uint32_t count;
+	uint32_t size;
+	uint32_t crc;
+};
+
+/**
+ * struct env_bin_rec - Header of one variable in a binary environment
+ *
+ * @hash: Hash of the name, as calculated by env_bin_hash()
+ * @name_len: Length of the name, excluding the terminating '\0'
+ * @flags: Record flags (ENV_BIN_...)
+ * @value_len: Length of the value, excluding the terminating '\0'
+ */
+struct env_bin_rec {
+	uint32_t hash;
+	uint16_t name_len;
+	uint16_t flags;
+	uint32_t value_len;
+};
+
+/**
+ * env_bin_hash() - Calculate the hash of a variable name
+ *
+ * This is the hash used by the environment hash table before it is reduced
+ * to the size of the table. It is hashpjw from [Aho,Sethi,Ullman], which
+ * uses every character of the name, so that names with a long common
+ * prefix (bootcmd_mmc0, bootcmd_mmc1, ...) do not collide.
+ *
+ * @name: Variable name
+ * @len: Length of @name
+ * @return hash value
+ */
+static inline uint32_t env_bin_hash(const char *name, size_t len)
+{
+	uint32_t hval = 0, g;
+
+	while (len-- > 0) {
+		hval = (hval << 4) + (unsigned char)*name++;
+		g = hval & 0xf0000000;
+		if (g)
+			hval ^= g ^ (g >> 24);
+	}
+
+	return hval;
+}
+
+/**
+ * env_bin_rec_size() - Get the size of a record
+ *
+ * @name_len: Length of the variable name
+ * @value_len: Length of the variable value
+ * @return number of bytes taken by the record, including padding
+ */
+static inline size_t env_bin_rec_size(size_t name_len, size_t value_len)
+{
+	return sizeof(struct env_bin_rec) +
+		((name_len + 1 + value_len + 1 + 3) & ~3);
+}
+
+#endif
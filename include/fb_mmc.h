@@ -28,6 +28,42 @@ int fastboot_mmc_get_part_info(const char *part_name,
  */
 void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 			      u32 download_bytes, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Prepare streaming an image to eMMC
+ *
+ * The image is then written segment by segment while it is downloaded,
+ * see fastboot_mmc_stream_write().
+ *
+ * @cmd: Named partition to write image to
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_start(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_write() - Write the next segment of a streamed image
+ *
+ * Raw and sparse images are told apart by the start of the first segment.
+ * All segments but the last must be a multiple of the block size.
+ *
+ * @buffer: Pointer to segment data
+ * @len: Size of segment data
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_write(const void *buffer, u32 len, char *response);
+
+/**
+ * fastboot_mmc_stream_finish() - Complete streaming an image to eMMC
+ *
+ * This must be called for every started stream, also after an error.
+ *
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if the complete image was written, -ve on error
+ */
+int fastboot_mmc_stream_finish(char *response);
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
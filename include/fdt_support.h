@@ -173,6 +173,86 @@ int fdt_pci_dma_ranges(void *blob, int phb_off, struct pci_controller *hose);
 
 int fdt_find_or_add_subnode(void *fdt, int parentoffset, const char *name);
 
+#if CONFIG_IS_ENABLED(OF_FIXUP_BATCH)
+/**
+ * fdt_batch_begin() - Start recording property edits to a device tree
+ *
+ * Each fdt_setprop() which adds or resizes a property moves the rest of the
+ * blob, so a series of fixups costs the blob size times the number of edits.
+ * Between fdt_batch_begin() and fdt_batch_end(), fdt_batch_setprop() only
+ * records each edit and fdt_batch_end() writes them all with one pass over
+ * the blob.
+ *
+ * While a batch is open, the blob still holds the old property values and
+ * must not be changed other than through fdt_batch_setprop() and
+ * fdt_find_or_add_subnode(). Node offsets stay valid until fdt_batch_end()
+ * or fdt_batch_flush(). Calls may be nested, in which case the edits are
+ * written by the outermost fdt_batch_end().
+ *
+ * @fdt: FDT blob to edit
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_begin(void *fdt);
+
+/**
+ * fdt_batch_end() - Write recorded edits and stop recording
+ *
+ * @fdt: FDT blob being edited
+ * @return 0 if OK, -FDT_ERR_... if any recorded edit could not be written,
+ *	e.g. -FDT_ERR_NOSPACE
+ */
+int fdt_batch_end(void *fdt);
+
+/**
+ * fdt_batch_flush() - Write recorded edits and keep recording
+ *
+ * This invalidates node offsets, as fdt_setprop() does.
+ *
+ * @fdt: FDT blob being edited
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_flush(void *fdt);
+
+/**
+ * fdt_batch_setprop() - Set a property, as part of a batch if one is open
+ *
+ * This is the same as fdt_setprop(), except that if a batch has been
+ * started on @fdt the edit is recorded and written later. Setting the same
+ * property twice records only the last value. Running out of space is then
+ * reported by fdt_batch_end().
+ *
+ * @fdt: FDT blob to edit
+ * @nodeoffset: Offset of the node whose property to set
+ * @name: Name of the property
+ * @val: Value of the property, which is copied
+ * @len: Length of the value in bytes
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_batch_setprop(void *fdt, int nodeoffset, const char *name,
+		      const void *val, int len);
+#else
+static inline int fdt_batch_begin(void *fdt)
+{
+	return 0;
+}
+
+static inline int fdt_batch_end(void *fdt)
+{
+	return 0;
+}
+
+static inline int fdt_batch_flush(void *fdt)
+{
+	return 0;
+}
+
+static inline int fdt_batch_setprop(void *fdt, int nodeoffset,
+				    const char *name, const void *val, int len)
+{
+	return fdt_setprop(fdt, nodeoffset, name, val, len);
+}
+#endif
+
 /**
  * Add board-specific data to the FDT before booting the OS.
  *
@@ -327,6 +407,7 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 			    u32 height, u32 stride, const char *format);
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
+int fdt_overlay_apply_multi_verbose(void *fdt, void *const fdtos[], int count);
 
 /**
  * fdt_get_cells_len() - Get the length of a type of cell in top-level nodes
@@ -661,6 +661,74 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+#if CONFIG_IS_ENABLED(OF_INDEX)
+/**
+ * fdtdec_node_offset_by_phandle() - Find a node by its phandle
+ *
+ * This behaves like fdt_node_offset_by_phandle(), but uses the lookup index
+ * when @blob is the control DT.
+ *
+ * @blob: Device tree blob
+ * @phandle: Phandle to look up
+ * @return offset of the node, or -ve FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * fdtdec_parent_offset() - Find the parent of a node
+ *
+ * This behaves like fdt_parent_offset(), but uses the lookup index when
+ * @blob is the control DT.
+ *
+ * @blob: Device tree blob
+ * @node: Offset of the node
+ * @return offset of the parent node, or -ve FDT_ERR_... on error
+ */
+int fdtdec_parent_offset(const void *blob, int node);
+
+/**
+ * fdtdec_path_offset() - Find a node by its path or alias
+ *
+ * This behaves like fdt_path_offset(), but looks up plain alias names in the
+ * lookup index when @blob is the control DT.
+ *
+ * @blob: Device tree blob
+ * @path: Full path of the node, or an alias
+ * @return offset of the node, or -ve FDT_ERR_... on error
+ */
+int fdtdec_path_offset(const void *blob, const char *path);
+
+/**
+ * fdtdec_index_invalidate() - Drop the lookup index of the control DT
+ *
+ * The index is rebuilt on next use. This must be called after changing a
+ * blob, since a change which leaves its size alone (e.g. with
+ * fdt_setprop_inplace() or fdt_nop_node()) is not noticed otherwise.
+ *
+ * @blob: Blob which was changed, or NULL to drop the index whatever blob it
+ *	was built from
+ */
+void fdtdec_index_invalidate(const void *blob);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline int fdtdec_parent_offset(const void *blob, int node)
+{
+	return fdt_parent_offset(blob, node);
+}
+
+static inline int fdtdec_path_offset(const void *blob, const char *path)
+{
+	return fdt_path_offset(blob, path);
+}
+
+static inline void fdtdec_index_invalidate(const void *blob) {}
+#endif
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
@@ -1017,6 +1085,8 @@ int fdtdec_set_ethernet_mac_address(void *fdt, const u8 *mac, size_t size);
  */
 static inline int fdtdec_set_phandle(void *blob, int node, uint32_t phandle)
 {
+	fdtdec_index_invalidate(blob);
+
 	return fdt_setprop_u32(blob, node, "phandle", phandle);
 }
 
@@ -23,6 +23,17 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks so that they read back as zero. When set,
+	 * zero-filled chunks (and the don't-care chunks around them) are
+	 * batched up and erased in units of erase_blkcnt blocks instead of
+	 * being written. Must return the number of blocks erased.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	lbaint_t	erase_blkcnt;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -37,5 +48,88 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/*
+ * Range of device blocks which must read back as zero, collected from
+ * consecutive zero-filled chunks. [start, end) also covers neighbouring
+ * don't-care chunks so that a larger aligned area can be erased, while
+ * [zero_start, zero_end) is the part that really has to be zeroed.
+ */
+struct sparse_zero_run {
+	lbaint_t	start;
+	lbaint_t	end;
+	lbaint_t	zero_start;
+	lbaint_t	zero_end;
+};
+
+/* Buffer holding the pattern of CHUNK_TYPE_FILL chunks */
+struct sparse_fill_buf {
+	uint32_t	*buf;
+	uint32_t	val;
+	int		num_blks;
+};
+
+/**
+ * struct sparse_stream - state of a sparse image written piece by piece
+ *
+ * All members are private to lib/image-sparse.c
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	int			state;
+	sparse_header_t		sparse_header;
+	chunk_header_t		chunk_header;
+	uint32_t		hdr_len;
+	uint32_t		fill_val;
+	uint32_t		chunk;
+	uint32_t		left;
+	lbaint_t		blk;
+	uint32_t		bytes_written;
+	uint32_t		total_blocks;
+	struct sparse_fill_buf	fill;
+	struct sparse_zero_run	zero_run;
+	void			*blk_buf;
+	uint32_t		blk_len;
+};
+
+/**
+ * sparse_stream_start() - Start writing a sparse image in pieces
+ *
+ * @stream: Stream state to initialise
+ * @info: Storage to write the image to
+ * @response: Pointer to response buffer, passed to @info->mssg on error
+ * @return 0 if OK, -1 on error
+ */
+int sparse_stream_start(struct sparse_stream *stream,
+			struct sparse_storage *info, char *response);
+
+/**
+ * sparse_stream_write() - Write the next piece of a sparse image
+ *
+ * The image may be split at any byte offset. Data following the last chunk
+ * is ignored.
+ *
+ * @stream: Stream started with sparse_stream_start()
+ * @data: Next piece of the image
+ * @len: Length of @data in bytes
+ * @response: Pointer to response buffer, passed to @info->mssg on error
+ * @return 0 if OK, -1 on error
+ */
+int sparse_stream_write(struct sparse_stream *stream, const void *data,
+			uint32_t len, char *response);
+
+/**
+ * sparse_stream_finish() - Complete writing a sparse image
+ *
+ * This must be called for every started stream, also after an error, to
+ * release its buffers.
+ *
+ * @stream: Stream started with sparse_stream_start()
+ * @part_name: Name of the partition, for messages
+ * @response: Pointer to response buffer, passed to @info->mssg on error
+ * @return 0 if the complete image was written, -1 otherwise
+ */
+int sparse_stream_finish(struct sparse_stream *stream, const char *part_name,
+			 char *response);
+
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
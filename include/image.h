@@ -308,6 +308,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -725,6 +726,42 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size);
 
 int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 		  ulong *initrd_start, ulong *initrd_end);
+
+/**
+ * boot_ramdisk_relocates() - Check if the ramdisk is copied before booting
+ *
+ * @return true if boot_ramdisk_high() copies the ramdisk to a new place,
+ *	false if it is used where it is, as set by "initrd_high"
+ */
+bool boot_ramdisk_relocates(void);
+
+/**
+ * boot_ramdisk_alloc() - Reserve the final place for the ramdisk
+ *
+ * This picks the place that boot_ramdisk_high() would, but does not copy
+ * the ramdisk there.
+ *
+ * @lmb:	Memory map to reserve the place in
+ * @rd_data:	Current address of the ramdisk
+ * @rd_len:	Size of the ramdisk in bytes
+ * @initrd_start: Returns the final address of the ramdisk
+ * @return 0 if OK, -ENOMEM if there is no room below "initrd_high". No
+ *	message is printed.
+ */
+int boot_ramdisk_alloc(struct lmb *lmb, ulong rd_data, ulong rd_len,
+		       ulong *initrd_start);
+
+/**
+ * boot_ramdisk_copy() - Copy the ramdisk to its final place
+ *
+ * The time taken and the number of bytes are added to the bootstage
+ * record for BOOTSTAGE_ID_ACCUM_RAMDISK.
+ *
+ * @dest:	Final address of the ramdisk
+ * @src:	Current address of the ramdisk
+ * @len:	Size of the ramdisk in bytes
+ */
+void boot_ramdisk_copy(ulong dest, ulong src, ulong len);
 int boot_get_cmdline(struct lmb *lmb, ulong *cmd_start, ulong *cmd_end);
 #ifdef CONFIG_SYS_BOOT_GET_KBD
 int boot_get_kbd(struct lmb *lmb, bd_t **kbd);
@@ -885,6 +922,64 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * image_decomp_inplace_layout() - Work out where to decompress in place
+ *
+ * LZO, LZ4 and zstd data can be decompressed over itself, if it is at the
+ * end of a region a little larger than the uncompressed data. This works
+ * out that region from the headers in the compressed data, so that the
+ * compressed image need not be copied somewhere else first.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start: Address of the compressed data
+ * @image_len:	Number of bytes of compressed data
+ * @srcp:	Returns the address that the compressed data must be at
+ * @endp:	Returns the end of the region, i.e. @srcp + @image_len
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp cannot be decompressed in
+ *	place, -ENODATA if the uncompressed size is not recorded, other -ve
+ *	value if the data is corrupt
+ */
+int image_decomp_inplace_layout(int comp, ulong load, ulong image_start,
+				ulong image_len, ulong *srcp, ulong *endp);
+
+/**
+ * image_decomp_get_len() - Find the length of compressed data
+ *
+ * This works out the length of LZO, LZ4 or zstd data from its headers, for
+ * use when only its start address is known, e.g. with booti. For zstd, only
+ * the first frame is included.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @image_start: Address of the compressed data
+ * @max_len:	Maximum number of bytes of compressed data
+ * @lenp:	Returns the number of bytes of compressed data
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, other -ve
+ *	value if the data is corrupt or longer than @max_len
+ */
+int image_decomp_get_len(int comp, ulong image_start, ulong max_len,
+			 ulong *lenp);
+
+/**
+ * image_decomp_inplace() - decompress an image over its compressed data
+ *
+ * This moves the compressed data to the end of the region given by
+ * image_decomp_inplace_layout() if needed and then decompresses it to @load.
+ *
+ * @lmb:	Memory map used to check that the region is free, or NULL
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start: Address of the compressed data
+ * @type:	OS type (IH_OS_...)
+ * @image_len:	Number of bytes of compressed data
+ * @load_end:	Returns the end of the decompressed data
+ * @return 0 if OK, -EBUSY if the region is not free, in which case nothing
+ *	is changed, other -ve on error
+ */
+int image_decomp_inplace(struct lmb *lmb, int comp, ulong load,
+			 ulong image_start, int type, ulong image_len,
+			 ulong *load_end);
+
 /**
  * Set up properties in the FDT
  *
@@ -1081,6 +1176,26 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *comment, int require_keys,
 			      const char *engine_id, const char *cmdname);
 
+/**
+ * fit_precalc_hashes() - calculate hash values of component images ahead
+ *
+ * Calculates the values of all image hash nodes in the FIT blob on up to
+ * @jobs threads. fit_add_verification_data() then uses these instead of
+ * hashing the images one after another. Values of images which are not
+ * ciphered are kept until fit_free_precalc_hashes(), so that calling this
+ * again for the same FIT (e.g. with more space) does not hash them again.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @jobs:	Maximum number of threads to use
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int fit_precalc_hashes(void *fit, int jobs);
+
+/**
+ * fit_free_precalc_hashes() - drop values calculated by fit_precalc_hashes()
+ */
+void fit_free_precalc_hashes(void);
+
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
 int fit_image_verify(const void *fit, int noffset);
@@ -305,6 +305,27 @@ int fdt_next_region(const void *fdt,
  */
 int fdt_add_alias_regions(const void *fdt, struct fdt_region *region, int count,
 			  int max_regions, struct fdt_region_state *info);
+
+/**
+ * fdt_overlay_apply_multi() - Apply several overlays to a device tree
+ *
+ * This has the same effect as calling fdt_overlay_apply() for each overlay
+ * in turn, but is faster when there are many overlays or the base tree is
+ * large. The largest phandle in the base tree is found only once and the
+ * base tree's symbols are indexed so that each fixup does not need to
+ * search /__symbols__ and then the tree.
+ *
+ * As with fdt_overlay_apply(), @fdt must have enough free space for all of
+ * the overlays, the overlays are destroyed and @fdt is left invalid if an
+ * error occurs.
+ *
+ * @fdt:	Base device tree blob
+ * @fdtos:	Device tree overlay blobs, applied in order
+ * @count:	Number of overlays
+ * @return 0 on success, -FDT_ERR_NOSPACE if there is not enough space in
+ * @fdt or not enough memory, other -FDT_ERR_... value on other errors
+ */
+int fdt_overlay_apply_multi(void *fdt, void *const fdtos[], int count);
 #endif /* SWIG */
 
 extern struct fdt_header *working_fdt;  /* Pointer to the working fdt */
@@ -31,6 +31,19 @@ int lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
 int lzop_decompress(const unsigned char *src, size_t src_len,
 		    unsigned char *dst, size_t *dst_len);
 
+/*
+ * get the size of buffer needed to decompress lzop data in place, with the
+ * compressed data at its end; returns 0 or a negative errno
+ */
+int lzop_inplace_size(const unsigned char *src, size_t src_len,
+		      size_t *size);
+
+/*
+ * get the length of the lzop data at the start of a buffer of src_len
+ * bytes, up to and including its end marker; returns 0 or a negative errno
+ */
+int lzop_stream_len(const unsigned char *src, size_t src_len, size_t *len);
+
 /* check if the header is valid (based on magic numbers) */
 bool lzop_is_valid_header(const unsigned char *src);
 
@@ -113,6 +113,15 @@ extern void * memcpy(void *,const void *,__kernel_size_t);
 #ifndef __HAVE_ARCH_MEMMOVE
 extern void * memmove(void *,const void *,__kernel_size_t);
 #endif
+
+/*
+ * The versions in lib/string.c. These exist for any function which the
+ * architecture does not provide, and for all three with CONFIG_UT_BENCH.
+ */
+void *memset_generic(void *s, int c, size_t count);
+void *memcpy_generic(void *dest, const void *src, size_t count);
+void *memmove_generic(void *dest, const void *src, size_t count);
+
 #ifndef __HAVE_ARCH_MEMSCAN
 extern void * memscan(void *,int,__kernel_size_t);
 #endif
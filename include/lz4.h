@@ -9,16 +9,51 @@
 /**
  * ulz4fn() - Decompress LZ4 data
  *
+ * The data may consist of several frames, which are decompressed one after
+ * the other. Skippable frames are ignored, as is anything after the last
+ * frame. With CONFIG_LZ4_CHECKSUM, checksums in the data are checked. With
+ * CONFIG_WORKER, independent blocks are decompressed on several CPUs when
+ * the output buffer does not overlap the input.
+ *
  * @src: Source data to decompress
  * @srcn: Length of source data
  * @dst: Destination for uncompressed data
  * @dstn: Returns length of uncompressed data
  * @return 0 if OK, -EPROTONOSUPPORT if the magic number or version number are
- *	not recognised or independent blocks are used, -EINVAL if the reserved
- *	fields are non-zero, or input is overrun, -EENOBUFS if the destination
- *	buffer is overrun, -EEPROTO if the compressed data causes an error in
- *	the decompression algorithm
+ *	not recognised, -EINVAL if the reserved fields are non-zero, or input
+ *	is overrun, -ENOBUFS if the destination buffer is overrun, -EPROTO if
+ *	the compressed data causes an error in the decompression algorithm,
+ *	-EBADMSG if a checksum does not match
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * ulz4fn_inplace_size() - Get the space needed to decompress in place
+ *
+ * LZ4 data can be decompressed over itself if it is placed at the end of a
+ * buffer which is a little larger than the uncompressed data. This works out
+ * how large that buffer must be. If a frame does not record the size of its
+ * uncompressed data, the maximum block size is used for each block.
+ *
+ * @src: Compressed data
+ * @srcn: Length of compressed data
+ * @sizep: Returns the size of buffer needed
+ * @return 0 if OK, -ve on error as for ulz4fn()
+ */
+int ulz4fn_inplace_size(const void *src, size_t srcn, size_t *sizep);
+
+/**
+ * ulz4fn_stream_len() - Get the length of LZ4 data from its headers
+ *
+ * This walks the frames and blocks at @src, as ulz4fn() would, without
+ * decompressing anything. It is useful when only the start of the data is
+ * known.
+ *
+ * @src: Compressed data
+ * @srcn: Maximum length of compressed data
+ * @lenp: Returns the length of the frames, up to the end of the last one
+ * @return 0 if OK, -ve on error as for ulz4fn()
+ */
+int ulz4fn_stream_len(const void *src, size_t srcn, size_t *lenp);
+
 #endif
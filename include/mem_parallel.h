@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Zeroing and testing large areas of memory on several CPUs
+ *
+ * An area, such as the whole of DRAM, is split into one share for each CPU
+ * provided by worker_run(). Each CPU then zeroes, fills or checks its own
+ * share and records how long this took, so that the bandwidth of each CPU
+ * can be reported.
+ *
+ * The shares are worked on a chunk at a time, and between chunks the boot
+ * CPU resets the watchdog and checks for Ctrl-C, so large areas can be
+ * handled. Secondary CPUs are only used where the architecture provides
+ * arch_worker_start(), which at present is only sandbox. Elsewhere all the
+ * shares are handled by the boot CPU.
+ */
+
+#ifndef __MEM_PARALLEL_H
+#define __MEM_PARALLEL_H
+
+#include <linux/types.h>
+
+#if CONFIG_IS_ENABLED(WORKER)
+#define MEM_PARALLEL_MAX	CONFIG_WORKER_MAX
+#else
+#define MEM_PARALLEL_MAX	1
+#endif
+
+/**
+ * struct mem_parallel_part - The share of the area handled by one CPU
+ *
+ * @addr: Address of the start of the share, as used by the 'md' command
+ * @buf: Pointer to the start of the share
+ * @size: Size of the share in bytes
+ * @pattern: Value of the first word of the share, when filling or checking
+ * @incr: Amount added to the pattern for each word
+ * @offset: Offset within the share of the chunk being worked on
+ * @len: Length of that chunk in bytes, 0 if the share is finished
+ * @write_us: Time taken to zero or fill the share, in microseconds
+ * @read_us: Time taken to check the share, in microseconds
+ * @errs: Number of words which were wrong when checking
+ * @err_addr: Address of the first wrong word
+ * @err_expect: Value expected in the first wrong word
+ * @err_actual: Value read from the first wrong word
+ */
+struct mem_parallel_part {
+	ulong addr;
+	void *buf;
+	ulong size;
+	ulong pattern;
+	long incr;
+	ulong offset;
+	ulong len;
+	ulong write_us;
+	ulong read_us;
+	ulong errs;
+	ulong err_addr;
+	ulong err_expect;
+	ulong err_actual;
+};
+
+/**
+ * struct mem_parallel - An area split between CPUs
+ *
+ * @count: Number of shares in use
+ * @parts: The shares, one for each CPU
+ */
+struct mem_parallel {
+	int count;
+	struct mem_parallel_part parts[MEM_PARALLEL_MAX];
+};
+
+/**
+ * mem_parallel_split() - Split an area between the available CPUs
+ *
+ * Shares are aligned to 4KB from the start of the area, so that CPUs do not
+ * share cache lines. A small area may have fewer shares than there are CPUs.
+ *
+ * @par: Returns the shares
+ * @addr: Address of the area, as used by the 'md' command
+ * @buf: Pointer to the area
+ * @size: Size of the area in bytes
+ */
+void mem_parallel_split(struct mem_parallel *par, ulong addr, void *buf,
+			ulong size);
+
+/**
+ * mem_parallel_zero() - Zero an area, with each CPU zeroing its share
+ *
+ * @par: Area to zero, as set up by mem_parallel_split()
+ * @return 0 if OK, -EINTR if interrupted by Ctrl-C, other -ve on error
+ */
+int mem_parallel_zero(struct mem_parallel *par);
+
+/**
+ * mem_parallel_fill() - Fill an area with a sequence of words
+ *
+ * The first word is set to @pattern, and each word after that to the value
+ * of the one before plus @incr. A trailing part-word is not changed.
+ *
+ * @par: Area to fill, as set up by mem_parallel_split()
+ * @pattern: Value of the first word
+ * @incr: Amount to add for each word, which may be negative
+ * @return 0 if OK, -EINTR if interrupted by Ctrl-C, other -ve on error
+ */
+int mem_parallel_fill(struct mem_parallel *par, ulong pattern, long incr);
+
+/**
+ * mem_parallel_check() - Check an area filled by mem_parallel_fill()
+ *
+ * The errors found in each share are recorded in its @errs, @err_addr,
+ * @err_expect and @err_actual.
+ *
+ * @par: Area to check, as filled by mem_parallel_fill()
+ * @return total number of words which were wrong, or -1UL if interrupted by
+ *	Ctrl-C
+ */
+ulong mem_parallel_check(struct mem_parallel *par);
+
+/**
+ * mem_parallel_show() - Show the bandwidth each CPU achieved
+ *
+ * This shows the write bandwidth of the last zero or fill and the read
+ * bandwidth of the last check.
+ *
+ * @par: Area to report on
+ */
+void mem_parallel_show(struct mem_parallel *par);
+
+#endif
@@ -81,6 +81,7 @@ struct bd_info;
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -226,6 +227,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_STROBE_SUPPORT		184	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
@@ -788,6 +790,18 @@ int board_mmc_getwp(struct mmc *mmc);
 #endif
 
 int mmc_set_dsr(struct mmc *mmc, u16 val);
+
+/**
+ * mmc_erase_reads_zero() - Check whether erased blocks read back as zero
+ *
+ * eMMC devices report the content of erased memory in EXT_CSD, SD cards in
+ * the DATA_STAT_AFTER_ERASE bit of the SCR. Callers can use this to replace
+ * writing runs of zeroes by an erase.
+ *
+ * @mmc:	MMC device
+ * @return true if an erased block is guaranteed to read as all zeroes
+ */
+bool mmc_erase_reads_zero(struct mmc *mmc);
 /* Function to change the size of boot partition and rpmb partitions */
 int mmc_boot_partition_size_change(struct mmc *mmc, unsigned long bootsize,
 					unsigned long rpmbsize);
@@ -355,4 +355,44 @@ int os_read_file(const char *name, void **bufp, int *sizep);
  */
 void *os_find_text_base(void);
 
+/**
+ * os_thread_start() - Start a host thread
+ *
+ * The thread runs @func, which must not use the U-Boot console, malloc()
+ * or driver model, since none of these are thread-safe.
+ *
+ * @threadp:	Returns a handle for the thread, to pass to os_thread_join()
+ * @func:	Function to run in the thread
+ * @arg:	Argument to pass to @func
+ * @return 0 if OK, -ve on error
+ */
+int os_thread_start(void **threadp, void (*func)(void *arg), void *arg);
+
+/**
+ * os_thread_join() - Wait for a host thread to finish
+ *
+ * This also frees the handle returned by os_thread_start().
+ *
+ * @thread:	Thread handle
+ * @return 0 if OK, -ve on error
+ */
+int os_thread_join(void *thread);
+
+/**
+ * os_get_cpu_count() - Get the number of CPUs available on the host
+ *
+ * @return number of CPUs, at least 1
+ */
+int os_get_cpu_count(void);
+
+/**
+ * os_get_cycles() - Read the host CPU's cycle counter
+ *
+ * On x86 hosts this is the time-stamp counter, which counts at a constant
+ * rate close to the CPU's nominal clock.
+ *
+ * @return current cycle count, or 0 if the host has no counter
+ */
+uint64_t os_get_cycles(void);
+
 #endif
@@ -45,6 +45,12 @@ struct hsearch_data {
 	struct env_entry_node *table;
 	unsigned int size;
 	unsigned int filled;
+	/* Number of deleted slots, which still lengthen searches */
+	unsigned int deleted;
+	/* Table indices of the entries sorted by key, or NULL if not built */
+	unsigned int *sorted;
+	/* Non-zero while callbacks run, when the table must not be moved */
+	unsigned int busy;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -92,6 +98,21 @@ int himport_r(struct hsearch_data *htab, const char *env, size_t size,
 	      const char sep, int flag, int crlf_is_lf, int nvars,
 	      char * const vars[]);
 
+/*
+ * Binary environment (see env_bin.h). hbin_detect() returns 1 if "env"
+ * starts like a binary environment. himport_bin_r() and hexport_bin_r() are
+ * otherwise the same as himport_r() and hexport_r() with a '\0' separator.
+ * htext_to_bin() converts data in the format accepted by himport_r() to a
+ * newly allocated binary environment and returns its size.
+ */
+int hbin_detect(const char *env, size_t size);
+int himport_bin_r(struct hsearch_data *htab, const char *env, size_t size,
+		  int flag, int nvars, char * const vars[]);
+ssize_t hexport_bin_r(struct hsearch_data *htab, int flag, char **resp,
+		      size_t size);
+ssize_t htext_to_bin(const char *env, size_t size, const char sep,
+		     char **resp);
+
 /* Walk the whole table calling the callback on each element */
 int hwalk_r(struct hsearch_data *htab,
 	    int (*callback)(struct env_entry *entry));
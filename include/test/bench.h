@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Micro-benchmarks run by the 'ut bench' command
+ *
+ * Each benchmark is a unit test which calls bench_run() for the functions it
+ * wants to time. Results are printed as they are measured, either for a
+ * person to read or, with 'ut bench -m', as comma-separated values so that
+ * a CI system can compare them with a previous run.
+ *
+ * Most benchmarks are in test/bench/. Those which need the data generators
+ * of a functional test are declared next to that test, inside
+ * #ifdef CONFIG_UT_BENCH, so that the functional test itself only checks
+ * the results and does not time anything. The benchmarks are not run by
+ * 'ut all'.
+ */
+
+#ifndef __TEST_BENCH_H__
+#define __TEST_BENCH_H__
+
+#include <test/test.h>
+
+/* Declare a new benchmark */
+#define BENCH_TEST(_name, _flags)	UNIT_TEST(_name, _flags, bench_test)
+
+/**
+ * typedef bench_func_t - Function which is timed by a benchmark
+ *
+ * @priv: Private data passed to bench_run()
+ * @return 0 if OK, -ve on error
+ */
+typedef int (*bench_func_t)(void *priv);
+
+/**
+ * struct bench_opts - Options for a set of benchmarks
+ *
+ * @runs: Number of timed runs for each of the warm and cold measurements
+ * @cold: true to also time runs with cold caches
+ * @csv: true to print comma-separated values instead of readable text
+ */
+struct bench_opts {
+	int runs;
+	bool cold;
+	bool csv;
+};
+
+/**
+ * bench_set_opts() - Set the options used by bench_run()
+ *
+ * @opts: Options to use, which are copied
+ */
+void bench_set_opts(const struct bench_opts *opts);
+
+/**
+ * bench_run() - Time a function and print the results
+ *
+ * The function is called once to warm up the caches and work out how many
+ * calls are needed for a run to last long enough to time accurately. It is
+ * then timed for the requested number of runs. If cold-cache runs are
+ * enabled, a further set of single calls is timed, each after writing to a
+ * large buffer to push the function's data out of the caches.
+ *
+ * @name: Name of the benchmark, e.g. "lz4"
+ * @func: Function to time
+ * @priv: Private data for @func
+ * @bytes: Number of bytes processed by each call, used to work out the
+ *	throughput, or 0 if @func does not process data
+ * @return 0 if OK, else the error from @func
+ */
+int bench_run(const char *name, bench_func_t func, void *priv, ulong bytes);
+
+/**
+ * bench_get_cycles() - Read the CPU cycle counter
+ *
+ * The default implementation returns 0, meaning that there is no counter, in
+ * which case cycles/byte is not reported.
+ *
+ * @return current cycle count
+ */
+u64 bench_get_cycles(void);
+
+#endif /* __TEST_BENCH_H__ */
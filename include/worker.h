@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent jobs on several CPUs
+ *
+ * A caller with a list of jobs that do not depend on each other (for example
+ * the blocks of a compressed image) can pass them to worker_run(), which
+ * shares them out between the boot CPU and any secondary CPUs provided by the
+ * architecture. Jobs must not use the console, malloc() or driver model,
+ * since these are not safe to call from more than one CPU. They may read the
+ * time with timer_get_us() once the boot CPU has done so.
+ */
+
+#ifndef __WORKER_H
+#define __WORKER_H
+
+#include <linux/types.h>
+
+/**
+ * typedef worker_func_t - Function which runs one job
+ *
+ * @priv: Private data for the job
+ * @return 0 if OK, -ve on error
+ */
+typedef int (*worker_func_t)(void *priv);
+
+#if CONFIG_IS_ENABLED(WORKER)
+
+/**
+ * worker_count() - Get the number of CPUs which can run jobs
+ *
+ * @return number of CPUs, including the boot CPU
+ */
+int worker_count(void);
+
+/**
+ * worker_run() - Run a list of jobs, sharing them out between CPUs
+ *
+ * Each CPU runs every n'th job, so jobs should be of similar size. This
+ * returns when all the jobs have finished.
+ *
+ * @func: Function to run for each job
+ * @privs: Array of @count private-data structures, one for each job
+ * @priv_size: Size of each private-data structure in bytes
+ * @count: Number of jobs
+ * @return 0 if OK, else the error from the first job that failed
+ */
+int worker_run(worker_func_t func, void *privs, size_t priv_size, int count);
+
+/**
+ * arch_worker_count() - Get the number of secondary CPUs for jobs
+ *
+ * @return number of CPUs, not including the boot CPU. The default
+ *	implementation returns 0.
+ */
+int arch_worker_count(void);
+
+/**
+ * arch_worker_start() - Start a function on a secondary CPU
+ *
+ * @id: Secondary CPU to use, from 0 to arch_worker_count() - 1
+ * @func: Function to run
+ * @arg: Argument to pass to @func
+ * @return 0 if OK, -ve on error, in which case the caller runs @func itself
+ */
+int arch_worker_start(int id, void (*func)(void *arg), void *arg);
+
+/**
+ * arch_worker_wait() - Wait for a secondary CPU to finish its function
+ *
+ * @id: Secondary CPU passed to arch_worker_start()
+ * @return 0 if OK, -ve on error
+ */
+int arch_worker_wait(int id);
+
+#else
+
+static inline int worker_count(void)
+{
+	return 1;
+}
+
+static inline int worker_run(worker_func_t func, void *privs,
+			     size_t priv_size, int count)
+{
+	int ret, i;
+
+	for (i = 0; i < count; i++) {
+		ret = func(privs + i * priv_size);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Zstandard decompression of a whole buffer
+ */
+
+#ifndef __ZSTD_H
+#define __ZSTD_H
+
+/**
+ * zstd_decompress() - Decompress zstd data
+ *
+ * This decompresses one or more zstd frames in a single call. Since the
+ * whole output is in memory, no window buffer is needed, but a context of
+ * about 160KB is allocated with malloc().
+ *
+ * @src: Source data to decompress
+ * @srcn: Length of source data
+ * @dst: Destination for uncompressed data
+ * @dstn: On entry, the size of @dst; returns length of uncompressed data
+ * @return 0 if OK, -ENOMEM if the context cannot be allocated, -ENOSPC if
+ *	@dst is too small, -EINVAL if the data is corrupt or not zstd
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * zstd_inplace_size() - Get the space needed to decompress in place
+ *
+ * zstd data can be decompressed over itself if it is placed at the end of a
+ * buffer which is larger than the uncompressed data by about one block. This
+ * works out how large that buffer must be.
+ *
+ * @src: Compressed data
+ * @srcn: Length of compressed data
+ * @sizep: Returns the size of buffer needed
+ * @return 0 if OK, -ENODATA if a frame does not record the size of its
+ *	uncompressed data, -EINVAL if the data is corrupt or not zstd
+ */
+int zstd_inplace_size(const void *src, size_t srcn, size_t *sizep);
+
+/**
+ * zstd_stream_len() - Get the length of zstd data from its headers
+ *
+ * This finds the end of the first frame at @src, after any skippable frames,
+ * without decompressing it. It is useful when only the start of the data is
+ * known.
+ *
+ * @src: Compressed data
+ * @srcn: Maximum length of compressed data
+ * @lenp: Returns the length up to the end of the first frame
+ * @return 0 if OK, -EINVAL if the data is corrupt or not zstd
+ */
+int zstd_stream_len(const void *src, size_t srcn, size_t *lenp);
+
+#endif
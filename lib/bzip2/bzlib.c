@@ -580,6 +580,80 @@ int BZ_API(BZ2_bzDecompressInit)
 }
 
 
+/*---------------------------------------------------*/
+/*--
+   U-Boot: decompression using a work area supplied by
+   the caller, so that nothing is taken from malloc().
+   The area starts with a record of how much is used.
+   Nothing is freed until the stream ends, since all
+   allocations are made when the stream starts.
+--*/
+
+typedef
+   struct {
+      char *next;
+      char *end;
+   }
+   bz_work;
+
+#define BZ_WORK_ALIGN(n) (((n) + 7) & ~7)
+
+static
+void* work_bzalloc ( void* opaque, Int32 items, Int32 size )
+{
+   bz_work* w = opaque;
+   unsigned int len = BZ_WORK_ALIGN(items * size);
+   void* v;
+
+   if (len > w->end - w->next) return NULL;
+   v = w->next;
+   w->next += len;
+   return v;
+}
+
+static
+void work_bzfree ( void* opaque, void* addr )
+{
+}
+
+unsigned int BZ_API(BZ2_bzDecompressWorkSize) ( int blockSize100k,
+						int small )
+{
+   unsigned int n = 100000 * blockSize100k;
+   unsigned int size;
+
+   size = BZ_WORK_ALIGN(sizeof(bz_work)) + BZ_WORK_ALIGN(sizeof(DState));
+   if (small)
+      size += BZ_WORK_ALIGN(n * sizeof(UInt16)) +
+	      BZ_WORK_ALIGN(((1 + n) >> 1) * sizeof(UChar));
+   else
+      size += BZ_WORK_ALIGN(n * sizeof(Int32));
+
+   return size;
+}
+
+int BZ_API(BZ2_bzDecompressInitWork)
+		     ( bz_stream* strm,
+		       void*      work,
+		       unsigned int len )
+{
+   bz_work* w = work;
+
+   if (strm == NULL || work == NULL ||
+       len < BZ_WORK_ALIGN(sizeof(bz_work)))
+      return BZ_PARAM_ERROR;
+
+   w->next = (char *)work + BZ_WORK_ALIGN(sizeof(bz_work));
+   w->end = (char *)work + len;
+   strm->bzalloc = work_bzalloc;
+   strm->bzfree = work_bzfree;
+   strm->opaque = w;
+
+   /* Use the fast method if the block size leaves enough room */
+   return BZ2_bzDecompressInit ( strm, 0, 0 );
+}
+
+
 /*---------------------------------------------------*/
 static
 void unRLE_obuf_to_output_FAST ( DState* s )
@@ -1334,16 +1408,34 @@ int BZ_API(BZ2_bzBuffToBuffDecompress)
 			     int           verbosity )
 {
    bz_stream strm;
+   unsigned int workLen;
+   int blockSize100k;
+   void* work;
    int ret;
 
    if (destLen == NULL || source == NULL)
 	  return BZ_PARAM_ERROR;
 
-   strm.bzalloc = NULL;
-   strm.bzfree = NULL;
-   strm.opaque = NULL;
-   ret = BZ2_bzDecompressInit ( &strm, verbosity, small );
-   if (ret != BZ_OK) return ret;
+   /*
+    * Take all the memory in one piece, sized for the block
+    * size in the header. If there is not enough for the fast
+    * method, the small one is used. A bad header is rejected
+    * by BZ2_bzDecompress().
+    */
+   blockSize100k = sourceLen > 3 ? source[3] - '0' : 9;
+   if (blockSize100k < 1 || blockSize100k > 9) blockSize100k = 9;
+   workLen = BZ2_bzDecompressWorkSize ( blockSize100k, small );
+   work = malloc ( workLen );
+   if (work == NULL && !small) {
+      workLen = BZ2_bzDecompressWorkSize ( blockSize100k, 1 );
+      work = malloc ( workLen );
+   }
+   if (work == NULL) return BZ_MEM_ERROR;
+   ret = BZ2_bzDecompressInitWork ( &strm, work, workLen );
+   if (ret != BZ_OK) {
+      free ( work );
+      return ret;
+   }
 
    strm.next_in = source;
    strm.next_out = dest;
@@ -1357,19 +1449,20 @@ int BZ_API(BZ2_bzBuffToBuffDecompress)
 
    /* normal termination */
    BZ2_bzDecompressEnd ( &strm );
+   free ( work );
    return BZ_OK;
 
    output_overflow_or_eof:
-   if (strm.avail_out > 0) {
-      BZ2_bzDecompressEnd ( &strm );
+   BZ2_bzDecompressEnd ( &strm );
+   free ( work );
+   if (strm.avail_out > 0)
       return BZ_UNEXPECTED_EOF;
-   } else {
-      BZ2_bzDecompressEnd ( &strm );
+   else
       return BZ_OUTBUFF_FULL;
-   };
 
    errhandler:
    BZ2_bzDecompressEnd ( &strm );
+   free ( work );
    return ret;
 }
 
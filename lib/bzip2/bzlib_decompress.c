@@ -251,15 +251,20 @@ Int32 BZ2_decompress ( DState* s )
 	  s->blockSize100k > (BZ_HDR_0 + 9)) RETURN(BZ_DATA_ERROR_MAGIC);
       s->blockSize100k -= BZ_HDR_0;
 
+      /*
+       * U-Boot: if there is not enough memory for the fast method, use
+       * the small one, which needs 2.5 bytes per byte of block, not 4
+       */
+      if (!s->smallDecompress) {
+	 s->tt  = BZALLOC( s->blockSize100k * 100000 * sizeof(Int32) );
+	 if (s->tt == NULL) s->smallDecompress = True;
+      }
       if (s->smallDecompress) {
 	 s->ll16 = BZALLOC( s->blockSize100k * 100000 * sizeof(UInt16) );
 	 s->ll4  = BZALLOC(
 		      ((1 + s->blockSize100k * 100000) >> 1) * sizeof(UChar)
 		   );
 	 if (s->ll16 == NULL || s->ll4 == NULL) RETURN(BZ_MEM_ERROR);
-      } else {
-	 s->tt  = BZALLOC( s->blockSize100k * 100000 * sizeof(Int32) );
-	 if (s->tt == NULL) RETURN(BZ_MEM_ERROR);
       }
 
       GET_UCHAR(BZ_X_BLKHDR_1, uc);
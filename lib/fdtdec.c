@@ -19,6 +19,7 @@
 #include <mapmem.h>
 #include <linux/libfdt.h>
 #include <serial.h>
+#include <sort.h>
 #include <asm/sections.h>
 #include <linux/ctype.h>
 #include <linux/lzo.h>
@@ -81,6 +82,259 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id)
 	return compat_names[id];
 }
 
+#if CONFIG_IS_ENABLED(OF_INDEX)
+/*
+ * Lookup index for gd->fdt_blob. Finding a node by phandle, alias or
+ * finding its parent otherwise means a walk through the flat tree from the
+ * start, which adds up as every device is probed.
+ *
+ * The index is built from the blob on first use after full malloc() is
+ * available and is dropped again when gd->fdt_blob moves or the size of its
+ * structure or strings block changes, which is the case whenever nodes or
+ * properties are added or removed. Phandle hits are checked against the
+ * blob in any case.
+ */
+struct fdt_index_phandle {
+	u32 phandle;
+	int node;
+};
+
+struct fdt_index_alias {
+	const char *name;	/* Alias name, in the strings block */
+	const char *path;	/* Path the alias points to */
+	int len;		/* Length of path, including the nul */
+	int node;		/* Offset of the node, or -ve if not found */
+};
+
+struct fdt_index {
+	const void *blob;
+	int size_struct;
+	int size_strings;
+	int node_count;
+	int *node_offset;	/* Sorted offsets of all nodes */
+	int *node_parent;	/* Offset of the parent of each node */
+	int phandle_count;
+	struct fdt_index_phandle *phandles;	/* Sorted by phandle */
+	int alias_count;
+	struct fdt_index_alias *aliases;
+};
+
+static struct fdt_index *fdt_index;
+
+static int fdt_index_phandle_cmp(const void *a, const void *b)
+{
+	const struct fdt_index_phandle *pa = a, *pb = b;
+
+	if (pa->phandle != pb->phandle)
+		return pa->phandle < pb->phandle ? -1 : 1;
+
+	return pa->node - pb->node;
+}
+
+static struct fdt_index *fdt_index_build(const void *blob)
+{
+	int parents[FDT_MAX_DEPTH];
+	struct fdt_index *idx;
+	int nodes = 0, phandles = 0, aliases = 0;
+	int node, depth, aliases_node, prop;
+	void *ptr;
+
+	for (node = 0, depth = 0; node >= 0 && depth >= 0;
+	     node = fdt_next_node(blob, node, &depth)) {
+		if (depth >= FDT_MAX_DEPTH)
+			return NULL;
+		nodes++;
+		if (fdt_get_phandle(blob, node))
+			phandles++;
+	}
+	aliases_node = fdt_path_offset(blob, "/aliases");
+	fdt_for_each_property_offset(prop, blob, aliases_node)
+		aliases++;
+
+	idx = malloc(sizeof(*idx) + nodes * 2 * sizeof(int) +
+		     phandles * sizeof(struct fdt_index_phandle) +
+		     aliases * sizeof(struct fdt_index_alias));
+	if (!idx)
+		return NULL;
+	ptr = idx + 1;
+	idx->aliases = ptr;
+	ptr += aliases * sizeof(struct fdt_index_alias);
+	idx->phandles = ptr;
+	ptr += phandles * sizeof(struct fdt_index_phandle);
+	idx->node_offset = ptr;
+	idx->node_parent = idx->node_offset + nodes;
+
+	idx->blob = blob;
+	idx->size_struct = fdt_size_dt_struct(blob);
+	idx->size_strings = fdt_size_dt_strings(blob);
+	idx->node_count = 0;
+	idx->phandle_count = 0;
+	idx->alias_count = 0;
+
+	/* Nodes are visited in order, so node_offset[] ends up sorted */
+	for (node = 0, depth = 0; node >= 0 && depth >= 0;
+	     node = fdt_next_node(blob, node, &depth)) {
+		u32 phandle = fdt_get_phandle(blob, node);
+
+		parents[depth] = node;
+		idx->node_offset[idx->node_count] = node;
+		idx->node_parent[idx->node_count++] = depth ?
+			parents[depth - 1] : -FDT_ERR_NOTFOUND;
+		if (phandle) {
+			idx->phandles[idx->phandle_count].phandle = phandle;
+			idx->phandles[idx->phandle_count++].node = node;
+		}
+	}
+	qsort(idx->phandles, idx->phandle_count, sizeof(*idx->phandles),
+	      fdt_index_phandle_cmp);
+
+	fdt_for_each_property_offset(prop, blob, aliases_node) {
+		struct fdt_index_alias *alias = &idx->aliases[idx->alias_count];
+
+		alias->path = fdt_getprop_by_offset(blob, prop, &alias->name,
+						    &alias->len);
+		if (!alias->path || !alias->name)
+			continue;
+		alias->node = fdt_path_offset(blob, alias->path);
+		idx->alias_count++;
+	}
+	debug("%s: %d nodes, %d phandles, %d aliases\n", __func__,
+	      idx->node_count, idx->phandle_count, idx->alias_count);
+
+	return idx;
+}
+
+/*
+ * Blob for which building the index last failed, so that lookups do not try
+ * again each time. This is cleared along with the index.
+ */
+static struct {
+	const void *blob;
+	int size_struct;
+	int size_strings;
+} fdt_index_failed;
+
+void fdtdec_index_invalidate(const void *blob)
+{
+	if (blob && fdt_index && fdt_index->blob != blob)
+		return;
+	free(fdt_index);
+	fdt_index = NULL;
+	fdt_index_failed.blob = NULL;
+}
+
+/**
+ * fdt_index_get() - Get the lookup index for a blob
+ *
+ * @blob: Device tree blob
+ * @return index, or NULL if @blob is not the control DT or the index is not
+ *	available
+ */
+static struct fdt_index *fdt_index_get(const void *blob)
+{
+	int size_struct, size_strings;
+
+	if (!blob || blob != gd->fdt_blob ||
+	    !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return NULL;
+	size_struct = fdt_size_dt_struct(blob);
+	size_strings = fdt_size_dt_strings(blob);
+	if (fdt_index && (fdt_index->blob != blob ||
+			  fdt_index->size_struct != size_struct ||
+			  fdt_index->size_strings != size_strings))
+		fdtdec_index_invalidate(NULL);
+	if (fdt_index)
+		return fdt_index;
+
+	if (fdt_index_failed.blob == blob &&
+	    fdt_index_failed.size_struct == size_struct &&
+	    fdt_index_failed.size_strings == size_strings)
+		return NULL;
+	fdt_index = fdt_index_build(blob);
+	if (!fdt_index) {
+		fdt_index_failed.blob = blob;
+		fdt_index_failed.size_struct = size_struct;
+		fdt_index_failed.size_strings = size_strings;
+	}
+
+	return fdt_index;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	struct fdt_index *idx = fdt_index_get(blob);
+	int lo, hi;
+
+	if (!idx || phandle == 0 || phandle == -1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	lo = 0;
+	hi = idx->phandle_count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (idx->phandles[mid].phandle < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < idx->phandle_count && idx->phandles[lo].phandle == phandle) {
+		int node = idx->phandles[lo].node;
+
+		if (fdt_get_phandle(blob, node) == phandle)
+			return node;
+		/* The blob has been changed behind our back */
+		fdtdec_index_invalidate(NULL);
+	}
+
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+int fdtdec_parent_offset(const void *blob, int node)
+{
+	struct fdt_index *idx = fdt_index_get(blob);
+	int lo, hi;
+
+	if (!idx)
+		return fdt_parent_offset(blob, node);
+
+	lo = 0;
+	hi = idx->node_count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (idx->node_offset[mid] < node)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < idx->node_count && idx->node_offset[lo] == node)
+		return idx->node_parent[lo];
+
+	return fdt_parent_offset(blob, node);
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	struct fdt_index *idx;
+	int i;
+
+	/* Only plain alias names are in the index */
+	if (*path == '/' || strchr(path, '/'))
+		return fdt_path_offset(blob, path);
+	idx = fdt_index_get(blob);
+	if (!idx)
+		return fdt_path_offset(blob, path);
+
+	for (i = 0; i < idx->alias_count; i++) {
+		if (!strcmp(idx->aliases[i].name, path))
+			return idx->aliases[i].node;
+	}
+
+	return -FDT_ERR_BADPATH;
+}
+#endif /* OF_INDEX */
+
 fdt_addr_t fdtdec_get_addr_size_fixed(const void *blob, int node,
 				      const char *prop_name, int index, int na,
 				      int ns, fdt_size_t *sizep,
@@ -163,7 +417,7 @@ fdt_addr_t fdtdec_get_addr_size_auto_noparent(const void *blob, int node,
 
 	debug("%s: ", __func__);
 
-	parent = fdt_parent_offset(blob, node);
+	parent = fdtdec_parent_offset(blob, node);
 	if (parent < 0) {
 		debug("(no parent found)\n");
 		return FDT_ADDR_T_NONE;
@@ -314,7 +568,7 @@ int fdtdec_next_alias(const void *blob, const char *name, enum fdt_compat_id id,
 	/* snprintf() is not available */
 	assert(strlen(name) < MAX_STR_LEN);
 	sprintf(str, "%.*s%d", MAX_STR_LEN, name, *upto);
-	node = fdt_path_offset(blob, str);
+	node = fdtdec_path_offset(blob, str);
 	if (node < 0)
 		return node;
 	err = fdt_node_check_compatible(blob, node, compat_names[id]);
@@ -451,6 +705,25 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 	return num_found;
 }
 
+/* Get the sequence number of an alias pointing to a node called find_name */
+static int alias_get_seq(const char *name, const char *prop, int len,
+			 const char *base, int base_len, const char *find_name,
+			 int find_namelen)
+{
+	const char *slash;
+
+	debug("   - %s, %s\n", name, prop);
+	if (len < find_namelen || *prop != '/' || prop[len - 1] ||
+	    strncmp(name, base, base_len))
+		return -1;
+
+	slash = strrchr(prop, '/');
+	if (strcmp(slash + 1, find_name))
+		return -1;
+
+	return trailing_strtol(name);
+}
+
 int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 			 int *seqp)
 {
@@ -459,29 +732,46 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	int find_namelen;
 	int prop_offset;
 	int aliases;
+	int val;
+#if CONFIG_IS_ENABLED(OF_INDEX)
+	struct fdt_index *idx = fdt_index_get(blob);
+#endif
 
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
+#if CONFIG_IS_ENABLED(OF_INDEX)
+	if (idx) {
+		int i;
+
+		for (i = 0; i < idx->alias_count; i++) {
+			struct fdt_index_alias *alias = &idx->aliases[i];
+
+			val = alias_get_seq(alias->name, alias->path,
+					    alias->len, base, base_len,
+					    find_name, find_namelen);
+			if (val != -1) {
+				*seqp = val;
+				debug("Found seq %d\n", *seqp);
+				return 0;
+			}
+		}
+		debug("Not found\n");
+		return -ENOENT;
+	}
+#endif
+
 	aliases = fdt_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
 		const char *prop;
 		const char *name;
-		const char *slash;
-		int len, val;
+		int len;
 
 		prop = fdt_getprop_by_offset(blob, prop_offset, &name, &len);
-		debug("   - %s, %s\n", name, prop);
-		if (len < find_namelen || *prop != '/' || prop[len - 1] ||
-		    strncmp(name, base, base_len))
-			continue;
-
-		slash = strrchr(prop, '/');
-		if (strcmp(slash + 1, find_name))
-			continue;
-		val = trailing_strtol(name);
+		val = alias_get_seq(name, prop, len, base, base_len,
+				    find_name, find_namelen);
 		if (val != -1) {
 			*seqp = val;
 			debug("Found seq %d\n", *seqp);
@@ -594,7 +884,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -725,8 +1015,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -906,7 +1196,7 @@ int fdt_get_resource(const void *fdt, int node, const char *property,
 	int na, ns, len, parent;
 	unsigned int i = 0;
 
-	parent = fdt_parent_offset(fdt, node);
+	parent = fdtdec_parent_offset(fdt, node);
 	if (parent < 0)
 		return parent;
 
@@ -1235,6 +1525,7 @@ int fdtdec_set_ethernet_mac_address(void *fdt, const u8 *mac, size_t size)
 	err = fdt_setprop_inplace(fdt, offset, "local-mac-address", mac, size);
 	if (err < 0)
 		return err;
+	fdtdec_index_invalidate(fdt);
 
 	debug("MAC address: %pM\n", mac);
 
@@ -1371,6 +1662,7 @@ int fdtdec_add_reserved_memory(void *blob, const char *basename,
 	err = fdt_setprop(blob, node, "reg", cells, (na + ns) * sizeof(*cells));
 	if (err < 0)
 		return err;
+	fdtdec_index_invalidate(blob);
 
 	/* return the phandle for the new node for the caller to use */
 	if (phandlep)
@@ -1462,6 +1754,7 @@ int fdtdec_set_carveout(void *blob, const char *node, const char *prop_name,
 		      node, err);
 		return err;
 	}
+	fdtdec_index_invalidate(blob);
 
 	return 0;
 }
@@ -32,6 +32,7 @@
 # include <common.h>
 # include <linux/string.h>
 # include <linux/ctype.h>
+# include <u-boot/crc.h>
 #endif
 
 #ifndef	CONFIG_ENV_MIN_ENTRIES	/* minimum number of entries */
@@ -44,6 +45,7 @@
 #define USED_FREE 0
 #define USED_DELETED -1
 
+#include <env_bin.h>
 #include <env_callback.h>
 #include <env_flags.h>
 #include <search.h>
@@ -62,6 +64,7 @@
 
 struct env_entry_node {
 	int used;
+	unsigned int hash;	/* hash of entry.key, from env_bin_hash() */
 	struct env_entry entry;
 };
 
@@ -119,6 +122,9 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 	htab->size = nel;
 	htab->filled = 0;
+	htab->deleted = 0;
+	htab->sorted = NULL;
+	htab->busy = 0;
 
 	/* allocate memory and zero out */
 	htab->table = (struct env_entry_node *)calloc(htab->size + 1,
@@ -160,11 +166,157 @@ void hdestroy_r(struct hsearch_data *htab)
 		}
 	}
 	free(htab->table);
+	free(htab->sorted);
+	htab->sorted = NULL;
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
 }
 
+/*
+ * Table maintenance
+ */
+
+/*
+ * Deleted slots are marked with USED_DELETED so that searches carry on past
+ * them, which makes searches slower as entries are deleted and added again.
+ * Before a new entry is added, the table is rebuilt if more than three
+ * quarters of it are in use or deleted. If more than half of it would be in
+ * use the size is doubled, so a table never fills up. Otherwise it is
+ * rebuilt at the same size, which drops the deleted slots.
+ *
+ * The table is not rebuilt while callbacks are running, since they may
+ * add variables while the caller still holds a pointer into the table.
+ */
+
+/* Get the first index tried for a hash, which is never zero */
+static unsigned int _hfirst(struct hsearch_data *htab, unsigned int hash)
+{
+	unsigned int hval = hash % htab->size;
+
+	return hval ? hval : 1;
+}
+
+/* Get the next index tried after idx, see hsearch_r() */
+static unsigned int _hnext(struct hsearch_data *htab, unsigned int hval,
+			   unsigned int idx)
+{
+	unsigned int hval2 = 1 + hval % (htab->size - 2);
+
+	if (idx <= hval2)
+		return htab->size + idx - hval2;
+
+	return idx - hval2;
+}
+
+/* Move an entry to a rebuilt table, returning its new index */
+static unsigned int _hmove(struct hsearch_data *htab,
+			   struct env_entry_node *node)
+{
+	unsigned int hval = _hfirst(htab, node->hash);
+	unsigned int idx = hval;
+
+	while (htab->table[idx].used > 0)
+		idx = _hnext(htab, hval, idx);
+	htab->table[idx] = *node;
+	htab->table[idx].used = hval;
+
+	return idx;
+}
+
+/* Rebuild the table with at least nel slots, keeping the sorted order */
+static int _hrehash(struct hsearch_data *htab, unsigned int nel)
+{
+	struct env_entry_node *old = htab->table;
+	unsigned int old_size = htab->size;
+	unsigned int i;
+
+	nel |= 1;
+	while (!isprime(nel))
+		nel += 2;
+
+	htab->table = calloc(nel + 1, sizeof(struct env_entry_node));
+	if (!htab->table) {
+		htab->table = old;
+		return 0;
+	}
+	if (htab->sorted) {
+		unsigned int *sorted;
+
+		sorted = realloc(htab->sorted, (nel + 1) * sizeof(*sorted));
+		if (!sorted) {
+			free(htab->table);
+			htab->table = old;
+			return 0;
+		}
+		htab->sorted = sorted;
+	}
+	debug("hrehash: %u -> %u slots, %u used, %u deleted\n", old_size, nel,
+	      htab->filled, htab->deleted);
+	htab->size = nel;
+	htab->deleted = 0;
+
+	if (htab->sorted) {
+		for (i = 0; i < htab->filled; i++)
+			htab->sorted[i] = _hmove(htab, &old[htab->sorted[i]]);
+	} else {
+		for (i = 1; i <= old_size; i++) {
+			if (old[i].used > 0)
+				_hmove(htab, &old[i]);
+		}
+	}
+	free(old);
+
+	return 1;
+}
+
+/* Find the position of key in the sorted list of n entries */
+static unsigned int _hsorted_pos(struct hsearch_data *htab, const char *key,
+				 unsigned int n)
+{
+	unsigned int lo = 0, hi = n;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (strcmp(key, htab->table[htab->sorted[mid]].entry.key) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Add the new entry at idx to the sorted list, if there is one */
+static void _hsorted_add(struct hsearch_data *htab, unsigned int idx)
+{
+	unsigned int n = htab->filled - 1;
+	unsigned int pos;
+
+	if (!htab->sorted)
+		return;
+	pos = _hsorted_pos(htab, htab->table[idx].entry.key, n);
+	memmove(&htab->sorted[pos + 1], &htab->sorted[pos],
+		(n - pos) * sizeof(*htab->sorted));
+	htab->sorted[pos] = idx;
+}
+
+/* Remove the entry at idx from the sorted list, if there is one */
+static void _hsorted_remove(struct hsearch_data *htab, unsigned int idx)
+{
+	unsigned int n = htab->filled;
+	unsigned int pos;
+
+	if (!htab->sorted)
+		return;
+	pos = _hsorted_pos(htab, htab->table[idx].entry.key, n);
+	if (pos == n || htab->sorted[pos] != idx)
+		return;
+	memmove(&htab->sorted[pos], &htab->sorted[pos + 1],
+		(n - pos - 1) * sizeof(*htab->sorted));
+}
+
 /*
  * hsearch()
  */
@@ -172,17 +324,19 @@ void hdestroy_r(struct hsearch_data *htab)
 /*
  * This is the search function. It uses double hashing with open addressing.
  * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
+ * probably strings of chars. The number for each string is generated by
+ * hashpjw (see [Aho,Sethi,Ullman] and env_bin_hash()). A simple shift and
+ * add only used the first eight characters of each name, so variables such
+ * as bootcmd_mmc0 and bootcmd_mmc1 all had the same hash.
  *
  * We use an trick to speed up the lookup. The table is created by hcreate
  * with one more element available. This enables us to use the index zero
  * special. This index will never be used because we store the first hash
  * index in the field used where zero means not used. Every other value
- * means used. The used field can be used as a first fast comparison for
- * equality of the stored and the parameter value. This helps to prevent
- * unnecessary expensive calls of strcmp.
+ * means used. The full hash of the key is kept in the field hash, which is
+ * used as a first fast comparison for equality of the stored and the
+ * parameter value. This helps to prevent unnecessary expensive calls of
+ * strcmp.
  *
  * This implementation differs from the standard library version of
  * this function in a number of ways:
@@ -208,7 +362,7 @@ int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
+	for (idx = last_idx + 1; idx <= htab->size; ++idx) {
 		if (htab->table[idx].used <= 0)
 			continue;
 		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
@@ -228,17 +382,22 @@ int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
  */
 static inline int _compare_and_overwrite_entry(struct env_entry item,
 		enum env_action action, struct env_entry **retval,
-		struct hsearch_data *htab, int flag, unsigned int hval,
+		struct hsearch_data *htab, int flag, unsigned int hash,
 		unsigned int idx)
 {
-	if (htab->table[idx].used == hval
+	if (htab->table[idx].used > 0 && htab->table[idx].hash == hash
 	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
 		/* Overwrite existing value? */
 		if (action == ENV_ENTER && item.data) {
+			int rejected;
+
 			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
+			htab->busy++;
+			rejected = htab->change_ok != NULL && htab->change_ok(
 			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
+			    env_op_overwrite, flag);
+			htab->busy--;
+			if (rejected) {
 				debug("change_ok() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EPERM);
@@ -247,9 +406,12 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 			}
 
 			/* If there is a callback, call it */
-			if (htab->table[idx].entry.callback &&
+			htab->busy++;
+			rejected = htab->table[idx].entry.callback &&
 			    htab->table[idx].entry.callback(item.key,
-			    item.data, env_op_overwrite, flag)) {
+			    item.data, env_op_overwrite, flag);
+			htab->busy--;
+			if (rejected) {
 				debug("callback() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EINVAL);
@@ -273,31 +435,25 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 	return -1;
 }
 
-int hsearch_r(struct env_entry item, enum env_action action,
-	      struct env_entry **retval, struct hsearch_data *htab, int flag)
+/*
+ * Search with a precomputed hash of item.key, as given by env_bin_hash().
+ * Otherwise the same as hsearch_r().
+ */
+static int _hsearch_r(struct env_entry item, unsigned int hash,
+		      enum env_action action, struct env_entry **retval,
+		      struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
 	unsigned int idx;
 	unsigned int first_deleted = 0;
+	int rejected;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
 	/*
 	 * First hash function:
 	 * simply take the modul but prevent zero.
 	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
+	hval = _hfirst(htab, hash);
 
 	/* The first index tried. */
 	idx = hval;
@@ -307,32 +463,22 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * Further action might be required according to the
 		 * action value.
 		 */
-		unsigned hval2;
-
 		if (htab->table[idx].used == USED_DELETED
 		    && !first_deleted)
 			first_deleted = idx;
 
 		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
+			flag, hash, idx);
 		if (ret != -1)
 			return ret;
 
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
 		do {
 			/*
+			 * Second hash function, as suggested in [Knuth].
 			 * Because SIZE is prime this guarantees to
 			 * step through all available indices.
 			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
+			idx = _hnext(htab, hval, idx);
 
 			/*
 			 * If we visited all entries leave the loop
@@ -347,7 +493,7 @@ int hsearch_r(struct env_entry item, enum env_action action,
 
 			/* If entry is found use it. */
 			ret = _compare_and_overwrite_entry(item, action, retval,
-				htab, flag, hval, idx);
+				htab, flag, hash, idx);
 			if (ret != -1)
 				return ret;
 		}
@@ -356,6 +502,21 @@ int hsearch_r(struct env_entry item, enum env_action action,
 
 	/* An empty bucket has been found. */
 	if (action == ENV_ENTER) {
+		/* Make room first if the table is getting crowded */
+		if (!htab->busy &&
+		    (htab->filled + htab->deleted + 1) * 4 > htab->size * 3) {
+			unsigned int nel = htab->size;
+
+			if ((htab->filled + 1) * 2 > htab->size)
+				nel *= 2;
+			if (_hrehash(htab, nel)) {
+				hval = _hfirst(htab, hash);
+				for (idx = hval; htab->table[idx].used;)
+					idx = _hnext(htab, hval, idx);
+				first_deleted = 0;
+			}
+		}
+
 		/*
 		 * If table is full and another entry should be
 		 * entered return with error.
@@ -370,10 +531,13 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * Create new entry;
 		 * create copies of item.key and item.data
 		 */
-		if (first_deleted)
+		if (first_deleted) {
 			idx = first_deleted;
+			htab->deleted--;
+		}
 
 		htab->table[idx].used = hval;
+		htab->table[idx].hash = hash;
 		htab->table[idx].entry.key = strdup(item.key);
 		htab->table[idx].entry.data = strdup(item.data);
 		if (!htab->table[idx].entry.key ||
@@ -384,6 +548,7 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		}
 
 		++htab->filled;
+		_hsorted_add(htab, idx);
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -391,8 +556,11 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		env_flags_init(&htab->table[idx].entry);
 
 		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		htab->busy++;
+		rejected = htab->change_ok != NULL && htab->change_ok(
+		    &htab->table[idx].entry, item.data, env_op_create, flag);
+		htab->busy--;
+		if (rejected) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -402,9 +570,12 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		}
 
 		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
+		htab->busy++;
+		rejected = htab->table[idx].entry.callback &&
 		    htab->table[idx].entry.callback(item.key, item.data,
-		    env_op_create, flag)) {
+		    env_op_create, flag);
+		htab->busy--;
+		if (rejected) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -423,6 +594,13 @@ int hsearch_r(struct env_entry item, enum env_action action,
 	return 0;
 }
 
+int hsearch_r(struct env_entry item, enum env_action action,
+	      struct env_entry **retval, struct hsearch_data *htab, int flag)
+{
+	return _hsearch_r(item, env_bin_hash(item.key, strlen(item.key)),
+			  action, retval, htab, flag);
+}
+
 
 /*
  * hdelete()
@@ -439,6 +617,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 {
 	/* free used entry */
 	debug("hdelete: DELETING key \"%s\"\n", key);
+	_hsorted_remove(htab, idx);
 	free((void *)ep->key);
 	free(ep->data);
 	ep->callback = NULL;
@@ -446,11 +625,13 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 	htab->table[idx].used = USED_DELETED;
 
 	--htab->filled;
+	++htab->deleted;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 {
 	struct env_entry e, *ep;
+	int rejected;
 	int idx;
 
 	debug("hdelete: DELETE key \"%s\"\n", key);
@@ -464,8 +645,11 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* Check for permission */
-	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	htab->busy++;
+	rejected = htab->change_ok != NULL &&
+	    htab->change_ok(ep, NULL, env_op_delete, flag);
+	htab->busy--;
+	if (rejected) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -473,8 +657,11 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (htab->table[idx].entry.callback &&
-	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
+	htab->busy++;
+	rejected = htab->table[idx].entry.callback &&
+	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag);
+	htab->busy--;
+	if (rejected) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
@@ -537,6 +724,36 @@ static int cmpkey(const void *p1, const void *p2)
 	return (strcmp(e1->key, e2->key));
 }
 
+/*
+ * Build the list of entries sorted by key, if there is not one already.
+ * Once built, it is kept up to date as entries are added and deleted.
+ */
+static int _hsort(struct hsearch_data *htab)
+{
+	struct env_entry *list[htab->size];
+	int i, n;
+
+	if (htab->sorted)
+		return 0;
+
+	htab->sorted = malloc((htab->size + 1) * sizeof(*htab->sorted));
+	if (!htab->sorted) {
+		__set_errno(ENOMEM);
+		return -1;
+	}
+
+	for (i = 1, n = 0; i <= htab->size; ++i) {
+		if (htab->table[i].used > 0)
+			list[n++] = &htab->table[i].entry;
+	}
+	qsort(list, n, sizeof(struct env_entry *), cmpkey);
+	for (i = 0; i < n; i++)
+		htab->sorted[i] = container_of(list[i], struct env_entry_node,
+					       entry) - htab->table;
+
+	return 0;
+}
+
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -612,56 +829,53 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, size = %lu\n",
 	      htab, htab->size, htab->filled, (ulong)size);
+	if (_hsort(htab))
+		return -1;
+
 	/*
 	 * Pass 1:
-	 * search used entries,
+	 * search used entries in sorted order,
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
+	for (i = 0, n = 0, totlen = 0; i < htab->filled; ++i) {
+		struct env_entry *ep = &htab->table[htab->sorted[i]].entry;
+		int found = match_entry(ep, flag, argc, argv);
 
-			if ((argc > 0) && (found == 0))
-				continue;
+		if ((argc > 0) && (found == 0))
+			continue;
 
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+			continue;
 
-			list[n++] = ep;
+		list[n++] = ep;
 
-			totlen += strlen(ep->key);
+		totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
 #ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
+	/* Pass 1a: print sorted list */
+	printf("Sorted: n=%d\n", n);
 	for (i = 0; i < n; ++i) {
 		printf("\t%3d: %p ==> %-10s => %s\n",
 		       i, list[i], list[i]->key, list[i]->data);
 	}
 #endif
 
-	/* Sort list by keys */
-	qsort(list, n, sizeof(struct env_entry *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
@@ -785,34 +999,13 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  * '\0' and '\n' have really been tested.
  */
 
-int himport_r(struct hsearch_data *htab,
-		const char *env, size_t size, const char sep, int flag,
-		int crlf_is_lf, int nvars, char * const vars[])
+/*
+ * Set up the hash table for an import of "size" bytes, as described for
+ * himport_r(). At least "nent" entries are allowed for.
+ */
+static int _himport_prepare(struct hsearch_data *htab, size_t size,
+			    int nent_min, int flag, int nvars)
 {
-	char *data, *sp, *dp, *name, *value;
-	char *localvars[nvars];
-	int i;
-
-	/* Test for correct arguments.  */
-	if (htab == NULL) {
-		__set_errno(EINVAL);
-		return 0;
-	}
-
-	/* we allocate new space to make sure we can write to the array */
-	if ((data = malloc(size + 1)) == NULL) {
-		debug("himport_r: can't malloc %lu bytes\n", (ulong)size + 1);
-		__set_errno(ENOMEM);
-		return 0;
-	}
-	memcpy(data, env, size);
-	data[size] = '\0';
-	dp = data;
-
-	/* make a local copy of the list of variables */
-	if (nvars)
-		memcpy(localvars, vars, sizeof(vars[0]) * nvars);
-
 	if ((flag & H_NOCLEAR) == 0 && !nvars) {
 		/* Destroy old hash table if one exists */
 		debug("Destroy Hash Table: %p table = %p\n", htab,
@@ -844,36 +1037,64 @@ int himport_r(struct hsearch_data *htab,
 
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
 			nent = CONFIG_ENV_MAX_ENTRIES;
+		if (nent < nent_min)
+			nent = nent_min;
 
 		debug("Create Hash Table: N=%d\n", nent);
 
-		if (hcreate_r(nent, htab) == 0) {
-			free(data);
+		if (hcreate_r(nent, htab) == 0)
 			return 0;
-		}
 	}
 
-	if (!size) {
-		free(data);
-		return 1;		/* everything OK */
-	}
-	if(crlf_is_lf) {
-		/* Remove Carriage Returns in front of Line Feeds */
-		unsigned ignored_crs = 0;
-		for(;dp < data + size && *dp; ++dp) {
-			if(*dp == '\r' &&
-			   dp < data + size - 1 && *(dp+1) == '\n')
-				++ignored_crs;
-			else
-				*(dp-ignored_crs) = *dp;
-		}
-		size -= ignored_crs;
-		dp = data;
+	return 1;
+}
+
+/*
+ * Deal with the variables listed for an import which were not in the
+ * imported data
+ */
+static void _himport_finish(struct hsearch_data *htab, int flag, int nvars,
+			    char *vars[])
+{
+	int i;
+
+	if (flag & H_NOCLEAR)
+		return;
+
+	/* process variables which were not considered */
+	for (i = 0; i < nvars; i++) {
+		if (vars[i] == NULL)
+			continue;
+		/*
+		 * All variables which were not deleted from the variable list
+		 * were not present in the imported env
+		 * This could mean two things:
+		 * a) if the variable was present in current env, we delete it
+		 * b) if the variable was not present in current env, we notify
+		 *    it might be a typo
+		 */
+		if (hdelete_r(vars[i], htab, flag) == 0)
+			printf("WARNING: '%s' neither in running nor in imported env!\n", vars[i]);
+		else
+			printf("WARNING: '%s' not in imported env, deleting it!\n", vars[i]);
 	}
+}
+
+/*
+ * Parse linearized "name=value" data as described for himport_r(), calling
+ * add() for each entry with value set to NULL for entries to delete.
+ * The data is modified in place.
+ */
+static int _hparse(char *data, size_t size, const char sep,
+		   void (*add)(void *priv, const char *name, char *value),
+		   void *priv)
+{
+	char *sp, *dp, *name, *value;
+
+	dp = data;
+
 	/* Parse environment; allow for '\0' and 'sep' as separators */
 	do {
-		struct env_entry e, *rv;
-
 		/* skip leading white space */
 		while (isblank(*dp))
 			++dp;
@@ -898,12 +1119,7 @@ int himport_r(struct hsearch_data *htab,
 			*dp++ = '\0';	/* terminate name */
 
 			debug("DELETE CANDIDATE: \"%s\"\n", name);
-			if (!drop_var_from_set(name, nvars, localvars))
-				continue;
-
-			if (hdelete_r(name, htab, flag) == 0)
-				debug("DELETE ERROR ##############################\n");
-
+			add(priv, name, NULL);
 			continue;
 		}
 		*dp++ = '\0';	/* terminate name */
@@ -920,57 +1136,407 @@ int himport_r(struct hsearch_data *htab,
 		if (*name == 0) {
 			debug("INSERT: unable to use an empty key\n");
 			__set_errno(EINVAL);
-			free(data);
 			return 0;
 		}
 
+		add(priv, name, value);
+	} while ((dp < data + size) && *dp);	/* size check needed for text */
+						/* without '\0' termination */
+
+	return 1;
+}
+
+struct himport_priv {
+	struct hsearch_data *htab;
+	int flag;
+	int nvars;
+	char **vars;
+};
+
+static void _himport_add(void *priv, const char *name, char *value)
+{
+	struct himport_priv *imp = priv;
+	struct env_entry e, *rv;
+
+	/* Skip variables which are not supposed to be processed */
+	if (!drop_var_from_set(name, imp->nvars, imp->vars))
+		return;
+
+	if (!value) {
+		if (hdelete_r(name, imp->htab, imp->flag) == 0)
+			debug("DELETE ERROR ##############################\n");
+		return;
+	}
+
+	/* enter into hash table */
+	e.key = name;
+	e.data = value;
+
+	hsearch_r(e, ENV_ENTER, &rv, imp->htab, imp->flag);
+	if (rv == NULL)
+		printf("himport_r: can't insert \"%s=%s\" into hash table\n",
+			name, value);
+
+	debug("INSERT: table %p, filled %d/%d rv %p ==> name=\"%s\" value=\"%s\"\n",
+		imp->htab, imp->htab->filled, imp->htab->size,
+		rv, name, value);
+}
+
+int himport_r(struct hsearch_data *htab,
+		const char *env, size_t size, const char sep, int flag,
+		int crlf_is_lf, int nvars, char * const vars[])
+{
+	struct himport_priv imp;
+	char *data, *dp;
+	char *localvars[nvars];
+
+	/* Test for correct arguments.  */
+	if (htab == NULL) {
+		__set_errno(EINVAL);
+		return 0;
+	}
+
+	/* we allocate new space to make sure we can write to the array */
+	if ((data = malloc(size + 1)) == NULL) {
+		debug("himport_r: can't malloc %lu bytes\n", (ulong)size + 1);
+		__set_errno(ENOMEM);
+		return 0;
+	}
+	memcpy(data, env, size);
+	data[size] = '\0';
+	dp = data;
+
+	/* make a local copy of the list of variables */
+	if (nvars)
+		memcpy(localvars, vars, sizeof(vars[0]) * nvars);
+
+	if (!_himport_prepare(htab, size, 0, flag, nvars)) {
+		free(data);
+		return 0;
+	}
+
+	if (!size) {
+		free(data);
+		return 1;		/* everything OK */
+	}
+	if(crlf_is_lf) {
+		/* Remove Carriage Returns in front of Line Feeds */
+		unsigned ignored_crs = 0;
+		for(;dp < data + size && *dp; ++dp) {
+			if(*dp == '\r' &&
+			   dp < data + size - 1 && *(dp+1) == '\n')
+				++ignored_crs;
+			else
+				*(dp-ignored_crs) = *dp;
+		}
+		size -= ignored_crs;
+	}
+
+	imp.htab = htab;
+	imp.flag = flag;
+	imp.nvars = nvars;
+	imp.vars = localvars;
+	if (!_hparse(data, size, sep, _himport_add, &imp)) {
+		free(data);
+		return 0;
+	}
+	debug("INSERT: free(data = %p)\n", data);
+	free(data);
+
+	_himport_finish(htab, flag, nvars, localvars);
+
+	debug("INSERT: done\n");
+	return 1;		/* everything OK */
+}
+
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+/*
+ * Binary environment import and export, see env_bin.h for the format.
+ * The data may not be aligned, so headers are copied before use.
+ */
+
+/* Check the header of a binary environment, returning its size or 0 */
+static size_t _hbin_check(const char *env, size_t size,
+			  struct env_bin_hdr *hdr)
+{
+	if (size < sizeof(*hdr))
+		return 0;
+	memcpy(hdr, env, sizeof(*hdr));
+	if (hdr->magic != ENV_BIN_MAGIC)
+		return 0;
+	if (hdr->version != ENV_BIN_VERSION ||
+	    hdr->hdr_size < sizeof(*hdr) ||
+	    hdr->size > size - hdr->hdr_size) {
+		debug("Unsupported binary environment, version %d\n",
+		      hdr->version);
+		return 0;
+	}
+	if (crc32(0, (const uchar *)env + hdr->hdr_size, hdr->size) !=
+	    hdr->crc) {
+		debug("Bad CRC in binary environment\n");
+		return 0;
+	}
+
+	return hdr->hdr_size + hdr->size;
+}
+
+int hbin_detect(const char *env, size_t size)
+{
+	uint32_t magic;
+
+	if (size < sizeof(magic))
+		return 0;
+	memcpy(&magic, env, sizeof(magic));
+
+	return magic == ENV_BIN_MAGIC;
+}
+
+/*
+ * Import a binary environment into the hash table.
+ *
+ * The arguments and the result are the same as for himport_r(), except
+ * that there is no separator. The hash stored with each variable is used
+ * directly, so the names are neither parsed nor hashed.
+ */
+int himport_bin_r(struct hsearch_data *htab, const char *env, size_t size,
+		  int flag, int nvars, char * const vars[])
+{
+	char *localvars[nvars];
+	struct env_bin_hdr hdr;
+	struct env_bin_rec rec;
+	const char *p, *end;
+	uint i;
+
+	if (htab == NULL || !_hbin_check(env, size, &hdr)) {
+		__set_errno(EINVAL);
+		return 0;
+	}
+
+	/* make a local copy of the list of variables */
+	if (nvars)
+		memcpy(localvars, vars, sizeof(vars[0]) * nvars);
+
+	if (!_himport_prepare(htab, size, CONFIG_ENV_MIN_ENTRIES + hdr.count,
+			      flag, nvars))
+		return 0;
+
+	p = env + hdr.hdr_size;
+	end = p + hdr.size;
+	for (i = 0; i < hdr.count; i++) {
+		struct env_entry e, *rv;
+		const char *name;
+		char *value;
+		size_t left;
+
+		if (end - p < sizeof(rec)) {
+			__set_errno(EINVAL);
+			return 0;
+		}
+		memcpy(&rec, p, sizeof(rec));
+		name = p + sizeof(rec);
+		value = (char *)name + rec.name_len + 1;
+
+		/* Check each length so that the record size cannot wrap */
+		left = end - name;
+		if (!rec.name_len || rec.name_len >= left ||
+		    rec.value_len >= left - rec.name_len - 1 ||
+		    env_bin_rec_size(rec.name_len, rec.value_len) > end - p ||
+		    name[rec.name_len] || value[rec.value_len]) {
+			debug("Bad record %d in binary environment\n", i);
+			__set_errno(EINVAL);
+			return 0;
+		}
+		p += env_bin_rec_size(rec.name_len, rec.value_len);
+
 		/* Skip variables which are not supposed to be processed */
 		if (!drop_var_from_set(name, nvars, localvars))
 			continue;
 
-		/* enter into hash table */
+		if (rec.flags & ENV_BIN_DELETE) {
+			hdelete_r(name, htab, flag);
+			continue;
+		}
+
 		e.key = name;
 		e.data = value;
-
-		hsearch_r(e, ENV_ENTER, &rv, htab, flag);
+		_hsearch_r(e, rec.hash, ENV_ENTER, &rv, htab, flag);
 		if (rv == NULL)
-			printf("himport_r: can't insert \"%s=%s\" into hash table\n",
-				name, value);
+			printf("himport_bin_r: can't insert \"%s=%s\" into hash table\n",
+			       name, value);
+	}
 
-		debug("INSERT: table %p, filled %d/%d rv %p ==> name=\"%s\" value=\"%s\"\n",
-			htab, htab->filled, htab->size,
-			rv, name, value);
-	} while ((dp < data + size) && *dp);	/* size check needed for text */
-						/* without '\0' termination */
-	debug("INSERT: free(data = %p)\n", data);
-	free(data);
+	_himport_finish(htab, flag, nvars, localvars);
 
-	if (flag & H_NOCLEAR)
-		goto end;
+	return 1;		/* everything OK */
+}
 
-	/* process variables which were not considered */
-	for (i = 0; i < nvars; i++) {
-		if (localvars[i] == NULL)
+/* Add one record to a binary environment, returning the next position */
+static char *_hbin_add(char *p, const char *name, const char *value,
+		       uint flags)
+{
+	struct env_bin_rec rec;
+
+	rec.name_len = strlen(name);
+	rec.value_len = value ? strlen(value) : 0;
+	rec.hash = env_bin_hash(name, rec.name_len);
+	rec.flags = flags;
+	memcpy(p, &rec, sizeof(rec));
+	memcpy(p + sizeof(rec), name, rec.name_len + 1);
+	if (value)
+		memcpy(p + sizeof(rec) + rec.name_len + 1, value,
+		       rec.value_len + 1);
+
+	return p + env_bin_rec_size(rec.name_len, rec.value_len);
+}
+
+/* Fill in the header of a binary environment */
+static void _hbin_finish(char *res, uint count, size_t len)
+{
+	struct env_bin_hdr hdr;
+
+	hdr.magic = ENV_BIN_MAGIC;
+	hdr.version = ENV_BIN_VERSION;
+	hdr.hdr_size = sizeof(hdr);
+	hdr.reserved = 0;
+	hdr.count = count;
+	hdr.size = len - sizeof(hdr);
+	hdr.crc = crc32(0, (uchar *)res + sizeof(hdr), hdr.size);
+	memcpy(res, &hdr, sizeof(hdr));
+}
+
+#if !(defined(CONFIG_SPL_BUILD) && !defined(CONFIG_SPL_SAVEENV))
+/*
+ * Export the hash table as a binary environment.
+ *
+ * The arguments and the result are the same as for hexport_r() with a
+ * '\0' separator and no variable list. Variables are written in sorted
+ * order.
+ */
+ssize_t hexport_bin_r(struct hsearch_data *htab, int flag, char **resp,
+		      size_t size)
+{
+	struct env_entry *list[htab->size];
+	size_t totlen;
+	char *res, *p;
+	int i, n;
+
+	if (resp == NULL) {
+		__set_errno(EINVAL);
+		return -1;
+	}
+
+	if (_hsort(htab))
+		return -1;
+
+	for (i = 0, n = 0, totlen = sizeof(struct env_bin_hdr);
+	     i < htab->filled; ++i) {
+		struct env_entry *ep = &htab->table[htab->sorted[i]].entry;
+
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
 			continue;
-		/*
-		 * All variables which were not deleted from the variable list
-		 * were not present in the imported env
-		 * This could mean two things:
-		 * a) if the variable was present in current env, we delete it
-		 * b) if the variable was not present in current env, we notify
-		 *    it might be a typo
-		 */
-		if (hdelete_r(localvars[i], htab, flag) == 0)
-			printf("WARNING: '%s' neither in running nor in imported env!\n", localvars[i]);
-		else
-			printf("WARNING: '%s' not in imported env, deleting it!\n", localvars[i]);
+
+		list[n++] = ep;
+		totlen += env_bin_rec_size(strlen(ep->key), strlen(ep->data));
 	}
 
-end:
-	debug("INSERT: done\n");
-	return 1;		/* everything OK */
+	if (size) {
+		/* The caller may fall back to text, so do not complain */
+		if (size < totlen) {
+			debug("Env export buffer too small: %lu, but need %lu\n",
+			      (ulong)size, (ulong)totlen);
+			__set_errno(ENOMEM);
+			return -1;
+		}
+	} else {
+		size = totlen;
+	}
+
+	if (*resp) {
+		res = *resp;
+		memset(res, '\0', size);
+	} else {
+		*resp = res = calloc(1, size);
+		if (res == NULL) {
+			__set_errno(ENOMEM);
+			return -1;
+		}
+	}
+
+	p = res + sizeof(struct env_bin_hdr);
+	for (i = 0; i < n; i++)
+		p = _hbin_add(p, list[i]->key, list[i]->data, 0);
+	_hbin_finish(res, n, totlen);
+
+	return size;
+}
+#endif
+
+struct htext_to_bin_priv {
+	char *p;
+	uint count;
+	size_t len;
+};
+
+static void _htext_to_bin_add(void *priv, const char *name, char *value)
+{
+	struct htext_to_bin_priv *conv = priv;
+
+	if (conv->p)
+		conv->p = _hbin_add(conv->p, name, value,
+				    value ? 0 : ENV_BIN_DELETE);
+	conv->count++;
+	conv->len += env_bin_rec_size(strlen(name), value ? strlen(value) : 0);
 }
 
+/*
+ * Convert linearized "name=value" data, as accepted by himport_r(), to a
+ * binary environment in a newly allocated buffer.
+ *
+ * Returns the size of the binary environment, or -1 on error
+ */
+ssize_t htext_to_bin(const char *env, size_t size, const char sep,
+		     char **resp)
+{
+	struct htext_to_bin_priv conv = { };
+	char *data, *res = NULL;
+	int pass;
+
+	data = malloc(size + 1);
+	if (!data) {
+		__set_errno(ENOMEM);
+		return -1;
+	}
+
+	/* Count the space needed, then fill it in */
+	for (pass = 0; pass < 2; pass++) {
+		memcpy(data, env, size);
+		data[size] = '\0';
+		if (pass) {
+			res = calloc(1, conv.len);
+			if (!res) {
+				free(data);
+				__set_errno(ENOMEM);
+				return -1;
+			}
+			conv.p = res + sizeof(struct env_bin_hdr);
+		}
+		conv.count = 0;
+		conv.len = sizeof(struct env_bin_hdr);
+		if (size && !_hparse(data, size, sep, _htext_to_bin_add,
+				     &conv)) {
+			free(res);
+			free(data);
+			return -1;
+		}
+	}
+	free(data);
+	_hbin_finish(res, conv.count, conv.len);
+	*resp = res;
+
+	return conv.len;
+}
+#endif
+
 /*
  * hwalk_r()
  */
@@ -982,15 +1548,17 @@ end:
 int hwalk_r(struct hsearch_data *htab, int (*callback)(struct env_entry *entry))
 {
 	int i;
-	int retval;
+	int retval = 0;
 
+	htab->busy++;
 	for (i = 1; i <= htab->size; ++i) {
 		if (htab->table[i].used > 0) {
 			retval = callback(&htab->table[i].entry);
 			if (retval)
-				return retval;
+				break;
 		}
 	}
+	htab->busy--;
 
-	return 0;
+	return retval;
 }
@@ -44,43 +44,247 @@
 
 #include <linux/math64.h>
 
+enum {
+	SPARSE_FILE_HDR,	/* collecting the sparse file header */
+	SPARSE_CHUNK_HDR,	/* collecting a chunk header */
+	SPARSE_RAW,		/* writing the data of a CHUNK_TYPE_RAW */
+	SPARSE_FILL,		/* collecting the value of a CHUNK_TYPE_FILL */
+	SPARSE_SKIP,		/* skipping chunk data */
+	SPARSE_DONE,		/* all chunks processed */
+	SPARSE_ERROR,
+};
+
 static void default_log(const char *ignored, char *response) {}
 
-int write_sparse_image(struct sparse_storage *info,
-		       const char *part_name, void *data, char *response)
+static void set_sparse_fill(struct sparse_storage *info,
+			    struct sparse_fill_buf *fill, uint32_t fill_val)
+{
+	int i;
+
+	if (fill->val == fill_val)
+		return;
+
+	for (i = 0; i < (info->blksz * fill->num_blks / sizeof(fill_val)); i++)
+		fill->buf[i] = fill_val;
+	fill->val = fill_val;
+}
+
+static int write_sparse_fill(struct sparse_storage *info, lbaint_t *blkp,
+			     lbaint_t blkcnt, struct sparse_fill_buf *fill,
+			     char *response)
+{
+	lbaint_t blk = *blkp;
+	lbaint_t blks;
+	lbaint_t i;
+	lbaint_t j;
+
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > fill->num_blks)
+			j = fill->num_blks;
+		blks = info->write(info, blk, j, fill->buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [" LBAFU "]\n", __func__,
+			       "Write failed, block #", blk, j);
+			info->mssg("flash write failure", response);
+			return -1;
+		}
+		blk += blks;
+		i += j;
+	}
+	*blkp = blk;
+
+	return 0;
+}
+
+static lbaint_t sparse_round_down(lbaint_t blk, lbaint_t align)
+{
+	u32 rem;
+
+	div_u64_rem(blk, align, &rem);
+
+	return blk - rem;
+}
+
+static lbaint_t sparse_round_up(lbaint_t blk, lbaint_t align)
+{
+	return sparse_round_down(blk + align - 1, align);
+}
+
+/*
+ * Zero the blocks collected in @run, erasing as much of it as the erase
+ * granularity allows and writing zeroes to what is left over at the edges
+ */
+static int flush_sparse_zero_run(struct sparse_storage *info,
+				 struct sparse_zero_run *run,
+				 struct sparse_fill_buf *fill, char *response)
 {
+	lbaint_t align = info->erase_blkcnt ? info->erase_blkcnt : 1;
+	lbaint_t erase_start, erase_end;
+	lbaint_t head_end, tail_start;
 	lbaint_t blk;
-	lbaint_t blkcnt;
+
+	if (run->zero_start == run->zero_end)
+		goto out;
+
+	/*
+	 * Erase whole erase groups only, but don't stray further than one
+	 * group into the surrounding don't-care area
+	 */
+	erase_start = max(sparse_round_up(run->start, align),
+			  sparse_round_down(run->zero_start, align));
+	erase_end = min(sparse_round_down(run->end, align),
+			sparse_round_up(run->zero_end, align));
+
+	head_end = run->zero_end;
+	tail_start = run->zero_end;
+	if (erase_start < erase_end) {
+		debug("Erasing blocks " LBAFU " - " LBAFU "\n", erase_start,
+		      erase_end);
+		if (info->erase(info, erase_start, erase_end - erase_start) ==
+		    erase_end - erase_start) {
+			head_end = erase_start;
+			tail_start = erase_end;
+		} else {
+			printf("%s: erase failed, writing zeroes instead\n",
+			       __func__);
+		}
+	}
+
+	set_sparse_fill(info, fill, 0);
+
+	if (run->zero_start < head_end) {
+		blk = run->zero_start;
+		if (write_sparse_fill(info, &blk, head_end - run->zero_start,
+				      fill, response))
+			return -1;
+	}
+	if (tail_start < run->zero_end) {
+		blk = tail_start;
+		if (write_sparse_fill(info, &blk, run->zero_end - tail_start,
+				      fill, response))
+			return -1;
+	}
+
+out:
+	run->start = 0;
+	run->end = 0;
+	run->zero_start = 0;
+	run->zero_end = 0;
+
+	return 0;
+}
+
+static int sparse_flush(struct sparse_stream *s, char *response)
+{
+	return flush_sparse_zero_run(s->info, &s->zero_run, &s->fill,
+				     response);
+}
+
+/*
+ * Copy up to @size bytes of a header into @hdr, dropping anything past
+ * @hdr_size. Returns the number of bytes consumed from @data.
+ */
+static uint32_t sparse_gather(struct sparse_stream *s, void *hdr,
+			      uint32_t hdr_size, uint32_t size,
+			      const void *data, uint32_t len)
+{
+	uint32_t n = min(size - s->hdr_len, len);
+
+	if (s->hdr_len < hdr_size)
+		memcpy(hdr + s->hdr_len, data,
+		       min(n, hdr_size - s->hdr_len));
+	s->hdr_len += n;
+
+	return n;
+}
+
+static void sparse_next_chunk(struct sparse_stream *s)
+{
+	s->hdr_len = 0;
+	if (++s->chunk < s->sparse_header.total_chunks)
+		s->state = SPARSE_CHUNK_HDR;
+	else
+		s->state = SPARSE_DONE;
+}
+
+static int sparse_check_size(struct sparse_stream *s, lbaint_t blkcnt,
+			     char *response)
+{
+	struct sparse_storage *info = s->info;
+
+	if (s->blk + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		info->mssg("Request would exceed partition size!", response);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int sparse_write_blocks(struct sparse_stream *s, lbaint_t blkcnt,
+			       const void *data, char *response)
+{
+	struct sparse_storage *info = s->info;
 	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
 
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	blks = info->write(info, s->blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n",
+		       __func__, "Write failed, block #",
+		       s->blk, blks);
+		info->mssg("flash write failure", response);
+		return -1;
+	}
+	s->blk += blks;
 
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
+	return 0;
+}
 
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+/* Write the part of the current RAW chunk contained in @data */
+static int sparse_write_raw(struct sparse_stream *s, const void *data,
+			    uint32_t len, char *response)
+{
+	lbaint_t blksz = s->info->blksz;
+	uint32_t n;
+
+	/* Complete a block that was split between two pieces */
+	if (s->blk_len) {
+		n = min(len, (uint32_t)(blksz - s->blk_len));
+		memcpy(s->blk_buf + s->blk_len, data, n);
+		s->blk_len += n;
+		data += n;
+		len -= n;
+		if (s->blk_len < blksz)
+			return 0;
+		if (sparse_write_blocks(s, 1, s->blk_buf, response))
+			return -1;
+		s->blk_len = 0;
 	}
 
-	if (!info->mssg)
-		info->mssg = default_log;
+	n = len / blksz;
+	if (n) {
+		if (sparse_write_blocks(s, n, data, response))
+			return -1;
+		data += n * blksz;
+		len -= n * blksz;
+	}
+
+	if (len) {
+		memcpy(s->blk_buf, data, len);
+		s->blk_len = len;
+	}
+
+	return 0;
+}
+
+static int sparse_parse_file_hdr(struct sparse_stream *s, char *response)
+{
+	sparse_header_t *sparse_header = &s->sparse_header;
+	struct sparse_storage *info = s->info;
+	unsigned int offset;
 
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
@@ -106,156 +310,304 @@ int write_sparse_image(struct sparse_storage *info,
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
+	s->chunk = 0;
+	s->hdr_len = 0;
+	if (sparse_header->total_chunks)
+		s->state = SPARSE_CHUNK_HDR;
+	else
+		s->state = SPARSE_DONE;
+
+	return 0;
+}
+
+static int sparse_parse_chunk_hdr(struct sparse_stream *s, char *response)
+{
+	sparse_header_t *sparse_header = &s->sparse_header;
+	chunk_header_t *chunk_header = &s->chunk_header;
+	struct sparse_storage *info = s->info;
+	unsigned int chunk_data_sz;
+	lbaint_t blkcnt;
+
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
+
+	chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = chunk_data_sz / info->blksz;
+	s->hdr_len = 0;
+
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
+			info->mssg("Bogus chunk size for chunk type Raw",
+				   response);
+			return -1;
 		}
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
+		if (sparse_check_size(s, blkcnt, response) ||
+		    sparse_flush(s, response))
+			return -1;
+
+		s->bytes_written += blkcnt * info->blksz;
+		s->total_blocks += chunk_header->chunk_sz;
+		s->left = chunk_data_sz;
+		s->state = SPARSE_RAW;
+		if (!s->left)
+			sparse_next_chunk(s);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
+			info->mssg("Bogus chunk size for chunk type FILL",
+				   response);
+			return -1;
 		}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				info->mssg("Bogus chunk size for chunk type Raw",
-					   response);
-				return -1;
-			}
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
+		if (sparse_check_size(s, blkcnt, response))
+			return -1;
+
+		s->state = SPARSE_FILL;
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		if (info->erase && s->zero_run.end != s->blk) {
+			if (sparse_flush(s, response))
 				return -1;
-			}
-
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
+			s->zero_run.start = s->blk;
+		}
+		s->blk += info->reserve(info, s->blk, blkcnt);
+		/*
+		 * Let a pending zero run grow over this chunk so that it can
+		 * be erased in larger units
+		 */
+		if (info->erase)
+			s->zero_run.end = s->blk;
+		s->total_blocks += chunk_header->chunk_sz;
+		sparse_next_chunk(s);
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz !=
+		    sparse_header->chunk_hdr_sz) {
+			info->mssg("Bogus chunk size for chunk type Dont Care",
+				   response);
+			return -1;
+		}
+		s->total_blocks += chunk_header->chunk_sz;
+		s->left = chunk_data_sz;
+		s->state = SPARSE_SKIP;
+		if (!s->left)
+			sparse_next_chunk(s);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		info->mssg("Unknown chunk type", response);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int sparse_write_fill_chunk(struct sparse_stream *s, char *response)
+{
+	sparse_header_t *sparse_header = &s->sparse_header;
+	chunk_header_t *chunk_header = &s->chunk_header;
+	struct sparse_storage *info = s->info;
+	unsigned int chunk_data_sz;
+	lbaint_t blkcnt;
+
+	chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = chunk_data_sz / info->blksz;
+
+	if (!s->fill_val && info->erase) {
+		/* Batch up, see flush_sparse_zero_run() */
+		if (s->zero_run.end != s->blk) {
+			if (sparse_flush(s, response))
 				return -1;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+			s->zero_run.start = s->blk;
+		}
+		if (s->zero_run.zero_start == s->zero_run.zero_end)
+			s->zero_run.zero_start = s->blk;
+		s->blk += blkcnt;
+		s->zero_run.end = s->blk;
+		s->zero_run.zero_end = s->blk;
+	} else {
+		if (sparse_flush(s, response))
+			return -1;
+
+		set_sparse_fill(info, &s->fill, s->fill_val);
+		if (write_sparse_fill(info, &s->blk, blkcnt, &s->fill,
+				      response))
+			return -1;
+	}
+	s->bytes_written += blkcnt * info->blksz;
+	s->total_blocks += chunk_data_sz / sparse_header->blk_sz;
+	sparse_next_chunk(s);
+
+	return 0;
+}
+
+int sparse_stream_start(struct sparse_stream *s, struct sparse_storage *info,
+			char *response)
+{
+	memset(s, '\0', sizeof(*s));
+	s->info = info;
+	s->state = SPARSE_FILE_HDR;
+	s->blk = info->start;
+
+	if (!info->mssg)
+		info->mssg = default_log;
+
+	/* The fill buffer is shared by all CHUNK_TYPE_FILL chunks */
+	s->fill.num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	s->fill.buf = (uint32_t *)
+		      memalign(ARCH_DMA_MINALIGN,
+			       ROUNDUP(info->blksz * s->fill.num_blks,
+				       ARCH_DMA_MINALIGN));
+	s->blk_buf = memalign(ARCH_DMA_MINALIGN,
+			      ROUNDUP(info->blksz, ARCH_DMA_MINALIGN));
+	if (!s->fill.buf || !s->blk_buf) {
+		free(s->fill.buf);
+		free(s->blk_buf);
+		s->fill.buf = NULL;
+		s->blk_buf = NULL;
+		s->state = SPARSE_ERROR;
+		info->mssg("Malloc failed for: CHUNK_TYPE_FILL", response);
+		return -1;
+	}
+	memset(s->fill.buf, '\0', info->blksz * s->fill.num_blks);
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *s, const void *data,
+			uint32_t len, char *response)
+{
+	uint32_t size;
+	uint32_t n;
+	int ret = 0;
+
+	while (len && !ret) {
+		switch (s->state) {
+		case SPARSE_FILE_HDR:
+			/* The header size is known once the header is in */
+			size = sizeof(sparse_header_t);
+			if (s->hdr_len >= size)
+				size = max_t(uint32_t, size,
+					     s->sparse_header.file_hdr_sz);
+			n = sparse_gather(s, &s->sparse_header,
+					  sizeof(sparse_header_t), size, data,
+					  len);
+			if (s->hdr_len >= sizeof(sparse_header_t) &&
+			    s->hdr_len >= s->sparse_header.file_hdr_sz)
+				ret = sparse_parse_file_hdr(s, response);
 			break;
 
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
+		case SPARSE_CHUNK_HDR:
+			size = max_t(uint32_t, sizeof(chunk_header_t),
+				     s->sparse_header.chunk_hdr_sz);
+			n = sparse_gather(s, &s->chunk_header,
+					  sizeof(chunk_header_t), size, data,
+					  len);
+			if (s->hdr_len == size)
+				ret = sparse_parse_chunk_hdr(s, response);
 			break;
 
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
+		case SPARSE_RAW:
+			n = min(len, s->left);
+			ret = sparse_write_raw(s, data, n, response);
+			s->left -= n;
+			if (!s->left)
+				sparse_next_chunk(s);
 			break;
 
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				info->mssg("Bogus chunk size for chunk type Dont Care",
-					   response);
-				return -1;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+		case SPARSE_FILL:
+			n = sparse_gather(s, &s->fill_val, sizeof(uint32_t),
+					  sizeof(uint32_t), data, len);
+			if (s->hdr_len == sizeof(uint32_t))
+				ret = sparse_write_fill_chunk(s, response);
+			break;
+
+		case SPARSE_SKIP:
+			n = min(len, s->left);
+			s->left -= n;
+			if (!s->left)
+				sparse_next_chunk(s);
 			break;
 
+		case SPARSE_DONE:
+			/* Ignore anything after the last chunk */
+			return 0;
+
 		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			info->mssg("Unknown chunk type", response);
 			return -1;
 		}
+		data += n;
+		len -= n;
 	}
 
+	if (ret)
+		s->state = SPARSE_ERROR;
+
+	return ret;
+}
+
+int sparse_stream_finish(struct sparse_stream *s, const char *part_name,
+			 char *response)
+{
+	struct sparse_storage *info = s->info;
+	int ret = -1;
+
+	if (s->state == SPARSE_ERROR)
+		goto out;
+
+	if (sparse_flush(s, response))
+		goto out;
+
 	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	      s->total_blocks, s->sparse_header.total_blks);
+	printf("........ wrote %u bytes to '%s'\n", s->bytes_written,
+	       part_name);
 
-	if (total_blocks != sparse_header->total_blks) {
+	if (s->state != SPARSE_DONE ||
+	    s->total_blocks != s->sparse_header.total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
 	}
 
-	return 0;
+	ret = 0;
+out:
+	free(s->fill.buf);
+	free(s->blk_buf);
+	s->fill.buf = NULL;
+	s->blk_buf = NULL;
+
+	return ret;
+}
+
+int write_sparse_image(struct sparse_storage *info,
+		       const char *part_name, void *data, char *response)
+{
+	struct sparse_stream stream;
+	int ret;
+
+	if (sparse_stream_start(&stream, info, response))
+		return -1;
+
+	/*
+	 * The whole image is in memory and its size is given by the headers,
+	 * so parse until the last chunk
+	 */
+	ret = sparse_stream_write(&stream, data, UINT_MAX, response);
+	if (sparse_stream_finish(&stream, part_name, response))
+		ret = -1;
+
+	return ret;
 }
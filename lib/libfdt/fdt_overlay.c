@@ -1,2 +1,768 @@
 #include <linux/libfdt_env.h>
 #include "../../scripts/dtc/libfdt/fdt_overlay.c"
+
+/*
+ * U-Boot addition: apply a list of overlays in one go
+ *
+ * fdt_overlay_apply() walks the whole base tree to find the largest phandle
+ * and again for each fragment target and each symbol an overlay adds, and
+ * looks up every symbol it refers to in /__symbols__ and then by path. When
+ * many overlays are applied to a large tree this dominates the time taken.
+ * fdt_overlay_apply_multi() keeps an index of the base tree's phandles and
+ * symbols from one overlay to the next instead.
+ */
+#include <malloc.h>
+#include <sort.h>
+
+/**
+ * struct overlay_symbol - A symbol in the base tree's /__symbols__ node
+ *
+ * @nameoff: Offset of the symbol name in the strings block, which does not
+ *	change when the tree is modified
+ * @propoff: Offset of the symbol property, valid until the tree is modified
+ * @phandle: Phandle of the node the symbol refers to, or 0 if not yet known
+ */
+struct overlay_symbol {
+	int nameoff;
+	int propoff;
+	uint32_t phandle;
+};
+
+/**
+ * struct overlay_phandle - A node with a phandle in the base tree
+ *
+ * @phandle: Phandle of the node
+ * @offset: Offset of the node. This is kept up to date where possible as
+ *	the tree is modified, but must be checked before use.
+ */
+struct overlay_phandle {
+	uint32_t phandle;
+	int offset;
+};
+
+/**
+ * struct overlay_index - Index of the base tree
+ *
+ * @sym: Symbols, sorted by name
+ * @sym_count: Number of symbols
+ * @sym_max: Number of symbols there is space for
+ * @ph: Nodes with phandles, sorted by phandle
+ * @ph_count: Number of nodes with phandles
+ * @ph_max: Number of nodes there is space for
+ * @path: Buffer for the path of a fragment target
+ * @path_size: Size of @path
+ */
+struct overlay_index {
+	struct overlay_symbol *sym;
+	int sym_count;
+	int sym_max;
+	struct overlay_phandle *ph;
+	int ph_count;
+	int ph_max;
+	char *path;
+	int path_size;
+};
+
+/* Base tree being sorted by overlay_symbols_sync(), for overlay_sym_cmp() */
+static const void *overlay_sort_fdt;
+
+static int overlay_sym_cmp(const void *a, const void *b)
+{
+	const struct overlay_symbol *sa = a, *sb = b;
+
+	return strcmp(fdt_string(overlay_sort_fdt, sa->nameoff),
+		      fdt_string(overlay_sort_fdt, sb->nameoff));
+}
+
+static int overlay_ph_cmp(const void *a, const void *b)
+{
+	const struct overlay_phandle *pa = a, *pb = b;
+
+	return pa->phandle < pb->phandle ? -1 : pa->phandle > pb->phandle;
+}
+
+/* Grow an array in the index so that it has space for one more entry */
+static int overlay_index_grow(void **arrayp, int count, int *maxp, int size)
+{
+	void *array;
+	int max;
+
+	if (count < *maxp)
+		return 0;
+	max = *maxp ? *maxp * 2 : 64;
+	array = realloc(*arrayp, max * size);
+	if (!array)
+		return -FDT_ERR_NOSPACE;
+	*arrayp = array;
+	*maxp = max;
+
+	return 0;
+}
+
+static void overlay_index_free(struct overlay_index *idx)
+{
+	free(idx->path);
+	free(idx->ph);
+	free(idx->sym);
+}
+
+/**
+ * overlay_index_init() - Index the nodes with phandles in the base tree
+ *
+ * @fdt: Base device tree blob
+ * @idx: Index to set up
+ * @maxp: Returns the largest phandle in @fdt
+ * @return 0 on success, -FDT_ERR_NOSPACE if out of memory, other negative
+ *	error code on failure
+ */
+static int overlay_index_init(const void *fdt, struct overlay_index *idx,
+			      uint32_t *maxp)
+{
+	struct overlay_phandle *ph;
+	uint32_t phandle, max = 0;
+	int offset = -1;
+	int ret;
+
+	for (;;) {
+		offset = fdt_next_node(fdt, offset, NULL);
+		if (offset == -FDT_ERR_NOTFOUND)
+			break;
+		if (offset < 0)
+			return offset;
+
+		phandle = fdt_get_phandle(fdt, offset);
+		if (!phandle)
+			continue;
+		ret = overlay_index_grow((void **)&idx->ph, idx->ph_count,
+					 &idx->ph_max, sizeof(*ph));
+		if (ret)
+			return ret;
+		ph = &idx->ph[idx->ph_count++];
+		ph->phandle = phandle;
+		ph->offset = offset;
+		if (phandle > max)
+			max = phandle;
+	}
+	qsort(idx->ph, idx->ph_count, sizeof(*ph), overlay_ph_cmp);
+	*maxp = max;
+
+	return 0;
+}
+
+/**
+ * overlay_index_shift() - Update node offsets after the tree is modified
+ *
+ * Nodes after @offset have moved by @delta bytes. Nodes inside the subtree
+ * at @offset may be left with the wrong offset, which is found when they
+ * are next looked up.
+ *
+ * @idx: Index to update
+ * @offset: Offset of the node which was modified
+ * @delta: Change in size of the structure block
+ */
+static void overlay_index_shift(struct overlay_index *idx, int offset,
+				int delta)
+{
+	int i;
+
+	if (!delta)
+		return;
+	for (i = 0; i < idx->ph_count; i++) {
+		if (idx->ph[i].offset > offset)
+			idx->ph[i].offset += delta;
+	}
+}
+
+/* Find the node with a given phandle, like fdt_node_offset_by_phandle() */
+static int overlay_index_node(const void *fdt, struct overlay_index *idx,
+			      uint32_t phandle)
+{
+	struct overlay_phandle *ph = NULL;
+	int low = 0, high = idx->ph_count - 1;
+	int offset, ret;
+
+	while (low <= high) {
+		int mid = (low + high) / 2;
+
+		if (idx->ph[mid].phandle == phandle) {
+			ph = &idx->ph[mid];
+			break;
+		}
+		if (phandle < idx->ph[mid].phandle)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+	if (ph && fdt_get_phandle(fdt, ph->offset) == phandle)
+		return ph->offset;
+
+	offset = fdt_node_offset_by_phandle(fdt, phandle);
+	if (offset < 0)
+		return offset;
+
+	if (!ph) {
+		ret = overlay_index_grow((void **)&idx->ph, idx->ph_count,
+					 &idx->ph_max, sizeof(*ph));
+		if (ret)
+			return ret;
+		ph = &idx->ph[low];
+		memmove(ph + 1, ph, (idx->ph_count - low) * sizeof(*ph));
+		idx->ph_count++;
+		ph->phandle = phandle;
+	}
+	ph->offset = offset;
+
+	return offset;
+}
+
+/* Find the target of a fragment, like overlay_get_target() */
+static int overlay_index_target(const void *fdt, const void *fdto,
+				struct overlay_index *idx, int fragment,
+				const char **pathp)
+{
+	uint32_t phandle;
+	const char *path = NULL;
+	int path_len = 0, ret;
+
+	phandle = overlay_get_target_phandle(fdto, fragment);
+	if (phandle == (uint32_t)-1)
+		return -FDT_ERR_BADPHANDLE;
+
+	if (!phandle) {
+		path = fdt_getprop(fdto, fragment, "target-path", &path_len);
+		if (path)
+			ret = fdt_path_offset(fdt, path);
+		else
+			ret = path_len;
+	} else {
+		ret = overlay_index_node(fdt, idx, phandle);
+	}
+
+	if (ret < 0 && path_len == -FDT_ERR_NOTFOUND)
+		ret = -FDT_ERR_BADOVERLAY;
+	if (ret < 0)
+		return ret;
+
+	if (pathp)
+		*pathp = path;
+
+	return ret;
+}
+
+static struct overlay_symbol *overlay_symbols_find(const void *fdt,
+						   struct overlay_index *idx,
+						   const char *name)
+{
+	int low = 0, high = idx->sym_count - 1;
+
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		struct overlay_symbol *sym = &idx->sym[mid];
+		int cmp = strcmp(name, fdt_string(fdt, sym->nameoff));
+
+		if (!cmp)
+			return sym;
+		if (cmp < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+
+	return NULL;
+}
+
+/**
+ * overlay_symbols_sync() - Bring the symbol index up to date
+ *
+ * This records the current property offset of each symbol and adds any new
+ * symbols. Phandles already looked up are kept.
+ *
+ * @fdt: Base device tree blob
+ * @symbols_off: Offset of the /__symbols__ node in @fdt
+ * @idx: Index to update
+ * @return 0 on success, -FDT_ERR_NOSPACE if out of memory, other negative
+ *	error code on failure
+ */
+static int overlay_symbols_sync(const void *fdt, int symbols_off,
+				struct overlay_index *idx)
+{
+	const struct fdt_property *prop;
+	struct overlay_symbol *sym;
+	int old_count = idx->sym_count;
+	int property, nameoff, len, ret;
+
+	fdt_for_each_property_offset(property, fdt, symbols_off) {
+		prop = fdt_get_property_by_offset(fdt, property, &len);
+		if (!prop)
+			return len;
+
+		nameoff = fdt32_to_cpu(prop->nameoff);
+		sym = overlay_symbols_find(fdt, idx, fdt_string(fdt, nameoff));
+		if (!sym) {
+			ret = overlay_index_grow((void **)&idx->sym,
+						 idx->sym_count, &idx->sym_max,
+						 sizeof(*sym));
+			if (ret)
+				return ret;
+			sym = &idx->sym[idx->sym_count++];
+			sym->nameoff = nameoff;
+			sym->phandle = 0;
+		}
+		sym->propoff = property;
+	}
+
+	if (idx->sym_count != old_count) {
+		overlay_sort_fdt = fdt;
+		qsort(idx->sym, idx->sym_count, sizeof(*sym), overlay_sym_cmp);
+	}
+
+	return 0;
+}
+
+/* Forget the phandles of all symbols */
+static void overlay_symbols_forget_all(struct overlay_index *idx)
+{
+	int i;
+
+	for (i = 0; i < idx->sym_count; i++)
+		idx->sym[i].phandle = 0;
+}
+
+/* Look up the phandle of the node a symbol refers to */
+static int overlay_symbols_get_phandle(const void *fdt,
+				       struct overlay_index *idx,
+				       const char *label, uint32_t *phandlep)
+{
+	struct overlay_symbol *sym;
+	const char *path;
+	int node, len;
+
+	sym = overlay_symbols_find(fdt, idx, label);
+	if (!sym)
+		return -FDT_ERR_NOTFOUND;
+
+	if (!sym->phandle) {
+		path = fdt_getprop_by_offset(fdt, sym->propoff, NULL, &len);
+		if (!path)
+			return len;
+		node = fdt_path_offset(fdt, path);
+		if (node < 0)
+			return node;
+		sym->phandle = fdt_get_phandle(fdt, node);
+		if (!sym->phandle)
+			return -FDT_ERR_NOTFOUND;
+	}
+	*phandlep = sym->phandle;
+
+	return 0;
+}
+
+/**
+ * overlay_fixup_phandles_indexed() - Resolve overlay phandles using an index
+ *
+ * This does the same as overlay_fixup_phandles() but finds each symbol
+ * through @idx.
+ *
+ * @fdt: Base device tree blob
+ * @fdto: Device tree overlay blob
+ * @idx: Index of @fdt
+ * @return 0 on success, negative error code on failure
+ */
+static int overlay_fixup_phandles_indexed(void *fdt, void *fdto,
+					  struct overlay_index *idx)
+{
+	int fixups_off, symbols_off;
+	int property, ret;
+
+	fixups_off = fdt_path_offset(fdto, "/__fixups__");
+	if (fixups_off == -FDT_ERR_NOTFOUND)
+		return 0;
+	if (fixups_off < 0)
+		return fixups_off;
+
+	symbols_off = fdt_subnode_offset(fdt, 0, "__symbols__");
+	if (symbols_off < 0)
+		return symbols_off;
+	ret = overlay_symbols_sync(fdt, symbols_off, idx);
+	if (ret)
+		return ret;
+
+	fdt_for_each_property_offset(property, fdto, fixups_off) {
+		const char *value, *label;
+		uint32_t phandle = 0;
+		int len;
+
+		value = fdt_getprop_by_offset(fdto, property, &label, &len);
+		if (!value)
+			return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_INTERNAL :
+				len;
+
+		ret = overlay_symbols_get_phandle(fdt, idx, label, &phandle);
+		if (ret)
+			return ret;
+
+		do {
+			const char *path, *name, *fixup_end;
+			const char *fixup_str = value;
+			uint32_t path_len, name_len;
+			uint32_t fixup_len;
+			char *sep, *endptr;
+			fdt32_t phandle_prop;
+			int poffset, fixup_off;
+
+			fixup_end = memchr(value, '\0', len);
+			if (!fixup_end)
+				return -FDT_ERR_BADOVERLAY;
+			fixup_len = fixup_end - fixup_str;
+
+			len -= fixup_len + 1;
+			value += fixup_len + 1;
+
+			path = fixup_str;
+			sep = memchr(fixup_str, ':', fixup_len);
+			if (!sep)
+				return -FDT_ERR_BADOVERLAY;
+
+			path_len = sep - path;
+			if (path_len == (fixup_len - 1))
+				return -FDT_ERR_BADOVERLAY;
+
+			fixup_len -= path_len + 1;
+			name = sep + 1;
+			sep = memchr(name, ':', fixup_len);
+			if (!sep)
+				return -FDT_ERR_BADOVERLAY;
+
+			name_len = sep - name;
+			if (!name_len)
+				return -FDT_ERR_BADOVERLAY;
+
+			poffset = strtoul(sep + 1, &endptr, 10);
+			if ((*endptr != '\0') || (endptr <= (sep + 1)))
+				return -FDT_ERR_BADOVERLAY;
+
+			fixup_off = fdt_path_offset_namelen(fdto, path,
+							    path_len);
+			if (fixup_off == -FDT_ERR_NOTFOUND)
+				return -FDT_ERR_BADOVERLAY;
+			if (fixup_off < 0)
+				return fixup_off;
+
+			phandle_prop = cpu_to_fdt32(phandle);
+			ret = fdt_setprop_inplace_namelen_partial(fdto,
+					fixup_off, name, name_len, poffset,
+					&phandle_prop, sizeof(phandle_prop));
+			if (ret)
+				return ret;
+		} while (len > 0);
+	}
+
+	return 0;
+}
+
+/*
+ * Check whether merging @node into @target gives a phandle to a node that
+ * is already in the base tree, replacing the phandle it had
+ */
+static int overlay_replaces_phandle(const void *fdt, int target,
+				    const void *fdto, int node)
+{
+	int subnode, base, ret;
+
+	fdt_for_each_subnode(subnode, fdto, node) {
+		base = fdt_subnode_offset(fdt, target,
+					  fdt_get_name(fdto, subnode, NULL));
+		if (base == -FDT_ERR_NOTFOUND)
+			continue;
+		if (base < 0)
+			return base;
+		if (fdt_get_phandle(fdto, subnode))
+			return 1;
+		ret = overlay_replaces_phandle(fdt, base, fdto, subnode);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Check whether a node or any of its subnodes has a phandle */
+static bool overlay_has_phandle(const void *fdto, int node)
+{
+	int depth = 0;
+
+	do {
+		if (fdt_get_phandle(fdto, node))
+			return true;
+		node = fdt_next_node(fdto, node, &depth);
+	} while (node >= 0 && depth > 0);
+
+	return false;
+}
+
+/**
+ * overlay_merge_indexed() - Merge an overlay into its base device tree
+ *
+ * This does the same as overlay_merge(), finding each target through @idx.
+ * A symbol's phandle is kept in the index after it is looked up, which is
+ * only wrong if an overlay gives a new phandle to a node which is already
+ * in the base tree. This checks for that before merging each fragment and
+ * forgets the phandles if so.
+ *
+ * @fdt: Base device tree blob
+ * @fdto: Device tree overlay blob
+ * @idx: Index of @fdt
+ * @return 0 on success, negative error code on failure
+ */
+static int overlay_merge_indexed(void *fdt, void *fdto,
+				 struct overlay_index *idx)
+{
+	int fragment, overlay, target, size, ret;
+
+	fdt_for_each_subnode(fragment, fdto, 0) {
+		overlay = fdt_subnode_offset(fdto, fragment, "__overlay__");
+		if (overlay == -FDT_ERR_NOTFOUND)
+			continue;
+		if (overlay < 0)
+			return overlay;
+
+		target = overlay_index_target(fdt, fdto, idx, fragment, NULL);
+		if (target < 0)
+			return target;
+
+		if (overlay_has_phandle(fdto, overlay)) {
+			ret = fdt_get_phandle(fdto, overlay) ? 1 :
+				overlay_replaces_phandle(fdt, target, fdto,
+							 overlay);
+			if (ret < 0)
+				return ret;
+			if (ret)
+				overlay_symbols_forget_all(idx);
+		}
+
+		size = fdt_size_dt_struct(fdt);
+		ret = overlay_apply_node(fdt, target, fdto, overlay);
+		if (ret)
+			return ret;
+		size = fdt_size_dt_struct(fdt) - size;
+		overlay_index_shift(idx, target, size);
+	}
+
+	return 0;
+}
+
+/* Get the path of a node into idx->path, growing it as needed */
+static int overlay_index_path(const void *fdt, struct overlay_index *idx,
+			      int node)
+{
+	char *path;
+	int ret;
+
+	for (;;) {
+		if (idx->path_size) {
+			ret = fdt_get_path(fdt, node, idx->path,
+					   idx->path_size);
+			if (ret != -FDT_ERR_NOSPACE)
+				return ret;
+		}
+		path = realloc(idx->path, idx->path_size + 256);
+		if (!path)
+			return -FDT_ERR_NOSPACE;
+		idx->path = path;
+		idx->path_size += 256;
+	}
+}
+
+/**
+ * overlay_symbol_update_indexed() - Update the symbols of the base tree
+ *
+ * This does the same as overlay_symbol_update(), finding each target
+ * through @idx. The symbols which the overlay adds or changes are forgotten
+ * by the index.
+ *
+ * @fdt: Base device tree blob
+ * @fdto: Device tree overlay blob
+ * @idx: Index of @fdt
+ * @return 0 on success, negative error code on failure
+ */
+static int overlay_symbol_update_indexed(void *fdt, void *fdto,
+					 struct overlay_index *idx)
+{
+	int root_sym, ov_sym, prop, path_len, fragment, target;
+	int len, frag_name_len, ret, rel_path_len, prop_len, size;
+	const char *s, *e;
+	const char *path;
+	const char *name;
+	const char *frag_name;
+	const char *rel_path;
+	const char *target_path;
+	struct overlay_symbol *sym;
+	char *buf;
+
+	ov_sym = fdt_subnode_offset(fdto, 0, "__symbols__");
+	if (ov_sym < 0)
+		return 0;
+
+	root_sym = fdt_subnode_offset(fdt, 0, "__symbols__");
+	if (root_sym == -FDT_ERR_NOTFOUND) {
+		size = fdt_size_dt_struct(fdt);
+		root_sym = fdt_add_subnode(fdt, 0, "__symbols__");
+		overlay_index_shift(idx, 0, fdt_size_dt_struct(fdt) - size);
+	}
+	if (root_sym < 0)
+		return root_sym;
+
+	fdt_for_each_property_offset(prop, fdto, ov_sym) {
+		path = fdt_getprop_by_offset(fdto, prop, &name, &path_len);
+		if (!path)
+			return path_len;
+
+		if (path_len < 1 ||
+		    memchr(path, '\0', path_len) != &path[path_len - 1])
+			return -FDT_ERR_BADVALUE;
+		e = path + path_len;
+
+		if (*path != '/')
+			return -FDT_ERR_BADVALUE;
+
+		s = strchr(path + 1, '/');
+		if (!s)
+			continue;
+
+		frag_name = path + 1;
+		frag_name_len = s - path - 1;
+
+		len = sizeof("/__overlay__/") - 1;
+		if ((e - s) > len && (memcmp(s, "/__overlay__/", len) == 0)) {
+			rel_path = s + len;
+			rel_path_len = e - rel_path;
+		} else if ((e - s) == len &&
+			   (memcmp(s, "/__overlay__", len - 1) == 0)) {
+			rel_path = "";
+			rel_path_len = 0;
+		} else {
+			continue;
+		}
+
+		ret = fdt_subnode_offset_namelen(fdto, 0, frag_name,
+						 frag_name_len);
+		if (ret < 0)
+			return -FDT_ERR_BADOVERLAY;
+		fragment = ret;
+
+		ret = fdt_subnode_offset(fdto, fragment, "__overlay__");
+		if (ret < 0)
+			return -FDT_ERR_BADOVERLAY;
+
+		ret = overlay_index_target(fdt, fdto, idx, fragment,
+					   &target_path);
+		if (ret < 0)
+			return ret;
+		target = ret;
+
+		if (!target_path) {
+			ret = overlay_index_path(fdt, idx, target);
+			if (ret < 0)
+				return ret;
+			target_path = idx->path;
+		}
+		len = strlen(target_path);
+
+		/*
+		 * Build the new value in idx->path, after the target path.
+		 * This has the same length as overlay_symbol_update() gives.
+		 */
+		prop_len = len + (len > 1) + rel_path_len + 1;
+		if (prop_len > idx->path_size) {
+			buf = realloc(idx->path, prop_len);
+			if (!buf)
+				return -FDT_ERR_NOSPACE;
+			if (target_path == idx->path)
+				target_path = buf;
+			idx->path = buf;
+			idx->path_size = prop_len;
+		}
+		buf = idx->path;
+		if (target_path != buf)
+			memcpy(buf, target_path, len + 1);
+		if (len == 1)
+			len--;
+		buf[len] = '/';
+		memcpy(buf + len + 1, rel_path, rel_path_len);
+		buf[len + 1 + rel_path_len] = '\0';
+
+		size = fdt_size_dt_struct(fdt);
+		ret = fdt_setprop(fdt, root_sym, name, buf, prop_len);
+		if (ret < 0)
+			return ret;
+		overlay_index_shift(idx, root_sym,
+				    fdt_size_dt_struct(fdt) - size);
+
+		sym = overlay_symbols_find(fdt, idx, name);
+		if (sym)
+			sym->phandle = 0;
+	}
+
+	return 0;
+}
+
+int fdt_overlay_apply_multi(void *fdt, void *const fdtos[], int count)
+{
+	struct overlay_index idx = { };
+	uint32_t delta, max;
+	void *fdto = NULL;
+	int ret, i;
+
+	FDT_RO_PROBE(fdt);
+
+	ret = overlay_index_init(fdt, &idx, &delta);
+	if (ret)
+		goto err;
+
+	for (i = 0; i < count; i++) {
+		fdto = fdtos[i];
+		ret = fdt_ro_probe_(fdto);
+		if (ret < 0)
+			goto err;
+
+		ret = overlay_adjust_local_phandles(fdto, delta);
+		if (ret)
+			goto err;
+
+		ret = overlay_update_local_references(fdto, delta);
+		if (ret)
+			goto err;
+
+		ret = overlay_fixup_phandles_indexed(fdt, fdto, &idx);
+		if (ret)
+			goto err;
+
+		/* The overlay's phandles are now the largest in the tree */
+		ret = fdt_find_max_phandle(fdto, &max);
+		if (ret)
+			goto err;
+
+		ret = overlay_merge_indexed(fdt, fdto, &idx);
+		if (ret)
+			goto err;
+
+		ret = overlay_symbol_update_indexed(fdt, fdto, &idx);
+		if (ret)
+			goto err;
+
+		if (max > delta)
+			delta = max;
+		fdt_set_magic(fdto, ~0);
+	}
+	overlay_index_free(&idx);
+
+	return 0;
+
+err:
+	overlay_index_free(&idx);
+	if (fdto)
+		fdt_set_magic(fdto, ~0);
+	fdt_set_magic(fdt, ~0);
+
+	return ret;
+}
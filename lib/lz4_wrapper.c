@@ -7,8 +7,12 @@
 #include <compiler.h>
 #include <image.h>
 #include <lz4.h>
+#include <worker.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
+#include <linux/sizes.h>
 #include <linux/types.h>
+#include <linux/xxhash.h>
 
 static u16 LZ4_readLE16(const void *src) { return le16_to_cpu(*(u16 *)src); }
 static void LZ4_copy4(void *dst, const void *src) { *(u32 *)dst = *(u32 *)src; }
@@ -62,77 +66,440 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
-int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+/* Skippable frames have this magic, with any value in the bottom four bits */
+#define LZ4F_SKIP_MAGIC		0x184d2a50
+#define LZ4F_SKIP_MASK		0xfffffff0
+
+/* Number of blocks to scan before decompressing them on several CPUs */
+#if CONFIG_IS_ENABLED(WORKER)
+#define LZ4_MAX_BLOCKS		(CONFIG_WORKER_MAX * 4)
+#else
+#define LZ4_MAX_BLOCKS		1
+#endif
+
+/**
+ * struct lz4_frame - Information from a frame header
+ *
+ * @has_block_checksum: true if each block is followed by a checksum
+ * @has_content_checksum: true if the frame ends with a checksum of its data
+ * @independent: true if matches cannot refer to earlier blocks
+ * @block_size: Maximum size of a block of uncompressed data, or 0 if the
+ *	header uses a reserved value
+ * @content_size: Size of the uncompressed data, or 0 if not recorded
+ */
+struct lz4_frame {
+	bool has_block_checksum;
+	bool has_content_checksum;
+	bool independent;
+	size_t block_size;
+	u64 content_size;
+};
+
+/**
+ * struct lz4_block - A block to decompress
+ *
+ * @in: Block data
+ * @size: Size of the block data
+ * @not_compressed: true if the data is stored uncompressed
+ * @checksum: Block checksum, or NULL if there is none
+ * @out: Where to put the uncompressed data
+ * @avail: Space available at @out
+ * @low_prefix: Start of the data which matches may refer to, which is @out
+ *	for independent blocks and the start of the frame for linked blocks
+ * @len: Returns the length of the uncompressed data
+ */
+struct lz4_block {
+	const void *in;
+	u32 size;
+	bool not_compressed;
+	const void *checksum;
+	void *out;
+	size_t avail;
+	const void *low_prefix;
+	size_t len;
+};
+
+static int lz4_decode_block(void *priv)
 {
-	const void *end = dst + *dstn;
-	const void *in = src;
-	void *out = dst;
-	int has_block_checksum;
+	struct lz4_block *blk = priv;
 	int ret;
-	*dstn = 0;
 
-	{ /* With in-place decompression the header may become invalid later. */
-		const struct lz4_frame_header *h = in;
+	blk->len = 0;
+	if (CONFIG_IS_ENABLED(LZ4_CHECKSUM) && blk->checksum &&
+	    xxh32(blk->in, blk->size, 0) != get_unaligned_le32(blk->checksum))
+		return -EBADMSG;
 
-		if (srcn < sizeof(*h) + sizeof(u64) + sizeof(u8))
-			return -EINVAL;	/* input overrun */
+	if (blk->not_compressed) {
+		size_t size = min_t(size_t, blk->size, blk->avail);
 
-		/* We assume there's always only a single, standard frame. */
-		if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
-			return -EPROTONOSUPPORT;	/* unknown format */
-		if (h->reserved0 || h->reserved1 || h->reserved2)
-			return -EINVAL;	/* reserved must be zero */
-		if (!h->independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
-		has_block_checksum = h->has_block_checksum;
-
-		in += sizeof(*h);
-		if (h->has_content_size)
-			in += sizeof(u64);
-		in += sizeof(u8);
+		/* The output may be just below the input if in place */
+		memmove(blk->out, blk->in, size);
+		blk->len = size;
+		if (size < blk->size)
+			return -ENOBUFS;	/* output overrun */
+	} else {
+		/* constant folding essential, do not touch params! */
+		ret = LZ4_decompress_generic(blk->in, blk->out, blk->size,
+				blk->avail, endOnInputSize,
+				full, 0, noDict, blk->low_prefix, NULL, 0);
+		if (ret < 0)
+			return -EPROTO;	/* decompression error */
+		blk->len = ret;
 	}
 
-	while (1) {
+	return 0;
+}
+
+/**
+ * lz4_scan_blocks() - Find the next blocks in a frame
+ *
+ * @inp: Pointer to the next block header, updated to point after the blocks
+ *	found
+ * @src_end: End of the compressed data
+ * @has_block_checksum: true if each block is followed by a checksum
+ * @blks: Returns the blocks found
+ * @max: Maximum number of blocks to find
+ * @donep: Set to true if the end mark of the frame is reached
+ * @return number of blocks found, or -EINVAL if the input is overrun
+ */
+static int lz4_scan_blocks(const void **inp, const void *src_end,
+			   bool has_block_checksum, struct lz4_block *blks,
+			   int max, bool *donep)
+{
+	const void *in = *inp;
+	int count;
+
+	for (count = 0; count < max; count++) {
 		struct lz4_block_header b;
+		struct lz4_block *blk = &blks[count];
 
-		b.raw = le32_to_cpu(*(u32 *)in);
-		in += sizeof(struct lz4_block_header);
+		if (src_end - in < sizeof(b))
+			return -EINVAL;		/* input overrun */
+		b.raw = get_unaligned_le32(in);
+		in += sizeof(b);
 
-		if (in - src + b.size > srcn) {
-			ret = -EINVAL;		/* input overrun */
+		if (!b.size) {
+			*donep = true;
 			break;
 		}
+		if (src_end - in < b.size + (has_block_checksum ? 4 : 0))
+			return -EINVAL;		/* input overrun */
 
-		if (!b.size) {
-			ret = 0;	/* decompression successful */
+		blk->in = in;
+		blk->size = b.size;
+		blk->not_compressed = b.not_compressed;
+		in += b.size;
+		blk->checksum = has_block_checksum ? in : NULL;
+		if (has_block_checksum)
+			in += sizeof(u32);
+	}
+	*inp = in;
+
+	return count;
+}
+
+/**
+ * lz4_parse_header() - Read the header of an LZ4 frame
+ *
+ * @inp: Pointer to the frame, updated to point to the first block
+ * @src_end: End of the compressed data
+ * @frame: Returns information from the header
+ * @return 0 if OK, -ve on error
+ */
+static int lz4_parse_header(const void **inp, const void *src_end,
+			    struct lz4_frame *frame)
+{
+	const struct lz4_frame_header *h = *inp;
+	const void *in = *inp;
+
+	if (src_end - in < sizeof(*h) + sizeof(u8))
+		return -EINVAL;	/* input overrun */
+	if (get_unaligned_le32(&h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;	/* reserved must be zero */
+	frame->has_block_checksum = h->has_block_checksum;
+	frame->has_content_checksum = h->has_content_checksum;
+	frame->independent = h->independent_blocks;
+	frame->block_size = h->max_block_size >= 4 ?
+		SZ_64K << (2 * (h->max_block_size - 4)) : 0;
+	frame->content_size = 0;
+
+	in += sizeof(*h);
+	if (h->has_content_size) {
+		if (src_end - in < sizeof(u64) + sizeof(u8))
+			return -EINVAL;	/* input overrun */
+		frame->content_size = get_unaligned_le64(in);
+		in += sizeof(u64);
+	}
+	if (CONFIG_IS_ENABLED(LZ4_CHECKSUM) &&
+	    ((xxh32(&h->flags, in - (void *)&h->flags, 0) >> 8) & 0xff) !=
+	    *(u8 *)in)
+		return -EBADMSG;
+	in += sizeof(u8);
+	*inp = in;
+
+	return 0;
+}
+
+/**
+ * lz4_decode_frame() - Decompress a single LZ4 frame
+ *
+ * @inp: Pointer to the frame, updated to point after it
+ * @src_end: End of the compressed data
+ * @outp: Pointer to the output position, updated as data is written
+ * @end: End of the output buffer
+ * @parallel: true to decompress independent blocks on several CPUs, which
+ *	requires that the output buffer does not overlap the input
+ * @return 0 if OK, -ve on error
+ */
+static int lz4_decode_frame(const void **inp, const void *src_end,
+			    void **outp, const void *end, bool parallel)
+{
+	struct lz4_block blks[LZ4_MAX_BLOCKS];
+	struct lz4_frame frame;
+	const void *in = *inp;
+	void *start = *outp;
+	void *out = start;
+	bool done = false;
+	size_t block_size;
+	int ret = 0;
+
+	/* With in-place decompression the header may become invalid later. */
+	ret = lz4_parse_header(&in, src_end, &frame);
+	if (ret)
+		return ret;
+	block_size = frame.block_size;
+
+	parallel = parallel && frame.independent && block_size;
+	while (!done) {
+		int count, i;
+
+		count = lz4_scan_blocks(&in, src_end, frame.has_block_checksum,
+					blks, parallel ? LZ4_MAX_BLOCKS : 1,
+					&done);
+		if (count < 0) {
+			ret = count;
 			break;
 		}
 
-		if (b.not_compressed) {
-			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
-			out += size;
-			if (size < b.size) {
-				ret = -ENOBUFS;	/* output overrun */
-				break;
+		/*
+		 * Put each block in its own slot, which is large enough for
+		 * any block but the last, then close up any gaps
+		 */
+		if (count > 1 && (count - 1) * block_size < end - out) {
+			void *pos = out;
+
+			for (i = 0; i < count; i++) {
+				blks[i].out = out + i * block_size;
+				blks[i].avail = i < count - 1 ? block_size :
+					end - blks[i].out;
+				blks[i].low_prefix = blks[i].out;
 			}
-		} else {
-			/* constant folding essential, do not touch params! */
-			ret = LZ4_decompress_generic(in, out, b.size,
-					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
-			if (ret < 0) {
-				ret = -EPROTO;	/* decompression error */
+			ret = worker_run(lz4_decode_block, blks, sizeof(*blks),
+					 count);
+			if (ret)
 				break;
+			for (i = 0; i < count; i++) {
+				if (blks[i].out != pos)
+					memmove(pos, blks[i].out, blks[i].len);
+				pos += blks[i].len;
 			}
-			out += ret;
+			out = pos;
+			continue;
 		}
 
-		in += b.size;
-		if (has_block_checksum)
-			in += sizeof(u32);
+		for (i = 0; i < count; i++) {
+			blks[i].out = out;
+			blks[i].avail = end - out;
+			blks[i].low_prefix = frame.independent ? out : start;
+			ret = lz4_decode_block(&blks[i]);
+			out += blks[i].len;
+			if (ret)
+				break;
+		}
+		if (ret)
+			break;
+	}
+	*outp = out;
+	if (ret)
+		return ret;
+
+	if (frame.has_content_checksum) {
+		if (src_end - in < sizeof(u32))
+			return -EINVAL;	/* input overrun */
+		if (CONFIG_IS_ENABLED(LZ4_CHECKSUM) &&
+		    xxh32(start, out - start, 0) != get_unaligned_le32(in))
+			return -EBADMSG;
+		in += sizeof(u32);
+	}
+	*inp = in;
+
+	return 0;
+}
+
+/* Skip any skippable frames, returning -EINVAL if one is truncated */
+static int lz4_skip_frames(const void **inp, const void *src_end)
+{
+	const void *in = *inp;
+
+	while (src_end - in >= 2 * sizeof(u32) &&
+	       (get_unaligned_le32(in) & LZ4F_SKIP_MASK) == LZ4F_SKIP_MAGIC) {
+		u32 size = get_unaligned_le32(in + sizeof(u32));
+
+		in += 2 * sizeof(u32);
+		if (src_end - in < size)
+			return -EINVAL;	/* input overrun */
+		in += size;
+	}
+	*inp = in;
+
+	return 0;
+}
+
+int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	const void *src_end = src + srcn;
+	const void *end = dst + *dstn;
+	const void *in = src;
+	void *out = dst;
+	bool parallel;
+	int frames;
+	int ret;
+
+	/* Blocks cannot be put in slots if decompressing in place */
+	parallel = worker_count() > 1 &&
+		(end <= src || src_end <= (const void *)dst);
+
+	for (frames = 0;; frames++) {
+		ret = lz4_skip_frames(&in, src_end);
+		if (ret)
+			break;
+
+		/* Anything after the last frame is ignored */
+		if (frames && (src_end - in < sizeof(u32) ||
+			       get_unaligned_le32(in) != LZ4F_MAGIC))
+			break;
+
+		ret = lz4_decode_frame(&in, src_end, &out, end, parallel);
+		if (ret)
+			break;
 	}
 
 	*dstn = out - dst;
 	return ret;
 }
+
+/**
+ * lz4_frame_inplace() - Work out the space needed for a frame in place
+ *
+ * @inp: Pointer to the frame, updated to point after it
+ * @src_end: End of the compressed data
+ * @sizep: Incremented by the size of the uncompressed data, or an upper
+ *	bound on it if the frame does not record it
+ * @marginp: Incremented by the gap needed between the output and input
+ * @return 0 if OK, -ve on error
+ */
+static int lz4_frame_inplace(const void **inp, const void *src_end,
+			     size_t *sizep, size_t *marginp)
+{
+	const void *start = *inp;
+	const void *in = start;
+	struct lz4_frame frame;
+	struct lz4_block blk;
+	size_t size = 0, hdr_len;
+	bool done = false;
+	int blocks, ret;
+
+	ret = lz4_parse_header(&in, src_end, &frame);
+	if (ret)
+		return ret;
+	hdr_len = in - start;
+	for (blocks = 0; !done; blocks += ret) {
+		ret = lz4_scan_blocks(&in, src_end, frame.has_block_checksum,
+				      &blk, 1, &done);
+		if (ret < 0)
+			return ret;
+		if (ret && !frame.block_size && !blk.not_compressed)
+			return -EINVAL;
+		if (ret && blk.not_compressed)
+			size += blk.size;
+		else if (ret)
+			size += frame.block_size;
+	}
+	if (frame.has_content_checksum) {
+		if (src_end - in < sizeof(u32))
+			return -EINVAL;	/* input overrun */
+		in += sizeof(u32);
+	}
+
+	/*
+	 * A long run of literals needs an extra length byte for every 255
+	 * bytes, so the input can gain on the output by 1/256 of its size.
+	 * The decoder also copies up to 32 bytes at a time. Headers and
+	 * checksums produce no output at all.
+	 */
+	*sizep += frame.content_size ? frame.content_size : size;
+	*marginp += ((in - start) >> 8) + 32 + hdr_len +
+		(blocks + 1) * 2 * sizeof(u32);
+	*inp = in;
+
+	return 0;
+}
+
+int ulz4fn_inplace_size(const void *src, size_t srcn, size_t *sizep)
+{
+	const void *src_end = src + srcn;
+	const void *in = src;
+	size_t size = 0, margin = 0;
+	int frames;
+	int ret;
+
+	for (frames = 0;; frames++) {
+		const void *skip = in;
+
+		/* Skipped data is read without writing anything */
+		ret = lz4_skip_frames(&in, src_end);
+		if (ret)
+			return ret;
+		margin += in - skip;
+
+		if (frames && (src_end - in < sizeof(u32) ||
+			       get_unaligned_le32(in) != LZ4F_MAGIC))
+			break;
+
+		ret = lz4_frame_inplace(&in, src_end, &size, &margin);
+		if (ret)
+			return ret;
+	}
+	*sizep = size + margin;
+
+	return 0;
+}
+
+int ulz4fn_stream_len(const void *src, size_t srcn, size_t *lenp)
+{
+	const void *src_end = src + srcn;
+	const void *in = src;
+	size_t size = 0, margin = 0;
+	int frames;
+	int ret;
+
+	/* Walk the frames in the same way as ulz4fn() */
+	for (frames = 0;; frames++) {
+		ret = lz4_skip_frames(&in, src_end);
+		if (ret)
+			return ret;
+
+		if (frames && (src_end - in < sizeof(u32) ||
+			       get_unaligned_le32(in) != LZ4F_MAGIC))
+			break;
+
+		ret = lz4_frame_inplace(&in, src_end, &size, &margin);
+		if (ret)
+			return ret;
+	}
+	*lenp = in - src;
+
+	return 0;
+}
@@ -23,101 +23,146 @@
 
 #ifdef CONFIG_LZMA
 
-#define LZMA_PROPERTIES_OFFSET 0
 #define LZMA_SIZE_OFFSET       LZMA_PROPS_SIZE
-#define LZMA_DATA_OFFSET       LZMA_SIZE_OFFSET+sizeof(uint64_t)
 
 #include "LzmaTools.h"
 #include "LzmaDec.h"
 
 #include <linux/string.h>
 #include <malloc.h>
+#include <asm/unaligned.h>
 
 static void *SzAlloc(void *p, size_t size) { return malloc(size); }
 static void SzFree(void *p, void *address) { free(address); }
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
 
-int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
-                  unsigned char *inStream,  SizeT  length)
+void lzma_stream_init(struct lzma_stream *strm, void *out, SizeT out_max)
 {
-    int res = SZ_ERROR_DATA;
-    int i;
-    ISzAlloc g_Alloc;
-
-    SizeT outSizeFull = 0xFFFFFFFF; /* 4GBytes limit */
-    SizeT outProcessed;
-    SizeT outSize;
-    SizeT outSizeHigh;
-    ELzmaStatus state;
-    SizeT compressedSize = (SizeT)(length - LZMA_PROPS_SIZE);
-
-    debug ("LZMA: Image address............... 0x%p\n", inStream);
-    debug ("LZMA: Properties address.......... 0x%p\n", inStream + LZMA_PROPERTIES_OFFSET);
-    debug ("LZMA: Uncompressed size address... 0x%p\n", inStream + LZMA_SIZE_OFFSET);
-    debug ("LZMA: Compressed data address..... 0x%p\n", inStream + LZMA_DATA_OFFSET);
-    debug ("LZMA: Destination address......... 0x%p\n", outStream);
-
-    memset(&state, 0, sizeof(state));
-
-    outSize = 0;
-    outSizeHigh = 0;
-    /* Read the uncompressed size */
-    for (i = 0; i < 8; i++) {
-        unsigned char b = inStream[LZMA_SIZE_OFFSET + i];
-            if (i < 4) {
-                outSize     += (UInt32)(b) << (i * 8);
-        } else {
-                outSizeHigh += (UInt32)(b) << ((i - 4) * 8);
-        }
-    }
-
-    outSizeFull = (SizeT)outSize;
-    if (sizeof(SizeT) >= 8) {
-        /*
-         * SizeT is a 64 bit uint => We can manage files larger than 4GB!
-         *
-         */
-            outSizeFull |= (((SizeT)outSizeHigh << 16) << 16);
-    } else if (outSizeHigh != 0 || (UInt32)(SizeT)outSize != outSize) {
-        /*
-         * SizeT is a 32 bit uint => We cannot manage files larger than
-         * 4GB!  Assume however that all 0xf values is "unknown size" and
-         * not actually a file of 2^64 bits.
-         *
-         */
-        if (outSizeHigh != (SizeT)-1 || outSize != (SizeT)-1) {
-            debug ("LZMA: 64bit support not enabled.\n");
-            return SZ_ERROR_DATA;
-        }
-    }
-
-    debug("LZMA: Uncompresed size............ 0x%zx\n", outSizeFull);
-    debug("LZMA: Compresed size.............. 0x%zx\n", compressedSize);
-
-    g_Alloc.Alloc = SzAlloc;
-    g_Alloc.Free = SzFree;
-
-    /* Short-circuit early if we know the buffer can't hold the results. */
-    if (outSizeFull != (SizeT)-1 && *uncompressedSize < outSizeFull)
-        return SZ_ERROR_OUTPUT_EOF;
-
-    /* Decompress */
-    outProcessed = min(outSizeFull, *uncompressedSize);
-
-    WATCHDOG_RESET();
-
-    res = LzmaDecode(
-        outStream, &outProcessed,
-        inStream + LZMA_DATA_OFFSET, &compressedSize,
-        inStream, LZMA_PROPS_SIZE, LZMA_FINISH_END, &state, &g_Alloc);
-    *uncompressedSize = outProcessed;
-
-    debug("LZMA: Uncompressed ............... 0x%zx\n", outProcessed);
-
-    if (res != SZ_OK)  {
-        return res;
-    }
-
-    return res;
+	LzmaDec_Construct(&strm->dec);
+	strm->dec.dic = out;
+	strm->dec.dicBufSize = out_max;
+	strm->hdr_len = 0;
+	strm->out_len = 0;
+}
+
+/* Set up the decoder once the header has been collected */
+static int lzma_stream_start(struct lzma_stream *strm)
+{
+	u64 size;
+	SRes res;
+
+	res = LzmaDec_AllocateProbs(&strm->dec, strm->hdr, LZMA_PROPS_SIZE,
+				    &g_Alloc);
+	if (res != SZ_OK)
+		return res == SZ_ERROR_MEM ? -ENOMEM : -EPROTONOSUPPORT;
+	LzmaDec_Init(&strm->dec);
+
+	/* All ones means that the size is not known */
+	size = get_unaligned_le64(strm->hdr + LZMA_SIZE_OFFSET);
+	if (size == U64_MAX) {
+		strm->out_size = (SizeT)-1;
+	} else {
+		if (size > strm->dec.dicBufSize)
+			return -ENOSPC;
+		strm->out_size = size;
+	}
+
+	return 0;
+}
+
+int lzma_stream_decode(struct lzma_stream *strm, const void *in,
+		       SizeT *in_len)
+{
+	const Byte *src = in;
+	SizeT left = *in_len, len, limit;
+	ELzmaStatus status;
+	SRes res;
+	int ret;
+
+	*in_len = 0;
+	if (strm->hdr_len < LZMA_STREAM_HDR_SIZE) {
+		len = min_t(SizeT, left, LZMA_STREAM_HDR_SIZE - strm->hdr_len);
+		memcpy(strm->hdr + strm->hdr_len, src, len);
+		strm->hdr_len += len;
+		src += len;
+		left -= len;
+		*in_len = len;
+		if (strm->hdr_len < LZMA_STREAM_HDR_SIZE)
+			return 0;
+		ret = lzma_stream_start(strm);
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * If the size is not known, the stream ends with a mark, which the
+	 * decoder looks for once the buffer is full
+	 */
+	if (strm->out_size == (SizeT)-1)
+		limit = strm->dec.dicBufSize;
+	else
+		limit = strm->out_size;
+	len = left;
+	WATCHDOG_RESET();
+	res = LzmaDec_DecodeToDic(&strm->dec, limit, src, &len,
+				  LZMA_FINISH_END, &status);
+	*in_len += len;
+	strm->out_len = strm->dec.dicPos;
+	if (res != SZ_OK)
+		return strm->out_len == limit && limit != strm->out_size ?
+			-ENOSPC : -EBADMSG;
+
+	switch (status) {
+	case LZMA_STATUS_FINISHED_WITH_MARK:
+		return 1;
+	case LZMA_STATUS_MAYBE_FINISHED_WITHOUT_MARK:
+		if (strm->out_len == strm->out_size)
+			return 1;
+		return -ENOSPC;
+	case LZMA_STATUS_NEEDS_MORE_INPUT:
+		return 0;
+	default:
+		return -EBADMSG;
+	}
+}
+
+void lzma_stream_end(struct lzma_stream *strm)
+{
+	LzmaDec_FreeProbs(&strm->dec, &g_Alloc);
+}
+
+/* The whole stream is given at once, as a single piece */
+int lzmaBuffToBuffDecompress(unsigned char *outStream,
+			     SizeT *uncompressedSize, unsigned char *inStream,
+			     SizeT length)
+{
+	struct lzma_stream strm;
+	SizeT len = length;
+	int ret;
+
+	debug("LZMA: Image address............... 0x%p\n", inStream);
+	debug("LZMA: Destination address......... 0x%p\n", outStream);
+
+	lzma_stream_init(&strm, outStream, *uncompressedSize);
+	ret = lzma_stream_decode(&strm, inStream, &len);
+	*uncompressedSize = strm.out_len;
+	lzma_stream_end(&strm);
+	debug("LZMA: Uncompressed ............... 0x%zx\n", strm.out_len);
+
+	switch (ret) {
+	case 1:
+		return SZ_OK;
+	case 0:
+		return SZ_ERROR_INPUT_EOF;
+	case -ENOSPC:
+		return SZ_ERROR_OUTPUT_EOF;
+	case -ENOMEM:
+		return SZ_ERROR_MEM;
+	case -EPROTONOSUPPORT:
+		return SZ_ERROR_UNSUPPORTED;
+	default:
+		return SZ_ERROR_DATA;
+	}
 }
 
 #endif
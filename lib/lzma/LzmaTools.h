@@ -12,7 +12,67 @@
 #define __LZMA_TOOL_H__
 
 #include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+/* Size of the header of the LZMA_Alone format: properties and size */
+#define LZMA_STREAM_HDR_SIZE	(LZMA_PROPS_SIZE + 8)
+
+/**
+ * struct lzma_stream - State of an LZMA stream decoded a piece at a time
+ *
+ * The output buffer serves as the dictionary, so it must hold the whole of
+ * the uncompressed data. The only other memory needed is the decoder's table
+ * of probabilities, which is allocated with malloc() once the header has
+ * been read. It is sized for the stream: about 30KB for the usual lc=3,
+ * lp=0. The struct itself is small enough to go on the stack, even in SPL.
+ *
+ * @out_len: Number of bytes written to the output buffer so far
+ *
+ * The other members are private to lib/lzma/LzmaTools.c
+ */
+struct lzma_stream {
+	CLzmaDec dec;
+	Byte hdr[LZMA_STREAM_HDR_SIZE];
+	unsigned int hdr_len;
+	SizeT out_size;
+	SizeT out_len;
+};
+
+/**
+ * lzma_stream_init() - Start decoding an LZMA stream in pieces
+ *
+ * @strm: Stream state to set up
+ * @out: Buffer for the uncompressed data
+ * @out_max: Size of @out in bytes
+ */
+void lzma_stream_init(struct lzma_stream *strm, void *out, SizeT out_max);
+
+/**
+ * lzma_stream_decode() - Decode the next piece of an LZMA stream
+ *
+ * The stream may be split at any byte offset. Data following the end of the
+ * stream is not used.
+ *
+ * @strm: Stream set up by lzma_stream_init()
+ * @in: Next piece of compressed data
+ * @in_len: Number of bytes at @in; returns the number of bytes used
+ * @return 1 if the stream is complete, 0 if more input is needed,
+ *	-EPROTONOSUPPORT if the properties are not supported, -ENOMEM if the
+ *	probabilities cannot be allocated, -ENOSPC if the output buffer is
+ *	too small, -EBADMSG if the data is corrupt
+ */
+int lzma_stream_decode(struct lzma_stream *strm, const void *in,
+		       SizeT *in_len);
+
+/**
+ * lzma_stream_end() - Free the memory used to decode an LZMA stream
+ *
+ * This must be called once decoding is finished or has failed.
+ *
+ * @strm: Stream set up by lzma_stream_init()
+ */
+void lzma_stream_end(struct lzma_stream *strm);
 #endif
@@ -112,10 +112,10 @@ int lzop_decompress(const unsigned char *src, size_t src_len,
 			return LZO_E_OUTPUT_OVERRUN;
 
 		/* When the input data is not compressed at all,
-		 * lzo1x_decompress_safe will fail, so call memcpy()
-		 * instead */
+		 * lzo1x_decompress_safe will fail, so call memmove()
+		 * instead, since the output may overlap the input */
 		if (dlen == slen) {
-			memcpy(dst, src, slen);
+			memmove(dst, src, slen);
 		} else {
 			/* decompress */
 			tmp = dlen;
@@ -138,6 +138,63 @@ int lzop_decompress(const unsigned char *src, size_t src_len,
 	return LZO_E_INPUT_OVERRUN;
 }
 
+/*
+ * Walk the blocks of lzop data, returning the size of buffer needed to
+ * decompress it in place and the length of the compressed data
+ */
+static int lzop_scan(const unsigned char *src, size_t src_len, size_t *size,
+		     size_t *len)
+{
+	const unsigned char *start = src, *send = src + src_len;
+	size_t dsize = 0, margin = sizeof(u32);
+	u32 slen, dlen;
+
+	src = parse_header(src);
+	if (!src)
+		return -EPROTONOSUPPORT;
+
+	while (send - src >= sizeof(u32)) {
+		dlen = get_unaligned_be32(src);
+		if (!dlen) {
+			*size = dsize + margin;
+			*len = src + sizeof(u32) - start;
+			return 0;
+		}
+		if (send - src < 3 * sizeof(u32))
+			break;
+		slen = get_unaligned_be32(src + sizeof(u32));
+		if (!slen || slen > dlen)
+			return -EINVAL;
+
+		/*
+		 * Each block has a 12-byte header and LZO1X output can fall
+		 * behind its input by dlen / 16 + 64 + 3 bytes
+		 */
+		dsize += dlen;
+		margin += 3 * sizeof(u32);
+		if (slen != dlen)
+			margin += dlen / 16 + 64 + 3;
+		src += 3 * sizeof(u32) + slen;
+	}
+
+	return -EINVAL;
+}
+
+int lzop_inplace_size(const unsigned char *src, size_t src_len,
+		      size_t *size)
+{
+	size_t len;
+
+	return lzop_scan(src, src_len, size, &len);
+}
+
+int lzop_stream_len(const unsigned char *src, size_t src_len, size_t *len)
+{
+	size_t size;
+
+	return lzop_scan(src, src_len, &size, len);
+}
+
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			unsigned char *out, size_t *out_len)
 {
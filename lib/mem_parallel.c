@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Zeroing and testing large areas of memory on several CPUs
+ */
+
+#include <common.h>
+#include <console.h>
+#include <display_options.h>
+#include <mem_parallel.h>
+#include <watchdog.h>
+#include <worker.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+/* Shares start on this boundary, so that no two CPUs use a cache line */
+#define MEM_PARALLEL_ALIGN	SZ_4K
+
+/*
+ * Each CPU handles this much of its share at a time, so that the boot CPU
+ * can reset the watchdog and check for Ctrl-C between chunks
+ */
+#define MEM_PARALLEL_CHUNK	SZ_16M
+
+void mem_parallel_split(struct mem_parallel *par, ulong addr, void *buf,
+			ulong size)
+{
+	ulong share, done;
+	int count, i;
+
+	count = min(worker_count(), MEM_PARALLEL_MAX);
+	share = ALIGN(DIV_ROUND_UP(size, count), MEM_PARALLEL_ALIGN);
+	memset(par, '\0', sizeof(*par));
+	for (i = 0, done = 0; i < count && done < size; i++) {
+		struct mem_parallel_part *part = &par->parts[i];
+
+		part->addr = addr + done;
+		part->buf = buf + done;
+		part->size = min(share, size - done);
+		done += part->size;
+	}
+	par->count = i;
+}
+
+/*
+ * Run @func on each share a chunk at a time, adding up how long it took.
+ * Returns -EINTR if Ctrl-C is pressed.
+ */
+static int mem_parallel_run(struct mem_parallel *par, worker_func_t func)
+{
+	ulong offset;
+	int ret, i;
+
+	/* Make sure the timer is set up before other CPUs read it */
+	timer_get_us();
+
+	/* The first share is the largest */
+	for (offset = 0; offset < par->parts[0].size;
+	     offset += MEM_PARALLEL_CHUNK) {
+		for (i = 0; i < par->count; i++) {
+			struct mem_parallel_part *part = &par->parts[i];
+
+			part->offset = offset;
+			part->len = offset < part->size ?
+				min_t(ulong, part->size - offset,
+				      MEM_PARALLEL_CHUNK) : 0;
+		}
+		ret = worker_run(func, par->parts, sizeof(par->parts[0]),
+				 par->count);
+		if (ret)
+			return ret;
+		WATCHDOG_RESET();
+		if (ctrlc())
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+static int mem_parallel_zero_part(void *priv)
+{
+	struct mem_parallel_part *part = priv;
+	ulong start = timer_get_us();
+
+	memset(part->buf + part->offset, '\0', part->len);
+	part->write_us += timer_get_us() - start;
+
+	return 0;
+}
+
+int mem_parallel_zero(struct mem_parallel *par)
+{
+	int i;
+
+	for (i = 0; i < par->count; i++)
+		par->parts[i].write_us = 0;
+
+	return mem_parallel_run(par, mem_parallel_zero_part);
+}
+
+static int mem_parallel_fill_part(void *priv)
+{
+	struct mem_parallel_part *part = priv;
+	ulong start = timer_get_us();
+	vu_long *addr = part->buf + part->offset;
+	vu_long *end = addr + part->len / sizeof(ulong);
+	ulong val = part->pattern + part->offset / sizeof(ulong) * part->incr;
+
+	while (addr < end) {
+		*addr++ = val;
+		val += part->incr;
+	}
+	part->write_us += timer_get_us() - start;
+
+	return 0;
+}
+
+int mem_parallel_fill(struct mem_parallel *par, ulong pattern, long incr)
+{
+	int i;
+
+	/* Each share carries on the sequence from the one before */
+	for (i = 0; i < par->count; i++) {
+		struct mem_parallel_part *part = &par->parts[i];
+		ulong words = (part->addr - par->parts[0].addr) / sizeof(ulong);
+
+		part->pattern = pattern + words * incr;
+		part->incr = incr;
+		part->write_us = 0;
+	}
+
+	return mem_parallel_run(par, mem_parallel_fill_part);
+}
+
+static int mem_parallel_check_part(void *priv)
+{
+	struct mem_parallel_part *part = priv;
+	ulong start = timer_get_us();
+	vu_long *buf = part->buf + part->offset;
+	ulong words = part->len / sizeof(ulong);
+	ulong val = part->pattern + part->offset / sizeof(ulong) * part->incr;
+	ulong readback, i;
+
+	for (i = 0; i < words; i++) {
+		readback = buf[i];
+		if (readback != val) {
+			if (!part->errs) {
+				part->err_addr = part->addr + part->offset +
+					i * sizeof(ulong);
+				part->err_expect = val;
+				part->err_actual = readback;
+			}
+			part->errs++;
+		}
+		val += part->incr;
+	}
+	part->read_us += timer_get_us() - start;
+
+	return 0;
+}
+
+ulong mem_parallel_check(struct mem_parallel *par)
+{
+	ulong errs = 0;
+	int i;
+
+	for (i = 0; i < par->count; i++) {
+		par->parts[i].errs = 0;
+		par->parts[i].read_us = 0;
+	}
+	if (mem_parallel_run(par, mem_parallel_check_part))
+		return -1UL;
+	for (i = 0; i < par->count; i++)
+		errs += par->parts[i].errs;
+
+	return errs;
+}
+
+/* Bytes per microsecond is MB/s */
+static ulong mem_parallel_mbps(ulong bytes, ulong us)
+{
+	return us ? (ulong)div_u64(bytes, us) : 0;
+}
+
+void mem_parallel_show(struct mem_parallel *par)
+{
+	ulong total = 0, write_us = 0, read_us = 0;
+	int i;
+
+	for (i = 0; i < par->count; i++) {
+		struct mem_parallel_part *part = &par->parts[i];
+
+		printf("CPU %d: %08lx, ", i, part->addr);
+		print_size(part->size, "");
+		if (part->write_us)
+			printf(", write %lu MB/s",
+			       mem_parallel_mbps(part->size, part->write_us));
+		if (part->read_us)
+			printf(", read %lu MB/s",
+			       mem_parallel_mbps(part->size, part->read_us));
+		printf("\n");
+		total += part->size;
+		write_us = max(write_us, part->write_us);
+		read_us = max(read_us, part->read_us);
+	}
+	if (par->count < 2)
+		return;
+	printf("Total: ");
+	print_size(total, "");
+	if (write_us)
+		printf(", write %lu MB/s", mem_parallel_mbps(total, write_us));
+	if (read_us)
+		printf(", read %lu MB/s", mem_parallel_mbps(total, read_us));
+	printf("\n");
+}
@@ -9,6 +9,7 @@
  */
 
 #include <common.h>
+#include <fdtdec.h>
 #include <linux/libfdt.h>
 #include <of_live.h>
 #include <malloc.h>
@@ -28,101 +29,29 @@ static void *unflatten_dt_alloc(void **mem, unsigned long size,
 }
 
 /**
- * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
+ * unflatten_dt_props() - Alloc and populate the properties of a device_node
  * @blob: The parent device tree blob
- * @mem: Memory chunk to use for allocating device nodes and properties
- * @poffset: pointer to node in flat tree
- * @dad: Parent struct device_node
- * @nodepp: The device_node tree created by the call
- * @fpsize: Size of the node path up at t05he current depth.
- * @dryrun: If true, do not allocate device nodes but still calculate needed
+ * @mem: Memory chunk to use for allocating properties
+ * @node: Offset of the node in the flat tree
+ * @np: Node to add the properties to
+ * @pathp: Name of the node in the flat tree
+ * @dryrun: If true, do not allocate properties but still calculate needed
  * memory size
  */
-static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
-			       struct device_node *dad,
-			       struct device_node **nodepp,
-			       unsigned long fpsize, bool dryrun)
+static void *unflatten_dt_props(const void *blob, void *mem, int node,
+				struct device_node *np, const char *pathp,
+				bool dryrun)
 {
 	const __be32 *p;
-	struct device_node *np;
 	struct property *pp, **prev_pp = NULL;
-	const char *pathp;
-	int l;
-	unsigned int allocl;
-	static int depth;
-	int old_depth;
 	int offset;
 	int has_name = 0;
-	int new_format = 0;
-
-	pathp = fdt_get_name(blob, *poffset, &l);
-	if (!pathp)
-		return mem;
-
-	allocl = ++l;
-
-	/*
-	 * version 0x10 has a more compact unit name here instead of the full
-	 * path. we accumulate the full path size using "fpsize", we'll rebuild
-	 * it later. We detect this because the first character of the name is
-	 * not '/'.
-	 */
-	if ((*pathp) != '/') {
-		new_format = 1;
-		if (fpsize == 0) {
-			/*
-			 * root node: special case. fpsize accounts for path
-			 * plus terminating zero. root node only has '/', so
-			 * fpsize should be 2, but we want to avoid the first
-			 * level nodes to have two '/' so we use fpsize 1 here
-			 */
-			fpsize = 1;
-			allocl = 2;
-			l = 1;
-			pathp = "";
-		} else {
-			/*
-			 * account for '/' and path size minus terminal 0
-			 * already in 'l'
-			 */
-			fpsize += l;
-			allocl = fpsize;
-		}
-	}
-
-	np = unflatten_dt_alloc(&mem, sizeof(struct device_node) + allocl,
-				__alignof__(struct device_node));
-	if (!dryrun) {
-		char *fn;
-
-		fn = (char *)np + sizeof(*np);
-		np->full_name = fn;
-		if (new_format) {
-			/* rebuild full path for new format */
-			if (dad && dad->parent) {
-				strcpy(fn, dad->full_name);
-#ifdef DEBUG
-				if ((strlen(fn) + l + 1) != allocl) {
-					debug("%s: p: %d, l: %d, a: %d\n",
-					      pathp, (int)strlen(fn), l,
-					      allocl);
-				}
-#endif
-				fn += strlen(fn);
-			}
-			*(fn++) = '/';
-		}
-		memcpy(fn, pathp, l);
 
+	if (!dryrun)
 		prev_pp = &np->properties;
-		if (dad != NULL) {
-			np->parent = dad;
-			np->sibling = dad->child;
-			dad->child = np;
-		}
-	}
+
 	/* process properties */
-	for (offset = fdt_first_property_offset(blob, *poffset);
+	for (offset = fdt_first_property_offset(blob, node);
 	     (offset >= 0);
 	     (offset = fdt_next_property_offset(blob, offset))) {
 		const char *pname;
@@ -207,12 +136,230 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		if (!np->name)
 			np->name = "<NULL>";
 		if (!np->type)
-			np->type = "<NULL>";	}
+			np->type = "<NULL>";
+	}
+
+
+	return mem;
+}
+
+/* Number of properties and nodes left in the flat tree, for reporting */
+static int of_live_lazy_props;
+static int of_live_skipped_nodes;
+
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/* Blob the live tree was built from, for unflattening properties later */
+static const void *of_live_blob;
+
+/**
+ * unflatten_dt_lazy() - Set up a device_node without its properties
+ *
+ * Only the name, type and phandle of the node are filled in. The properties
+ * are unflattened by of_node_props() when they are first needed.
+ *
+ * @blob: The parent device tree blob
+ * @mem: Memory chunk to use for allocating the name, if needed
+ * @node: Offset of the node in the flat tree
+ * @np: Node to set up
+ * @pathp: Name of the node in the flat tree
+ * @dryrun: If true, do not set up the node but still calculate needed
+ * memory size
+ */
+static void *unflatten_dt_lazy(const void *blob, void *mem, int node,
+			       struct device_node *np, const char *pathp,
+			       bool dryrun)
+{
+	const char *name;
+	const fdt32_t *prop;
+
+	if (dryrun) {
+		int offset;
+
+		fdt_for_each_property_offset(offset, blob, node)
+			of_live_lazy_props++;
+	}
+
+	/* Same as the "name" property that unflatten_dt_props() adds */
+	name = fdt_getprop(blob, node, "name", NULL);
+	if (!name) {
+		const char *p1 = pathp, *ps = pathp, *pa = NULL;
+		char *buf;
+		int sz;
+
+		while (*p1) {
+			if ((*p1) == '@')
+				pa = p1;
+			if ((*p1) == '/')
+				ps = p1 + 1;
+			p1++;
+		}
+		if (pa < ps)
+			pa = p1;
+		sz = (pa - ps) + 1;
+		buf = unflatten_dt_alloc(&mem, sz, 1);
+		if (!dryrun) {
+			memcpy(buf, ps, sz - 1);
+			buf[sz - 1] = 0;
+		}
+		name = buf;
+	}
+	if (dryrun)
+		return mem;
+
+	np->name = name;
+	np->type = fdt_getprop(blob, node, "device_type", NULL);
+	if (!np->type)
+		np->type = "<NULL>";
+	np->phandle = fdt_get_phandle(blob, node);
+	prop = fdt_getprop(blob, node, "ibm,phandle", NULL);
+	if (prop)
+		np->phandle = fdt32_to_cpu(*prop);
+	np->props_offset = node;
+
+	return mem;
+}
+
+struct property *of_node_props(const struct device_node *cnp)
+{
+	struct device_node *np = (struct device_node *)cnp;
+	const void *blob = of_live_blob;
+	const char *pathp;
+	unsigned long size;
+	void *mem;
+	int node;
+
+	if (np->props_offset < 0)
+		return np->properties;
+
+	pathp = fdt_get_name(blob, np->props_offset, NULL);
+	if (!pathp)
+		return NULL;
+	size = (unsigned long)unflatten_dt_props(blob, NULL, np->props_offset,
+						 np, pathp, true);
+	mem = malloc(size);
+	if (!mem) {
+		log_err("Out of memory for properties of %s\n", np->full_name);
+		return NULL;
+	}
+	node = np->props_offset;
+	np->props_offset = -1;
+	unflatten_dt_props(blob, mem, node, np, pathp, false);
+
+	return np->properties;
+}
+#endif
+
+/**
+ * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
+ * @blob: The parent device tree blob
+ * @mem: Memory chunk to use for allocating device nodes and properties
+ * @poffset: pointer to node in flat tree
+ * @dad: Parent struct device_node
+ * @nodepp: The device_node tree created by the call
+ * @fpsize: Size of the node path up at t05he current depth.
+ * @dryrun: If true, do not allocate device nodes but still calculate needed
+ * memory size
+ */
+static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
+			       struct device_node *dad,
+			       struct device_node **nodepp,
+			       unsigned long fpsize, bool dryrun)
+{
+	struct device_node *np;
+	const char *pathp;
+	int l;
+	unsigned int allocl;
+	static int depth;
+	int old_depth;
+	int new_format = 0;
+	bool skip;
+
+	pathp = fdt_get_name(blob, *poffset, &l);
+	if (!pathp)
+		return mem;
+
+	allocl = ++l;
+
+	/*
+	 * version 0x10 has a more compact unit name here instead of the full
+	 * path. we accumulate the full path size using "fpsize", we'll rebuild
+	 * it later. We detect this because the first character of the name is
+	 * not '/'.
+	 */
+	if ((*pathp) != '/') {
+		new_format = 1;
+		if (fpsize == 0) {
+			/*
+			 * root node: special case. fpsize accounts for path
+			 * plus terminating zero. root node only has '/', so
+			 * fpsize should be 2, but we want to avoid the first
+			 * level nodes to have two '/' so we use fpsize 1 here
+			 */
+			fpsize = 1;
+			allocl = 2;
+			l = 1;
+			pathp = "";
+		} else {
+			/*
+			 * account for '/' and path size minus terminal 0
+			 * already in 'l'
+			 */
+			fpsize += l;
+			allocl = fpsize;
+		}
+	}
+
+	np = unflatten_dt_alloc(&mem, sizeof(struct device_node) + allocl,
+				__alignof__(struct device_node));
+	if (!dryrun) {
+		char *fn;
+
+		fn = (char *)np + sizeof(*np);
+		np->full_name = fn;
+		if (new_format) {
+			/* rebuild full path for new format */
+			if (dad && dad->parent) {
+				strcpy(fn, dad->full_name);
+#ifdef DEBUG
+				if ((strlen(fn) + l + 1) != allocl) {
+					debug("%s: p: %d, l: %d, a: %d\n",
+					      pathp, (int)strlen(fn), l,
+					      allocl);
+				}
+#endif
+				fn += strlen(fn);
+			}
+			*(fn++) = '/';
+		}
+		memcpy(fn, pathp, l);
+
+		if (dad != NULL) {
+			np->parent = dad;
+			np->sibling = dad->child;
+			dad->child = np;
+		}
+	}
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	mem = unflatten_dt_lazy(blob, mem, *poffset, np, pathp, dryrun);
+#else
+	mem = unflatten_dt_props(blob, mem, *poffset, np, pathp, dryrun);
+#endif
 
 	old_depth = depth;
+	skip = CONFIG_IS_ENABLED(OF_LIVE_SKIP_DISABLED) && dad &&
+		!fdtdec_get_is_enabled(blob, *poffset);
 	*poffset = fdt_next_node(blob, *poffset, &depth);
 	if (depth < 0)
 		depth = 0;
+
+	/* Nothing below a disabled node is ever bound, so leave it out */
+	while (skip && *poffset > 0 && depth > old_depth) {
+		if (dryrun)
+			of_live_skipped_nodes++;
+		*poffset = fdt_next_node(blob, *poffset, &depth);
+		if (depth < 0)
+			depth = 0;
+	}
 	while (*poffset > 0 && depth > old_depth) {
 		mem = unflatten_dt_node(blob, mem, poffset, np, NULL,
 					fpsize, dryrun);
@@ -309,6 +456,10 @@ static int unflatten_device_tree(const void *blob,
 		return -ENOSPC;
 	}
 
+	log_debug("Live tree: %lu bytes, %d properties (%lu bytes) left flat, %d nodes skipped\n",
+		  size, of_live_lazy_props,
+		  (unsigned long)of_live_lazy_props * sizeof(struct property),
+		  of_live_skipped_nodes);
 	debug(" <- unflatten_device_tree()\n");
 
 	return 0;
@@ -319,6 +470,9 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 	int ret;
 
 	debug("%s: start\n", __func__);
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	of_live_blob = fdt_blob;
+#endif
 	ret = unflatten_device_tree(fdt_blob, rootp);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
@@ -16,6 +16,7 @@
  */
 
 #include <config.h>
+#include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
@@ -481,37 +482,48 @@ char *strswab(const char *s)
 }
 #endif
 
-#ifndef __HAVE_ARCH_MEMSET
+/*
+ * With benchmarks enabled, the generic memset(), memcpy() and memmove() are
+ * built as xxx_generic() even when the architecture has its own, so that
+ * 'ut bench' can compare the two. Otherwise they are only built when needed
+ * and the standard names are aliases for them.
+ */
+#if !defined(__HAVE_ARCH_MEMSET) || CONFIG_IS_ENABLED(UT_BENCH)
 /**
- * memset - Fill a region of memory with the given value
+ * memset_generic - Fill a region of memory with the given value
  * @s: Pointer to the start of the area.
  * @c: The byte to fill the area with
  * @count: The size of the area.
  *
  * Do not use memset() to access IO space, use memset_io() instead.
  */
-void * memset(void * s,int c,size_t count)
+void *memset_generic(void *s, int c, size_t count)
 {
-	unsigned long *sl = (unsigned long *) s;
-	char *s8;
+	char *s8 = s;
 
 #if !CONFIG_IS_ENABLED(TINY_MEMSET)
+	unsigned long *sl;
 	unsigned long cl = 0;
 	int i;
 
-	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
+	/* do it one word at a time (32 bits or 64 bits) once aligned */
+	if (count >= 2 * sizeof(*sl)) {
+		while ((ulong)s8 & (sizeof(*sl) - 1)) {
+			*s8++ = c;
+			count--;
+		}
 		for (i = 0; i < sizeof(*sl); i++) {
 			cl <<= 8;
 			cl |= c & 0xff;
 		}
+		sl = (unsigned long *)s8;
 		while (count >= sizeof(*sl)) {
 			*sl++ = cl;
 			count -= sizeof(*sl);
 		}
+		s8 = (char *)sl;
 	}
 #endif	/* fill 8 bits at a time */
-	s8 = (char *)sl;
 	while (count--)
 		*s8++ = c;
 
@@ -519,34 +531,91 @@ void * memset(void * s,int c,size_t count)
 }
 #endif
 
-#ifndef __HAVE_ARCH_MEMCPY
+#ifndef __HAVE_ARCH_MEMSET
+void *memset(void *s, int c, size_t count) __alias(memset_generic);
+#endif
+
+#if !defined(__HAVE_ARCH_MEMCPY) || !defined(__HAVE_ARCH_MEMMOVE) || \
+	CONFIG_IS_ENABLED(UT_BENCH)
+/*
+ * Combine the words holding the two parts of an unaligned word, @shift
+ * bits into the first one in memory order
+ */
+static inline unsigned long merge_words(unsigned long first,
+					unsigned long second, int shift)
+{
+	const int bits = 8 * sizeof(first);
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return first << shift | second >> (bits - shift);
+#else
+	return first >> shift | second << (bits - shift);
+#endif
+}
+#endif
+
+#if !defined(__HAVE_ARCH_MEMCPY) || !defined(__HAVE_ARCH_MEMMOVE) || \
+	CONFIG_IS_ENABLED(UT_BENCH)
 /**
- * memcpy - Copy one area of memory to another
+ * memcpy_generic - Copy one area of memory to another
  * @dest: Where to copy to
  * @src: Where to copy from
  * @count: The size of the area.
  *
  * You should not use this function to access IO space, use memcpy_toio()
  * or memcpy_fromio() instead.
+ *
+ * This only ever copies forwards, reading each source byte before writing
+ * the destination byte it is copied to, which memmove_generic() relies on.
  */
-void * memcpy(void *dest, const void *src, size_t count)
+void *memcpy_generic(void *dest, const void *src, size_t count)
 {
-	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
-	char *d8, *s8;
+	unsigned long *dl;
+	const unsigned long *sl;
+	unsigned long prev, next;
+	char *d8 = dest;
+	const char *s8 = src;
+	int shift;
 
 	if (src == dest)
 		return dest;
 
-	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
-		while (count >= sizeof(*dl)) {
-			*dl++ = *sl++;
-			count -= sizeof(*dl);
+	if (count >= 2 * sizeof(*dl)) {
+		/* copy bytes until the destination is aligned */
+		while ((ulong)d8 & (sizeof(*dl) - 1)) {
+			*d8++ = *s8++;
+			count--;
 		}
+		dl = (unsigned long *)d8;
+		shift = 8 * ((ulong)s8 & (sizeof(*dl) - 1));
+		if (!shift) {
+			/* then copy a word at a time (common case) */
+			sl = (const unsigned long *)s8;
+			while (count >= sizeof(*dl)) {
+				*dl++ = *sl++;
+				count -= sizeof(*dl);
+			}
+			s8 = (const char *)sl;
+		} else {
+			/*
+			 * or read aligned words from the source and shift
+			 * them into place, never reading past the word that
+			 * holds the last byte needed
+			 */
+			sl = (const unsigned long *)((ulong)s8 &
+						     ~(sizeof(*dl) - 1));
+			prev = *sl++;
+			while (count >= sizeof(*dl)) {
+				next = *sl++;
+				*dl++ = merge_words(prev, next, shift);
+				prev = next;
+				count -= sizeof(*dl);
+			}
+			s8 = (const char *)sl - sizeof(*dl) + shift / 8;
+		}
+		d8 = (char *)dl;
 	}
-	/* copy the reset one byte at a time */
-	d8 = (char *)dl;
-	s8 = (char *)sl;
+	/* copy the rest one byte at a time */
 	while (count--)
 		*d8++ = *s8++;
 
@@ -554,32 +623,76 @@ void * memcpy(void *dest, const void *src, size_t count)
 }
 #endif
 
-#ifndef __HAVE_ARCH_MEMMOVE
+#ifndef __HAVE_ARCH_MEMCPY
+void *memcpy(void *dest, const void *src, size_t count)
+	__alias(memcpy_generic);
+#endif
+
+#if !defined(__HAVE_ARCH_MEMMOVE) || CONFIG_IS_ENABLED(UT_BENCH)
 /**
- * memmove - Copy one area of memory to another
+ * memmove_generic - Copy one area of memory to another
  * @dest: Where to copy to
  * @src: Where to copy from
  * @count: The size of the area.
  *
  * Unlike memcpy(), memmove() copes with overlapping areas.
  */
-void * memmove(void * dest,const void *src,size_t count)
+void *memmove_generic(void *dest, const void *src, size_t count)
 {
-	char *tmp, *s;
-
-	if (dest <= src) {
-		memcpy(dest, src, count);
-	} else {
-		tmp = (char *) dest + count;
-		s = (char *) src + count;
-		while (count--)
+	unsigned long *dl;
+	const unsigned long *sl;
+	unsigned long prev, next;
+	char *tmp;
+	const char *s;
+	int shift;
+
+	/* memcpy() copies forwards, so is safe unless dest is inside src */
+	if ((ulong)dest - (ulong)src >= count)
+		return memcpy_generic(dest, src, count);
+
+	tmp = (char *)dest + count;
+	s = (const char *)src + count;
+	if (count >= 2 * sizeof(*dl)) {
+		/* copy bytes backwards until the end is aligned */
+		while ((ulong)tmp & (sizeof(*dl) - 1)) {
 			*--tmp = *--s;
+			count--;
 		}
+		dl = (unsigned long *)tmp;
+		shift = 8 * ((ulong)s & (sizeof(*dl) - 1));
+		if (!shift) {
+			sl = (const unsigned long *)s;
+			while (count >= sizeof(*dl)) {
+				*--dl = *--sl;
+				count -= sizeof(*dl);
+			}
+			s = (const char *)sl;
+		} else {
+			sl = (const unsigned long *)((ulong)s &
+						     ~(sizeof(*dl) - 1));
+			next = *sl;
+			while (count >= sizeof(*dl)) {
+				prev = *--sl;
+				*--dl = merge_words(prev, next, shift);
+				next = prev;
+				count -= sizeof(*dl);
+			}
+			s = (const char *)sl + shift / 8;
+		}
+		tmp = (char *)dl;
+	}
+	while (count--)
+		*--tmp = *--s;
 
 	return dest;
 }
 #endif
 
+#ifndef __HAVE_ARCH_MEMMOVE
+void *memmove(void *dest, const void *src, size_t count)
+	__alias(memmove_generic);
+#endif
+
 #ifndef __HAVE_ARCH_MEMCMP
 /**
  * memcmp - Compare two areas of memory
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running independent jobs on several CPUs
+ */
+
+#include <common.h>
+#include <worker.h>
+
+/**
+ * struct worker_batch - The jobs given to one CPU
+ *
+ * @func: Function to run for each job
+ * @privs: Private data for all the jobs
+ * @priv_size: Size of each job's private data
+ * @first: First job for this CPU
+ * @stride: Number of jobs between each job for this CPU
+ * @count: Total number of jobs
+ * @started: true if the jobs are running on a secondary CPU
+ * @ret: Error from the first job which failed, or 0
+ * @failed: Index of the job which failed
+ */
+struct worker_batch {
+	worker_func_t func;
+	void *privs;
+	size_t priv_size;
+	int first;
+	int stride;
+	int count;
+	bool started;
+	int ret;
+	int failed;
+};
+
+__weak int arch_worker_count(void)
+{
+	return 0;
+}
+
+__weak int arch_worker_start(int id, void (*func)(void *arg), void *arg)
+{
+	return -ENOTSUPP;
+}
+
+__weak int arch_worker_wait(int id)
+{
+	return 0;
+}
+
+int worker_count(void)
+{
+	return min(arch_worker_count() + 1, CONFIG_WORKER_MAX);
+}
+
+static void worker_run_batch(void *arg)
+{
+	struct worker_batch *batch = arg;
+	int ret, i;
+
+	for (i = batch->first; i < batch->count; i += batch->stride) {
+		ret = batch->func(batch->privs + i * batch->priv_size);
+		if (ret && !batch->ret) {
+			batch->ret = ret;
+			batch->failed = i;
+		}
+	}
+}
+
+int worker_run(worker_func_t func, void *privs, size_t priv_size, int count)
+{
+	struct worker_batch batches[CONFIG_WORKER_MAX];
+	int failed = count;
+	int ret = 0;
+	int num, i;
+
+	num = min(worker_count(), count);
+	for (i = 0; i < num; i++) {
+		struct worker_batch *batch = &batches[i];
+
+		batch->func = func;
+		batch->privs = privs;
+		batch->priv_size = priv_size;
+		batch->first = i;
+		batch->stride = num;
+		batch->count = count;
+		batch->started = false;
+		batch->ret = 0;
+	}
+
+	/* Keep the first batch for this CPU */
+	for (i = 1; i < num; i++) {
+		if (!arch_worker_start(i - 1, worker_run_batch, &batches[i]))
+			batches[i].started = true;
+	}
+	for (i = 0; i < num; i++) {
+		if (!batches[i].started)
+			worker_run_batch(&batches[i]);
+	}
+	for (i = 0; i < num; i++) {
+		struct worker_batch *batch = &batches[i];
+
+		if (batch->started)
+			arch_worker_wait(i - 1);
+		if (batch->ret && batch->failed < failed) {
+			ret = batch->ret;
+			failed = batch->failed;
+		}
+	}
+
+	return ret;
+}
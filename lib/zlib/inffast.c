@@ -31,6 +31,77 @@
 #  define PUP(a) *++(a)
 #endif
 
+/*
+   U-Boot: with CONFIG_ZLIB_WORD_ACCESS the bit buffer is refilled a word at
+   a time instead of a byte at a time. On a 64-bit machine a single refill at
+   the top of the loop then provides enough bits for a whole length/distance
+   pair. Matches copied from the output are also copied a word at a time,
+   which may write up to a word past the end of the match.
+ */
+#if CONFIG_IS_ENABLED(ZLIB_WORD_ACCESS)
+#  define HOLD_BITS (8 * sizeof(unsigned long))
+#  define WORD_SIZE sizeof(unsigned long)
+
+local inline unsigned long load_word(const unsigned char FAR *p)
+{
+    return *(const unsigned long *)p;
+}
+
+local inline void store_word(unsigned char FAR *p, unsigned long val)
+{
+    *(unsigned long *)p = val;
+}
+
+local inline unsigned long load_word_le(const unsigned char FAR *p)
+{
+    if (sizeof(unsigned long) == sizeof(u64))
+        return le64_to_cpu(*(const u64 *)p);
+    return le32_to_cpu(*(const u32 *)p);
+}
+
+/* Bits above 'bits' in hold are already the next input bits, so or-ing the
+   same bits in again does no harm. This leaves at least HOLD_BITS - 8 bits */
+#  define REFILL() \
+    do { \
+        hold |= load_word_le(in + OFF) << bits; \
+        in += (HOLD_BITS - 1 - bits) >> 3; \
+        bits |= HOLD_BITS - 8; \
+    } while (0)
+#  define PULL_TOP() REFILL()
+#  define PULL_15() \
+    do { \
+        if (bits < 15) \
+            REFILL(); \
+    } while (0)
+#  define PULL_OP(n) \
+    do { \
+        if (bits < (n)) \
+            REFILL(); \
+    } while (0)
+#else
+#  define PULL_15() \
+    do { \
+        if (bits < 15) { \
+            hold += (unsigned long)(PUP(in)) << bits; \
+            bits += 8; \
+            hold += (unsigned long)(PUP(in)) << bits; \
+            bits += 8; \
+        } \
+    } while (0)
+#  define PULL_TOP() PULL_15()
+#  define PULL_OP(n) \
+    do { \
+        if (bits < (n)) { \
+            hold += (unsigned long)(PUP(in)) << bits; \
+            bits += 8; \
+            if (bits < (n)) { \
+                hold += (unsigned long)(PUP(in)) << bits; \
+                bits += 8; \
+            } \
+        } \
+    } while (0)
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -42,8 +113,8 @@
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
-        strm->avail_out >= 258
+        strm->avail_in >= INFLATE_FAST_MIN_INPUT
+        strm->avail_out >= INFLATE_FAST_MIN_OUTPUT
         start >= strm->avail_out
         state->bits < 8
 
@@ -98,18 +169,18 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
-    if (in > last && strm->avail_in > 5) {
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_INPUT - 1));
+    if (in > last && strm->avail_in > INFLATE_FAST_MIN_INPUT - 1) {
         /*
          * overflow detected, limit strm->avail_in to the
          * max. possible size and recalculate last
          */
 	strm->avail_in = 0xffffffff - (uintptr_t)in;
-        last = in + (strm->avail_in - 5);
+        last = in + (strm->avail_in - (INFLATE_FAST_MIN_INPUT - 1));
     }
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
-    end = out + (strm->avail_out - 257);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -127,12 +198,7 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
-        if (bits < 15) {
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-        }
+        PULL_TOP();
         this = lcode[hold & lmask];
       dolen:
         op = (unsigned)(this.bits);
@@ -149,21 +215,13 @@ void inflate_fast(z_streamp strm, unsigned start)
             len = (unsigned)(this.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                }
+                PULL_OP(op);
                 len += (unsigned)hold & ((1U << op) - 1);
                 hold >>= op;
                 bits -= op;
             }
             Tracevv((stderr, "inflate:         length %u\n", len));
-            if (bits < 15) {
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
-            }
+            PULL_15();
             this = dcode[hold & dmask];
           dodist:
             op = (unsigned)(this.bits);
@@ -173,14 +231,7 @@ void inflate_fast(z_streamp strm, unsigned start)
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(this.val);
                 op &= 15;                       /* number of extra bits */
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                    if (bits < op) {
-                        hold += (unsigned long)(PUP(in)) << bits;
-                        bits += 8;
-                    }
-                }
+                PULL_OP(op);
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
                 if (dist > dmax) {
@@ -253,6 +304,30 @@ void inflate_fast(z_streamp strm, unsigned start)
                     }
                 }
                 else {
+#if CONFIG_IS_ENABLED(ZLIB_WORD_ACCESS)
+                    unsigned char FAR *dst = out + OFF;
+                    unsigned char FAR *dend = dst + len;
+                    unsigned wide = dist;
+
+                    /* A match closer than a word overlaps itself, so copy
+                       bytes until the output repeats every 'wide' bytes,
+                       with wide >= WORD_SIZE. Then copy words. */
+                    if (dist < WORD_SIZE) {
+                        while (wide < WORD_SIZE)
+                            wide += dist;
+                        from = dst - dist;
+                        op = min(wide - dist, len);
+                        while (op--)
+                            *dst++ = *from++;
+                    }
+                    from = dst - wide;
+                    while (dst < dend) {
+                        store_word(dst, load_word(from));
+                        dst += WORD_SIZE;
+                        from += WORD_SIZE;
+                    }
+                    out = dend - OFF;
+#else
 		    unsigned short *sout;
 		    unsigned long loops;
 
@@ -294,6 +369,7 @@ void inflate_fast(z_streamp strm, unsigned start)
 		    }
 		    if (len & 1)
 			PUP(out) = PUP(from);
+#endif
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -331,9 +407,12 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_INPUT - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_INPUT - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
-                                 257 + (end - out) : 257 - (out - end));
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) + (end - out) :
+                                 (INFLATE_FAST_MIN_OUTPUT - 1) - (out - end));
     state->hold = hold;
     state->bits = bits;
     return;
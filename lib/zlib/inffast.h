@@ -9,3 +9,17 @@
  */
 
 void inflate_fast OF((z_streamp strm, unsigned start));
+
+/*
+ * inflate() only calls inflate_fast() when at least this much input and
+ * output space is available. Refilling the bit buffer a word at a time may
+ * read a word ahead, and copying a match a word at a time may write up to a
+ * word past its end.
+ */
+#if CONFIG_IS_ENABLED(ZLIB_WORD_ACCESS)
+#define INFLATE_FAST_MIN_INPUT	(6 + sizeof(unsigned long))
+#define INFLATE_FAST_MIN_OUTPUT	(258 + sizeof(unsigned long))
+#else
+#define INFLATE_FAST_MIN_INPUT	6
+#define INFLATE_FAST_MIN_OUTPUT	258
+#endif
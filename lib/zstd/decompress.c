@@ -404,7 +404,8 @@ static size_t ZSTD_copyRawBlock(void *dst, size_t dstCapacity, const void *src,
 {
 	if (srcSize > dstCapacity)
 		return ERROR(dstSize_tooSmall);
-	memcpy(dst, src, srcSize);
+	/* dst may overlap src when decompressing in place */
+	memmove(dst, src, srcSize);
 	return srcSize;
 }
 
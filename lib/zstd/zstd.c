@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompress a whole buffer of zstd frames
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <zstd.h>
+#include <linux/errno.h>
+#include <linux/zstd.h>
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	size_t wsize;
+	size_t ret;
+
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate %zu bytes\n", __func__, wsize);
+		return -ENOMEM;
+	}
+
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		free(workspace);
+		return -EINVAL;
+	}
+
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	free(workspace);
+	if (ZSTD_isError(ret)) {
+		debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+		if (ZSTD_getErrorCode(ret) == ZSTD_error_dstSize_tooSmall)
+			return -ENOSPC;
+		return -EINVAL;
+	}
+	*dstn = ret;
+
+	return 0;
+}
+
+int zstd_inplace_size(const void *src, size_t srcn, size_t *sizep)
+{
+	size_t size = 0, margin = 0;
+
+	while (srcn) {
+		ZSTD_frameParams params;
+		unsigned long long content;
+		size_t frame_size, block_size, blocks;
+
+		if (ZSTD_getFrameParams(&params, src, srcn))
+			return -EINVAL;
+		frame_size = ZSTD_findFrameCompressedSize(src, srcn);
+		if (ZSTD_isError(frame_size))
+			return -EINVAL;
+
+		if (!params.windowSize) {
+			/* A skippable frame is read without writing anything */
+			margin += frame_size;
+		} else {
+			content = ZSTD_getFrameContentSize(src, srcn);
+			if (content >= ZSTD_CONTENTSIZE_ERROR)
+				return -ENODATA;
+
+			/*
+			 * A block is decoded completely before it is written,
+			 * so the output must stay a block behind the input,
+			 * plus the headers and checksum, which produce no
+			 * output. The input cannot gain more than that unless
+			 * the frame is larger than its content.
+			 */
+			block_size = min_t(size_t, params.windowSize,
+					   ZSTD_BLOCKSIZE_ABSOLUTEMAX);
+			blocks = DIV_ROUND_UP(content, block_size);
+			size += content;
+			margin += ZSTD_FRAMEHEADERSIZE_MAX + sizeof(u32) +
+				3 * blocks + block_size;
+			if (frame_size > content)
+				margin += frame_size - content;
+		}
+		src += frame_size;
+		srcn -= frame_size;
+	}
+	*sizep = size + margin;
+
+	return 0;
+}
+
+int zstd_stream_len(const void *src, size_t srcn, size_t *lenp)
+{
+	ZSTD_frameParams params;
+	size_t len = 0, frame_size;
+
+	/* Skippable frames have no window and may come before the data */
+	do {
+		if (ZSTD_getFrameParams(&params, src + len, srcn - len))
+			return -EINVAL;
+		frame_size = ZSTD_findFrameCompressedSize(src + len,
+							  srcn - len);
+		if (ZSTD_isError(frame_size))
+			return -EINVAL;
+		len += frame_size;
+	} while (!params.windowSize);
+	*lenp = len;
+
+	return 0;
+}
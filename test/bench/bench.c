@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Timing of micro-benchmarks
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/bench.h>
+#include <linux/math64.h>
+
+/* A warm run must last at least this long to be timed accurately */
+#define BENCH_MIN_US		10000
+
+/* Stride used to touch every cache line of the eviction buffer */
+#define BENCH_LINE_SIZE		32
+
+/**
+ * struct bench_result - Timing of a set of runs
+ *
+ * @best_ns: Shortest time for one call in nanoseconds
+ * @avg_ns: Average time for one call in nanoseconds
+ * @best_cycles: Fewest CPU cycles for one call, or 0 if not known
+ */
+struct bench_result {
+	u64 best_ns;
+	u64 avg_ns;
+	u64 best_cycles;
+};
+
+static struct bench_opts bench_opts = {
+	.runs = 3,
+	.cold = true,
+};
+
+__weak u64 bench_get_cycles(void)
+{
+	return 0;
+}
+
+void bench_set_opts(const struct bench_opts *opts)
+{
+	bench_opts = *opts;
+}
+
+/* Write to every cache line of @buf, pushing other data out of the caches */
+static void bench_evict(char *buf, ulong size)
+{
+	ulong i;
+
+	for (i = 0; i < size; i += BENCH_LINE_SIZE)
+		buf[i]++;
+}
+
+/* Call @func @loops times, returning the time taken and cycles used */
+static int bench_loop(bench_func_t func, void *priv, ulong loops,
+		      ulong *usp, u64 *cyclesp)
+{
+	ulong start, i;
+	u64 cycles;
+	int ret;
+
+	cycles = bench_get_cycles();
+	start = timer_get_us();
+	for (i = 0; i < loops; i++) {
+		ret = func(priv);
+		if (ret)
+			return ret;
+	}
+	*usp = timer_get_us() - start;
+	*cyclesp = bench_get_cycles() - cycles;
+
+	return 0;
+}
+
+static int bench_measure(bench_func_t func, void *priv, ulong loops,
+			 char *evict, struct bench_result *res)
+{
+	u64 total_ns = 0, ns, cycles;
+	ulong us;
+	int ret, i;
+
+	res->best_ns = U64_MAX;
+	res->best_cycles = U64_MAX;
+	for (i = 0; i < bench_opts.runs; i++) {
+		if (evict)
+			bench_evict(evict, CONFIG_UT_BENCH_EVICT_SIZE);
+		ret = bench_loop(func, priv, loops, &us, &cycles);
+		if (ret)
+			return ret;
+		ns = div_u64((u64)us * 1000, loops);
+		cycles = div_u64(cycles, loops);
+		total_ns += ns;
+		res->best_ns = min(res->best_ns, ns);
+		res->best_cycles = min(res->best_cycles, cycles);
+	}
+	res->avg_ns = div_u64(total_ns, bench_opts.runs);
+
+	return 0;
+}
+
+static void bench_show(const char *name, const char *cache, ulong bytes,
+		       ulong loops, struct bench_result *res)
+{
+	ulong mbps = 0, cpb = 0;
+
+	/* Bytes per microsecond is MB/s; cold runs may be too short to time */
+	if (res->best_ns)
+		mbps = div_u64((u64)bytes * 1000, res->best_ns);
+	if (res->best_cycles && bytes)
+		cpb = div_u64(res->best_cycles * 100, bytes);
+
+	if (bench_opts.csv) {
+		printf("bench,%s,%s,%lu,%d,%lu,%llu,%llu,%lu,", name, cache,
+		       bytes, bench_opts.runs, loops, res->best_ns,
+		       res->avg_ns, mbps);
+		if (cpb)
+			printf("%lu.%02lu", cpb / 100, cpb % 100);
+		printf("\n");
+		return;
+	}
+
+	if (!bytes) {
+		printf("%-24s %s: best %9llu ns, avg %9llu ns\n", name, cache,
+		       res->best_ns, res->avg_ns);
+		return;
+	}
+	printf("%-24s %s %8lu bytes: best %9llu ns, avg %9llu ns, %5lu MB/s",
+	       name, cache, bytes, res->best_ns, res->avg_ns, mbps);
+	if (cpb)
+		printf(", %lu.%02lu cycles/byte", cpb / 100, cpb % 100);
+	printf("\n");
+}
+
+int bench_run(const char *name, bench_func_t func, void *priv, ulong bytes)
+{
+	struct bench_result res;
+	ulong loops, us;
+	char *evict;
+	u64 cycles;
+	int ret;
+
+	/* Warm up, calling more often until a run is long enough to time */
+	for (loops = 1;; ) {
+		ret = bench_loop(func, priv, loops, &us, &cycles);
+		if (ret)
+			return ret;
+		if (us >= BENCH_MIN_US)
+			break;
+		loops = us ? loops * BENCH_MIN_US / us + 1 : loops * 10;
+	}
+	ret = bench_measure(func, priv, loops, NULL, &res);
+	if (ret)
+		return ret;
+	bench_show(name, "warm", bytes, loops, &res);
+
+	if (!bench_opts.cold)
+		return 0;
+	evict = malloc(CONFIG_UT_BENCH_EVICT_SIZE);
+	if (!evict) {
+		printf("%s: No memory for cold runs\n", name);
+		return 0;
+	}
+	ret = bench_measure(func, priv, 1, evict, &res);
+	free(evict);
+	if (ret)
+		return ret;
+	bench_show(name, "cold", bytes, 1, &res);
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Micro-benchmarks run by the 'ut bench' command
+ */
+
+#include <common.h>
+#include <command.h>
+#include <test/bench.h>
+#include <test/suites.h>
+#include <test/ut.h>
+
+int do_ut_bench(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, bench_test);
+	const int n_ents = ll_entry_count(struct unit_test, bench_test);
+	struct bench_opts opts = {
+		.runs = 3,
+		.cold = true,
+	};
+
+	/* Options come before the test name, which stays in argv[1] */
+	while (argc > 1 && *argv[1] == '-') {
+		switch (argv[1][1]) {
+		case 'm':
+			opts.csv = true;
+			break;
+		case 'w':
+			opts.cold = false;
+			break;
+		case 'r':
+			if (argc < 3)
+				return CMD_RET_USAGE;
+			opts.runs = simple_strtoul(argv[2], NULL, 10);
+			if (opts.runs < 1)
+				return CMD_RET_USAGE;
+			argc--;
+			argv++;
+			break;
+		default:
+			return CMD_RET_USAGE;
+		}
+		argc--;
+		argv++;
+	}
+	bench_set_opts(&opts);
+	if (opts.csv)
+		printf("bench,name,cache,bytes,runs,loops,best_ns,avg_ns,mb_per_s,cycles_per_byte\n");
+
+	return cmd_ut_category("benchmark", "bench_test_", tests, n_ents,
+			       argc, argv);
+}
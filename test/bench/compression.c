@@ -0,0 +1,455 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmarks for the decompressors
+ *
+ * Each decoder expands the same 256KB of data: a paragraph of text repeated
+ * many times. This is far more compressible than a kernel, so the results
+ * mostly show how fast matches are copied, but they are stable enough to
+ * spot a regression. The gzip and lzo data is created when the test runs,
+ * since U-Boot has a gzip compressor and lzo1x is simple to encode; the rest
+ * was made on the host from a file holding the repeated text.
+ */
+
+#include <common.h>
+#include <gzip.h>
+#include <hexdump.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <zstd.h>
+#include <bzlib.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#include <asm/unaligned.h>
+#include <linux/lzo.h>
+#include <test/bench.h>
+#include <test/ut.h>
+
+static const char bench_text[] =
+	"U-Boot loads a compressed kernel, a device tree and a ramdisk, checks\n"
+	"their hashes and copies them to where they need to be before jumping to\n"
+	"the kernel. Each of these steps is limited by how fast the decoder, the\n"
+	"hash or the memory copy runs on the board, so it is worth measuring\n"
+	"them.\n";
+
+#define BENCH_TEXT_LEN		(sizeof(bench_text) - 1)
+#define BENCH_TEXT_REPEAT	910
+#define BENCH_SIZE		(BENCH_TEXT_LEN * BENCH_TEXT_REPEAT)
+
+/* bzip2 -9 -c text.txt > text.bz2 */
+static const char bench_bzip2[] =
+	"\x42\x5a\x68\x39\x31\x41\x59\x26\x53\x59\xb7\x22\x9f\x59\x00\x73"
+	"\x86\xd7\x80\x00\x10\x40\x07\x12\x00\x02\x00\x3f\xff\xdf\xa0\x60"
+	"\x06\x3e\x00\x00\x00\x00\x00\x00\x31\x80\x00\x00\x00\x31\x80\x00"
+	"\x00\x00\x31\x80\x00\x00\x00\x31\x80\x00\x00\x00\x13\x55\x10\x4c"
+	"\xa6\xa7\x94\xc1\x94\x99\xa3\x50\xc6\x00\x00\x00\x03\x58\x54\x7e"
+	"\x21\x51\xe6\x15\x1f\xb8\x54\x7a\xc2\xa3\x58\x54\x66\x15\x1d\x21"
+	"\x51\xf9\x85\x46\xf0\xa8\xd2\x15\x1b\xc2\xa3\x34\x2a\x34\x85\x46"
+	"\xb0\xa8\xed\x0a\x8c\xc2\xa3\xee\x15\x1a\xc2\xa3\x48\x54\x7d\xc2"
+	"\xa3\xea\x15\x1a\xc2\xa3\x88\x54\x7f\x61\x51\xcc\x2a\x3a\x42\xa3"
+	"\x88\x54\x62\x15\x1a\xc2\xa3\x58\x54\x78\x85\x46\x90\xa8\xde\x15"
+	"\x19\x85\x46\xb0\xa8\xc4\x2a\x39\x85\x46\x90\xa8\xf4\x85\x46\xd0"
+	"\xa8\xc4\x2a\x3e\xa1\x51\xd2\x15\x1e\x90\xa8\xe2\x15\x1e\x61\x51"
+	"\xbc\x2a\x3b\xc2\xa3\xac\x2a\x3e\xa1\x51\xa4\x2a\x3b\x42\xa3\x78"
+	"\x54\x7d\x42\xa3\xea\x15\x1b\xc2\xa3\x98\x54\x7e\xa1\x51\xc4\x2a"
+	"\x36\x85\x47\x88\x54\x78\x85\x47\x88\x54\x62\x49\x25\xfa\x85\x47"
+	"\x58\x54\x71\x0a\x8d\x28\x54\x66\x15\x1f\x34\x2a\x3f\x30\xa8\xef"
+	"\x0a\x8d\x6a\x15\x1f\xc8\x54\x78\x85\x46\x61\x51\xa5\x0a\x8c\x49"
+	"\x24\xbe\x21\x51\x98\x54\x62\x15\x18\xa1\x51\xc4\x2a\x34\x85\x47"
+	"\x10\xa8\xc4\x2a\x3b\x42\xa3\x78\x54\x73\x0a\x8d\xe1\x51\xfb\x85"
+	"\x46\x68\x54\x74\x85\x46\x28\x54\x7b\xc2\xa3\x30\xa8\xfe\x42\xa3"
+	"\xa4\x2a\x35\x85\x47\xbc\x2a\x3c\x42\xa3\x78\x54\x71\x0a\x8e\x90"
+	"\xa8\xfc\x42\xa3\x98\x54\x74\x85\x46\x68\x54\x62\x85\x47\x10\xa8"
+	"\xe9\x0a\x8e\x21\x51\xa4\x2a\x3e\x68\x54\x62\x15\x1d\xe1\x51\x88"
+	"\x54\x71\x0a\x8d\x61\x51\x98\x54\x77\x85\x47\x78\x54\x75\x85\x47"
+	"\xa5\x0a\x8e\x61\x51\xda\x15\x1d\xa1\x51\xed\x0a\x8d\xe1\x51\xac"
+	"\x54\x2a\xd6\x15\x18\x92\x49\x7f\xd0\xa8\xda\x15\x19\xa1\x51\xac"
+	"\x2a\x3e\xe1\x51\xfe\x85\x47\x98\x54\x77\x85\x46\x61\x51\xd6\x15"
+	"\x1b\x50\xa8\xef\x0a\x8c\x42\xa3\xda\x15\x18\x85\x47\x30\xa8\xc5"
+	"\x0a\x8e\xb0\xa8\xda\x85\x46\x68\x54\x62\x85\x47\xc4\x2a\x33\x42"
+	"\xa3\xda\x15\x1a\x42\xa3\xee\x15\x1e\xd4\x2a\x36\xa1\x51\xb4\x2a"
+	"\x3a\xd0\xa8\xde\x85\x46\xd0\xa8\xef\x42\xa3\x98\x54\x62\x15\x1d"
+	"\xa1\x51\xf3\x0a\x8e\xb0\xa8\xe2\x15\x18\x85\x46\x21\x51\xfe\x85"
+	"\x46\x68\x54\x66\x15\x1e\x61\x51\xef\x0a\x8f\xcc\x2a\x3b\xc2\xa3"
+	"\xc4\x2a\x31\x0a\x8c\xd0\xa8\xf5\x85\x46\x61\x51\xde\x15\x18\x85"
+	"\x46\x61\x51\xd2\x15\x1e\xb0\xa8\xd2\x15\x1a\x42\xa3\xb4\x2a\x3d"
+	"\xe1\x51\xeb\x0a\x8d\x28\x54\x6b\x0a\x8d\xe1\x51\x88\x54\x79\x85"
+	"\x47\xc4\x2a\x35\x85\x46\xf0\xa8\xe6\x15\x1e\x61\x51\xa4\x2a\x33"
+	"\x0a\x8c\x42\xa3\xe2\x15\x1d\x68\x54\x69\x0a\x8e\x61\x51\xac\x2a"
+	"\x34\x85\x46\x61\x51\x88\x54\x69\x0a\x8e\x61\x51\xb4\x2a\x33\x0a"
+	"\x8c\x42\xa3\xe6\x15\x1b\x49\x24\xbc\xc2\xa3\x10\xa8\xc4\x2a\x31"
+	"\x0a\x8c\x42\xa3\x14\x92\x4b\xee\x15\x1a\x42\xa3\x58\x54\x71\x0a"
+	"\x8e\x90\xa8\xda\x85\x46\xb0\xa8\xf1\x0a\x8d\x61\x51\xd6\x15\x1f"
+	"\xf8\xbb\x92\x29\xc2\x84\x85\xb9\x14\xfa\xc8";
+
+/* lzma -z -c text.txt > text.lzma */
+static const char bench_lzma[] =
+	"\x5d\x00\x00\x80\x00\xff\xff\xff\xff\xff\xff\xff\xff\x00\x2a\x8b"
+	"\x44\x47\x3c\x99\x21\x4b\x80\xeb\xf9\x87\xdb\x1a\xe0\x44\x0f\x3d"
+	"\x94\x9d\xe9\x4b\x83\xae\xc6\x4d\x20\x40\x71\xfd\x0a\x21\x99\xda"
+	"\x20\x4c\xc6\x65\x23\xff\x0f\x87\x61\xf3\xf0\x83\x8c\xdf\xac\x17"
+	"\xbd\xe6\xee\xd1\xde\x7a\x68\xe6\x2e\x40\x47\x5d\x13\x0e\x2c\x8d"
+	"\x66\xad\x8e\x1e\x71\xd0\x56\x91\xfd\x86\x62\x63\x36\x0e\x61\x29"
+	"\x26\x29\x7d\x04\x70\x15\x35\x08\x1b\xab\x31\x7e\xec\x40\xb9\x9d"
+	"\x08\x3f\x8e\xaf\xa4\x87\xf4\x03\x79\xf7\x96\x7c\x77\xaa\xb3\x2e"
+	"\x15\x3b\xc1\xee\x10\x4d\xb8\xc2\x5e\x0d\x34\x77\x91\xa1\x66\xdd"
+	"\x2b\x72\x42\xe1\x71\x82\xfe\xe6\xe3\x36\x0f\x48\xed\x04\x19\x09"
+	"\xa8\x39\x73\x1f\xc2\x73\x77\x5e\x31\xe1\x39\x90\x58\x73\x02\x7c"
+	"\x8a\x61\x32\xa8\x92\xb3\x5b\xa1\x73\x79\x5e\xd4\xfe\xe8\x95\x6b"
+	"\x68\xc4\xcd\x5e\x57\x9b\xee\x95\x32\x90\x5a\x15\x2d\x14\x20\x39"
+	"\x96\xc4\x69\xdf\x5a\x6f\x2a\x9d\x8f\x12\xcb\x48\x1e\x21\x02\x23"
+	"\xde\xf0\xf0\x21\x7e\x58\x36\x0d\xd5\xff\x94\x6a\x46\x1e\xf2\xb6"
+	"\xb4\x1e\x70\xe1\x33\x69\x57\xad\xcd\x81\x3d\x59\xdd\x19\x42\x8f"
+	"\x57\x8e\xcb\x79\xea\x01\x37\x3e\xe8\x40\x09\xc4\xe5\x0b\x4d\x2f"
+	"\x4b\x93\xff\xc5\x18\x31\xe5\xa3\x7b\x88\x85\xa3\x4c\x92\xc2\x45"
+	"\x17\x1a\x5d\xfe\xd9\xef\x4d\xe3\x75\xfd\x05\x10\x4c\xac\x4d\xbf"
+	"\xb6\xaa\x64\xcd\xb3\x08\xfe\x6b\x6b\x6d\xa4\xaf\x4b\x2c\x15\x01"
+	"\xa5\xe8\xa3\x09\x2a\xec\xaa\xff\x5a\x26\xaa\xa2\xef\x82\xa5\xd6"
+	"\x05\xfa\x0c\x3e\xd6";
+
+/* lz4 -9 -c text.txt > text.lz4 */
+static const char bench_lz4[] =
+	"\x04\x22\x4d\x18\x64\x50\x08\x1d\x05\x00\x00\xf1\x43\x55\x2d\x42"
+	"\x6f\x6f\x74\x20\x6c\x6f\x61\x64\x73\x20\x61\x20\x63\x6f\x6d\x70"
+	"\x72\x65\x73\x73\x65\x64\x20\x6b\x65\x72\x6e\x65\x6c\x2c\x20\x61"
+	"\x20\x64\x65\x76\x69\x63\x65\x20\x74\x72\x65\x65\x20\x61\x6e\x64"
+	"\x20\x61\x20\x72\x61\x6d\x64\x69\x73\x6b\x2c\x20\x63\x68\x65\x63"
+	"\x6b\x73\x0a\x74\x68\x65\x69\x72\x20\x68\x61\x73\x68\x65\x73\x23"
+	"\x00\xf0\x05\x63\x6f\x70\x69\x65\x73\x20\x74\x68\x65\x6d\x20\x74"
+	"\x6f\x20\x77\x68\x65\x72\x65\x0e\x00\x60\x79\x20\x6e\x65\x65\x64"
+	"\x13\x00\xf0\x05\x62\x65\x20\x62\x65\x66\x6f\x72\x65\x20\x6a\x75"
+	"\x6d\x70\x69\x6e\x67\x20\x74\x6f\x48\x00\x03\x78\x00\x90\x2e\x20"
+	"\x45\x61\x63\x68\x20\x6f\x66\x36\x00\xf0\x10\x73\x65\x20\x73\x74"
+	"\x65\x70\x73\x20\x69\x73\x20\x6c\x69\x6d\x69\x74\x65\x64\x20\x62"
+	"\x79\x20\x68\x6f\x77\x20\x66\x61\x73\x74\x23\x00\x90\x20\x64\x65"
+	"\x63\x6f\x64\x65\x72\x2c\x0d\x00\x10\x0a\x8a\x00\x31\x20\x6f\x72"
+	"\x19\x00\x60\x6d\x65\x6d\x6f\x72\x79\x92\x00\x91\x79\x20\x72\x75"
+	"\x6e\x73\x20\x6f\x6e\x18\x00\xc0\x62\x6f\x61\x72\x64\x2c\x20\x73"
+	"\x6f\x20\x69\x74\x59\x00\xf0\x00\x77\x6f\x72\x74\x68\x20\x6d\x65"
+	"\x61\x73\x75\x72\x69\x6e\x67\x8c\x00\x3f\x6d\x2e\x0a\x20\x01\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+	"\xff\x8a\x50\x68\x65\x6d\x2e\x0a\x00\x00\x00\x00\x15\xca\x0c\xb9";
+
+/* zstd -19 -c text.txt > text.zst */
+static const char bench_zstd[] =
+	"\x28\xb5\x2f\xfd\xa4\xc0\xff\x03\x00\x3c\x06\x00\x66\xd0\x2b\x17"
+	"\x90\x3b\x07\x00\x6a\x62\xe1\x65\xfb\xff\xe9\x5b\x8e\x72\x3f\xc5"
+	"\xb3\xbc\x04\xae\x57\xd1\x05\x25\x00\x23\x00\x24\x00\x47\xe5\x60"
+	"\x51\xb6\x5a\x7a\x4e\x5e\x2e\xf9\x7f\xeb\x2b\xf6\x7c\x39\x39\x60"
+	"\xee\xde\x17\xaf\xab\xfe\x35\x2d\x95\x93\x75\xa5\x64\xbc\x99\x84"
+	"\x60\x04\x8e\x35\xcd\x51\xfc\x97\xc8\x0f\xff\x70\xae\xd7\xef\x1c"
+	"\x1d\xd7\x7f\x47\xc8\xb9\x6e\xc7\xb5\x9e\x35\xa9\xf4\xa8\x09\xfd"
+	"\xd8\x71\x01\x5d\x54\xc0\x71\x1d\xbc\xaf\x54\x5f\x5e\x4d\x88\xa1"
+	"\x44\x47\x87\xd7\x97\x35\xc6\x58\x99\xb5\xf9\xaa\xaf\xc7\x35\x92"
+	"\x46\x95\x0a\x0f\xc7\x05\x72\x9d\x04\xc0\xd0\x8e\x0b\x24\x8e\x3d"
+	"\x47\xd3\x9b\x71\x5f\x42\x56\xe6\x65\x4e\x75\xb0\x5e\xca\xc3\xa5"
+	"\xd5\x39\xcf\x51\x93\xca\xd1\xcb\xf6\xf6\xd2\xa8\x09\x03\x06\x00"
+	"\xee\xf6\x1f\x59\xf9\xdd\x29\x21\xcf\xbb\x74\x56\xeb\x8e\x73\x4b"
+	"\xa6\x55\x51\x55\x00\x00\x00\x01\x00\xbd\xff\xe3\xff\xb9\x06\x02"
+	"\x2f\xc7\xd3\x13";
+
+/**
+ * struct bench_decomp - Data for one decompressor
+ *
+ * @in: Compressed data
+ * @in_size: Size of @in in bytes
+ * @out: Buffer for the decompressed data, BENCH_SIZE bytes long
+ * @out_size: Number of bytes decompressed by the last call
+ */
+struct bench_decomp {
+	const void *in;
+	ulong in_size;
+	void *out;
+	ulong out_size;
+};
+
+static void bench_make_text(char *buf)
+{
+	int i;
+
+	for (i = 0; i < BENCH_TEXT_REPEAT; i++)
+		memcpy(buf + i * BENCH_TEXT_LEN, bench_text, BENCH_TEXT_LEN);
+}
+
+/* Time a decompressor and check that its output is correct */
+static int bench_decomp(struct unit_test_state *uts, const char *name,
+			bench_func_t func, const void *in, ulong in_size)
+{
+	struct bench_decomp dec;
+	char *text;
+
+	text = malloc(BENCH_SIZE);
+	ut_assertnonnull(text);
+	bench_make_text(text);
+	dec.in = in;
+	dec.in_size = in_size;
+	dec.out = malloc(BENCH_SIZE);
+	ut_assertnonnull(dec.out);
+	dec.out_size = 0;
+
+	ut_assertok(bench_run(name, func, &dec, BENCH_SIZE));
+	ut_asserteq(BENCH_SIZE, dec.out_size);
+	ut_asserteq_mem(text, dec.out, BENCH_SIZE);
+	free(dec.out);
+	free(text);
+
+	return 0;
+}
+
+#if defined(CONFIG_GZIP) && defined(CONFIG_GZIP_COMPRESSED)
+static int bench_gunzip(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	unsigned long len = dec->in_size;
+	int ret;
+
+	ret = gunzip(dec->out, BENCH_SIZE, (uchar *)dec->in, &len);
+	dec->out_size = len;
+
+	return ret;
+}
+
+static int bench_test_gzip(struct unit_test_state *uts)
+{
+	unsigned long len = BENCH_SIZE;
+	char *text, *buf;
+
+	text = malloc(BENCH_SIZE);
+	ut_assertnonnull(text);
+	bench_make_text(text);
+	buf = malloc(len);
+	ut_assertnonnull(buf);
+	ut_assertok(gzip(buf, &len, (uchar *)text, BENCH_SIZE));
+	free(text);
+	ut_assertok(bench_decomp(uts, "gzip", bench_gunzip, buf, len));
+	free(buf);
+
+	return 0;
+}
+BENCH_TEST(bench_test_gzip, 0);
+#endif
+
+#ifdef CONFIG_BZIP2
+static int bench_bunzip2(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	unsigned int len = BENCH_SIZE;
+	int ret;
+
+	ret = BZ2_bzBuffToBuffDecompress(dec->out, &len, (char *)dec->in,
+					 dec->in_size,
+					 CONFIG_SYS_MALLOC_LEN < (4096 * 1024),
+					 0);
+	dec->out_size = len;
+
+	return ret == BZ_OK ? 0 : -EINVAL;
+}
+
+static int bench_test_bzip2(struct unit_test_state *uts)
+{
+	return bench_decomp(uts, "bzip2", bench_bunzip2, bench_bzip2,
+			    sizeof(bench_bzip2) - 1);
+}
+BENCH_TEST(bench_test_bzip2, 0);
+#endif
+
+static int bench_unlzma(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	SizeT len = BENCH_SIZE;
+	int ret;
+
+	ret = lzmaBuffToBuffDecompress(dec->out, &len, (uchar *)dec->in,
+				       dec->in_size);
+	dec->out_size = len;
+
+	return ret == SZ_OK ? 0 : -EINVAL;
+}
+
+static int bench_test_lzma(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_LZMA))
+		return 0;
+
+	return bench_decomp(uts, "lzma", bench_unlzma, bench_lzma,
+			    sizeof(bench_lzma) - 1);
+}
+BENCH_TEST(bench_test_lzma, 0);
+
+/* Write an lzo1x length field, for a code with @bits bits of length */
+static u8 *bench_lzo_len(u8 *p, u8 code, int bits, ulong len)
+{
+	ulong max = (1 << bits) - 1;
+
+	if (len <= max) {
+		*p++ = code | len;
+		return p;
+	}
+	*p++ = code;
+	for (len -= max; len > 255; len -= 255)
+		*p++ = 0;
+	*p++ = len;
+
+	return p;
+}
+
+/*
+ * Encode the text as a raw lzo1x stream: one literal run holding the
+ * paragraph, then a match of the previous copy for each repeat
+ */
+static ulong bench_make_lzo(u8 *buf)
+{
+	u8 *p = buf;
+	int i;
+
+	p = bench_lzo_len(p, 0, 4, BENCH_TEXT_LEN - 3);
+	memcpy(p, bench_text, BENCH_TEXT_LEN);
+	p += BENCH_TEXT_LEN;
+	for (i = 1; i < BENCH_TEXT_REPEAT; i++) {
+		p = bench_lzo_len(p, 0x20, 5, BENCH_TEXT_LEN - 2);
+		put_unaligned_le16((BENCH_TEXT_LEN - 1) << 2, p);
+		p += 2;
+	}
+	/* End-of-stream marker */
+	*p++ = 0x11;
+	*p++ = 0;
+	*p++ = 0;
+
+	return p - buf;
+}
+
+static int bench_unlzo(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	size_t len = BENCH_SIZE;
+	int ret;
+
+	ret = lzo1x_decompress_safe(dec->in, dec->in_size, dec->out, &len);
+	dec->out_size = len;
+
+	return ret == LZO_E_OK ? 0 : -EINVAL;
+}
+
+static int bench_test_lzo(struct unit_test_state *uts)
+{
+	ulong len;
+	u8 *buf;
+
+	if (!IS_ENABLED(CONFIG_LZO))
+		return 0;
+	buf = malloc(BENCH_TEXT_LEN + BENCH_TEXT_REPEAT * 8);
+	ut_assertnonnull(buf);
+	len = bench_make_lzo(buf);
+	ut_assertok(bench_decomp(uts, "lzo", bench_unlzo, buf, len));
+	free(buf);
+
+	return 0;
+}
+BENCH_TEST(bench_test_lzo, 0);
+
+static int bench_unlz4(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	size_t len = BENCH_SIZE;
+	int ret;
+
+	ret = ulz4fn(dec->in, dec->in_size, dec->out, &len);
+	dec->out_size = len;
+
+	return ret;
+}
+
+static int bench_test_lz4(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_LZ4))
+		return 0;
+
+	return bench_decomp(uts, "lz4", bench_unlz4, bench_lz4,
+			    sizeof(bench_lz4) - 1);
+}
+BENCH_TEST(bench_test_lz4, 0);
+
+static int bench_unzstd(void *priv)
+{
+	struct bench_decomp *dec = priv;
+	size_t len = BENCH_SIZE;
+	int ret;
+
+	ret = zstd_decompress(dec->in, dec->in_size, dec->out, &len);
+	dec->out_size = len;
+
+	return ret;
+}
+
+static int bench_test_zstd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	return bench_decomp(uts, "zstd", bench_unzstd, bench_zstd,
+			    sizeof(bench_zstd) - 1);
+}
+BENCH_TEST(bench_test_zstd, 0);
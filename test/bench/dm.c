@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmarks for driver model
+ *
+ * Binding and probing a device looks up its uclass several times, so these
+ * show the effect of CONFIG_DM_UCLASS_TABLE and the number of uclasses.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <test/bench.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of devices bound and probed in each call */
+#define BENCH_DM_DEVS		32
+
+/**
+ * struct bench_dm - Devices used by the benchmark
+ *
+ * @drv: Driver to bind
+ * @devs: Devices bound in this call
+ */
+struct bench_dm {
+	const struct driver *drv;
+	struct udevice *devs[BENCH_DM_DEVS];
+};
+
+/* Private data of each device, so that probing allocates memory */
+struct bench_dm_priv {
+	ulong value;
+};
+
+static int bench_dm_probe(struct udevice *dev)
+{
+	struct bench_dm_priv *priv = dev_get_priv(dev);
+
+	priv->value = dev->seq;
+
+	return 0;
+}
+
+U_BOOT_DRIVER(bench_dm_drv) = {
+	.name	= "bench_dm_drv",
+	.id	= UCLASS_NOP,
+	.probe	= bench_dm_probe,
+	.priv_auto_alloc_size	= sizeof(struct bench_dm_priv),
+};
+
+/* Bind and probe the devices, then remove and unbind them again */
+static int bench_dm_bind_probe(void *priv)
+{
+	struct bench_dm *dm = priv;
+	int ret, i;
+
+	for (i = 0; i < BENCH_DM_DEVS; i++) {
+		ret = device_bind(dm_root(), dm->drv, dm->drv->name, NULL, -1,
+				  &dm->devs[i]);
+		if (ret)
+			return ret;
+	}
+	for (i = 0; i < BENCH_DM_DEVS; i++) {
+		ret = device_probe(dm->devs[i]);
+		if (ret)
+			return ret;
+	}
+	for (i = 0; i < BENCH_DM_DEVS; i++) {
+		ret = device_remove(dm->devs[i], DM_REMOVE_NORMAL);
+		if (!ret)
+			ret = device_unbind(dm->devs[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int bench_test_dm(struct unit_test_state *uts)
+{
+	struct bench_dm dm;
+	struct uclass *uc;
+	int count = 0;
+
+	/* Look the driver up by name, see dm_test_probe_async() */
+	dm.drv = lists_driver_lookup_name("bench_dm_drv");
+	ut_assertnonnull(dm.drv);
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node)
+		count++;
+	printf("%d uclasses, uclass table %s\n", count,
+	       CONFIG_IS_ENABLED(DM_UCLASS_TABLE) ? "on" : "off");
+
+	ut_assertok(bench_run("dm-bind-probe-32", bench_dm_bind_probe, &dm,
+			      0));
+
+	return 0;
+}
+BENCH_TEST(bench_test_dm, 0);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmarks for the environment hash table
+ *
+ * These time the operations used by environment-heavy scripts: looking up
+ * variables which exist and which do not, setting and deleting temporary
+ * variables and printing the whole environment. With CONFIG_ENV_BINARY,
+ * importing a text environment is compared with importing the same
+ * variables in the binary format.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/bench.h>
+#include <test/ut.h>
+
+/* Number of variables in the table */
+#define BENCH_ENV_VARS		400
+
+/**
+ * struct bench_env - Data used by the benchmarks
+ *
+ * @htab: Hash table holding BENCH_ENV_VARS variables
+ * @text: Text environment holding the same variables, for importing
+ * @text_size: Size of @text in bytes, including the final nul
+ * @bin: @text in the binary format
+ * @bin_size: Size of @bin in bytes
+ */
+struct bench_env {
+	struct hsearch_data htab;
+	char *text;
+	int text_size;
+	char *bin;
+	ssize_t bin_size;
+};
+
+static int bench_env_find(struct bench_env *env, const char *fmt, bool found)
+{
+	struct env_entry item, *ritem;
+	char key[30];
+	int i;
+
+	item.data = NULL;
+	item.key = key;
+	for (i = 0; i < BENCH_ENV_VARS; i++) {
+		snprintf(key, sizeof(key), fmt, i);
+		hsearch_r(item, ENV_FIND, &ritem, &env->htab, 0);
+		if (!ritem != !found)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Look up every variable */
+static int bench_env_hit(void *priv)
+{
+	return bench_env_find(priv, "bench_var_%d", true);
+}
+
+/* Look up variables which do not exist */
+static int bench_env_miss(void *priv)
+{
+	return bench_env_find(priv, "bench_missing_%d", false);
+}
+
+/* Set and delete a temporary variable, as a script using setexpr would */
+static int bench_env_churn(void *priv)
+{
+	struct bench_env *env = priv;
+	struct env_entry item, *ritem;
+	char key[30];
+	int i;
+
+	item.callback = NULL;
+	item.flags = 0;
+	item.key = key;
+	item.data = key;
+	for (i = 0; i < BENCH_ENV_VARS; i++) {
+		snprintf(key, sizeof(key), "bench_tmp_%d", i);
+		hsearch_r(item, ENV_ENTER, &ritem, &env->htab, 0);
+		if (!ritem || hdelete_r(key, &env->htab, 0) != 1)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int bench_env_export(void *priv)
+{
+	struct bench_env *env = priv;
+	char *res = NULL;
+
+	if (hexport_r(&env->htab, '\n', 0, &res, 0, 0, NULL) <= 0)
+		return -EINVAL;
+	free(res);
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+/* Import the text environment into a new table, then destroy it */
+static int bench_env_import_text(void *priv)
+{
+	struct bench_env *env = priv;
+	struct hsearch_data htab;
+
+	memset(&htab, '\0', sizeof(htab));
+	if (himport_r(&htab, env->text, env->text_size, '\0', 0, 0, 0,
+		      NULL) != 1)
+		return -EINVAL;
+	hdestroy_r(&htab);
+
+	return 0;
+}
+
+static int bench_env_import_bin(void *priv)
+{
+	struct bench_env *env = priv;
+	struct hsearch_data htab;
+
+	memset(&htab, '\0', sizeof(htab));
+	if (himport_bin_r(&htab, env->bin, env->bin_size, 0, 0, NULL) != 1)
+		return -EINVAL;
+	hdestroy_r(&htab);
+
+	return 0;
+}
+#endif
+
+static int bench_test_env(struct unit_test_state *uts)
+{
+	struct env_entry item, *ritem;
+	struct bench_env env;
+	char key[30];
+	int i;
+
+	memset(&env, '\0', sizeof(env));
+	ut_asserteq(1, hcreate_r(BENCH_ENV_VARS * 2, &env.htab));
+	item.callback = NULL;
+	item.flags = 0;
+	item.key = key;
+	item.data = key;
+	for (i = 0; i < BENCH_ENV_VARS; i++) {
+		snprintf(key, sizeof(key), "bench_var_%d", i);
+		ut_asserteq(1, hsearch_r(item, ENV_ENTER, &ritem, &env.htab,
+					 0));
+	}
+
+	/*
+	 * Allocate everything before timing anything, so that these buffers
+	 * do not split the space used to evict the caches
+	 */
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+	env.text_size = hexport_r(&env.htab, '\0', 0, &env.text, 0, 0, NULL);
+	ut_assert(env.text_size > 0);
+	env.bin_size = htext_to_bin(env.text, env.text_size, '\0', &env.bin);
+	ut_assert(env.bin_size > 0);
+#endif
+
+	ut_assertok(bench_run("env-find", bench_env_hit, &env, 0));
+	ut_assertok(bench_run("env-miss", bench_env_miss, &env, 0));
+	ut_assertok(bench_run("env-set-delete", bench_env_churn, &env, 0));
+	ut_assertok(bench_run("env-export", bench_env_export, &env, 0));
+	ut_asserteq(BENCH_ENV_VARS, env.htab.filled);
+
+#if CONFIG_IS_ENABLED(ENV_BINARY)
+	ut_assertok(bench_run("env-import-text", bench_env_import_text, &env,
+			      env.text_size));
+	ut_assertok(bench_run("env-import-bin", bench_env_import_bin, &env,
+			      env.bin_size));
+	free(env.bin);
+	free(env.text);
+#endif
+	hdestroy_r(&env.htab);
+
+	return 0;
+}
+BENCH_TEST(bench_test_env, 0);
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmarks for the hash algorithms
+ *
+ * Each algorithm supported by hash_lookup_algo() hashes 1MB of
+ * pseudo-random data in one call, as happens when checking a FIT image.
+ */
+
+#include <common.h>
+#include <hash.h>
+#include <malloc.h>
+#include <test/bench.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+#define BENCH_HASH_SIZE		SZ_1M
+
+/* Algorithms from common/hash.c, skipped if not enabled */
+static const char *const bench_hash_algos[] = {
+	"sha1",
+	"sha256",
+	"crc16-ccitt",
+	"crc32",
+};
+
+/**
+ * struct bench_hash - Data for one hash algorithm
+ *
+ * @algo: Algorithm to use
+ * @buf: Data to hash, BENCH_HASH_SIZE bytes long
+ * @digest: Output of the hash
+ */
+struct bench_hash {
+	struct hash_algo *algo;
+	u8 *buf;
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+};
+
+static int bench_hash(void *priv)
+{
+	struct bench_hash *hash = priv;
+
+	hash->algo->hash_func_ws(hash->buf, BENCH_HASH_SIZE, hash->digest,
+				 hash->algo->chunk_size);
+
+	return 0;
+}
+
+static int bench_test_hash(struct unit_test_state *uts)
+{
+	struct bench_hash hash;
+	int i;
+
+	hash.buf = malloc(BENCH_HASH_SIZE);
+	ut_assertnonnull(hash.buf);
+	for (i = 0; i < BENCH_HASH_SIZE; i++)
+		hash.buf[i] = (i * 2654435761U) >> 24;
+
+	for (i = 0; i < ARRAY_SIZE(bench_hash_algos); i++) {
+		if (hash_lookup_algo(bench_hash_algos[i], &hash.algo))
+			continue;
+		ut_assertok(bench_run(hash.algo->name, bench_hash, &hash,
+				      BENCH_HASH_SIZE));
+	}
+	free(hash.buf);
+
+	return 0;
+}
+BENCH_TEST(bench_test_hash, 0);
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmarks for memcpy(), memset() and memmove()
+ *
+ * The generic versions in lib/string.c are always timed, with names ending
+ * in "-generic". Where the architecture has its own version (it defines
+ * __HAVE_ARCH_xxx), that is timed too, with names ending in "-arch", so the
+ * two can be compared on the same board. Small sizes show the call overhead
+ * and large ones the memory bandwidth.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/bench.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+/* Extra space so that the buffers can be offset from their alignment */
+#define BENCH_MEM_SLACK		64
+
+static const ulong bench_mem_sizes[] = { 256, SZ_4K, SZ_64K, SZ_1M };
+
+/**
+ * struct bench_mem - Arguments for one call
+ *
+ * @impl: Implementation to time
+ * @dst: Destination buffer
+ * @src: Source buffer
+ * @size: Number of bytes to copy or set
+ */
+struct bench_mem {
+	const struct bench_mem_impl *impl;
+	char *dst;
+	const char *src;
+	ulong size;
+};
+
+/**
+ * struct bench_mem_impl - Implementations of the functions being timed
+ *
+ * @suffix: Suffix for the benchmark names
+ * @copy: memcpy() implementation
+ * @set: memset() implementation
+ * @move: memmove() implementation
+ */
+struct bench_mem_impl {
+	const char *suffix;
+	void *(*copy)(void *dest, const void *src, size_t count);
+	void *(*set)(void *s, int c, size_t count);
+	void *(*move)(void *dest, const void *src, size_t count);
+};
+
+static const struct bench_mem_impl bench_mem_generic = {
+	.suffix		= "generic",
+	.copy		= memcpy_generic,
+	.set		= memset_generic,
+	.move		= memmove_generic,
+};
+
+/* The linked-in versions, NULL where they are the generic ones */
+static const struct bench_mem_impl bench_mem_arch = {
+	.suffix		= "arch",
+#ifdef __HAVE_ARCH_MEMCPY
+	.copy		= memcpy,
+#endif
+#ifdef __HAVE_ARCH_MEMSET
+	.set		= memset,
+#endif
+#ifdef __HAVE_ARCH_MEMMOVE
+	.move		= memmove,
+#endif
+};
+
+static int bench_memcpy(void *priv)
+{
+	struct bench_mem *mem = priv;
+
+	mem->impl->copy(mem->dst, mem->src, mem->size);
+
+	return 0;
+}
+
+static int bench_memset(void *priv)
+{
+	struct bench_mem *mem = priv;
+
+	mem->impl->set(mem->dst, 0x5a, mem->size);
+
+	return 0;
+}
+
+static int bench_memzero(void *priv)
+{
+	struct bench_mem *mem = priv;
+
+	mem->impl->set(mem->dst, '\0', mem->size);
+
+	return 0;
+}
+
+static int bench_memmove(void *priv)
+{
+	struct bench_mem *mem = priv;
+
+	mem->impl->move(mem->dst, mem->src, mem->size);
+
+	return 0;
+}
+
+/* Time @func for each size, with the given buffer offsets */
+static int bench_mem(struct unit_test_state *uts,
+		     const struct bench_mem_impl *impl, const char *name,
+		     bench_func_t func, char *dst, const char *src)
+{
+	struct bench_mem mem;
+	char str[40];
+	int i;
+
+	mem.impl = impl;
+	mem.dst = dst;
+	mem.src = src;
+	for (i = 0; i < ARRAY_SIZE(bench_mem_sizes); i++) {
+		mem.size = bench_mem_sizes[i];
+		snprintf(str, sizeof(str), "%s-%s-%luk", name, impl->suffix,
+			 mem.size / SZ_1K);
+		if (mem.size < SZ_1K)
+			snprintf(str, sizeof(str), "%s-%s-%lu", name,
+				 impl->suffix, mem.size);
+		ut_assertok(bench_run(str, func, &mem, mem.size));
+	}
+
+	return 0;
+}
+
+/* Time each function of @impl which is present */
+static int bench_mem_impl(struct unit_test_state *uts,
+			  const struct bench_mem_impl *impl, char *dst,
+			  char *src)
+{
+	if (impl->copy) {
+		ut_assertok(bench_mem(uts, impl, "memcpy", bench_memcpy, dst,
+				      src));
+		ut_assertok(bench_mem(uts, impl, "memcpy-unaligned",
+				      bench_memcpy, dst + 3, src + 1));
+	}
+	if (impl->set) {
+		ut_assertok(bench_mem(uts, impl, "memset", bench_memset, dst,
+				      NULL));
+		ut_assertok(bench_mem(uts, impl, "memset-unaligned",
+				      bench_memset, dst + 1, NULL));
+		/* Zeroing may use a faster path, e.g. DC ZVA on ARMv8 */
+		ut_assertok(bench_mem(uts, impl, "memzero", bench_memzero, dst,
+				      NULL));
+	}
+	if (impl->move) {
+		/* Overlapping, so that the copy must go backwards */
+		ut_assertok(bench_mem(uts, impl, "memmove", bench_memmove,
+				      src + 32, src));
+		ut_assertok(bench_mem(uts, impl, "memmove-unaligned",
+				      bench_memmove, src + 35, src));
+		ut_assertok(bench_mem(uts, impl, "memmove-forward",
+				      bench_memmove, src, src + 32));
+	}
+
+	return 0;
+}
+
+static int bench_test_string(struct unit_test_state *uts)
+{
+	const ulong size = SZ_1M + BENCH_MEM_SLACK;
+	char *src, *dst;
+
+	src = malloc(size);
+	dst = malloc(size);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	memset(src, 0xa5, size);
+
+	ut_assertok(bench_mem_impl(uts, &bench_mem_generic, dst, src));
+	ut_assertok(bench_mem_impl(uts, &bench_mem_arch, dst, src));
+	free(dst);
+	free(src);
+
+	return 0;
+}
+BENCH_TEST(bench_test_string, 0);
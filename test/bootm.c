@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for bootm
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <image.h>
+#include <mapmem.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new bootm test */
+#define BOOTM_TEST(_name, _flags)	UNIT_TEST(_name, _flags, bootm_test)
+
+#ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
+/* Memory given to bootm, which is clear of U-Boot's own data */
+#define BOOTM_TEST_LOW		0x1000000
+#define BOOTM_TEST_SIZE		0x1000000
+
+/* Size of the kernel and of the ramdisk */
+#define BOOTM_TEST_IMG_SIZE	SZ_64K
+
+/* Address of the FIT, just above the lowest place the OS can load */
+#define BOOTM_TEST_FIT		(BOOTM_TEST_LOW + BOOTM_TEST_IMG_SIZE)
+#define BOOTM_TEST_FIT_SIZE	SZ_256K
+
+/* Add an image node holding BOOTM_TEST_IMG_SIZE bytes of @val to a FIT */
+static int bootm_test_fit_image(void *fit, const char *name, const char *type,
+				u8 val, ulong load)
+{
+	void *data;
+	int ret;
+
+	ret = fdt_begin_node(fit, name);
+	if (!ret)
+		ret = fdt_property_placeholder(fit, "data", BOOTM_TEST_IMG_SIZE,
+					       &data);
+	if (ret)
+		return ret;
+	memset(data, val, BOOTM_TEST_IMG_SIZE);
+	ret = fdt_property_string(fit, "type", type);
+	if (!ret)
+		ret = fdt_property_string(fit, "arch", "sandbox");
+	if (!ret)
+		ret = fdt_property_string(fit, "os", "linux");
+	if (!ret)
+		ret = fdt_property_string(fit, "compression", "none");
+	if (!ret && load)
+		ret = fdt_property_u32(fit, "load", load);
+	if (!ret && load)
+		ret = fdt_property_u32(fit, "entry", load);
+	if (!ret)
+		ret = fdt_end_node(fit);
+
+	return ret;
+}
+
+/*
+ * Write a FIT with a kernel loaded at @load and a ramdisk, returning the
+ * address just past it
+ */
+static int bootm_test_make_fit(struct unit_test_state *uts, ulong load,
+			       ulong *endp)
+{
+	void *fit = map_sysmem(BOOTM_TEST_FIT, BOOTM_TEST_FIT_SIZE);
+
+	ut_assertok(fdt_create(fit, BOOTM_TEST_FIT_SIZE));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_string(fit, "description", "bootm test"));
+	ut_assertok(fdt_property_u32(fit, "timestamp", 0));
+	ut_assertok(fdt_begin_node(fit, "images"));
+	ut_assertok(bootm_test_fit_image(fit, "kernel", "kernel", 0x5a, load));
+	ut_assertok(bootm_test_fit_image(fit, "ramdisk", "ramdisk", 0xa5, 0));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_begin_node(fit, "configurations"));
+	ut_assertok(fdt_property_string(fit, "default", "conf-1"));
+	ut_assertok(fdt_begin_node(fit, "conf-1"));
+	ut_assertok(fdt_property_string(fit, "kernel", "kernel"));
+	ut_assertok(fdt_property_string(fit, "ramdisk", "ramdisk"));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+	*endp = BOOTM_TEST_FIT + fdt_totalsize(fit);
+	unmap_sysmem(fit);
+
+	return 0;
+}
+
+/* Check that the ramdisk is intact at @addr */
+static int bootm_test_check_ramdisk(struct unit_test_state *uts, ulong addr)
+{
+	u8 *rd = map_sysmem(addr, BOOTM_TEST_IMG_SIZE);
+	int i;
+
+	for (i = 0; i < BOOTM_TEST_IMG_SIZE; i++)
+		ut_asserteq(0xa5, rd[i]);
+	unmap_sysmem(rd);
+	ut_asserteq(addr, env_get_hex("initrd_start", 0));
+	ut_asserteq(addr + BOOTM_TEST_IMG_SIZE, env_get_hex("initrd_end", 0));
+
+	return 0;
+}
+
+/*
+ * Boot the FIT as far as relocating the ramdisk, with the OS loaded at
+ * @load and the ramdisk allowed up to @initrd_high. Check where the ramdisk
+ * goes and whether it was placed before the OS was loaded.
+ */
+static int bootm_test_ramdisk(struct unit_test_state *uts, ulong load,
+			      ulong initrd_high, bool early)
+{
+	char cmd[30];
+	ulong start;
+
+	ut_assertok(env_set_hex("bootm_low", BOOTM_TEST_LOW));
+	ut_assertok(env_set_hex("bootm_size", BOOTM_TEST_SIZE));
+	ut_assertok(env_set_hex("initrd_high", initrd_high));
+
+	snprintf(cmd, sizeof(cmd), "bootm start %lx", (ulong)BOOTM_TEST_FIT);
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq(BOOTM_TEST_IMG_SIZE, images.rd_end - images.rd_start);
+	start = images.initrd_start;
+	if (early) {
+		ut_assert(start);
+
+		/* A second copy from the FIT would bring this back */
+		memset(map_sysmem(images.rd_start, BOOTM_TEST_IMG_SIZE), '\0',
+		       BOOTM_TEST_IMG_SIZE);
+	} else {
+		ut_asserteq(0, start);
+	}
+	ut_assertok(run_command("bootm loados", 0));
+	ut_assertok(run_command("bootm ramdisk", 0));
+	if (early)
+		ut_asserteq(start, images.initrd_start);
+	start = images.initrd_start;
+	ut_assert(start + BOOTM_TEST_IMG_SIZE <= initrd_high);
+
+	/* Nothing loaded later may overwrite the ramdisk */
+	ut_assert(start >= load + BOOTM_TEST_IMG_SIZE ||
+		  start + BOOTM_TEST_IMG_SIZE <= load);
+	ut_assertok(bootm_test_check_ramdisk(uts, start));
+
+	return 0;
+}
+
+/* Run a ramdisk test, then put back the environment it changes */
+static int bootm_test_ramdisk_env(struct unit_test_state *uts, ulong load,
+				  ulong initrd_high, bool early)
+{
+	char *old_high = env_get("initrd_high");
+	char *old_size = env_get("bootm_size");
+	int ret;
+
+	old_high = old_high ? strdup(old_high) : NULL;
+	old_size = old_size ? strdup(old_size) : NULL;
+	ret = bootm_test_ramdisk(uts, load, initrd_high, early);
+	env_set("bootm_low", NULL);
+	env_set("bootm_size", old_size);
+	env_set("initrd_high", old_high);
+	free(old_size);
+	free(old_high);
+
+	return ret;
+}
+
+/*
+ * With room below initrd_high clear of the OS, the ramdisk is copied once,
+ * straight to its final place, even if the OS goes at the top of memory
+ */
+static int bootm_test_ramdisk_early(struct unit_test_state *uts)
+{
+	const ulong top = BOOTM_TEST_LOW + BOOTM_TEST_SIZE;
+	const ulong load = top - BOOTM_TEST_IMG_SIZE;
+	ulong end;
+
+	ut_assertok(bootm_test_make_fit(uts, load, &end));
+	ut_assertok(bootm_test_ramdisk_env(uts, load, top, true));
+
+	return 0;
+}
+BOOTM_TEST(bootm_test_ramdisk_early, 0);
+
+/*
+ * With no such room, the ramdisk is relocated once the OS is loaded, as
+ * before. Here the OS and the FIT fill the space below initrd_high, but the
+ * FIT may be overwritten once the OS is loaded.
+ */
+static int bootm_test_ramdisk_late(struct unit_test_state *uts)
+{
+	ulong end;
+
+	ut_assertok(bootm_test_make_fit(uts, BOOTM_TEST_LOW, &end));
+	ut_assertok(bootm_test_ramdisk_env(uts, BOOTM_TEST_LOW,
+					   ALIGN(end, SZ_4K), false));
+
+	return 0;
+}
+BOOTM_TEST(bootm_test_ramdisk_late, 0);
+#endif
+
+int do_ut_bootm(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, bootm_test);
+	const int n_ents = ll_entry_count(struct unit_test, bootm_test);
+
+	return cmd_ut_category("bootm", "bootm_test_", tests, n_ents, argc,
+			       argv);
+}
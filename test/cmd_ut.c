@@ -45,6 +45,9 @@ int cmd_ut_category(const char *name, const char *prefix,
 
 static cmd_tbl_t cmd_ut_sub[] = {
 	U_BOOT_CMD_MKENT(all, CONFIG_SYS_MAXARGS, 1, do_ut_all, "", ""),
+#ifdef CONFIG_UT_BENCH
+	U_BOOT_CMD_MKENT(bench, CONFIG_SYS_MAXARGS, 1, do_ut_bench, "", ""),
+#endif
 #if defined(CONFIG_UT_DM)
 	U_BOOT_CMD_MKENT(dm, CONFIG_SYS_MAXARGS, 1, do_ut_dm, "", ""),
 #endif
@@ -71,6 +74,7 @@ static cmd_tbl_t cmd_ut_sub[] = {
 			 "", ""),
 	U_BOOT_CMD_MKENT(bloblist, CONFIG_SYS_MAXARGS, 1, do_ut_bloblist,
 			 "", ""),
+	U_BOOT_CMD_MKENT(bootm, CONFIG_SYS_MAXARGS, 1, do_ut_bootm, "", ""),
 #endif
 };
 
@@ -81,6 +85,9 @@ static int do_ut_all(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	int any_fail = 0;
 
 	for (i = 1; i < ARRAY_SIZE(cmd_ut_sub); i++) {
+		/* Benchmarks take a long time and do not pass or fail */
+		if (!strcmp(cmd_ut_sub[i].name, "bench"))
+			continue;
 		printf("----Running %s tests----\n", cmd_ut_sub[i].name);
 		retval = cmd_ut_sub[i].cmd(cmdtp, flag, 1, &cmd_ut_sub[i].name);
 		if (!any_fail)
@@ -111,9 +118,13 @@ static int do_ut(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 #ifdef CONFIG_SYS_LONGHELP
 static char ut_help_text[] =
-	"all - execute all enabled tests\n"
+	"all - execute all enabled tests, except the benchmarks\n"
+#ifdef CONFIG_UT_BENCH
+	"ut bench [-m] [-w] [-r <runs>] [test-name] - run micro-benchmarks\n"
+#endif
 #ifdef CONFIG_SANDBOX
 	"ut bloblist - Test bloblist implementation\n"
+	"ut bootm - Test bootm\n"
 	"ut compression - Test compressors and bootm decompression\n"
 #endif
 #ifdef CONFIG_UT_DM
@@ -7,10 +7,16 @@
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
+#include <hexdump.h>
+#include <lmb.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <worker.h>
+#include <zstd.h>
 #include <asm/io.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -19,11 +25,18 @@
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
 
+#include <linux/log2.h>
 #include <linux/lzo.h>
+#include <linux/zstd.h>
+#include <linux/sizes.h>
+#include <linux/xxhash.h>
+#include <test/bench.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
 	"I am a highly compressable bit of text.\n"
@@ -119,6 +132,23 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -182,8 +212,7 @@ static int uncompress_using_bzip2(struct unit_test_state *uts,
 	int ret;
 	unsigned int inout_size = out_max;
 
-	ret = BZ2_bzBuffToBuffDecompress(out, &inout_size, in, in_size,
-			CONFIG_SYS_MALLOC_LEN < (4096 * 1024), 0);
+	ret = BZ2_bzBuffToBuffDecompress(out, &inout_size, in, in_size, 0, 0);
 	if (out_size)
 		*out_size = inout_size;
 
@@ -294,6 +323,40 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -412,6 +475,162 @@ static int compression_test_gzip(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_gzip, 0);
 
+/*
+ * Make data which looks like an uncompressed kernel to deflate: a mix of
+ * literals and copies of earlier data, with mostly short distances and
+ * lengths, including overlapping copies
+ */
+static void gzip_make_data(u8 *buf, size_t size)
+{
+	u32 seed = 1;
+	size_t pos = 0;
+
+	while (pos < size) {
+		u32 r;
+
+		seed = seed * 1103515245 + 12345;
+		r = seed >> 8;
+		if (pos > 64 && (r & 3)) {
+			size_t dist, len;
+
+			if (r & 4)
+				dist = 1 + (r >> 3) % 16;
+			else
+				dist = 1 + (r >> 3) % min_t(size_t, pos, 32768);
+			len = min_t(size_t, 3 + (r >> 18) % 40, size - pos);
+			for (; len; len--, pos++)
+				buf[pos] = buf[pos - dist];
+		} else {
+			buf[pos++] = r & (r & 0x80 ? 0xff : 0x1f);
+		}
+	}
+}
+
+/* The header written by gzip(), before the deflate data */
+#define GZIP_HEADER_SIZE	10
+
+/*
+ * Inflate with a small output buffer, so that inflate_fast() often runs out
+ * of space and must copy matches from its window
+ */
+static int gzip_check_window(struct unit_test_state *uts, u8 *comp,
+			     size_t comp_size, const u8 *data, size_t size)
+{
+	u8 *out = malloc(size);
+	z_stream s;
+	int chunk;
+
+	ut_assertnonnull(out);
+	memset(&s, '\0', sizeof(s));
+	ut_asserteq(Z_OK, inflateInit2(&s, -MAX_WBITS));
+	s.next_in = comp + GZIP_HEADER_SIZE;
+	s.avail_in = comp_size - GZIP_HEADER_SIZE;
+	s.next_out = out;
+	for (chunk = 300; s.total_out < size; chunk = chunk * 3 % 5000 + 300) {
+		s.avail_out = min_t(size_t, chunk, size - s.total_out);
+		ut_assert(inflate(&s, Z_SYNC_FLUSH) >= 0);
+	}
+	inflateEnd(&s);
+	ut_asserteq(size, s.total_out);
+	ut_asserteq_mem(data, out, size);
+	free(out);
+
+	return 0;
+}
+
+static int compression_test_gzip_data(struct unit_test_state *uts)
+{
+	const size_t size = SZ_1M;
+	unsigned long comp_size, out_size;
+	u8 *data, *comp, *out;
+
+	data = malloc(size);
+	comp = malloc(size);
+	out = malloc(size);
+	ut_assertnonnull(data);
+	ut_assertnonnull(comp);
+	ut_assertnonnull(out);
+	gzip_make_data(data, size);
+
+	comp_size = size;
+	ut_assertok(gzip(comp, &comp_size, data, size));
+	comp_size = size - comp_size;
+	ut_asserteq(0, comp[3]);	/* no optional header fields */
+	out_size = comp_size;
+	ut_assertok(gunzip(out, size, comp, &out_size));
+	ut_asserteq(size, out_size);
+	ut_asserteq_mem(data, out, size);
+
+	ut_assertok(gzip_check_window(uts, comp, comp_size, data, size));
+
+	free(out);
+	free(comp);
+	free(data);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzip_data, 0);
+
+#ifdef CONFIG_UT_BENCH
+/* About the size of an uncompressed arm64 kernel */
+#define GZIP_BENCH_SIZE		(30 << 20)
+#define GZIP_BENCH_COMP_SIZE	(20 << 20)
+
+/**
+ * struct gzip_bench - Data used by the benchmark
+ *
+ * @comp: Compressed data
+ * @comp_size: Size of @comp in bytes
+ * @out: Buffer for the decompressed data
+ */
+struct gzip_bench {
+	u8 *comp;
+	unsigned long comp_size;
+	u8 *out;
+};
+
+static int gzip_bench_gunzip(void *priv)
+{
+	struct gzip_bench *bench = priv;
+	unsigned long out_size = bench->comp_size;
+
+	return gunzip(bench->out, GZIP_BENCH_SIZE, bench->comp, &out_size);
+}
+
+/* Time inflating a kernel-sized image, which is where most time is spent */
+static int bench_test_gunzip_kernel(struct unit_test_state *uts)
+{
+	struct gzip_bench bench;
+	u8 *data;
+
+	/*
+	 * Too big for malloc(), so use RAM above the other tests. Leave room
+	 * for the malloc() area at the top.
+	 */
+	data = map_sysmem(SZ_1M, GZIP_BENCH_SIZE);
+	bench.out = map_sysmem(SZ_1M + GZIP_BENCH_SIZE, GZIP_BENCH_SIZE);
+	bench.comp = map_sysmem(SZ_1M + 2 * GZIP_BENCH_SIZE,
+				GZIP_BENCH_COMP_SIZE);
+	gzip_make_data(data, GZIP_BENCH_SIZE);
+
+	bench.comp_size = GZIP_BENCH_COMP_SIZE;
+	ut_assertok(gzip(bench.comp, &bench.comp_size, data,
+			 GZIP_BENCH_SIZE));
+	bench.comp_size = GZIP_BENCH_COMP_SIZE - bench.comp_size;
+
+	ut_assertok(bench_run("gunzip-30m", gzip_bench_gunzip, &bench,
+			      GZIP_BENCH_SIZE));
+	ut_asserteq_mem(data, bench.out, GZIP_BENCH_SIZE);
+
+	unmap_sysmem(bench.comp);
+	unmap_sysmem(bench.out);
+	unmap_sysmem(data);
+
+	return 0;
+}
+BENCH_TEST(bench_test_gunzip_kernel, 0);
+#endif
+
 static int compression_test_bzip2(struct unit_test_state *uts)
 {
 	return run_test(uts, "bzip2", compress_using_bzip2,
@@ -419,6 +638,62 @@ static int compression_test_bzip2(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bzip2, 0);
 
+/* Decompress bzip2 data @chunk bytes at a time using a work area */
+static int bzip2_check_stream(struct unit_test_state *uts, uint work_len,
+			      uint chunk, int expect)
+{
+	char out[1024];
+	bz_stream strm;
+	uint pos, len;
+	void *work;
+	int ret;
+
+	work = malloc(work_len);
+	ut_assertnonnull(work);
+	ut_asserteq(BZ_OK, BZ2_bzDecompressInitWork(&strm, work, work_len));
+	strm.next_out = out;
+	strm.avail_out = sizeof(out);
+	for (pos = 0, ret = BZ_OK; ret == BZ_OK && pos < bzip2_compressed_size;
+	     pos += len) {
+		len = min_t(uint, chunk, bzip2_compressed_size - pos);
+		strm.next_in = (char *)bzip2_compressed + pos;
+		strm.avail_in = len;
+		ret = BZ2_bzDecompress(&strm);
+	}
+	BZ2_bzDecompressEnd(&strm);
+	free(work);
+	ut_asserteq(expect, ret);
+	if (ret == BZ_STREAM_END) {
+		ut_asserteq(strlen(plain), sizeof(out) - strm.avail_out);
+		ut_asserteq_mem(plain, out, strlen(plain));
+	}
+
+	return 0;
+}
+
+static int compression_test_bzip2_stream(struct unit_test_state *uts)
+{
+	uint fast = BZ2_bzDecompressWorkSize(9, 0);
+	uint small = BZ2_bzDecompressWorkSize(9, 1);
+
+	/* The test data uses 900KB blocks */
+	ut_asserteq('9', bzip2_compressed[3]);
+	ut_assert(small < fast);
+
+	ut_assertok(bzip2_check_stream(uts, fast, 1, BZ_STREAM_END));
+	ut_assertok(bzip2_check_stream(uts, fast, 7, BZ_STREAM_END));
+	ut_assertok(bzip2_check_stream(uts, fast, bzip2_compressed_size,
+				       BZ_STREAM_END));
+
+	/* Too little room for the fast method, so the small one is used */
+	ut_assertok(bzip2_check_stream(uts, fast - 1, 64, BZ_STREAM_END));
+	ut_assertok(bzip2_check_stream(uts, small, 64, BZ_STREAM_END));
+	ut_assertok(bzip2_check_stream(uts, small - 1, 64, BZ_MEM_ERROR));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_bzip2_stream, 0);
+
 static int compression_test_lzma(struct unit_test_state *uts)
 {
 	return run_test(uts, "lzma", compress_using_lzma,
@@ -426,6 +701,59 @@ static int compression_test_lzma(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lzma, 0);
 
+/* Decompress lzma data @chunk bytes at a time */
+static int lzma_check_stream(struct unit_test_state *uts, SizeT out_max,
+			     SizeT in_size, SizeT chunk, int expect)
+{
+	struct lzma_stream strm;
+	SizeT pos, len;
+	char *out;
+	int ret;
+
+	out = malloc(out_max);
+	ut_assertnonnull(out);
+	lzma_stream_init(&strm, out, out_max);
+	for (pos = 0, ret = 0; !ret && pos < in_size; pos += len) {
+		len = min(chunk, in_size - pos);
+		ret = lzma_stream_decode(&strm, lzma_compressed + pos, &len);
+	}
+	lzma_stream_end(&strm);
+	ut_asserteq(expect, ret);
+	if (ret == 1) {
+		ut_asserteq(lzma_compressed_size, pos);
+		ut_asserteq(strlen(plain), strm.out_len);
+		ut_asserteq_mem(plain, out, strlen(plain));
+	}
+	free(out);
+
+	return 0;
+}
+
+static int compression_test_lzma_stream(struct unit_test_state *uts)
+{
+	SizeT size = strlen(plain);
+
+	ut_assertok(lzma_check_stream(uts, size, lzma_compressed_size, 1, 1));
+	ut_assertok(lzma_check_stream(uts, size, lzma_compressed_size, 7, 1));
+	ut_assertok(lzma_check_stream(uts, size, lzma_compressed_size,
+				      lzma_compressed_size, 1));
+
+	/* Trailing data is not used */
+	ut_assertok(lzma_check_stream(uts, size, lzma_compressed_size + 1,
+				      lzma_compressed_size + 1, 1));
+
+	/* More input is needed */
+	ut_assertok(lzma_check_stream(uts, size, lzma_compressed_size - 1,
+				      64, 0));
+
+	/* The output buffer is too small for the size in the header */
+	ut_assertok(lzma_check_stream(uts, size - 1, lzma_compressed_size, 64,
+				      -ENOSPC));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lzma_stream, 0);
+
 static int compression_test_lzo(struct unit_test_state *uts)
 {
 	return run_test(uts, "lzo", compress_using_lzo, uncompress_using_lzo);
@@ -438,6 +766,336 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+/* Several frames, with skippable frames and trailing data */
+static int compression_test_lz4_frames(struct unit_test_state *uts)
+{
+	static const char skip[] =
+		"\x5a\x2a\x4d\x18\x03\x00\x00\x00\x61\x62\x63";
+	size_t plain_size = strlen(plain);
+	char in[TEST_BUFFER_SIZE * 2];
+	char out[TEST_BUFFER_SIZE * 2];
+	size_t in_size, out_size;
+	char *p = in;
+
+	memcpy(p, skip, sizeof(skip) - 1);
+	p += sizeof(skip) - 1;
+	memcpy(p, lz4_compressed, lz4_compressed_size);
+	p += lz4_compressed_size;
+	memcpy(p, skip, sizeof(skip) - 1);
+	p += sizeof(skip) - 1;
+	memcpy(p, lz4_compressed, lz4_compressed_size);
+	p += lz4_compressed_size;
+	strcpy(p, "trailing");
+	in_size = p + strlen(p) - in;
+
+	out_size = sizeof(out);
+	ut_assertok(ulz4fn(in, in_size, out, &out_size));
+	ut_asserteq(plain_size * 2, out_size);
+	ut_asserteq_mem(plain, out, plain_size);
+	ut_asserteq_mem(plain, out + plain_size, plain_size);
+
+	/* The second frame does not fit */
+	out_size = plain_size + 10;
+	ut_asserteq(-EPROTO, ulz4fn(in, in_size, out, &out_size));
+	ut_asserteq(plain_size, out_size);
+
+	/* A truncated skippable frame */
+	out_size = sizeof(out);
+	ut_asserteq(-EINVAL, ulz4fn(skip, sizeof(skip) - 2, out, &out_size));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_frames, 0);
+
+#if CONFIG_IS_ENABLED(LZ4_CHECKSUM)
+static int compression_test_lz4_checksum(struct unit_test_state *uts)
+{
+	char in[TEST_BUFFER_SIZE], out[TEST_BUFFER_SIZE];
+	size_t out_size;
+
+	memcpy(in, lz4_compressed, lz4_compressed_size);
+	out_size = sizeof(out);
+	ut_assertok(ulz4fn(in, lz4_compressed_size, out, &out_size));
+
+	/* Content checksum */
+	in[lz4_compressed_size - 1] ^= 1;
+	out_size = sizeof(out);
+	ut_asserteq(-EBADMSG, ulz4fn(in, lz4_compressed_size, out, &out_size));
+	ut_asserteq(strlen(plain), out_size);
+	in[lz4_compressed_size - 1] ^= 1;
+
+	/* Header checksum */
+	in[6] ^= 1;
+	out_size = sizeof(out);
+	ut_asserteq(-EBADMSG, ulz4fn(in, lz4_compressed_size, out, &out_size));
+	ut_asserteq(0, out_size);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_checksum, 0);
+#endif
+
+/*
+ * There is no lz4 compressor in U-Boot, and frames with several blocks are
+ * too large to include here, so build them. The data repeats every
+ * LZ4_TEST_PERIOD bytes, so each block is a run of literals followed by one
+ * long match. With linked blocks, each block after the first is a match into
+ * the one before.
+ */
+#define LZ4_TEST_PERIOD		61
+#define LZ4_TEST_BLOCKS		33
+
+static u8 *lz4_put_len(u8 *p, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*p++ = 255;
+	*p++ = len;
+
+	return p;
+}
+
+/*
+ * Add a sequence of literals, followed by a match @offset bytes back if
+ * @match_len is not 0
+ */
+static u8 *lz4_put_seq(u8 *p, const u8 *lit, size_t lit_len, size_t match_len,
+		       uint offset)
+{
+	u8 *token = p++;
+
+	*token = min_t(size_t, lit_len, 15) << 4;
+	if (lit_len >= 15)
+		p = lz4_put_len(p, lit_len - 15);
+	memcpy(p, lit, lit_len);
+	p += lit_len;
+	if (match_len) {
+		put_unaligned_le16(offset, p);
+		p += 2;
+		*token |= min_t(size_t, match_len - 4, 15);
+		if (match_len - 4 >= 15)
+			p = lz4_put_len(p, match_len - 4 - 15);
+	}
+
+	return p;
+}
+
+static size_t lz4_make_frame(u8 *out, const u8 *data, size_t size,
+			     size_t block_size, bool linked)
+{
+	u8 *p = out;
+	size_t pos;
+
+	put_unaligned_le32(LZ4F_MAGIC, p);
+	/* Block and content checksums */
+	p[4] = 0x54 | (linked ? 0 : 0x20);
+	p[5] = (ilog2(block_size / SZ_64K) / 2 + 4) << 4;
+	p[6] = IS_ENABLED(CONFIG_XXHASH) ? xxh32(p + 4, 2, 0) >> 8 : 0;
+	p += 7;
+
+	for (pos = 0; pos < size; pos += block_size) {
+		size_t len = min(block_size, size - pos);
+		size_t lit_len = linked && pos ? 0 : LZ4_TEST_PERIOD;
+		u8 *blk = p + 4;
+
+		p = lz4_put_seq(blk, data + pos, lit_len, len - lit_len - 5,
+				LZ4_TEST_PERIOD);
+		p = lz4_put_seq(p, data + pos + len - 5, 5, 0, 0);
+		put_unaligned_le32(p - blk, blk - 4);
+		put_unaligned_le32(IS_ENABLED(CONFIG_XXHASH) ?
+				   xxh32(blk, p - blk, 0) : 0, p);
+		p += 4;
+	}
+	put_unaligned_le32(0, p);
+	put_unaligned_le32(IS_ENABLED(CONFIG_XXHASH) ?
+			   xxh32(data, size, 0) : 0, p + 4);
+
+	return p + 8 - out;
+}
+
+/* Decompress into a separate buffer, using @threads secondary CPUs */
+static int lz4_check_threads(struct unit_test_state *uts, const u8 *data,
+			     size_t size, u8 *comp, size_t comp_size, u8 *buf,
+			     int threads)
+{
+	size_t out_size = size;
+	int ret;
+
+	memset(buf, '\0', size);
+	sandbox_set_worker_count(threads);
+	ret = ulz4fn(comp, comp_size, buf, &out_size);
+	sandbox_set_worker_count(-1);
+	ut_assertok(ret);
+	ut_asserteq(size, out_size);
+	ut_asserteq_mem(data, buf, size);
+
+	/* Too little space for the last block */
+	out_size = size - 1;
+	sandbox_set_worker_count(threads);
+	ret = ulz4fn(comp, comp_size, buf, &out_size);
+	sandbox_set_worker_count(-1);
+	ut_asserteq(-EPROTO, ret);
+
+	return 0;
+}
+
+static int lz4_check_blocks(struct unit_test_state *uts, bool linked)
+{
+	size_t block_size = SZ_64K, size, comp_size, out_size;
+	u8 *data, *buf, *comp;
+	int i;
+
+	size = block_size * LZ4_TEST_BLOCKS - 1000;
+	data = malloc(size);
+	buf = malloc(size + block_size);
+	comp = malloc(block_size);
+	ut_assertnonnull(data);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(comp);
+	for (i = 0; i < size; i++)
+		data[i] = i % LZ4_TEST_PERIOD;
+	comp_size = lz4_make_frame(comp, data, size, block_size, linked);
+
+	ut_assertok(lz4_check_threads(uts, data, size, comp, comp_size, buf,
+				      0));
+	ut_assertok(lz4_check_threads(uts, data, size, comp, comp_size, buf,
+				      3));
+
+	/* In place, which always uses one CPU */
+	memset(buf, '\0', size);
+	memcpy(buf + size + block_size - comp_size, comp, comp_size);
+	out_size = size;
+	sandbox_set_worker_count(3);
+	ut_assertok(ulz4fn(buf + size + block_size - comp_size, comp_size,
+			   buf, &out_size));
+	sandbox_set_worker_count(-1);
+	ut_asserteq(size, out_size);
+	ut_asserteq_mem(data, buf, size);
+
+	if (CONFIG_IS_ENABLED(LZ4_CHECKSUM)) {
+		/* Break the checksum of the first block */
+		comp[7 + 4 + (comp[7] | comp[8] << 8)] ^= 1;
+		out_size = size;
+		sandbox_set_worker_count(3);
+		ut_asserteq(-EBADMSG, ulz4fn(comp, comp_size, buf, &out_size));
+		sandbox_set_worker_count(-1);
+	}
+
+	free(comp);
+	free(buf);
+	free(data);
+
+	return 0;
+}
+
+static int compression_test_lz4_blocks(struct unit_test_state *uts)
+{
+	ut_assertok(lz4_check_blocks(uts, false));
+	ut_assertok(lz4_check_blocks(uts, true));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_blocks, 0);
+
+#ifdef CONFIG_UT_BENCH
+/**
+ * struct lz4_bench - Data used by the benchmark
+ *
+ * @comp: Compressed frame
+ * @comp_size: Size of @comp in bytes
+ * @buf: Buffer for the decompressed data, with room for the frame at the end
+ * @size: Size of the decompressed data in bytes
+ * @block_size: Size of each block in bytes
+ * @threads: Number of secondary CPUs to use
+ * @in_place: true to decompress a copy of the frame at the end of @buf
+ */
+struct lz4_bench {
+	const u8 *comp;
+	size_t comp_size;
+	u8 *buf;
+	size_t size;
+	size_t block_size;
+	int threads;
+	bool in_place;
+};
+
+static int lz4_bench_decomp(void *priv)
+{
+	struct lz4_bench *bench = priv;
+	const u8 *comp = bench->comp;
+	size_t out_size = bench->size;
+	int ret;
+
+	if (bench->in_place) {
+		comp = bench->buf + bench->size + bench->block_size -
+			bench->comp_size;
+		memcpy((u8 *)comp, bench->comp, bench->comp_size);
+	}
+	sandbox_set_worker_count(bench->threads);
+	ret = ulz4fn(comp, bench->comp_size, bench->buf, &out_size);
+	sandbox_set_worker_count(-1);
+
+	return ret;
+}
+
+/*
+ * Compare decompressing a frame with several blocks on one CPU, on several
+ * and in place, which always uses one CPU
+ */
+static int bench_test_lz4_blocks(struct unit_test_state *uts)
+{
+	struct lz4_bench bench;
+	char name[30];
+	u8 *data, *comp;
+	int linked, threads, i;
+
+	bench.block_size = SZ_64K;
+	bench.size = bench.block_size * LZ4_TEST_BLOCKS - 1000;
+	data = malloc(bench.size);
+	bench.buf = malloc(bench.size + bench.block_size);
+	comp = malloc(bench.block_size);
+	ut_assertnonnull(data);
+	ut_assertnonnull(bench.buf);
+	ut_assertnonnull(comp);
+	for (i = 0; i < bench.size; i++)
+		data[i] = i % LZ4_TEST_PERIOD;
+	bench.comp = comp;
+
+	for (linked = 0; linked < 2; linked++) {
+		const char *kind = linked ? "linked" : "indep";
+
+		bench.comp_size = lz4_make_frame(comp, data, bench.size,
+						 bench.block_size, linked);
+		bench.in_place = false;
+		for (threads = 0; threads <= 3; threads += 3) {
+			bench.threads = threads;
+			snprintf(name, sizeof(name), "lz4-%s-%dthreads", kind,
+				 threads);
+			ut_assertok(bench_run(name, lz4_bench_decomp, &bench,
+					      bench.size));
+		}
+		bench.in_place = true;
+		snprintf(name, sizeof(name), "lz4-%s-in-place", kind);
+		ut_assertok(bench_run(name, lz4_bench_decomp, &bench,
+				      bench.size));
+		ut_asserteq_mem(data, bench.buf, bench.size);
+	}
+
+	free(comp);
+	free(bench.buf);
+	free(data);
+
+	return 0;
+}
+BENCH_TEST(bench_test_lz4_blocks, 0);
+#endif
+
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -528,12 +1186,318 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/* Address used by the in-place tests, clear of the bootm tests above */
+#define INPLACE_LOAD		0x1000000
+
+/**
+ * inplace_check() - Decompress data in place and check the result
+ *
+ * @lmb:	Memory map to check against
+ * @comp_type:	Compression type to test
+ * @comp:	Compressed data
+ * @comp_size:	Size of compressed data
+ * @data:	Expected uncompressed data
+ * @size:	Size of uncompressed data
+ * @offset:	Offset of the compressed data from the load address
+ * @return 0 if OK, non-zero on failure
+ */
+static int inplace_check(struct unit_test_state *uts, struct lmb *lmb,
+			 int comp_type, const void *comp, ulong comp_size,
+			 const void *data, ulong size, long offset)
+{
+	ulong image_start = INPLACE_LOAD + offset;
+	ulong load_end;
+
+	memcpy(map_sysmem(image_start, comp_size), comp, comp_size);
+	ut_assertok(image_decomp_inplace(lmb, comp_type, INPLACE_LOAD,
+					 image_start, IH_TYPE_KERNEL,
+					 comp_size, &load_end));
+	ut_asserteq(INPLACE_LOAD + size, load_end);
+	ut_asserteq_mem(data, map_sysmem(INPLACE_LOAD, size), size);
+
+	return 0;
+}
+
+static int run_inplace_test(struct unit_test_state *uts, int comp_type,
+			    const void *comp, ulong comp_size)
+{
+	ulong size = strlen(plain);
+	ulong src, end, load_end, len;
+	struct lmb lmb;
+
+	printf("Testing: %s\n", genimg_get_comp_name(comp_type));
+	lmb_init(&lmb);
+	lmb_add(&lmb, 0, gd->ram_size);
+
+	/* At the load address, and overlapping it from either side */
+	ut_assertok(inplace_check(uts, &lmb, comp_type, comp, comp_size, plain,
+				  size, 0));
+	ut_assertok(inplace_check(uts, &lmb, comp_type, comp, comp_size, plain,
+				  size, -16));
+	ut_assertok(inplace_check(uts, &lmb, comp_type, comp, comp_size, plain,
+				  size, 16));
+
+	/* The data must stay put if part of the region is in use */
+	memcpy(map_sysmem(INPLACE_LOAD, comp_size), comp, comp_size);
+	ut_assertok(image_decomp_inplace_layout(comp_type, INPLACE_LOAD,
+						INPLACE_LOAD, comp_size, &src,
+						&end));
+	ut_assert(end - INPLACE_LOAD >= size);
+	ut_assert(src >= INPLACE_LOAD);
+	lmb_reserve(&lmb, end - 1, 1);
+	ut_asserteq(-EBUSY, image_decomp_inplace(&lmb, comp_type, INPLACE_LOAD,
+						 INPLACE_LOAD, IH_TYPE_KERNEL,
+						 comp_size, &load_end));
+	ut_asserteq_mem(comp, map_sysmem(INPLACE_LOAD, comp_size), comp_size);
+
+	/* The length can be found from the headers, as booti does */
+	memset(map_sysmem(INPLACE_LOAD + comp_size, SZ_4K), '\0', SZ_4K);
+	ut_assertok(image_decomp_get_len(comp_type, INPLACE_LOAD,
+					 comp_size + SZ_4K, &len));
+	ut_asserteq(comp_size, len);
+	ut_assert(image_decomp_get_len(comp_type, INPLACE_LOAD, comp_size - 1,
+				       &len));
+
+	return 0;
+}
+
+static int compression_test_inplace_lzo(struct unit_test_state *uts)
+{
+	return run_inplace_test(uts, IH_COMP_LZO, lzo_compressed,
+				lzo_compressed_size);
+}
+COMPRESSION_TEST(compression_test_inplace_lzo, 0);
+
+static int compression_test_inplace_lz4(struct unit_test_state *uts)
+{
+	return run_inplace_test(uts, IH_COMP_LZ4, lz4_compressed,
+				lz4_compressed_size);
+}
+COMPRESSION_TEST(compression_test_inplace_lz4, 0);
+
+static int compression_test_inplace_zstd(struct unit_test_state *uts)
+{
+	return run_inplace_test(uts, IH_COMP_ZSTD, zstd_compressed,
+				zstd_compressed_size);
+}
+COMPRESSION_TEST(compression_test_inplace_zstd, 0);
+
+/*
+ * Data which does not compress is the hardest case for in-place
+ * decompression, since the input is consumed no faster than the output is
+ * written. Build frames made of stored blocks to check the margins.
+ */
+static size_t lz4_make_stored_frame(u8 *out, const u8 *data, size_t size)
+{
+	u8 *p = out;
+	size_t pos;
+
+	put_unaligned_le32(LZ4F_MAGIC, p);
+	/* Independent 64KB blocks, no checksums */
+	p[4] = 0x60;
+	p[5] = 0x40;
+	p[6] = IS_ENABLED(CONFIG_XXHASH) ? xxh32(p + 4, 2, 0) >> 8 : 0;
+	p += 7;
+	for (pos = 0; pos < size; pos += SZ_64K) {
+		size_t len = min_t(size_t, SZ_64K, size - pos);
+
+		put_unaligned_le32(len | 0x80000000, p);
+		memcpy(p + 4, data + pos, len);
+		p += 4 + len;
+	}
+	put_unaligned_le32(0, p);
+
+	return p + 4 - out;
+}
+
+static size_t zstd_make_stored_frame(u8 *out, const u8 *data, size_t size)
+{
+	u8 *p = out;
+	size_t pos;
+
+	put_unaligned_le32(ZSTD_MAGICNUMBER, p);
+	/* Single segment, 8-byte content size */
+	p[4] = 0xe0;
+	put_unaligned_le64(size, p + 5);
+	p += 13;
+	for (pos = 0; pos < size; pos += SZ_128K) {
+		size_t len = min_t(size_t, SZ_128K, size - pos);
+		u32 hdr = len << 3 | (pos + len == size);
+
+		/* Raw block, with the last-block flag in bit 0 */
+		put_unaligned_le16(hdr, p);
+		p[2] = hdr >> 16;
+		memcpy(p + 3, data + pos, len);
+		p += 3 + len;
+	}
+
+	return p - out;
+}
+
+static int compression_test_inplace_stored(struct unit_test_state *uts)
+{
+	size_t size = SZ_1M - 1000, comp_size;
+	struct lmb lmb;
+	u8 *data, *comp;
+	u32 seed = 1;
+	int i;
+
+	data = malloc(size);
+	comp = malloc(size + SZ_4K);
+	ut_assertnonnull(data);
+	ut_assertnonnull(comp);
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 16;
+	}
+	lmb_init(&lmb);
+	lmb_add(&lmb, 0, gd->ram_size);
+
+	if (IS_ENABLED(CONFIG_LZ4)) {
+		comp_size = lz4_make_stored_frame(comp, data, size);
+		ut_assertok(inplace_check(uts, &lmb, IH_COMP_LZ4, comp,
+					  comp_size, data, size, 0));
+	}
+	if (IS_ENABLED(CONFIG_ZSTD)) {
+		comp_size = zstd_make_stored_frame(comp, data, size);
+		ut_assertok(inplace_check(uts, &lmb, IH_COMP_ZSTD, comp,
+					  comp_size, data, size, 0));
+	}
+	free(comp);
+	free(data);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_inplace_stored, 0);
+
+/* Number of bits in the hash of four bytes used to find LZ4 matches */
+#define LZ4_HASH_BITS		12
+
+/*
+ * Compress a block greedily, looking for a match for each position in a
+ * table of the last position with the same hash. As the format requires,
+ * the last match starts at least 12 bytes before the end of the block and
+ * the last 5 bytes are literals.
+ */
+static size_t lz4_compress_block(u8 *out, const u8 *in, size_t len,
+				 u32 *table)
+{
+	const u8 *ip = in, *anchor = in, *end = in + len;
+	u8 *op = out;
+
+	memset(table, '\0', sizeof(*table) << LZ4_HASH_BITS);
+	while (len > 12 && ip < end - 12) {
+		u32 seq = get_unaligned_le32(ip);
+		u32 hash = seq * 2654435761U >> (32 - LZ4_HASH_BITS);
+		const u8 *ref = in + table[hash] - 1;
+		size_t match_len;
+
+		table[hash] = ip - in + 1;
+		if (ref < in || ip - ref > 0xffff ||
+		    get_unaligned_le32(ref) != seq) {
+			ip++;
+			continue;
+		}
+		for (match_len = 4; ip + match_len < end - 5 &&
+		     ref[match_len] == ip[match_len]; match_len++)
+			;
+		op = lz4_put_seq(op, anchor, ip - anchor, match_len, ip - ref);
+		ip += match_len;
+		anchor = ip;
+	}
+
+	return lz4_put_seq(op, anchor, end - anchor, 0, 0) - out;
+}
+
+/* Build a frame of independent 256KB blocks, recording the content size */
+static size_t lz4_compress_frame(u8 *out, const u8 *data, size_t size,
+				 u32 *table)
+{
+	u8 *p = out;
+	size_t pos;
+
+	put_unaligned_le32(LZ4F_MAGIC, p);
+	p[4] = 0x68;
+	p[5] = 0x50;
+	put_unaligned_le64(size, p + 6);
+	p[14] = IS_ENABLED(CONFIG_XXHASH) ? xxh32(p + 4, 10, 0) >> 8 : 0;
+	p += 15;
+	for (pos = 0; pos < size; pos += SZ_256K) {
+		size_t len = min_t(size_t, SZ_256K, size - pos);
+		size_t blk_len;
+
+		blk_len = lz4_compress_block(p + 4, data + pos, len, table);
+		if (blk_len >= len) {
+			memcpy(p + 4, data + pos, len);
+			blk_len = len | 0x80000000;
+		}
+		put_unaligned_le32(blk_len, p);
+		p += 4 + (blk_len & ~0x80000000);
+	}
+	put_unaligned_le32(0, p);
+
+	return p + 4 - out;
+}
+
+/*
+ * Decompress a multi-megabyte LZ4 stream of kernel-like data in place, with
+ * most of the compressed data inside the region being written
+ */
+static int compression_test_inplace_large(struct unit_test_state *uts)
+{
+	const size_t size = 6 << 20;
+	size_t comp_size;
+	ulong src, end, len;
+	struct lmb lmb;
+	u8 *data, *comp;
+	u32 *table;
+
+	if (!IS_ENABLED(CONFIG_LZ4))
+		return 0;
+	data = malloc(size);
+	comp = malloc(size + SZ_64K);
+	table = malloc(sizeof(*table) << LZ4_HASH_BITS);
+	ut_assertnonnull(data);
+	ut_assertnonnull(comp);
+	ut_assertnonnull(table);
+	gzip_make_data(data, size);
+	comp_size = lz4_compress_frame(comp, data, size, table);
+	ut_assert(comp_size > SZ_1M);
+	ut_assert(comp_size < size);
+
+	memcpy(map_sysmem(INPLACE_LOAD, comp_size), comp, comp_size);
+	ut_assertok(image_decomp_get_len(IH_COMP_LZ4, INPLACE_LOAD, size,
+					 &len));
+	ut_asserteq(comp_size, len);
+	ut_assertok(image_decomp_inplace_layout(IH_COMP_LZ4, INPLACE_LOAD,
+						INPLACE_LOAD, comp_size, &src,
+						&end));
+	ut_assert(src < INPLACE_LOAD + size);
+
+	lmb_init(&lmb);
+	lmb_add(&lmb, 0, gd->ram_size);
+	ut_assertok(inplace_check(uts, &lmb, IH_COMP_LZ4, comp, comp_size,
+				  data, size, 0));
+	free(table);
+	free(comp);
+	free(data);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_inplace_large, 0);
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -737,6 +738,26 @@ static int dm_test_uclass_before_ready(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass_before_ready, 0);
 
+/* Check that uclass_find() tracks uclasses as they come and go */
+static int dm_test_uclass_find(struct unit_test_state *uts)
+{
+	struct uclass *uc, *found;
+
+	ut_asserteq_ptr(NULL, uclass_find(UCLASS_COUNT));
+	ut_asserteq_ptr(NULL, uclass_find(UCLASS_INVALID));
+
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	ut_asserteq_ptr(uc, uclass_find(UCLASS_TEST));
+	list_for_each_entry(found, &gd->uclass_root, sibling_node)
+		ut_asserteq_ptr(found, uclass_find(found->uc_drv->id));
+
+	ut_assertok(uclass_destroy(uc));
+	ut_asserteq_ptr(NULL, uclass_find(UCLASS_TEST));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_find, DM_TESTF_SCAN_PDATA);
+
 static int dm_test_uclass_devices_find(struct unit_test_state *uts)
 {
 	struct udevice *dev;
@@ -904,3 +925,245 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+/* Driver data flag telling the async test driver to fail its probe */
+#define ASYNC_TEST_FAIL		0x100
+
+struct async_test_priv {
+	int polls;
+};
+
+/* Probe which takes (driver data & 0xff) polls of probe_finish() */
+static int async_test_probe(struct udevice *dev)
+{
+	struct async_test_priv *priv = dev_get_priv(dev);
+
+	priv->polls = dev_get_driver_data(dev) & 0xff;
+
+	return priv->polls ? -EINPROGRESS : 0;
+}
+
+static int async_test_probe_finish(struct udevice *dev)
+{
+	struct async_test_priv *priv = dev_get_priv(dev);
+
+	if (--priv->polls > 0)
+		return -EINPROGRESS;
+
+	return dev_get_driver_data(dev) & ASYNC_TEST_FAIL ? -EIO : 0;
+}
+
+U_BOOT_DRIVER(async_test_drv) = {
+	.name	= "async_test_drv",
+	.id	= UCLASS_TEST_DUMMY,
+	.probe	= async_test_probe,
+	.probe_finish	= async_test_probe_finish,
+	.priv_auto_alloc_size	= sizeof(struct async_test_priv),
+};
+
+/* Test probing devices which complete their probe later */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	const struct driver *drv = lists_driver_lookup_name("async_test_drv");
+	struct udevice *dev1, *dev2, *dev3, *dev4, *dev5;
+
+	ut_assertok(device_bind_with_driver_data(dm_root(), drv, "async1", 3,
+						 ofnode_null(), &dev1));
+	ut_assertok(device_bind_with_driver_data(dev1, drv, "async2", 2,
+						 ofnode_null(), &dev2));
+	ut_assertok(device_bind_with_driver_data(dm_root(), drv, "async3", 0,
+						 ofnode_null(), &dev3));
+	ut_assertok(device_bind_with_driver_data(dm_root(), drv, "async4",
+						 2 | ASYNC_TEST_FAIL,
+						 ofnode_null(), &dev4));
+	ut_assertok(device_bind_with_driver_data(dev1, drv, "async5", 1,
+						 ofnode_null(), &dev5));
+
+	/* dev2 must wait for its parent; dev3 completes immediately */
+	ut_assertok(dm_probe_async_start());
+	ut_asserteq(-EALREADY, dm_probe_async_start());
+	ut_assert(dev1->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(!device_active(dev1));
+	ut_assert(!device_active(dev2));
+	ut_assert(device_active(dev3));
+	ut_assert(!(dev3->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(dev4->flags & DM_FLAG_PROBE_PENDING);
+
+	/* A waiting device which is unbound is dropped from the list */
+	ut_assertok(device_unbind(dev5));
+	ut_asserteq(3, dm_probe_async_poll());
+
+	/* dev4 fails while someone else waits for it, and is left inactive */
+	ut_asserteq(-EIO, device_probe(dev4));
+	ut_assert(!device_active(dev4));
+	ut_assert(!(dev4->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(2, dm_probe_async_poll());
+
+	/* dev1 completes, so dev2 is started */
+	ut_asserteq(1, dm_probe_async_poll());
+	ut_assert(device_active(dev1));
+	ut_assert(!(dev1->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(dev2->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(!device_active(dev2));
+	ut_asserteq(-EINVAL, device_unbind(dev2));
+
+	/* Probing a pending device waits for it */
+	ut_assertok(device_probe(dev2));
+	ut_assert(!(dev2->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(0, dm_probe_async_poll());
+
+	/* The failure of dev4 is still reported */
+	ut_asserteq(-EIO, dm_probe_async_finish());
+
+	/* Without the scheduler, device_probe() waits for the probe */
+	ut_assertok(device_remove(dev1, DM_REMOVE_NORMAL));
+	ut_assertok(device_probe(dev1));
+	ut_assert(!(dev1->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(-EIO, device_probe(dev4));
+	ut_assert(!device_active(dev4));
+
+	/* A pending probe is completed before the device is removed */
+	ut_assertok(device_remove(dev1, DM_REMOVE_NORMAL));
+	ut_asserteq(-EINPROGRESS, device_probe_start(dev1));
+	ut_assertok(device_remove(dev1, DM_REMOVE_NORMAL));
+	ut_assert(!device_active(dev1));
+	ut_assert(!(dev1->flags & DM_FLAG_PROBE_PENDING));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, DM_TESTF_SCAN_PDATA);
+#endif
+
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+/* Find the driver for @compat by checking each driver in turn */
+static int compat_lookup_linear(const char *compat, struct driver **drvp,
+				const struct udevice_id **of_idp)
+{
+	struct driver *drivers = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *drv;
+
+	for (drv = drivers; drv != drivers + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*drvp = drv;
+				*of_idp = id;
+				return 0;
+			}
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* Test that looking up compatible strings finds the same driver as a scan */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *drivers = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	static const char *const unknown[] = {
+		"", "0", "denx,u-boot-fdt-tes", "denx,u-boot-fdt-test-",
+		"google,another-fdt-test ", "zzzz,no-such-device",
+	};
+	const struct udevice_id *id, *found_id, *expect_id;
+	struct driver *drv, *found, *expect;
+	int multi = 0;
+	int i;
+
+	for (drv = drivers; drv != drivers + n_ents; drv++) {
+		if (drv->of_match && drv->of_match[0].compatible &&
+		    drv->of_match[1].compatible)
+			multi++;
+		for (id = drv->of_match; id && id->compatible; id++) {
+			const char *compat = id->compatible;
+
+			ut_assertok(lists_driver_lookup_compatible(compat,
+								   &found,
+								   &found_id));
+			ut_assertok(compat_lookup_linear(compat, &expect,
+							 &expect_id));
+			ut_asserteq_ptr(expect, found);
+			ut_asserteq_ptr(expect_id, found_id);
+		}
+	}
+
+	/* Some drivers have more than one compatible string */
+	ut_assert(multi > 0);
+
+	for (i = 0; i < ARRAY_SIZE(unknown); i++) {
+		ut_asserteq(-ENOENT,
+			    lists_driver_lookup_compatible(unknown[i], &found,
+							   &found_id));
+		ut_asserteq(-ENOENT, compat_lookup_linear(unknown[i], &expect,
+							  &expect_id));
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
+/*
+ * Bind a new node with the given compatible strings, returning the driver
+ * and driver data it was bound with, or NULL if nothing was bound
+ */
+static int compat_bind_node(struct unit_test_state *uts, void *blob,
+			    const char *compat, int len,
+			    const struct driver **drvp, ulong *datap)
+{
+	struct udevice *dev;
+	int node;
+
+	node = fdt_add_subnode(blob, 0, "compat-test");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop(blob, node, "compatible", compat, len));
+	ut_assertok(lists_bind_fdt(dm_root(), offset_to_ofnode(node), &dev,
+				   false));
+	*drvp = NULL;
+	if (dev) {
+		*drvp = dev->driver;
+		*datap = dev->driver_data;
+		ut_assertok(device_unbind(dev));
+	}
+	ut_assertok(fdt_del_node(blob, node));
+
+	return 0;
+}
+
+/* Test that nodes bind to the driver for their first known compatible */
+static int dm_test_lists_bind_compat(struct unit_test_state *uts)
+{
+	static const char multi[] = "u-boot,no-such-device\0"
+		"google,another-fdt-test\0denx,u-boot-fdt-test";
+	static const char none[] = "u-boot,no-such-device\0zzzz,none";
+	const void *blob = gd->fdt_blob;
+	int size = fdt_totalsize(blob) + 0x1000;
+	const struct driver *multi_drv, *none_drv;
+	ulong data = 0;
+	void *copy;
+	int ret;
+
+	copy = malloc(size);
+	ut_assertnonnull(copy);
+	ut_assertok(fdt_open_into(blob, copy, size));
+
+	/* The nodes are offsets into the copy, so it must be the control DT */
+	gd->fdt_blob = copy;
+	ret = compat_bind_node(uts, copy, multi, sizeof(multi), &multi_drv,
+			       &data);
+	if (!ret)
+		ret = compat_bind_node(uts, copy, none, sizeof(none), &none_drv,
+				       &data);
+	gd->fdt_blob = blob;
+	free(copy);
+	ut_assertok(ret);
+
+	ut_asserteq_ptr(lists_driver_lookup_name("testfdt_drv"), multi_drv);
+	ut_asserteq(DM_TEST_TYPE_SECOND, data);
+	ut_assertnull(none_drv);
+
+	return 0;
+}
+DM_TEST(dm_test_lists_bind_compat, DM_TESTF_FLAT_TREE);
+#endif
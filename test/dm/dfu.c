@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing to DFU entities
+ */
+
+#include <common.h>
+#include <dfu.h>
+#include <dm.h>
+#include <env.h>
+#include <malloc.h>
+#include <spi.h>
+#include <spi_flash.h>
+#include <asm/state.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <linux/sizes.h>
+#include <test/ut.h>
+
+/* Size of the USB transfers, as used by dfu-util */
+#define DFU_TEST_BLK	SZ_4K
+
+/* Size of the image, not a whole number of blocks or sectors */
+#define DFU_TEST_LEN	(SZ_256K + 100)
+
+/*
+ * Write an image to @dfu in the way run_usb_dnl_gadget() does, with the
+ * medium written from the main loop
+ */
+static int dfu_test_download(struct unit_test_state *uts,
+			     struct dfu_entity *dfu, u8 *data, int len)
+{
+	int seq, size;
+
+	dfu_set_write_deferred(true);
+	for (seq = 0; len > 0; seq++) {
+		size = min(len, DFU_TEST_BLK);
+		ut_assertok(dfu_write(dfu, data, size, seq));
+		ut_assertok(dfu_write_pending());
+		data += size;
+		len -= size;
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, seq));
+	dfu_set_write_deferred(false);
+
+	return 0;
+}
+
+static u8 *dfu_test_image(void)
+{
+	u8 *data;
+	int i;
+
+	data = malloc(DFU_TEST_LEN);
+	if (!data)
+		return NULL;
+	for (i = 0; i < DFU_TEST_LEN; i++)
+		data[i] = i * 7 + (i >> 12);
+
+	return data;
+}
+
+/* Test downloading to RAM, where the buffer is split into two halves */
+static int dm_test_dfu_ram(struct unit_test_state *uts)
+{
+	char alt_info[40];
+	struct dfu_entity *dfu;
+	u8 *data, *mem;
+
+	data = dfu_test_image();
+	ut_assertnonnull(data);
+	mem = calloc(1, DFU_TEST_LEN + 1);
+	ut_assertnonnull(mem);
+
+	ut_assertok(env_set("dfu_bufsiz", "0x10000"));
+	snprintf(alt_info, sizeof(alt_info), "img ram %lx %x",
+		 (ulong)mem, DFU_TEST_LEN);
+	ut_assertok(dfu_config_entities(alt_info, "ram", "0"));
+	dfu = dfu_get_entity(0);
+	ut_assertnonnull(dfu);
+
+	ut_assertok(dfu_test_download(uts, dfu, data, DFU_TEST_LEN));
+	ut_assertok(memcmp(data, mem, DFU_TEST_LEN));
+	ut_asserteq(0, mem[DFU_TEST_LEN]);
+
+	dfu_free_entities();
+	ut_assertok(env_set("dfu_bufsiz", NULL));
+	free(mem);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_dfu_ram, 0);
+
+/*
+ * Test downloading to SPI flash, which erases a sector on each write. The
+ * buffer holds a single sector, so it must not be split. This uses the
+ * backing file of the flash in the device tree, spi.bin.
+ */
+static int dm_test_dfu_sf(struct unit_test_state *uts)
+{
+	char alt_info[] = "img raw 0 80000";
+	struct spi_flash *flash;
+	struct dfu_entity *dfu;
+	u8 *data, *readback;
+
+	data = dfu_test_image();
+	ut_assertnonnull(data);
+	readback = malloc(SZ_512K);
+	ut_assertnonnull(readback);
+
+	/* Start with a partition full of something other than the image */
+	flash = spi_flash_probe(0, 0, CONFIG_SF_DEFAULT_SPEED,
+				CONFIG_SF_DEFAULT_MODE);
+	ut_assertnonnull(flash);
+	memset(readback, 0x5a, SZ_512K);
+	ut_assertok(spi_flash_erase(flash, 0, SZ_512K));
+	ut_assertok(spi_flash_write(flash, 0, SZ_512K, readback));
+	spi_flash_free(flash);
+
+	ut_assertok(dfu_config_entities(alt_info, "sf", "0:0"));
+	dfu = dfu_get_entity(0);
+	ut_assertnonnull(dfu);
+	ut_assertok(dfu_test_download(uts, dfu, data, DFU_TEST_LEN));
+	dfu_free_entities();
+
+	flash = spi_flash_probe(0, 0, CONFIG_SF_DEFAULT_SPEED,
+				CONFIG_SF_DEFAULT_MODE);
+	ut_assertnonnull(flash);
+	ut_assertok(spi_flash_read(flash, 0, DFU_TEST_LEN, readback));
+	ut_assertok(memcmp(data, readback, DFU_TEST_LEN));
+	spi_flash_free(flash);
+
+	/* Forget the emulation device, as the devices are about to go */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+	free(readback);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_dfu_sf, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -2,6 +2,7 @@
 
 #include <common.h>
 #include <dm.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
@@ -113,3 +114,40 @@ static int dm_test_ofnode_read_chosen(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_read_chosen, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that each live-tree node has the properties of the flat tree */
+static int dm_test_ofnode_live_props(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	struct device_node *np;
+	int count = 0;
+
+	if (!of_live_active())
+		return 0;
+
+	for_each_of_allnodes(np) {
+		int node = fdt_path_offset(blob, np->full_name);
+		int prop;
+
+		ut_assert(node >= 0);
+		ut_asserteq(fdt_get_phandle(blob, node), np->phandle);
+		fdt_for_each_property_offset(prop, blob, node) {
+			const struct property *pp;
+			const char *name;
+			const void *val;
+			int len;
+
+			val = fdt_getprop_by_offset(blob, prop, &name, &len);
+			pp = of_find_property(np, name, NULL);
+			ut_assertnonnull(pp);
+			ut_asserteq(len, pp->length);
+			ut_assertok(memcmp(val, pp->value, len));
+		}
+		ut_assertnonnull(of_find_property(np, "name", NULL));
+		count++;
+	}
+	ut_assert(count > 1);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_live_props, DM_TESTF_SCAN_FDT);
@@ -953,3 +953,93 @@ static int dm_test_first_child_probe(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_first_child_probe, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that lookups through fdtdec agree with libfdt for every node */
+static int check_fdt_lookups(struct unit_test_state *uts, const void *blob)
+{
+	int node, depth, prop, aliases;
+
+	for (node = 0, depth = 0; node >= 0 && depth >= 0;
+	     node = fdt_next_node(blob, node, &depth)) {
+		u32 phandle = fdt_get_phandle(blob, node);
+
+		ut_asserteq(fdt_parent_offset(blob, node),
+			    fdtdec_parent_offset(blob, node));
+		if (!phandle)
+			continue;
+		ut_asserteq(node, fdtdec_node_offset_by_phandle(blob, phandle));
+	}
+
+	aliases = fdt_path_offset(blob, "/aliases");
+	ut_assert(aliases > 0);
+	fdt_for_each_property_offset(prop, blob, aliases) {
+		const char *name;
+
+		fdt_getprop_by_offset(blob, prop, &name, NULL);
+		ut_asserteq(fdt_path_offset(blob, name),
+			    fdtdec_path_offset(blob, name));
+	}
+	ut_asserteq(-FDT_ERR_BADPATH, fdtdec_path_offset(blob, "no-alias"));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(blob, 0x7fffffff));
+
+	return 0;
+}
+
+/* Change @copy, which is the control DT, and check the lookups each time */
+static int check_fdt_lookup_changes(struct unit_test_state *uts, void *copy)
+{
+	int node, i;
+
+	ut_assertok(check_fdt_lookups(uts, copy));
+
+	/* Adding a node moves everything after it */
+	node = fdt_add_subnode(copy, 0, "aaa-new-node");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop_u32(copy, node, "phandle", 0x7ffffffe));
+	ut_asserteq(node, fdtdec_node_offset_by_phandle(copy, 0x7ffffffe));
+	ut_assertok(check_fdt_lookups(uts, copy));
+
+	/* Changing a phandle in place leaves the size alone */
+	ut_assertok(fdtdec_set_phandle(copy, node, 0x7ffffffd));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(copy, 0x7ffffffe));
+	ut_assertok(check_fdt_lookups(uts, copy));
+
+	/* A tree too deep to index still works, without the index */
+	for (i = 0; i <= FDT_MAX_DEPTH; i++) {
+		node = fdt_add_subnode(copy, node, "deep");
+		ut_assert(node > 0);
+	}
+	ut_assertok(check_fdt_lookups(uts, copy));
+	ut_assertok(check_fdt_lookups(uts, copy));
+
+	return 0;
+}
+
+/* Test looking up nodes by phandle, alias and parent */
+static int dm_test_fdt_lookup_index(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	int size = fdt_totalsize(blob) + 0x1000;
+	void *copy;
+	int ret;
+
+	ut_assertok(check_fdt_lookups(uts, blob));
+
+	copy = malloc(size);
+	ut_assertnonnull(copy);
+	ut_assertok(fdt_open_into(blob, copy, size));
+
+	/* Put the original back whatever happens, for the tests which follow */
+	gd->fdt_blob = copy;
+	ret = check_fdt_lookup_changes(uts, copy);
+	gd->fdt_blob = blob;
+	free(copy);
+	ut_assertok(ret);
+
+	ut_assertok(check_fdt_lookups(uts, blob));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lookup_index, 0);
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the binary environment format
+ *
+ * Importing a binary environment must give the same hash table as importing
+ * the text it was converted from. The time taken by each is measured by
+ * 'ut bench env'.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_bin.h>
+#include <env_internal.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define TEST_VARS	500
+
+/* Build a text environment with a few escapes and deletions */
+static int env_bin_make_text(struct unit_test_state *uts, char *buf,
+			     int size)
+{
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < TEST_VARS; i++) {
+		p += snprintf(p, buf + size - p, "var%d=value %d of %d", i, i,
+			      TEST_VARS) + 1;
+		ut_assert(p < buf + size);
+	}
+	p += snprintf(p, buf + size - p, "escaped=a\\\\b\\c") + 1;
+	p += snprintf(p, buf + size - p, "  blank=leading") + 1;
+	p += snprintf(p, buf + size - p, "var1") + 1;
+	p += snprintf(p, buf + size - p, "var2=") + 1;
+	*p++ = '\0';
+	ut_assert(p < buf + size);
+
+	return p - buf;
+}
+
+/* Check that two tables hold the same variables */
+static int env_bin_check_same(struct unit_test_state *uts,
+			      struct hsearch_data *htab1,
+			      struct hsearch_data *htab2)
+{
+	struct env_entry item, *ritem1, *ritem2;
+	char key[20];
+	int i;
+
+	ut_asserteq(htab1->filled, htab2->filled);
+	for (i = 0; i < TEST_VARS; i++) {
+		snprintf(key, sizeof(key), "var%d", i);
+		item.key = key;
+		item.data = NULL;
+		hsearch_r(item, ENV_FIND, &ritem1, htab1, 0);
+		hsearch_r(item, ENV_FIND, &ritem2, htab2, 0);
+		if (!ritem1) {
+			ut_assertnull(ritem2);
+			continue;
+		}
+		ut_assertnonnull(ritem2);
+		ut_asserteq_str(ritem1->data, ritem2->data);
+	}
+
+	return 0;
+}
+
+static int env_test_bin_import(struct unit_test_state *uts)
+{
+	struct hsearch_data htab1, htab2;
+	struct env_entry item, *ritem;
+	struct env_bin_hdr *hdr;
+	char *text, *bin;
+	ssize_t len;
+	int size;
+
+	text = malloc(TEST_VARS * 32);
+	ut_assertnonnull(text);
+	size = env_bin_make_text(uts, text, TEST_VARS * 32);
+	ut_assert(size > 0);
+
+	len = htext_to_bin(text, size, '\0', &bin);
+	ut_assert(len > sizeof(*hdr));
+	ut_asserteq(1, hbin_detect(bin, len));
+	ut_asserteq(0, hbin_detect(text, size));
+
+	memset(&htab1, '\0', sizeof(htab1));
+	memset(&htab2, '\0', sizeof(htab2));
+	ut_asserteq(1, himport_r(&htab1, text, size, '\0', 0, 0, 0, NULL));
+	ut_asserteq(1, himport_bin_r(&htab2, bin, len, 0, 0, NULL));
+
+	ut_assertok(env_bin_check_same(uts, &htab1, &htab2));
+	ut_asserteq(TEST_VARS, htab2.filled);
+
+	item.data = NULL;
+	item.key = "escaped";
+	hsearch_r(item, ENV_FIND, &ritem, &htab2, 0);
+	ut_assertnonnull(ritem);
+	ut_asserteq_str("a\\bc", ritem->data);
+	item.key = "blank";
+	hsearch_r(item, ENV_FIND, &ritem, &htab2, 0);
+	ut_assertnonnull(ritem);
+	ut_asserteq_str("leading", ritem->data);
+
+	/* Importing only some variables, without clearing the table */
+	hdestroy_r(&htab1);
+	memset(&htab1, '\0', sizeof(htab1));
+	ut_asserteq(1, hcreate_r(TEST_VARS * 2, &htab1));
+	ut_asserteq(1, himport_bin_r(&htab1, bin, len, H_NOCLEAR, 1,
+				     (char * const[]){ "var3" }));
+	ut_asserteq(1, htab1.filled);
+
+	/* A bad CRC or version is rejected */
+	hdr = (struct env_bin_hdr *)bin;
+	bin[len - 1] ^= 1;
+	ut_asserteq(0, himport_bin_r(&htab1, bin, len, 0, 0, NULL));
+	bin[len - 1] ^= 1;
+	hdr->version++;
+	ut_asserteq(0, himport_bin_r(&htab1, bin, len, 0, 0, NULL));
+	hdr->version--;
+
+	hdestroy_r(&htab2);
+	hdestroy_r(&htab1);
+	free(bin);
+	free(text);
+
+	return 0;
+}
+ENV_TEST(env_test_bin_import, 0);
+
+/* Export and import again, which must give the same table */
+static int env_test_bin_export(struct unit_test_state *uts)
+{
+	struct hsearch_data htab1, htab2;
+	char *text, *bin = NULL;
+	ssize_t len;
+	int size;
+
+	text = malloc(TEST_VARS * 32);
+	ut_assertnonnull(text);
+	size = env_bin_make_text(uts, text, TEST_VARS * 32);
+
+	memset(&htab1, '\0', sizeof(htab1));
+	memset(&htab2, '\0', sizeof(htab2));
+	ut_asserteq(1, himport_r(&htab1, text, size, '\0', 0, 0, 0, NULL));
+	len = hexport_bin_r(&htab1, 0, &bin, 0);
+	ut_assert(len > 0);
+	ut_asserteq(1, himport_bin_r(&htab2, bin, len, 0, 0, NULL));
+	ut_assertok(env_bin_check_same(uts, &htab1, &htab2));
+
+	hdestroy_r(&htab2);
+	hdestroy_r(&htab1);
+	free(bin);
+	free(text);
+
+	return 0;
+}
+ENV_TEST(env_test_bin_export, 0);
+
+/* Saving falls back to text when the binary form does not fit */
+static int env_test_bin_save_text(struct unit_test_state *uts)
+{
+	char *text = NULL, *value;
+	env_t *env;
+	ssize_t len;
+	int size;
+
+	env = malloc(sizeof(*env));
+	ut_assertnonnull(env);
+	ut_assertok(env_export(env));
+	ut_asserteq(1, hbin_detect((char *)env->data, ENV_SIZE));
+
+	/* Fill the environment so that only the text form fits */
+	len = hexport_r(&env_htab, '\0', 0, &text, 0, 0, NULL);
+	ut_assert(len > 0);
+	free(text);
+	size = ENV_SIZE - len - 0x20;
+	ut_assert(size > 0);
+	value = malloc(size + 1);
+	ut_assertnonnull(value);
+	memset(value, 'x', size);
+	value[size] = '\0';
+	ut_assertok(env_set("bin_test_big", value));
+
+	ut_assertok(env_export(env));
+	ut_asserteq(0, hbin_detect((char *)env->data, ENV_SIZE));
+	ut_assertok(env_set("bin_test_big", NULL));
+	ut_assertok(env_import((char *)env, 1));
+	ut_asserteq_str(value, env_get("bin_test_big"));
+	ut_assertok(env_set("bin_test_big", NULL));
+
+	free(value);
+	free(env);
+
+	return 0;
+}
+ENV_TEST(env_test_bin_save_text, 0);
+
+/*
+ * Look up variables with env_get_f() in the stored environment @data. Only
+ * the binary format can hold a deleted variable.
+ */
+static int env_bin_check_get_f(struct unit_test_state *uts, u8 *data,
+			       bool bin)
+{
+	char buf[16];
+
+	gd->env_addr = (ulong)data;
+	gd->env_valid = ENV_VALID;
+	ut_asserteq(5, env_get_f("name", buf, sizeof(buf)));
+	ut_asserteq_str("value", buf);
+	ut_asserteq(3, env_get_f("last", buf, sizeof(buf)));
+	ut_asserteq_str("end", buf);
+	if (bin)
+		ut_asserteq(-1, env_get_f("gone", buf, sizeof(buf)));
+	ut_asserteq(-1, env_get_f("nam", buf, sizeof(buf)));
+	ut_asserteq(-1, env_get_f("names", buf, sizeof(buf)));
+
+	return 0;
+}
+
+/* A stored environment can be read before relocation in either format */
+static int env_test_bin_get_f(struct unit_test_state *uts)
+{
+	static const char text[] =
+		"first=1\0name=value\0gone=x\0gone\0last=end\0";
+	ulong env_addr = gd->env_addr;
+	int env_valid = gd->env_valid;
+	env_t *env;
+	char *bin;
+	ssize_t len;
+	int ret;
+
+	len = htext_to_bin(text, sizeof(text), '\0', &bin);
+	ut_assert(len > 0 && len <= ENV_SIZE);
+	env = calloc(1, sizeof(*env));
+	ut_assertnonnull(env);
+
+	memcpy(env->data, bin, len);
+	ret = env_bin_check_get_f(uts, env->data, true);
+	if (!ret) {
+		memcpy(env->data, text, sizeof(text));
+		ret = env_bin_check_get_f(uts, env->data, false);
+	}
+	gd->env_addr = env_addr;
+	gd->env_valid = env_valid;
+	free(env);
+	free(bin);
+	ut_assertok(ret);
+
+	return 0;
+}
+ENV_TEST(env_test_bin_get_f, 0);
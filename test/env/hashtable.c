@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <malloc.h>
 #include <search.h>
 #include <stdio.h>
 #include <test/env.h>
@@ -123,3 +124,70 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Check that an exported table is sorted and has the expected size */
+static int htab_check_export(struct unit_test_state *uts,
+			     struct hsearch_data *htab, size_t size)
+{
+	char *res = NULL, *p, *prev = NULL;
+	size_t n = 0;
+
+	ut_assert(hexport_r(htab, '\n', 0, &res, 0, 0, NULL) > 0);
+	for (p = strtok(res, "\n"); p; p = strtok(NULL, "\n")) {
+		*strchr(p, '=') = '\0';
+		if (prev)
+			ut_assert(strcmp(prev, p) < 0);
+		prev = p;
+		n++;
+	}
+	ut_asserteq(size, n);
+	free(res);
+
+	return 0;
+}
+
+/* Fill the hashtable beyond its initial size, so that it must grow */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 8));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 8));
+	ut_asserteq(SIZE * 8, htab.filled);
+	ut_assert(htab.size > SIZE * 8);
+	ut_assertok(htab_check_export(uts, &htab, SIZE * 8));
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/*
+ * Deleted slots must be reclaimed, and the sorted order must be kept up to
+ * date as entries are added and deleted
+ */
+static int env_test_htab_compact(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE / 2));
+	ut_assertok(htab_check_export(uts, &htab, SIZE / 2));
+	ut_assertok(htab_create_delete(uts, &htab, ITERATIONS));
+	ut_assert((htab.filled + htab.deleted) * 4 <= htab.size * 3);
+	ut_assertok(htab_check_fill(uts, &htab, SIZE / 2));
+	ut_assertok(htab_check_export(uts, &htab, SIZE / 2));
+	ut_asserteq(1, hdelete_r("3", &htab, 0));
+	ut_assertok(htab_check_export(uts, &htab, SIZE / 2 - 1));
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_compact, 0);
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for bootstage
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <malloc.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Size of the device tree used to hold the report */
+#define BOOTSTAGE_TEST_FDT_SIZE	SZ_16K
+
+/*
+ * Add the bootstage report to an empty device tree and read back the
+ * "bytes" property of the copy_ramdisk record, or 0 if there is none
+ */
+static int bootstage_test_fdt_bytes(struct unit_test_state *uts, ulong *bytesp)
+{
+	struct fdt_header *old_fdt = working_fdt;
+	int parent, node;
+	void *blob;
+
+	blob = malloc(BOOTSTAGE_TEST_FDT_SIZE);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_create_empty_tree(blob, BOOTSTAGE_TEST_FDT_SIZE));
+	working_fdt = blob;
+	bootstage_fdt_add_report();
+	working_fdt = old_fdt;
+
+	parent = fdt_subnode_offset(blob, 0, "bootstage");
+	ut_assert(parent >= 0);
+	*bytesp = 0;
+	fdt_for_each_subnode(node, blob, parent) {
+		const char *name = fdt_getprop(blob, node, "name", NULL);
+		const fdt32_t *bytes;
+
+		if (name && !strcmp(name, "copy_ramdisk")) {
+			ut_assertnonnull(fdt_getprop(blob, node, "accum",
+						     NULL));
+			bytes = fdt_getprop(blob, node, "bytes", NULL);
+			if (bytes)
+				*bytesp = fdt32_to_cpu(*bytes);
+			break;
+		}
+	}
+	free(blob);
+
+	return 0;
+}
+
+/* Test that bytes are counted and added to the device tree */
+static int lib_bootstage_bytes(struct unit_test_state *uts)
+{
+	ulong before, after;
+
+	ut_assertok(bootstage_test_fdt_bytes(uts, &before));
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_RAMDISK, "copy_ramdisk");
+	udelay(10);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_RAMDISK);
+	bootstage_add_bytes(BOOTSTAGE_ID_ACCUM_RAMDISK, 1000);
+	bootstage_add_bytes(BOOTSTAGE_ID_ACCUM_RAMDISK, 234);
+
+	ut_assertok(bootstage_test_fdt_bytes(uts, &after));
+	ut_asserteq(before + 1234, after);
+
+	return 0;
+}
+LIB_TEST(lib_bootstage_bytes, 0);
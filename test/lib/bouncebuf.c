@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the bounce buffer API and its pool
+ */
+
+#include <common.h>
+#include <bouncebuf.h>
+#include <malloc.h>
+#include <linux/sizes.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Size of the transfers used by the tests, not a whole number of blocks */
+#define BB_TEST_LEN	(SZ_8K + 3)
+
+/* Test that an aligned buffer is used directly and an unaligned one bounces */
+static int lib_bouncebuf_start(struct unit_test_state *uts)
+{
+	struct bounce_buffer_stats before, after;
+	struct bounce_buffer state;
+	void *bounce;
+	u8 *buf;
+	int i;
+
+	buf = memalign(ARCH_DMA_MINALIGN, BB_TEST_LEN + 1);
+	ut_assertnonnull(buf);
+	for (i = 0; i < BB_TEST_LEN + 1; i++)
+		buf[i] = i;
+
+	bounce_buffer_get_stats(&before);
+	ut_assertok(bounce_buffer_start(&state, buf, SZ_8K, GEN_BB_RW));
+	ut_asserteq_ptr(buf, state.bounce_buffer);
+	ut_assertok(bounce_buffer_stop(&state));
+	bounce_buffer_get_stats(&after);
+	ut_asserteq(before.starts + 1, after.starts);
+	ut_asserteq(before.direct + 1, after.direct);
+	ut_asserteq(before.copied, after.copied);
+
+	/* The data is copied in for a read, and out again for a write */
+	ut_assertok(bounce_buffer_start(&state, buf + 1, BB_TEST_LEN,
+					GEN_BB_READ));
+	bounce = state.bounce_buffer;
+	ut_assert(bounce != buf + 1);
+	ut_asserteq(0, (ulong)bounce & (ARCH_DMA_MINALIGN - 1));
+	ut_assertok(memcmp(buf + 1, bounce, BB_TEST_LEN));
+	memset(bounce, 0xaa, BB_TEST_LEN);
+	ut_assertok(bounce_buffer_stop(&state));
+	ut_asserteq(1, buf[1]);
+
+	ut_assertok(bounce_buffer_start(&state, buf + 1, BB_TEST_LEN,
+					GEN_BB_WRITE));
+	memset(state.bounce_buffer, 0x55, BB_TEST_LEN);
+	ut_assertok(bounce_buffer_stop(&state));
+	for (i = 1; i < BB_TEST_LEN + 1; i++)
+		ut_asserteq(0x55, buf[i]);
+	ut_asserteq(0, buf[0]);
+
+	bounce_buffer_get_stats(&after);
+	ut_asserteq(before.starts + 3, after.starts);
+	ut_asserteq(before.direct + 1, after.direct);
+	ut_asserteq(before.copied + 2 * BB_TEST_LEN, after.copied);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_bouncebuf_start, 0);
+
+/* Test that buffers of a similar size are reused from the pool */
+static int lib_bouncebuf_pool(struct unit_test_state *uts)
+{
+	struct bounce_buffer_stats before, after;
+	void *bufs[CONFIG_BOUNCE_BUFFER_POOL_SLOTS];
+	void *buf, *buf2, *big;
+	int i;
+
+	/* The pool is reserved in one block after relocation */
+	bounce_buffer_get_stats(&before);
+	ut_assert(before.pool_size > 0);
+
+	buf = bounce_buffer_alloc(BB_TEST_LEN);
+	ut_assertnonnull(buf);
+	ut_asserteq(0, (ulong)buf & (ARCH_DMA_MINALIGN - 1));
+	bounce_buffer_free(buf);
+
+	/* The same buffer comes back for any size in its class */
+	bounce_buffer_get_stats(&before);
+	buf2 = bounce_buffer_alloc(SZ_16K);
+	ut_asserteq_ptr(buf, buf2);
+	bounce_buffer_get_stats(&after);
+	ut_asserteq(before.pool_hits + 1, after.pool_hits);
+	ut_asserteq(before.pool_size, after.pool_size);
+
+	/* Once every buffer of that size is busy, fall back to malloc() */
+	for (i = 0; i < CONFIG_BOUNCE_BUFFER_POOL_SLOTS; i++) {
+		bufs[i] = bounce_buffer_alloc(BB_TEST_LEN);
+		ut_assertnonnull(bufs[i]);
+		ut_assert(bufs[i] != buf2);
+	}
+	bounce_buffer_get_stats(&after);
+	ut_asserteq(before.pool_misses + 1, after.pool_misses);
+	for (i = 0; i < CONFIG_BOUNCE_BUFFER_POOL_SLOTS; i++)
+		bounce_buffer_free(bufs[i]);
+	bounce_buffer_free(buf2);
+
+	/* Transfers too large for the pool always use malloc() */
+	bounce_buffer_get_stats(&before);
+	big = bounce_buffer_alloc(SZ_4K << CONFIG_BOUNCE_BUFFER_POOL_CLASSES);
+	ut_assertnonnull(big);
+	bounce_buffer_free(big);
+	bounce_buffer_get_stats(&after);
+	ut_asserteq(before.pool_misses + 1, after.pool_misses);
+	ut_asserteq(before.pool_hits, after.pool_hits);
+	bounce_buffer_free(NULL);
+
+	return 0;
+}
+LIB_TEST(lib_bouncebuf_pool, 0);
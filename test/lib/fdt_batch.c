@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for batched device-tree fixups
+ *
+ * The batch must produce the same blob as calling fdt_setprop() for each
+ * edit in turn. The time taken by each method for a large device tree is
+ * measured by 'ut bench fdt_batch'.
+ */
+
+#include <common.h>
+#include <fdt_support.h>
+#include <malloc.h>
+#include <test/bench.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Enough nodes and properties for a device tree of about 300KB */
+#define TEST_NODES	2000
+#define TEST_PROPS	6
+#define TEST_EDIT_STEP	25
+#define TEST_FDT_SIZE	(512 << 10)
+
+static int fdt_batch_make_tree(struct unit_test_state *uts, void *fdt)
+{
+	char name[20], prop[20];
+	fdt32_t val[4];
+	int i, j;
+
+	ut_assertok(fdt_create(fdt, TEST_FDT_SIZE));
+	ut_assertok(fdt_finish_reservemap(fdt));
+	ut_assertok(fdt_begin_node(fdt, ""));
+	ut_assertok(fdt_property_string(fdt, "compatible", "test,batch"));
+	for (i = 0; i < TEST_NODES; i++) {
+		snprintf(name, sizeof(name), "node@%x", i);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_string(fdt, "compatible",
+						"test,batch-node"));
+		for (j = 0; j < TEST_PROPS; j++) {
+			snprintf(prop, sizeof(prop), "prop%d", j);
+			val[0] = cpu_to_fdt32(i);
+			val[1] = cpu_to_fdt32(j);
+			ut_assertok(fdt_property(fdt, prop, val, 4 * (j % 4)));
+		}
+		ut_assertok(fdt_end_node(fdt));
+	}
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_finish(fdt));
+	ut_assertok(fdt_open_into(fdt, fdt, TEST_FDT_SIZE));
+
+	return 0;
+}
+
+/*
+ * Check that two blobs have the same layout and contents. The padding after
+ * property values is not compared, since fdt_setprop() leaves old data there.
+ */
+static int fdt_batch_check_same(struct unit_test_state *uts, void *fdt1,
+				void *fdt2)
+{
+	const struct fdt_property *prop1, *prop2;
+	int offset, next, tag;
+
+	ut_asserteq(fdt_off_dt_struct(fdt1), fdt_off_dt_struct(fdt2));
+	ut_asserteq(fdt_size_dt_struct(fdt1), fdt_size_dt_struct(fdt2));
+	ut_asserteq(fdt_off_dt_strings(fdt1), fdt_off_dt_strings(fdt2));
+	ut_asserteq(fdt_size_dt_strings(fdt1), fdt_size_dt_strings(fdt2));
+	ut_assertok(memcmp(fdt1 + fdt_off_dt_strings(fdt1),
+			   fdt2 + fdt_off_dt_strings(fdt2),
+			   fdt_size_dt_strings(fdt1)));
+
+	for (offset = 0; ; offset = next) {
+		tag = fdt_next_tag(fdt1, offset, &next);
+		ut_asserteq(tag, fdt_next_tag(fdt2, offset, &next));
+		if (tag == FDT_END)
+			break;
+		if (tag == FDT_BEGIN_NODE) {
+			ut_asserteq_str(fdt_get_name(fdt1, offset, NULL),
+					fdt_get_name(fdt2, offset, NULL));
+		} else if (tag == FDT_PROP) {
+			prop1 = fdt_offset_ptr(fdt1, offset, sizeof(*prop1));
+			prop2 = fdt_offset_ptr(fdt2, offset, sizeof(*prop2));
+			ut_asserteq(fdt32_to_cpu(prop1->nameoff),
+				    fdt32_to_cpu(prop2->nameoff));
+			ut_asserteq(fdt32_to_cpu(prop1->len),
+				    fdt32_to_cpu(prop2->len));
+			ut_assertok(memcmp(prop1->data, prop2->data,
+					   fdt32_to_cpu(prop1->len)));
+		}
+	}
+
+	return 0;
+}
+
+/* Make a set of edits, either directly or through a batch */
+static int fdt_batch_edit(struct unit_test_state *uts, void *fdt, bool batch)
+{
+	char long_val[40], name[20];
+	int (*setprop)(void *fdt, int nodeoffset, const char *name,
+		       const void *val, int len);
+	int node, i;
+
+	setprop = batch ? fdt_batch_setprop : fdt_setprop;
+	if (batch)
+		ut_assertok(fdt_batch_begin(fdt));
+
+	memset(long_val, 'x', sizeof(long_val));
+	for (i = 0; i < TEST_NODES; i += TEST_EDIT_STEP) {
+		snprintf(name, sizeof(name), "/node@%x", i);
+		node = fdt_path_offset(fdt, name);
+		ut_assert(node > 0);
+
+		/* Grow, shrink and add properties, with new and old names */
+		ut_assertok(setprop(fdt, node, "prop1", long_val, i % 37));
+		ut_assertok(setprop(fdt, node, "prop3", "", 0));
+		ut_assertok(setprop(fdt, node, "mac-address", long_val, 6));
+		ut_assertok(setprop(fdt, node, "local-mac-address", long_val,
+				    6));
+		ut_assertok(setprop(fdt, node, "address", long_val, 4));
+		ut_assertok(setprop(fdt, node, "status", "okay", 5));
+		ut_assertok(setprop(fdt, node, "status", "disabled", 9));
+	}
+
+	/* Add a node part-way through, which writes the edits so far */
+	node = fdt_find_or_add_subnode(fdt, 0, "chosen");
+	ut_assert(node > 0);
+	ut_assertok(setprop(fdt, node, "bootargs", long_val,
+			    sizeof(long_val)));
+	ut_assertok(setprop(fdt, 0, "serial-number", "1234", 5));
+
+	if (batch)
+		ut_assertok(fdt_batch_end(fdt));
+
+	return 0;
+}
+
+static int lib_fdt_batch(struct unit_test_state *uts)
+{
+	void *base, *fdt1, *fdt2;
+
+	base = malloc(TEST_FDT_SIZE);
+	fdt1 = malloc(TEST_FDT_SIZE);
+	fdt2 = malloc(TEST_FDT_SIZE);
+	ut_assertnonnull(base);
+	ut_assertnonnull(fdt1);
+	ut_assertnonnull(fdt2);
+
+	ut_assertok(fdt_batch_make_tree(uts, base));
+	memcpy(fdt1, base, TEST_FDT_SIZE);
+	memcpy(fdt2, base, TEST_FDT_SIZE);
+
+	ut_assertok(fdt_batch_edit(uts, fdt1, false));
+	ut_assertok(fdt_batch_edit(uts, fdt2, true));
+	ut_assertok(fdt_check_full(fdt2, TEST_FDT_SIZE));
+	ut_assertok(fdt_batch_check_same(uts, fdt1, fdt2));
+
+	/* A batch which does not fit reports the error when it ends */
+	memcpy(fdt2, base, TEST_FDT_SIZE);
+	fdt_set_totalsize(fdt2, fdt_off_dt_strings(fdt2) +
+			  fdt_size_dt_strings(fdt2));
+	ut_assertok(fdt_batch_begin(fdt2));
+	ut_assertok(fdt_batch_setprop(fdt2, 0, "model", "test", 5));
+	ut_asserteq(-FDT_ERR_NOSPACE, fdt_batch_end(fdt2));
+	ut_assertnull(fdt_getprop(fdt2, 0, "model", NULL));
+
+	free(fdt2);
+	free(fdt1);
+	free(base);
+
+	return 0;
+}
+LIB_TEST(lib_fdt_batch, 0);
+
+#ifdef CONFIG_UT_BENCH
+/**
+ * struct fdt_batch_bench - Data used by the benchmark
+ *
+ * @uts: Test state, for fdt_batch_edit()
+ * @base: Device tree before the edits
+ * @fdt: Device tree to edit
+ * @batch: true to use a batch, false to call fdt_setprop()
+ */
+struct fdt_batch_bench {
+	struct unit_test_state *uts;
+	void *base;
+	void *fdt;
+	bool batch;
+};
+
+/* Make the edits to a fresh copy of the tree, the copy being timed too */
+static int fdt_batch_bench_edit(void *priv)
+{
+	struct fdt_batch_bench *bench = priv;
+
+	memcpy(bench->fdt, bench->base, fdt_off_dt_strings(bench->base) +
+	       fdt_size_dt_strings(bench->base));
+
+	return fdt_batch_edit(bench->uts, bench->fdt, bench->batch);
+}
+
+static int bench_test_fdt_batch(struct unit_test_state *uts)
+{
+	struct fdt_batch_bench bench;
+
+	bench.uts = uts;
+	bench.base = malloc(TEST_FDT_SIZE);
+	bench.fdt = malloc(TEST_FDT_SIZE);
+	ut_assertnonnull(bench.base);
+	ut_assertnonnull(bench.fdt);
+	ut_assertok(fdt_batch_make_tree(uts, bench.base));
+
+	bench.batch = false;
+	ut_assertok(bench_run("fdt-setprop", fdt_batch_bench_edit, &bench, 0));
+	bench.batch = true;
+	ut_assertok(bench_run("fdt-batch", fdt_batch_bench_edit, &bench, 0));
+
+	free(bench.fdt);
+	free(bench.base);
+
+	return 0;
+}
+BENCH_TEST(bench_test_fdt_batch, 0);
+#endif
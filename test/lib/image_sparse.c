@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Block size of the storage, half the block size of the image */
+#define SPARSE_TEST_BLKSZ	512
+#define SPARSE_TEST_IMG_BLKSZ	1024
+
+/* Number of blocks in the storage */
+#define SPARSE_TEST_BLKS	32
+
+/* Headers larger than the structures, as allowed by the format */
+#define SPARSE_TEST_FILE_HDR_SZ	(sizeof(sparse_header_t) + 4)
+#define SPARSE_TEST_CHUNK_HDR_SZ	(sizeof(chunk_header_t) + 4)
+
+/* Value of the fill chunk, split in two by one of the tests */
+#define SPARSE_TEST_FILL	0x12345678
+
+/* Storage which writes into a buffer in memory */
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	if (blk + blkcnt > info->start + info->size)
+		return 0;
+	memcpy(info->priv + blk * info->blksz, buffer, blkcnt * info->blksz);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static void sparse_test_storage(struct sparse_storage *info, u8 *dev)
+{
+	memset(info, '\0', sizeof(*info));
+	info->blksz = SPARSE_TEST_BLKSZ;
+	info->start = 0;
+	info->size = SPARSE_TEST_BLKS;
+	info->priv = dev;
+	info->write = sparse_test_write;
+	info->reserve = sparse_test_reserve;
+	memset(dev, 0xa5, SPARSE_TEST_BLKS * SPARSE_TEST_BLKSZ);
+}
+
+/* Add a chunk header at @p, returning a pointer to the chunk data */
+static u8 *sparse_test_chunk(u8 *p, int type, uint blks, uint data_sz)
+{
+	chunk_header_t *chunk = (chunk_header_t *)p;
+
+	memset(p, '\0', SPARSE_TEST_CHUNK_HDR_SZ);
+	chunk->chunk_type = cpu_to_le16(type);
+	chunk->chunk_sz = cpu_to_le32(blks);
+	chunk->total_sz = cpu_to_le32(SPARSE_TEST_CHUNK_HDR_SZ + data_sz);
+
+	return p + SPARSE_TEST_CHUNK_HDR_SZ;
+}
+
+/*
+ * Create a sparse image with a raw, fill, don't-care, raw and zero-fill
+ * chunk. Returns its size and the offsets of the first chunk header and of
+ * the fill value.
+ */
+static int sparse_test_image(u8 *img, uint *chunk_ofsp, uint *fill_ofsp)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img;
+	u8 *p;
+	int i;
+
+	memset(hdr, '\0', SPARSE_TEST_FILE_HDR_SZ);
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(1);
+	hdr->file_hdr_sz = cpu_to_le16(SPARSE_TEST_FILE_HDR_SZ);
+	hdr->chunk_hdr_sz = cpu_to_le16(SPARSE_TEST_CHUNK_HDR_SZ);
+	hdr->blk_sz = cpu_to_le32(SPARSE_TEST_IMG_BLKSZ);
+	hdr->total_blks = cpu_to_le32(3 + 2 + 2 + 1 + 2);
+	hdr->total_chunks = cpu_to_le32(5);
+	p = img + SPARSE_TEST_FILE_HDR_SZ;
+	*chunk_ofsp = p - img;
+
+	p = sparse_test_chunk(p, CHUNK_TYPE_RAW, 3,
+			      3 * SPARSE_TEST_IMG_BLKSZ);
+	for (i = 0; i < 3 * SPARSE_TEST_IMG_BLKSZ; i++)
+		*p++ = i * 7 + (i >> 8);
+
+	p = sparse_test_chunk(p, CHUNK_TYPE_FILL, 2, sizeof(u32));
+	*fill_ofsp = p - img;
+	*(__le32 *)p = cpu_to_le32(SPARSE_TEST_FILL);
+	p += sizeof(u32);
+
+	p = sparse_test_chunk(p, CHUNK_TYPE_DONT_CARE, 2, 0);
+
+	p = sparse_test_chunk(p, CHUNK_TYPE_RAW, 1, SPARSE_TEST_IMG_BLKSZ);
+	for (i = 0; i < SPARSE_TEST_IMG_BLKSZ; i++)
+		*p++ = ~i;
+
+	p = sparse_test_chunk(p, CHUNK_TYPE_FILL, 2, sizeof(u32));
+	*(__le32 *)p = 0;
+	p += sizeof(u32);
+
+	return p - img;
+}
+
+/* Write @img through a stream, split at each offset in @splits */
+static int sparse_test_stream(struct unit_test_state *uts, u8 *img, int size,
+			      u8 *dev, const uint *splits, int count)
+{
+	struct sparse_storage info;
+	struct sparse_stream stream;
+	char response[64];
+	uint pos, next;
+	int i;
+
+	sparse_test_storage(&info, dev);
+	ut_assertok(sparse_stream_start(&stream, &info, response));
+	for (pos = 0, i = 0; pos < size; pos = next, i++) {
+		next = i < count ? splits[i] : size;
+		ut_assertok(sparse_stream_write(&stream, img + pos, next - pos,
+						response));
+	}
+	ut_assertok(sparse_stream_finish(&stream, "test", response));
+
+	return 0;
+}
+
+/*
+ * Test that a sparse image written in pieces gives the same result as
+ * write_sparse_image(), wherever it is split
+ */
+static int lib_image_sparse_stream(struct unit_test_state *uts)
+{
+	const int dev_size = SPARSE_TEST_BLKS * SPARSE_TEST_BLKSZ;
+	uint chunk_ofs, fill_ofs, splits[5];
+	uint *each;
+	struct sparse_storage info;
+	u8 *img, *expect, *dev;
+	char response[64];
+	int size, i;
+
+	img = malloc(8 * SPARSE_TEST_IMG_BLKSZ);
+	expect = malloc(dev_size);
+	dev = malloc(dev_size);
+	ut_assertnonnull(img);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(dev);
+	size = sparse_test_image(img, &chunk_ofs, &fill_ofs);
+
+	sparse_test_storage(&info, expect);
+	ut_assertok(write_sparse_image(&info, "test", img, response));
+	ut_asserteq(SPARSE_TEST_FILL, *(u32 *)(expect + 6 * SPARSE_TEST_BLKSZ));
+	ut_asserteq(0, expect[19 * SPARSE_TEST_BLKSZ]);
+
+	/* Cut through the file header, a chunk header and the fill word */
+	splits[0] = 10;
+	splits[1] = chunk_ofs + 5;
+	splits[2] = chunk_ofs + SPARSE_TEST_CHUNK_HDR_SZ + 100;
+	splits[3] = fill_ofs + 2;
+	splits[4] = fill_ofs + 3;
+	ut_assertok(sparse_test_stream(uts, img, size, dev, splits,
+				       ARRAY_SIZE(splits)));
+	ut_assertok(memcmp(expect, dev, dev_size));
+
+	/* The header sizes are only known once the start has arrived */
+	splits[0] = sizeof(sparse_header_t) - 1;
+	splits[1] = sizeof(sparse_header_t) + 1;
+	splits[2] = chunk_ofs + sizeof(chunk_header_t);
+	splits[3] = chunk_ofs + SPARSE_TEST_CHUNK_HDR_SZ + SPARSE_TEST_BLKSZ;
+	ut_assertok(sparse_test_stream(uts, img, size, dev, splits, 4));
+	ut_assertok(memcmp(expect, dev, dev_size));
+
+	/* One byte at a time */
+	each = calloc(size, sizeof(uint));
+	ut_assertnonnull(each);
+	for (i = 0; i < size - 1; i++)
+		each[i] = i + 1;
+	ut_assertok(sparse_test_stream(uts, img, size, dev, each, size - 1));
+	ut_assertok(memcmp(expect, dev, dev_size));
+
+	free(each);
+	free(dev);
+	free(expect);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_image_sparse_stream, 0);
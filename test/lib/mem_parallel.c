@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for zeroing and testing memory on several CPUs
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <mem_parallel.h>
+#include <asm/test.h>
+#include <linux/sizes.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Size of the area used by the tests, not a multiple of the share size */
+#define MEM_PAR_SIZE	(SZ_1M + 100)
+
+/* Address and size of an area large enough for several chunks per CPU */
+#define MEM_PAR_LARGE_ADDR	SZ_32M
+#define MEM_PAR_LARGE_SIZE	(SZ_32M + SZ_1M + 100)
+
+/* Test splitting an area between four CPUs */
+static int lib_mem_parallel_split(struct unit_test_state *uts)
+{
+	struct mem_parallel par;
+	char buf[1];
+	int i;
+
+	sandbox_set_worker_count(3);
+	mem_parallel_split(&par, 0x1000, buf, MEM_PAR_SIZE);
+	ut_asserteq(4, par.count);
+	for (i = 0; i < 4; i++) {
+		ut_asserteq(0x1000 + i * 0x41000, par.parts[i].addr);
+		ut_asserteq_ptr(buf + i * 0x41000, par.parts[i].buf);
+	}
+	ut_asserteq(0x41000, par.parts[0].size);
+	ut_asserteq(MEM_PAR_SIZE - 3 * 0x41000, par.parts[3].size);
+
+	/* Shares are whole 4KB blocks, so a small area gives fewer shares */
+	mem_parallel_split(&par, 0x1000, buf, 100);
+	ut_asserteq(1, par.count);
+	ut_asserteq(100, par.parts[0].size);
+	mem_parallel_split(&par, 0x1000, buf, 0x1001);
+	ut_asserteq(2, par.count);
+	ut_asserteq(1, par.parts[1].size);
+	sandbox_set_worker_count(-1);
+
+	return 0;
+}
+LIB_TEST(lib_mem_parallel_split, 0);
+
+/* Test zeroing, filling and checking an area on four CPUs */
+static int lib_mem_parallel_fill(struct unit_test_state *uts)
+{
+	struct mem_parallel par;
+	ulong *words;
+	u8 *buf;
+	int i;
+
+	buf = malloc(MEM_PAR_SIZE);
+	ut_assertnonnull(buf);
+	memset(buf, 0xff, MEM_PAR_SIZE);
+	sandbox_set_worker_count(3);
+	mem_parallel_split(&par, 0x100000, buf, MEM_PAR_SIZE);
+	ut_asserteq(4, par.count);
+
+	ut_assertok(mem_parallel_zero(&par));
+	for (i = 0; i < MEM_PAR_SIZE; i++)
+		ut_asserteq(0, buf[i]);
+
+	/* The sequence carries on from one share to the next */
+	words = (ulong *)buf;
+	ut_assertok(mem_parallel_fill(&par, 1000, -3));
+	for (i = 0; i < MEM_PAR_SIZE / sizeof(ulong); i++)
+		ut_asserteq(1000 - 3 * i, words[i]);
+	ut_asserteq(0, mem_parallel_check(&par));
+
+	/* Break two words in the third share */
+	i = 0x82000 / sizeof(ulong) + 5;
+	words[i] ^= 0x10;
+	words[i + 1] = 0;
+	ut_asserteq(2, mem_parallel_check(&par));
+	ut_asserteq(0, par.parts[1].errs);
+	ut_asserteq(2, par.parts[2].errs);
+	ut_asserteq(0x100000 + i * sizeof(ulong), par.parts[2].err_addr);
+	ut_asserteq(1000 - 3 * i, par.parts[2].err_expect);
+	ut_asserteq((1000 - 3 * i) ^ 0x10, par.parts[2].err_actual);
+	sandbox_set_worker_count(-1);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_mem_parallel_fill, 0);
+
+/* Test an area which each CPU handles in more than one chunk */
+static int lib_mem_parallel_large(struct unit_test_state *uts)
+{
+	struct mem_parallel par;
+	ulong *words;
+	int i;
+
+	words = map_sysmem(MEM_PAR_LARGE_ADDR, MEM_PAR_LARGE_SIZE);
+	sandbox_set_worker_count(1);
+	mem_parallel_split(&par, MEM_PAR_LARGE_ADDR, words, MEM_PAR_LARGE_SIZE);
+	ut_asserteq(2, par.count);
+	ut_assert(par.parts[1].size > SZ_16M);
+
+	ut_assertok(mem_parallel_fill(&par, 0x12345678, 5));
+	for (i = 0; i < MEM_PAR_LARGE_SIZE / sizeof(ulong); i++) {
+		if (words[i] != 0x12345678 + 5 * i)
+			ut_asserteq(0x12345678 + 5 * i, words[i]);
+	}
+	ut_asserteq(0, mem_parallel_check(&par));
+
+	/* Break a word in the second chunk of the second share */
+	i = (par.parts[1].addr - MEM_PAR_LARGE_ADDR + SZ_16M) / sizeof(ulong);
+	words[i] = 0;
+	ut_asserteq(1, mem_parallel_check(&par));
+	ut_asserteq(1, par.parts[1].errs);
+	ut_asserteq(MEM_PAR_LARGE_ADDR + i * sizeof(ulong),
+		    par.parts[1].err_addr);
+	ut_asserteq(0x12345678 + 5 * i, par.parts[1].err_expect);
+
+	ut_assertok(mem_parallel_zero(&par));
+	for (i = 0; i < MEM_PAR_LARGE_SIZE / sizeof(ulong); i++) {
+		if (words[i])
+			ut_asserteq(0, words[i]);
+	}
+	sandbox_set_worker_count(-1);
+	unmap_sysmem(words);
+
+	return 0;
+}
+LIB_TEST(lib_mem_parallel_large, 0);
@@ -11,6 +11,8 @@
 
 #include <common.h>
 #include <command.h>
+#include <malloc.h>
+#include <rand.h>
 #include <test/lib.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -192,3 +194,103 @@ static int lib_memmove(struct unit_test_state *uts)
 }
 
 LIB_TEST(lib_memmove, 0);
+
+/* Size of the buffer used by lib_memfuzz(), enough for the large-copy paths */
+#define FUZZ_BUFLEN 8192
+/* Number of random calls made by lib_memfuzz() */
+#define FUZZ_ROUNDS 4000
+
+/**
+ * fuzz_len() - pick a random length for lib_memfuzz()
+ *
+ * Short lengths are favoured, since they take the most varied paths.
+ *
+ * @max:	maximum length
+ * Return:	length from 0 to @max
+ */
+static int fuzz_len(int max)
+{
+	static const int limits[] = { 20, 160, 1024, FUZZ_BUFLEN };
+	int limit = limits[rand() % ARRAY_SIZE(limits)];
+
+	return rand() % (min(limit, max) + 1);
+}
+
+/**
+ * lib_memfuzz() - randomised test of memset(), memcpy() and memmove()
+ *
+ * Call the functions with random offsets and lengths, including overlapping
+ * moves in both directions, and compare the whole buffer with the result of
+ * doing the same thing a byte at a time. The lengths go well beyond those of
+ * the other tests, so that the loops for large areas are covered too.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_memfuzz(struct unit_test_state *uts)
+{
+	u8 *buf, *ref;
+	int round, op, dst, src, len, i;
+	void *ptr;
+
+	buf = malloc(FUZZ_BUFLEN);
+	ref = malloc(FUZZ_BUFLEN);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(ref);
+	srand(0x5eed);
+	for (i = 0; i < FUZZ_BUFLEN; i++)
+		buf[i] = rand();
+	memcpy(ref, buf, FUZZ_BUFLEN);
+
+	for (round = 0; round < FUZZ_ROUNDS; round++) {
+		op = rand() % 3;
+		dst = rand() % FUZZ_BUFLEN;
+		if (op == 2 && (rand() & 1)) {
+			/* overlap the source and destination */
+			src = dst + rand() % 257 - 128;
+			src = max(0, min(src, FUZZ_BUFLEN - 1));
+		} else {
+			src = rand() % FUZZ_BUFLEN;
+		}
+		len = fuzz_len(FUZZ_BUFLEN - max(dst, src));
+
+		switch (op) {
+		case 0:
+			/* only the bottom byte of the value counts */
+			ptr = memset(buf + dst, src, len);
+			for (i = 0; i < len; i++)
+				ref[dst + i] = src;
+			break;
+		case 1:
+			/* memcpy() needs areas which do not overlap */
+			if (dst < src + len && src < dst + len)
+				len = abs(dst - src);
+			ptr = memcpy(buf + dst, buf + src, len);
+			for (i = 0; i < len; i++)
+				ref[dst + i] = ref[src + i];
+			break;
+		default:
+			ptr = memmove(buf + dst, buf + src, len);
+			if (dst < src) {
+				for (i = 0; i < len; i++)
+					ref[dst + i] = ref[src + i];
+			} else {
+				for (i = len - 1; i >= 0; i--)
+					ref[dst + i] = ref[src + i];
+			}
+			break;
+		}
+		ut_asserteq_ptr(buf + dst, ptr);
+		if (memcmp(buf, ref, FUZZ_BUFLEN)) {
+			printf("%s: failure in round %d: op %d, %d, %d, %d\n",
+			       __func__, round, op, dst, src, len);
+			return CMD_RET_FAILURE;
+		}
+	}
+	free(ref);
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_memfuzz, 0);
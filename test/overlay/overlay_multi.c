@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for applying several overlays at once
+ *
+ * fdt_overlay_apply_multi() must give the same result as calling
+ * fdt_overlay_apply() for each overlay in turn, including for a large base
+ * tree and a set of generated overlays. The time taken by each method for
+ * those is measured by 'ut bench fdt_overlay_multi'.
+ */
+
+#include <common.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+#include <test/bench.h>
+#include <test/overlay.h>
+#include <test/ut.h>
+
+#define FDT_COPY_SIZE	(4 * SZ_1K)
+
+/* A base tree of about 130KB and overlays touching 200 of its nodes */
+#define BENCH_NODES	1000
+#define BENCH_OVERLAYS	20
+#define BENCH_FRAGMENTS	10
+#define BENCH_SHARED	50
+#define BENCH_BASE_SIZE	SZ_1M
+#define BENCH_OV_SIZE	(8 * SZ_1K)
+
+extern u32 __dtb_test_fdt_base_begin;
+extern u32 __dtb_test_fdt_overlay_begin;
+extern u32 __dtb_test_fdt_overlay_stacked_begin;
+
+/* Check that the multi-overlay call matches applying overlays one by one */
+static int fdt_overlay_multi(struct unit_test_state *uts)
+{
+	void *fdt1, *fdt2, *ovs[4];
+	int i;
+
+	fdt1 = malloc(FDT_COPY_SIZE);
+	fdt2 = malloc(FDT_COPY_SIZE);
+	for (i = 0; i < ARRAY_SIZE(ovs); i++) {
+		ovs[i] = malloc(FDT_COPY_SIZE);
+		ut_assertnonnull(ovs[i]);
+	}
+	ut_assertnonnull(fdt1);
+	ut_assertnonnull(fdt2);
+
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_base_begin, fdt1,
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_base_begin, fdt2,
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_overlay_begin, ovs[0],
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_overlay_stacked_begin,
+				  ovs[1], FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_overlay_begin, ovs[2],
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_overlay_stacked_begin,
+				  ovs[3], FDT_COPY_SIZE));
+
+	ut_assertok(fdt_overlay_apply(fdt1, ovs[0]));
+	ut_assertok(fdt_overlay_apply(fdt1, ovs[1]));
+	ut_assertok(fdt_overlay_apply_multi(fdt2, &ovs[2], 2));
+	ut_asserteq(fdt_totalsize(fdt1), fdt_totalsize(fdt2));
+	ut_assertok(memcmp(fdt1, fdt2, fdt_totalsize(fdt1)));
+
+	/* The stacked overlay refers to a label which is not in the base */
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_base_begin, fdt2,
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(&__dtb_test_fdt_overlay_stacked_begin,
+				  ovs[0], FDT_COPY_SIZE));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdt_overlay_apply_multi(fdt2, &ovs[0], 1));
+	ut_asserteq(-FDT_ERR_BADMAGIC, fdt_check_header(fdt2));
+
+	for (i = 0; i < ARRAY_SIZE(ovs); i++)
+		free(ovs[i]);
+	free(fdt2);
+	free(fdt1);
+
+	return 0;
+}
+OVERLAY_TEST(fdt_overlay_multi, 0);
+
+static int bench_make_base(struct unit_test_state *uts, void *fdt)
+{
+	char name[20], path[30];
+	int i;
+
+	ut_assertok(fdt_create(fdt, BENCH_BASE_SIZE));
+	ut_assertok(fdt_finish_reservemap(fdt));
+	ut_assertok(fdt_begin_node(fdt, ""));
+	ut_assertok(fdt_begin_node(fdt, "bus"));
+	for (i = 0; i < BENCH_NODES; i++) {
+		snprintf(name, sizeof(name), "dev@%x", i);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_string(fdt, "compatible",
+						"test,overlay-bench"));
+		ut_assertok(fdt_property_u32(fdt, "reg", i));
+		ut_assertok(fdt_property_string(fdt, "status", "disabled"));
+		ut_assertok(fdt_property_u32(fdt, "phandle", i + 1));
+		ut_assertok(fdt_end_node(fdt));
+	}
+	ut_assertok(fdt_end_node(fdt));
+
+	ut_assertok(fdt_begin_node(fdt, "__symbols__"));
+	for (i = 0; i < BENCH_NODES; i++) {
+		snprintf(name, sizeof(name), "dev%d", i);
+		snprintf(path, sizeof(path), "/bus/dev@%x", i);
+		ut_assertok(fdt_property_string(fdt, name, path));
+	}
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_finish(fdt));
+	ut_assertok(fdt_open_into(fdt, fdt, BENCH_BASE_SIZE));
+
+	return 0;
+}
+
+/*
+ * Create an overlay with fragments which each target a node in the base,
+ * refer to one of a few shared nodes (like a GPIO or clock controller) and
+ * add a child with a local phandle. After the first overlay, half of the
+ * references are to children added by the previous one.
+ */
+static int bench_make_overlay(struct unit_test_state *uts, void *fdt, int ov)
+{
+	char name[48], label[20], fixup[48];
+	int target[BENCH_FRAGMENTS];
+	int j;
+
+	for (j = 0; j < BENCH_FRAGMENTS; j++)
+		target[j] = BENCH_SHARED +
+			(ov * 37 + j * 89) % (BENCH_NODES - BENCH_SHARED);
+
+	ut_assertok(fdt_create(fdt, BENCH_OV_SIZE));
+	ut_assertok(fdt_finish_reservemap(fdt));
+	ut_assertok(fdt_begin_node(fdt, ""));
+	for (j = 0; j < BENCH_FRAGMENTS; j++) {
+		snprintf(name, sizeof(name), "fragment@%d", j);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_u32(fdt, "target", 0xffffffff));
+		ut_assertok(fdt_begin_node(fdt, "__overlay__"));
+		ut_assertok(fdt_property_string(fdt, "status", "okay"));
+		ut_assertok(fdt_property_u32(fdt, "ref", 0xffffffff));
+		snprintf(name, sizeof(name), "child-%d-%d", ov, j);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_u32(fdt, "link", j + 1));
+		ut_assertok(fdt_property_u32(fdt, "phandle", j + 1));
+		ut_assertok(fdt_end_node(fdt));
+		ut_assertok(fdt_end_node(fdt));
+		ut_assertok(fdt_end_node(fdt));
+	}
+
+	ut_assertok(fdt_begin_node(fdt, "__symbols__"));
+	for (j = 0; j < BENCH_FRAGMENTS; j++) {
+		snprintf(label, sizeof(label), "ov%d_%d", ov, j);
+		snprintf(name, sizeof(name),
+			 "/fragment@%d/__overlay__/child-%d-%d", j, ov, j);
+		ut_assertok(fdt_property_string(fdt, label, name));
+	}
+	ut_assertok(fdt_end_node(fdt));
+
+	/* No two fixups use the same label, so each has one entry */
+	ut_assertok(fdt_begin_node(fdt, "__fixups__"));
+	for (j = 0; j < BENCH_FRAGMENTS; j++) {
+		snprintf(label, sizeof(label), "dev%d", target[j]);
+		snprintf(fixup, sizeof(fixup), "/fragment@%d:target:0", j);
+		ut_assertok(fdt_property_string(fdt, label, fixup));
+
+		if (ov && (j & 1))
+			snprintf(label, sizeof(label), "ov%d_%d", ov - 1, j);
+		else
+			snprintf(label, sizeof(label), "dev%d",
+				 j * 7 % BENCH_SHARED);
+		snprintf(fixup, sizeof(fixup), "/fragment@%d/__overlay__:ref:0",
+			 j);
+		ut_assertok(fdt_property_string(fdt, label, fixup));
+	}
+	ut_assertok(fdt_end_node(fdt));
+
+	ut_assertok(fdt_begin_node(fdt, "__local_fixups__"));
+	for (j = 0; j < BENCH_FRAGMENTS; j++) {
+		snprintf(name, sizeof(name), "fragment@%d", j);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_begin_node(fdt, "__overlay__"));
+		snprintf(name, sizeof(name), "child-%d-%d", ov, j);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_u32(fdt, "link", 0));
+		ut_assertok(fdt_end_node(fdt));
+		ut_assertok(fdt_end_node(fdt));
+		ut_assertok(fdt_end_node(fdt));
+	}
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_finish(fdt));
+
+	return 0;
+}
+
+/* Compare applying many overlays one at a time and all together */
+static int fdt_overlay_multi_large(struct unit_test_state *uts)
+{
+	void *base, *fdt1, *fdt2, *ovs[BENCH_OVERLAYS];
+	void *templ[BENCH_OVERLAYS];
+	const char *path;
+	u32 phandle;
+	int i, node;
+
+	base = malloc(BENCH_BASE_SIZE);
+	fdt1 = malloc(BENCH_BASE_SIZE);
+	fdt2 = malloc(BENCH_BASE_SIZE);
+	ut_assertnonnull(base);
+	ut_assertnonnull(fdt1);
+	ut_assertnonnull(fdt2);
+	for (i = 0; i < BENCH_OVERLAYS; i++) {
+		templ[i] = malloc(BENCH_OV_SIZE);
+		ovs[i] = malloc(BENCH_OV_SIZE);
+		ut_assertnonnull(templ[i]);
+		ut_assertnonnull(ovs[i]);
+		ut_assertok(bench_make_overlay(uts, templ[i], i));
+	}
+	ut_assertok(bench_make_base(uts, base));
+
+	memcpy(fdt1, base, BENCH_BASE_SIZE);
+	for (i = 0; i < BENCH_OVERLAYS; i++)
+		memcpy(ovs[i], templ[i], BENCH_OV_SIZE);
+	for (i = 0; i < BENCH_OVERLAYS; i++)
+		ut_assertok(fdt_overlay_apply(fdt1, ovs[i]));
+
+	memcpy(fdt2, base, BENCH_BASE_SIZE);
+	for (i = 0; i < BENCH_OVERLAYS; i++)
+		memcpy(ovs[i], templ[i], BENCH_OV_SIZE);
+	ut_assertok(fdt_overlay_apply_multi(fdt2, ovs, BENCH_OVERLAYS));
+
+	ut_assertok(fdt_check_full(fdt2, BENCH_BASE_SIZE));
+	ut_assertok(memcmp(fdt1, fdt2, fdt_totalsize(fdt1)));
+
+	/* Overlay 2 fragment 1 refers to a child added by overlay 1 */
+	node = fdt_path_offset(fdt2, "/__symbols__");
+	ut_assert(node > 0);
+	path = fdt_getprop(fdt2, node, "ov1_1", NULL);
+	ut_assertnonnull(path);
+	node = fdt_path_offset(fdt2, path);
+	ut_assert(node > 0);
+	phandle = fdt_get_phandle(fdt2, node);
+	ut_assert(phandle > BENCH_NODES);
+	node = fdt_path_offset(fdt2, "/bus/dev@d5");
+	ut_assert(node > 0);
+	ut_asserteq(phandle, fdtdec_get_uint(fdt2, node, "ref", 0));
+
+	for (i = 0; i < BENCH_OVERLAYS; i++) {
+		free(ovs[i]);
+		free(templ[i]);
+	}
+	free(fdt2);
+	free(fdt1);
+	free(base);
+
+	return 0;
+}
+OVERLAY_TEST(fdt_overlay_multi_large, 0);
+
+#ifdef CONFIG_UT_BENCH
+/**
+ * struct overlay_multi_bench - Data used by the benchmark
+ *
+ * @base: Base tree before the overlays are applied
+ * @fdt: Tree to apply the overlays to
+ * @templ: Overlays before they are applied
+ * @ovs: Overlays to apply, which are changed when they are applied
+ * @multi: true to use fdt_overlay_apply_multi(), false to call
+ *	fdt_overlay_apply() for each overlay
+ */
+struct overlay_multi_bench {
+	void *base;
+	void *fdt;
+	void *templ[BENCH_OVERLAYS];
+	void *ovs[BENCH_OVERLAYS];
+	bool multi;
+};
+
+/* Apply the overlays to fresh copies of the trees, also timing the copies */
+static int overlay_multi_bench_apply(void *priv)
+{
+	struct overlay_multi_bench *bench = priv;
+	int ret, i;
+
+	memcpy(bench->fdt, bench->base, fdt_off_dt_strings(bench->base) +
+	       fdt_size_dt_strings(bench->base));
+	for (i = 0; i < BENCH_OVERLAYS; i++)
+		memcpy(bench->ovs[i], bench->templ[i],
+		       fdt_totalsize(bench->templ[i]));
+
+	if (bench->multi)
+		return fdt_overlay_apply_multi(bench->fdt, bench->ovs,
+					       BENCH_OVERLAYS);
+	for (i = 0; i < BENCH_OVERLAYS; i++) {
+		ret = fdt_overlay_apply(bench->fdt, bench->ovs[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int bench_test_fdt_overlay_multi(struct unit_test_state *uts)
+{
+	struct overlay_multi_bench bench;
+	int i;
+
+	bench.base = malloc(BENCH_BASE_SIZE);
+	bench.fdt = malloc(BENCH_BASE_SIZE);
+	ut_assertnonnull(bench.base);
+	ut_assertnonnull(bench.fdt);
+	for (i = 0; i < BENCH_OVERLAYS; i++) {
+		bench.templ[i] = malloc(BENCH_OV_SIZE);
+		bench.ovs[i] = malloc(BENCH_OV_SIZE);
+		ut_assertnonnull(bench.templ[i]);
+		ut_assertnonnull(bench.ovs[i]);
+		ut_assertok(bench_make_overlay(uts, bench.templ[i], i));
+	}
+	ut_assertok(bench_make_base(uts, bench.base));
+
+	bench.multi = false;
+	ut_assertok(bench_run("fdt-overlay-apply", overlay_multi_bench_apply,
+			      &bench, 0));
+	bench.multi = true;
+	ut_assertok(bench_run("fdt-overlay-multi", overlay_multi_bench_apply,
+			      &bench, 0));
+
+	for (i = 0; i < BENCH_OVERLAYS; i++) {
+		free(bench.ovs[i]);
+		free(bench.templ[i]);
+	}
+	free(bench.fdt);
+	free(bench.base);
+
+	return 0;
+}
+BENCH_TEST(bench_test_fdt_overlay_multi, 0);
+#endif
@@ -138,14 +138,16 @@ class DtbPlatdata(object):
         _dtb_fname: Filename of the input device tree binary file
         _valid_nodes: A list of Node object with compatible strings
         _include_disabled: true to include nodes marked status = "disabled"
+        _parents: true to link each device to the device of its parent node
         _outfile: The current output file (sys.stdout or a real file)
         _lines: Stashed list of output lines for outputting in the future
     """
-    def __init__(self, dtb_fname, include_disabled):
+    def __init__(self, dtb_fname, include_disabled, parents=False):
         self._fdt = None
         self._dtb_fname = dtb_fname
         self._valid_nodes = None
         self._include_disabled = include_disabled
+        self._parents = parents
         self._outfile = None
         self._lines = []
         self._aliases = {}
@@ -455,6 +457,20 @@ class DtbPlatdata(object):
                 self.out('#define %s%s %s%s\n'% (STRUCT_PREFIX, alias,
                                                  STRUCT_PREFIX, struct_name))
 
+    def get_parent_node(self, node):
+        """Get the node whose device is the parent of a node's device
+
+        Args:
+            node: node to check
+
+        Returns:
+            Parent node, or None if parent links are not enabled or the
+            parent node does not have a device (e.g. the root node)
+        """
+        if not self._parents or node.parent not in self._valid_nodes:
+            return None
+        return node.parent
+
     def output_node(self, node):
         """Output the C code for a node
 
@@ -515,6 +531,10 @@ class DtbPlatdata(object):
         self.buf('\t.name\t\t= "%s",\n' % struct_name)
         self.buf('\t.platdata\t= &%s%s,\n' % (VAL_PREFIX, var_name))
         self.buf('\t.platdata_size\t= sizeof(%s%s),\n' % (VAL_PREFIX, var_name))
+        parent = self.get_parent_node(node)
+        if parent:
+            self.buf('\t.parent\t\t= U_BOOT_DEVICE_REF(%s),\n' %
+                     conv_name_to_c(parent.name))
         self.buf('};\n')
         self.buf('\n')
 
@@ -543,13 +563,27 @@ class DtbPlatdata(object):
             # Output all the node's dependencies first
             for req_node in node.phandles:
                 if req_node in nodes_to_output:
-                    self.output_node(req_node)
-                    nodes_to_output.remove(req_node)
-            self.output_node(node)
-            nodes_to_output.remove(node)
+                    self.output_node_and_parents(req_node, nodes_to_output)
+            self.output_node_and_parents(node, nodes_to_output)
+
+    def output_node_and_parents(self, node, nodes_to_output):
+        """Output the C code for a node, after that of its parent device
+
+        A device refers to the device of its parent, so the parent has to be
+        declared first.
+
+        Args:
+            node: node to output
+            nodes_to_output: List of nodes not output yet. This is updated.
+        """
+        parent = self.get_parent_node(node)
+        if parent in nodes_to_output:
+            self.output_node_and_parents(parent, nodes_to_output)
+        self.output_node(node)
+        nodes_to_output.remove(node)
 
 
-def run_steps(args, dtb_file, include_disabled, output):
+def run_steps(args, dtb_file, include_disabled, output, parents=False):
     """Run all the steps of the dtoc tool
 
     Args:
@@ -557,11 +591,12 @@ def run_steps(args, dtb_file, include_disabled, output):
         dtb_file: Filename of dtb file to process
         include_disabled: True to include disabled nodes
         output: Name of output file
+        parents: True to link each device to the device of its parent node
     """
     if not args:
         raise ValueError('Please specify a command: struct, platdata')
 
-    plat = DtbPlatdata(dtb_file, include_disabled)
+    plat = DtbPlatdata(dtb_file, include_disabled, parents)
     plat.scan_dtb()
     plat.scan_tree()
     plat.scan_reg_sizes()
@@ -270,6 +270,51 @@ U_BOOT_DEVICE(pmic_at_9) = {
 
 ''', data)
 
+    def test_parents(self):
+        """Test linking devices to the device of their parent node"""
+        dtb_file = get_dtb_file('dtoc_test_simple.dts')
+        output = tools.GetOutputFilename('output')
+        dtb_platdata.run_steps(['platdata'], dtb_file, False, output, True)
+        with open(output) as infile:
+            data = infile.read()
+
+        # Top-level nodes have no parent device
+        self.assertIn('''U_BOOT_DEVICE(i2c_at_0) = {
+\t.name\t\t= "sandbox_i2c_test",
+\t.platdata\t= &dtv_i2c_at_0,
+\t.platdata_size\t= sizeof(dtv_i2c_at_0),
+};
+''', data)
+        self.assertIn('''U_BOOT_DEVICE(pmic_at_9) = {
+\t.name\t\t= "sandbox_pmic_test",
+\t.platdata\t= &dtv_pmic_at_9,
+\t.platdata_size\t= sizeof(dtv_pmic_at_9),
+\t.parent\t\t= U_BOOT_DEVICE_REF(i2c_at_0),
+};
+''', data)
+        self.assertLess(data.index('U_BOOT_DEVICE(i2c_at_0)'),
+                        data.index('U_BOOT_DEVICE(pmic_at_9)'))
+
+    def test_parents_phandle(self):
+        """Test that a parent is output before a child used by a phandle"""
+        dtb_file = get_dtb_file('dtoc_test_phandle_parent.dts')
+        output = tools.GetOutputFilename('output')
+        dtb_platdata.run_steps(['platdata'], dtb_file, False, output, True)
+        with open(output) as infile:
+            data = infile.read()
+        self.assertIn('''U_BOOT_DEVICE(phandle_target) = {
+\t.name\t\t= "target",
+\t.platdata\t= &dtv_phandle_target,
+\t.platdata_size\t= sizeof(dtv_phandle_target),
+\t.parent\t\t= U_BOOT_DEVICE_REF(bus),
+};
+''', data)
+        bus = data.index('U_BOOT_DEVICE(bus)')
+        target = data.index('U_BOOT_DEVICE(phandle_target)')
+        source = data.index('U_BOOT_DEVICE(phandle_source)')
+        self.assertLess(bus, target)
+        self.assertLess(target, source)
+
     def test_phandle(self):
         """Test output from a node containing a phandle reference"""
         dtb_file = get_dtb_file('dtoc_test_phandle.dts')
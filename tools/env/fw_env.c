@@ -12,6 +12,7 @@
 #include <compiler.h>
 #include <env.h>
 #include <errno.h>
+#include <env_bin.h>
 #include <env_flags.h>
 #include <fcntl.h>
 #include <libgen.h>
@@ -1383,6 +1384,72 @@ static int flash_io(int mode)
 	return rc;
 }
 
+/*
+ * U-Boot may save the environment in the binary format described in
+ * env_bin.h. Convert it to the usual "name=value" list so that it can be
+ * read and changed. The text is always smaller than the binary form. It is
+ * written back as text, which U-Boot also reads.
+ */
+static int env_bin_to_text(char *data, size_t size)
+{
+	struct env_bin_hdr hdr;
+	struct env_bin_rec rec;
+	const char *p, *end;
+	char *text, *out;
+	uint32_t i;
+
+	if (size < sizeof(hdr))
+		return 0;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.magic != ENV_BIN_MAGIC)
+		return 0;
+	if (hdr.version != ENV_BIN_VERSION || hdr.hdr_size < sizeof(hdr) ||
+	    hdr.size > size - hdr.hdr_size ||
+	    crc32(0, (uint8_t *)data + hdr.hdr_size, hdr.size) != hdr.crc) {
+		fprintf(stderr, "Unsupported binary environment\n");
+		return -EINVAL;
+	}
+
+	text = calloc(1, size);
+	if (!text)
+		return -ENOMEM;
+	out = text;
+	p = data + hdr.hdr_size;
+	end = p + hdr.size;
+	for (i = 0; i < hdr.count; i++) {
+		const char *name, *value;
+		size_t left;
+
+		if (end - p < sizeof(rec))
+			goto err;
+		memcpy(&rec, p, sizeof(rec));
+		name = p + sizeof(rec);
+		value = name + rec.name_len + 1;
+
+		/* Check each length so that the record size cannot wrap */
+		left = end - name;
+		if (!rec.name_len || rec.name_len >= left ||
+		    rec.value_len >= left - rec.name_len - 1 ||
+		    env_bin_rec_size(rec.name_len, rec.value_len) > end - p ||
+		    name[rec.name_len] || value[rec.value_len])
+			goto err;
+		p += env_bin_rec_size(rec.name_len, rec.value_len);
+		if (rec.flags & ENV_BIN_DELETE)
+			continue;
+		out += sprintf(out, "%s=%s", name, value) + 1;
+	}
+	memcpy(data, text, size);
+	free(text);
+
+	return 0;
+
+err:
+	fprintf(stderr, "Bad record %u in binary environment\n", i);
+	free(text);
+
+	return -EINVAL;
+}
+
 /*
  * Prevent confusion if running from erased flash memory
  */
@@ -1576,6 +1643,13 @@ int fw_env_open(struct env_opts *opts)
 		fprintf(stderr, "Selected env in %s\n", DEVNAME(dev_current));
 #endif
 	}
+
+	ret = env_bin_to_text(environment.data, ENV_SIZE);
+	if (ret) {
+		fw_env_close(opts);
+		return ret;
+	}
+
 	return 0;
 
  open_cleanup:
@@ -19,6 +19,7 @@
 #include <image.h>
 #include <stdarg.h>
 #include <version.h>
+#include <sys/time.h>
 #include <u-boot/crc.h>
 
 static image_header_t header;
@@ -66,6 +67,9 @@ static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 				      params->cmdname);
 	}
 
+	if (!ret)
+		ret = fit_precalc_hashes(ptr, params->jobs);
+
 	if (!ret) {
 		ret = fit_add_verification_data(params->keydir, dest_blob, ptr,
 						params->comment,
@@ -422,7 +426,7 @@ err_buf:
  */
 static int fit_extract_data(struct image_tool_params *params, const char *fname)
 {
-	void *buf;
+	void *buf = NULL;
 	int buf_ptr;
 	int fit_size, new_size;
 	int fd;
@@ -431,20 +435,21 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 	int ret;
 	int images;
 	int node;
+	int count = 0;
+	int align_size;
+
+	align_size = params->bl_len ? params->bl_len : 4;
+	if (params->external_offset % align_size) {
+		debug("External offset %x not aligned to %x\n",
+		      params->external_offset, align_size);
+		return -EINVAL;
+	}
 
 	fd = mmap_fdt(params->cmdname, fname, 0, &fdt, &sbuf, false, false);
 	if (fd < 0)
 		return -EIO;
 	fit_size = fdt_totalsize(fdt);
 
-	/* Allocate space to hold the image data we will extract */
-	buf = malloc(fit_size);
-	if (!buf) {
-		ret = -ENOMEM;
-		goto err_munmap;
-	}
-	buf_ptr = 0;
-
 	images = fdt_path_offset(fdt, FIT_IMAGES_PATH);
 	if (images < 0) {
 		debug("%s: Cannot find /images node: %d\n", __func__, images);
@@ -452,6 +457,17 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 		goto err_munmap;
 	}
 
+	fdt_for_each_subnode(node, fdt, images)
+		count++;
+
+	/* Allocate space to hold the image data we will extract */
+	buf = calloc(1, fit_size + count * align_size);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto err_munmap;
+	}
+	buf_ptr = 0;
+
 	for (node = fdt_first_subnode(fdt, images);
 	     node >= 0;
 	     node = fdt_next_subnode(fdt, node)) {
@@ -479,7 +495,7 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 		}
 		fdt_setprop_u32(fdt, node, FIT_DATA_SIZE_PROP, len);
 
-		buf_ptr += (len + 3) & ~3;
+		buf_ptr += (len + align_size - 1) & ~(align_size - 1);
 	}
 
 	/* Pack the FDT and place the data after it */
@@ -488,7 +504,13 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 	debug("Size reduced from %x to %x\n", fit_size, fdt_totalsize(fdt));
 	debug("External data size %x\n", buf_ptr);
 	new_size = fdt_totalsize(fdt);
-	new_size = (new_size + 3) & ~3;
+	new_size = (new_size + align_size - 1) & ~(align_size - 1);
+	/*
+	 * The external data starts at the 4-byte aligned end of the FDT, so
+	 * grow it to keep larger alignments
+	 */
+	if (align_size > 4)
+		fdt_set_totalsize(fdt, new_size);
 	munmap(fdt, sbuf.st_size);
 
 	if (ftruncate(fd, new_size)) {
@@ -631,9 +653,10 @@ err_no_fd:
 static int copyfile(const char *src, const char *dst)
 {
 	int fd_src = -1, fd_dst = -1;
-	void *buf = NULL;
+	void *buf = MAP_FAILED;
+	struct stat sbuf;
 	ssize_t size;
-	size_t count;
+	size_t count = 0;
 	int ret = -1;
 
 	fd_src = open(src, O_RDONLY);
@@ -648,38 +671,39 @@ static int copyfile(const char *src, const char *dst)
 		goto out;
 	}
 
-	buf = malloc(512);
-	if (!buf) {
-		printf("Can't allocate buffer to copy file\n");
+	if (fstat(fd_src, &sbuf) < 0) {
+		printf("Can't stat file %s (%s)\n", src, strerror(errno));
 		goto out;
 	}
 
-	while (1) {
-		size = read(fd_src, buf, 512);
-		if (size < 0) {
-			printf("Can't read file %s\n", src);
+	if (sbuf.st_size) {
+		buf = mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, fd_src,
+			   0);
+		if (buf == MAP_FAILED) {
+			printf("Can't map file %s (%s)\n", src,
+			       strerror(errno));
 			goto out;
 		}
-		if (!size)
-			break;
+	}
 
-		count = size;
-		size = write(fd_dst, buf, count);
+	while (count < sbuf.st_size) {
+		size = write(fd_dst, buf + count, sbuf.st_size - count);
 		if (size < 0) {
 			printf("Can't write file %s\n", dst);
 			goto out;
 		}
+		count += size;
 	}
 
 	ret = 0;
 
  out:
+	if (buf != MAP_FAILED)
+		munmap(buf, sbuf.st_size);
 	if (fd_src >= 0)
 		close(fd_src);
 	if (fd_dst >= 0)
 		close(fd_dst);
-	if (buf)
-		free(buf);
 
 	return ret;
 }
@@ -701,6 +725,7 @@ static int fit_handle_file(struct image_tool_params *params)
 	char tmpfile[MKIMAGE_MAX_TMPFILE_LEN];
 	char bakfile[MKIMAGE_MAX_TMPFILE_LEN + 4] = {0};
 	char cmd[MKIMAGE_MAX_DTC_CMDLINE_LEN];
+	struct timeval start, end;
 	size_t size_inc;
 	int ret;
 
@@ -762,8 +787,10 @@ static int fit_handle_file(struct image_tool_params *params)
 	 * calculate the signature every time. It would be better to calculate
 	 * all the data and then store it in a separate step. However, this
 	 * would be considerably more complex to implement. Generally a few
-	 * steps of this loop is enough to sign with several keys.
+	 * steps of this loop is enough to sign with several keys. Image hash
+	 * values are only calculated once, see fit_precalc_hashes().
 	 */
+	gettimeofday(&start, NULL);
 	for (size_inc = 0; size_inc < 64 * 1024; size_inc += 1024) {
 		if (copyfile(bakfile, tmpfile) < 0) {
 			printf("Can't copy %s to %s\n", bakfile, tmpfile);
@@ -774,6 +801,15 @@ static int fit_handle_file(struct image_tool_params *params)
 		if (!ret || ret != -ENOSPC)
 			break;
 	}
+	fit_free_precalc_hashes();
+	gettimeofday(&end, NULL);
+
+	if (params->vflag) {
+		printf("Hashes/signatures added in %ld ms (%d jobs, %zu KiB extra space)\n",
+		       (end.tv_sec - start.tv_sec) * 1000 +
+		       (end.tv_usec - start.tv_usec) / 1000,
+		       params->jobs, size_inc / 1024);
+	}
 
 	if (ret) {
 		fprintf(stderr, "%s Can't add hashes to FIT blob: %d\n",
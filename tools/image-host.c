@@ -11,8 +11,49 @@
 #include "mkimage.h"
 #include <bootm.h>
 #include <image.h>
+#include <pthread.h>
 #include <version.h>
 
+/**
+ * struct fit_hash_entry - hash value of an image, calculated ahead
+ *
+ * @image_name:	Name of the image node
+ * @node_name:	Name of the hash node
+ * @algo:	Hash algorithm
+ * @data:	Image data, only valid within fit_precalc_hashes()
+ * @size:	Size of image data in bytes
+ * @value:	Hash value
+ * @value_len:	Length of hash value, 0 if not calculated
+ */
+struct fit_hash_entry {
+	char *image_name;
+	char *node_name;
+	char *algo;
+	const void *data;
+	size_t size;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+};
+
+static struct fit_hash_entry *fit_hash_cache;
+static int fit_hash_count;
+
+static struct fit_hash_entry *fit_hash_find(const char *image_name,
+					    const char *node_name)
+{
+	int i;
+
+	for (i = 0; i < fit_hash_count; i++) {
+		struct fit_hash_entry *entry = &fit_hash_cache[i];
+
+		if (!strcmp(entry->image_name, image_name) &&
+		    !strcmp(entry->node_name, node_name))
+			return entry;
+	}
+
+	return NULL;
+}
+
 /**
  * fit_set_hash_value - set hash value in requested has node
  * @fit: pointer to the FIT format image header
@@ -59,6 +100,7 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
 static int fit_image_process_hash(void *fit, const char *image_name,
 		int noffset, const void *data, size_t size)
 {
+	struct fit_hash_entry *entry;
 	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
 	int value_len;
@@ -73,7 +115,12 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	entry = fit_hash_find(image_name, node_name);
+	if (entry && entry->value_len && entry->size == size &&
+	    !strcmp(entry->algo, algo)) {
+		value_len = entry->value_len;
+		memcpy(value, entry->value, value_len);
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		printf("Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 		       algo, node_name, image_name);
 		return -EPROTONOSUPPORT;
@@ -966,6 +1013,191 @@ int fit_cipher_data(const char *keydir, void *keydest, void *fit,
 	return 0;
 }
 
+/* Work shared by the threads of fit_precalc_hashes() */
+struct fit_hash_pool {
+	pthread_mutex_t lock;
+	struct fit_hash_entry **entry;
+	int count;
+	int next;
+};
+
+static void *fit_hash_worker(void *arg)
+{
+	struct fit_hash_pool *pool = arg;
+	struct fit_hash_entry *entry;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+		entry = pool->next < pool->count ? pool->entry[pool->next++] :
+			NULL;
+		pthread_mutex_unlock(&pool->lock);
+		if (!entry)
+			break;
+
+		/* Failures are reported by fit_image_process_hash() */
+		if (calculate_hash(entry->data, entry->size, entry->algo,
+				   entry->value, &entry->value_len))
+			entry->value_len = 0;
+	}
+
+	return NULL;
+}
+
+static struct fit_hash_entry *fit_hash_add(const char *image_name,
+					   const char *node_name)
+{
+	struct fit_hash_entry *cache, *entry;
+
+	cache = realloc(fit_hash_cache, (fit_hash_count + 1) * sizeof(*cache));
+	if (!cache)
+		return NULL;
+	fit_hash_cache = cache;
+
+	entry = &cache[fit_hash_count];
+	memset(entry, '\0', sizeof(*entry));
+	entry->image_name = strdup(image_name);
+	entry->node_name = strdup(node_name);
+	entry->algo = strdup("");
+	if (!entry->image_name || !entry->node_name || !entry->algo) {
+		free(entry->image_name);
+		free(entry->node_name);
+		free(entry->algo);
+		return NULL;
+	}
+	fit_hash_count++;
+
+	return entry;
+}
+
+/* Collect the hash nodes of an image whose value must be calculated */
+static int fit_hash_collect(void *fit, int image_noffset,
+			    struct fit_hash_entry **pending, int *count)
+{
+	struct fit_hash_entry *entry;
+	const char *image_name;
+	const void *data;
+	bool ciphered;
+	size_t size;
+	int noffset;
+
+	if (fit_image_get_data(fit, image_noffset, &data, &size))
+		return 0;
+
+	image_name = fit_get_name(fit, image_noffset, NULL);
+	ciphered = fdt_subnode_offset(fit, image_noffset,
+				      FIT_CIPHER_NODENAME) >= 0;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *node_name = fit_get_name(fit, noffset, NULL);
+		char *algo;
+
+		if (strncmp(node_name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)) ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			continue;
+
+		entry = fit_hash_find(image_name, node_name);
+		if (!entry) {
+			entry = fit_hash_add(image_name, node_name);
+			if (!entry)
+				return -ENOMEM;
+		}
+
+		/*
+		 * Data of ciphered images is encrypted again on each call and
+		 * may change, so only reuse plain values.
+		 */
+		if (entry->value_len && !ciphered && entry->size == size &&
+		    !strcmp(entry->algo, algo))
+			continue;
+
+		free(entry->algo);
+		entry->algo = strdup(algo);
+		if (!entry->algo)
+			return -ENOMEM;
+		entry->data = data;
+		entry->size = size;
+		entry->value_len = 0;
+		pending[(*count)++] = entry;
+	}
+
+	return 0;
+}
+
+int fit_precalc_hashes(void *fit, int jobs)
+{
+	struct fit_hash_pool pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
+	pthread_t *threads;
+	int images_noffset;
+	int noffset, depth;
+	int max_count = 0;
+	int i, ret = 0;
+
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0)
+		return 0;
+
+	/* Each hash node below the images may need one slot */
+	for (noffset = images_noffset, depth = 0;
+	     noffset >= 0 && depth >= 0;
+	     noffset = fdt_next_node(fit, noffset, &depth))
+		max_count++;
+
+	pool.entry = calloc(max_count, sizeof(*pool.entry));
+	if (!pool.entry)
+		return -ENOMEM;
+
+	fdt_for_each_subnode(noffset, fit, images_noffset) {
+		ret = fit_hash_collect(fit, noffset, pool.entry, &pool.count);
+		if (ret)
+			goto out;
+	}
+
+	if (jobs > pool.count)
+		jobs = pool.count;
+	if (jobs <= 1) {
+		fit_hash_worker(&pool);
+		goto out;
+	}
+
+	/* This thread is one of the jobs */
+	threads = calloc(jobs - 1, sizeof(*threads));
+	if (!threads) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < jobs - 1; i++) {
+		if (pthread_create(&threads[i], NULL, fit_hash_worker, &pool))
+			break;
+	}
+	fit_hash_worker(&pool);
+	while (i--)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+out:
+	for (i = 0; i < pool.count; i++)
+		pool.entry[i]->data = NULL;
+	free(pool.entry);
+
+	return ret;
+}
+
+void fit_free_precalc_hashes(void)
+{
+	int i;
+
+	for (i = 0; i < fit_hash_count; i++) {
+		free(fit_hash_cache[i].image_name);
+		free(fit_hash_cache[i].node_name);
+		free(fit_hash_cache[i].algo);
+	}
+	free(fit_hash_cache);
+	fit_hash_cache = NULL;
+	fit_hash_count = 0;
+}
+
 int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *comment, int require_keys,
 			      const char *engine_id, const char *cmdname)
@@ -77,6 +77,8 @@ struct image_tool_params {
 	bool quiet;		/* Don't output text in normal operation */
 	unsigned int external_offset;	/* Add padding to external data */
 	const char *engine_id;	/* Engine to use for signing */
+	int jobs;		/* Number of threads to hash images with */
+	unsigned int bl_len;	/* Alignment of external data, 0 for none */
 };
 
 /*
@@ -22,6 +22,7 @@
 #include <sys/mman.h>
 
 #include "compiler.h"
+#include <env_bin.h>
 #include <u-boot/crc.h>
 #include <version.h>
 
@@ -29,7 +30,7 @@
 
 static void usage(const char *exec_name)
 {
-	fprintf(stderr, "%s [-h] [-r] [-b] [-p <byte>] -s <environment partition size> -o <output> <input file>\n"
+	fprintf(stderr, "%s [-h] [-r] [-b] [-B] [-p <byte>] -s <environment partition size> -o <output> <input file>\n"
 	       "\n"
 	       "This tool takes a key=value input file (same as would a `printenv' show) and generates the corresponding environment image, ready to be flashed.\n"
 	       "\n"
@@ -41,6 +42,7 @@ static void usage(const char *exec_name)
 	       "\tcolumn are treated as comments (also skipped).\n"
 	       "\t-r : the environment has multiple copies in flash\n"
 	       "\t-b : the target is big endian (default is little endian)\n"
+	       "\t-B : write the environment in binary format (needs CONFIG_ENV_BINARY)\n"
 	       "\t-p <byte> : fill the image with <byte> bytes instead of 0xff bytes\n"
 	       "\t-V : print version information and exit\n"
 	       "\n"
@@ -68,6 +70,98 @@ long int xstrtol(const char *s)
 
 #define CHUNK_SIZE 4096
 
+static uint32_t target32(uint32_t val, int bigendian)
+{
+	return bigendian ? cpu_to_be32(val) : cpu_to_le32(val);
+}
+
+static uint16_t target16(uint16_t val, int bigendian)
+{
+	return bigendian ? cpu_to_be16(val) : cpu_to_le16(val);
+}
+
+/*
+ * Convert a list of '\0'-terminated "name=value" strings into the binary
+ * format described in env_bin.h, following the same parsing rules as
+ * himport_r(). Returns the number of bytes written to out, or -1 if it does
+ * not fit.
+ */
+static int env_to_bin(const unsigned char *env, unsigned char *out,
+		      unsigned int outsize, int bigendian)
+{
+	const char *dp = (const char *)env;
+	struct env_bin_hdr hdr;
+	struct env_bin_rec rec;
+	unsigned int len = sizeof(hdr), count = 0;
+	const char *name;
+	char *value;
+
+	while (*dp) {
+		unsigned int name_len, value_len = 0, flags = 0;
+		size_t size;
+
+		while (*dp == ' ' || *dp == '\t')
+			dp++;
+		if (*dp == '#' || !*dp) {
+			dp += strlen(dp) + 1;
+			continue;
+		}
+
+		name = dp;
+		name_len = strcspn(name, "=");
+		if (!name_len) {
+			fprintf(stderr, "Variable with an empty name\n");
+			exit(EXIT_FAILURE);
+		}
+		dp += name_len;
+		if (*dp != '=' || !dp[1]) {
+			flags = ENV_BIN_DELETE;
+		} else {
+			/* Reserve room to unescape the value into */
+			dp++;
+			value_len = strlen(dp);
+		}
+
+		size = env_bin_rec_size(name_len, value_len);
+		if (len + size > outsize)
+			return -1;
+		value = (char *)out + len + sizeof(rec) + name_len + 1;
+		memset(out + len + sizeof(rec), '\0', size - sizeof(rec));
+		memcpy(out + len + sizeof(rec), name, name_len);
+
+		/* Deal with escapes as himport_r() does */
+		value_len = 0;
+		for (; *dp; dp++) {
+			if (flags)
+				continue;
+			if (*dp == '\\' && dp[1])
+				dp++;
+			value[value_len++] = *dp;
+		}
+		dp++;
+
+		rec.hash = target32(env_bin_hash(name, name_len), bigendian);
+		rec.name_len = target16(name_len, bigendian);
+		rec.flags = target16(flags, bigendian);
+		rec.value_len = target32(value_len, bigendian);
+		memcpy(out + len, &rec, sizeof(rec));
+		len += env_bin_rec_size(name_len, value_len);
+		count++;
+	}
+
+	memset(&hdr, '\0', sizeof(hdr));
+	hdr.magic = target32(ENV_BIN_MAGIC, bigendian);
+	hdr.version = ENV_BIN_VERSION;
+	hdr.hdr_size = sizeof(hdr);
+	hdr.count = target32(count, bigendian);
+	hdr.size = target32(len - sizeof(hdr), bigendian);
+	hdr.crc = target32(crc32(0, out + sizeof(hdr), len - sizeof(hdr)),
+			   bigendian);
+	memcpy(out, &hdr, sizeof(hdr));
+
+	return len;
+}
+
 int main(int argc, char **argv)
 {
 	uint32_t crc, targetendian_crc;
@@ -77,6 +171,7 @@ int main(int argc, char **argv)
 	unsigned char *filebuf = NULL;
 	unsigned int filesize = 0, envsize = 0, datasize = 0;
 	int bigendian = 0;
+	int binary = 0;
 	int redundant = 0;
 	unsigned char padbyte = 0xff;
 	int readbytes = 0;
@@ -93,7 +188,7 @@ int main(int argc, char **argv)
 	opterr = 0;
 
 	/* Parse the cmdline */
-	while ((option = getopt(argc, argv, ":s:o:rbp:hV")) != -1) {
+	while ((option = getopt(argc, argv, ":s:o:rbBp:hV")) != -1) {
 		switch (option) {
 		case 's':
 			datasize = xstrtol(optarg);
@@ -111,6 +206,9 @@ int main(int argc, char **argv)
 		case 'b':
 			bigendian = 1;
 			break;
+		case 'B':
+			binary = 1;
+			break;
 		case 'p':
 			padbyte = xstrtol(optarg);
 			break;
@@ -254,6 +352,25 @@ int main(int argc, char **argv)
 		envptr[ep] = '\0';
 	}
 
+	if (binary) {
+		unsigned char *binptr = malloc(envsize);
+		int len;
+
+		if (!binptr) {
+			fprintf(stderr, "Can't alloc %d bytes for binptr.\n",
+				envsize);
+			return EXIT_FAILURE;
+		}
+		len = env_to_bin(envptr, binptr, envsize, bigendian);
+		if (len < 0) {
+			fprintf(stderr, "The environment file is too large for the target environment storage\n");
+			return EXIT_FAILURE;
+		}
+		memset(envptr, padbyte, envsize);
+		memcpy(envptr, binptr, len);
+		free(binptr);
+	}
+
 	/* Computes the CRC and put it at the beginning of the data */
 	crc = crc32(0, envptr, envsize);
 	targetendian_crc = bigendian ? cpu_to_be32(crc) : cpu_to_le32(crc);